@@ -0,0 +1,329 @@
+#include "admission.h"
+#include "client_stats.h"
+#include "client_table.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "fleet_sync.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "Admission";
+
+static admission_config_t config = {
+    .policy = ADMISSION_POLICY_UNAPPROVED_FIRST,
+    .reserve = 1,
+    .idle_s = 900,
+    .grace_s = 180,
+};
+static admission_status_t status;
+static admission_station_t stations[ADMISSION_MAX_STATIONS];
+static size_t station_count = 0;
+static SemaphoreHandle_t state_mutex = NULL;
+static TaskHandle_t check_task_handle = NULL;
+
+static client_stats_t stats_buf[CLIENT_STATS_MAX_TRACKED];   // Check task only
+static uint8_t steered_macs[ADMISSION_STEER_MEMORY][6];       // Check task only
+static size_t steered_next = 0;
+
+static const char *policy_names[] = {
+    [ADMISSION_POLICY_OFF] = "off",
+    [ADMISSION_POLICY_IDLE] = "idle",
+    [ADMISSION_POLICY_UNAPPROVED_FIRST] = "unapproved_first",
+};
+
+// Same clock as client_table's join and request stamps
+static uint32_t now_s(void)
+{
+    return (uint32_t)((xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+}
+
+static bool config_valid(const admission_config_t *cfg)
+{
+    return cfg->policy <= ADMISSION_POLICY_UNAPPROVED_FIRST &&
+           cfg->reserve >= 1 && cfg->reserve <= 4 &&
+           cfg->idle_s >= 60 && cfg->idle_s <= 7200 &&
+           cfg->grace_s >= 30 && cfg->grace_s <= 3600;
+}
+
+static esp_err_t save_config(const admission_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u8(nvs, "adm_policy", (uint8_t)cfg->policy);
+    nvs_set_u8(nvs, "adm_reserve", cfg->reserve);
+    nvs_set_u16(nvs, "adm_idle", cfg->idle_s);
+    nvs_set_u16(nvs, "adm_grace", cfg->grace_s);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+static void load_config(void)
+{
+    admission_config_t cfg = config;
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        uint8_t policy = (uint8_t)cfg.policy;
+        nvs_get_u8(nvs, "adm_policy", &policy);
+        nvs_get_u8(nvs, "adm_reserve", &cfg.reserve);
+        nvs_get_u16(nvs, "adm_idle", &cfg.idle_s);
+        nvs_get_u16(nvs, "adm_grace", &cfg.grace_s);
+        nvs_close(nvs);
+        cfg.policy = (admission_policy_t)policy;
+    }
+    if (config_valid(&cfg)) {
+        config = cfg;
+    }
+}
+
+// Fill in one associated station from the client table and forward-path counters
+static void describe(admission_station_t *s, const admission_config_t *cfg, size_t nstats, uint32_t now)
+{
+    uint32_t last = now;   // Unknown to the table: treat as just joined
+    client_entry_t e;
+    if (client_table_find_mac(s->mac, &e)) {
+        uint32_t joined = e.joined_at ? e.joined_at : now;
+        s->ip = e.ip;
+        s->approved = e.approved;
+        s->connected_s = now >= joined ? now - joined : 0;
+        last = joined;
+        if (e.last_request > last) {
+            last = e.last_request;
+        }
+        for (size_t i = 0; i < nstats && e.ip != 0; i++) {
+            if (stats_buf[i].ip == e.ip && stats_buf[i].idle_s < now && now - stats_buf[i].idle_s > last) {
+                last = now - stats_buf[i].idle_s;
+            }
+        }
+    }
+    s->idle_s = now >= last ? now - last : 0;
+    s->evictable = s->idle_s >= (s->approved ? cfg->idle_s : cfg->grace_s);
+}
+
+// Most idle eligible station, never-approved ones first if the policy says so
+static int pick_victim(const admission_station_t *list, size_t n, const bool *taken, admission_policy_t policy)
+{
+    int victim = -1;
+    for (size_t i = 0; i < n; i++) {
+        if (!list[i].evictable || taken[i]) {
+            continue;
+        }
+        if (victim < 0 ||
+            (policy == ADMISSION_POLICY_UNAPPROVED_FIRST && !list[i].approved && list[victim].approved)) {
+            victim = (int)i;   // List is sorted most idle first
+        }
+    }
+    return victim;
+}
+
+static bool was_steered(const uint8_t mac[6])
+{
+    for (int i = 0; i < ADMISSION_STEER_MEMORY; i++) {
+        if (memcmp(steered_macs[i], mac, 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Newest never-approved station that joined moments ago and hasn't been steered before
+static int pick_steer(const admission_station_t *list, size_t n, const bool *taken)
+{
+    int pick = -1;
+    for (size_t i = 0; i < n; i++) {
+        if (taken[i] || list[i].approved || list[i].connected_s >= ADMISSION_STEER_WINDOW_S ||
+            was_steered(list[i].mac)) {
+            continue;
+        }
+        if (pick < 0 || list[i].connected_s < list[pick].connected_s) {
+            pick = (int)i;
+        }
+    }
+    return pick;
+}
+
+static void check(void)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    admission_config_t cfg = config;
+    uint8_t max_stations = status.max_stations;
+    xSemaphoreGive(state_mutex);
+
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK) {
+        list.num = 0;   // AP not running
+    }
+    size_t nstats = client_stats_snapshot(stats_buf, CLIENT_STATS_MAX_TRACKED);
+    uint32_t now = now_s();
+
+    admission_station_t seen[ADMISSION_MAX_STATIONS];
+    size_t n = 0;
+    for (int i = 0; i < list.num && n < ADMISSION_MAX_STATIONS; i++) {
+        admission_station_t s = {0};
+        memcpy(s.mac, list.sta[i].mac, sizeof(s.mac));
+        describe(&s, &cfg, nstats, now);
+
+        // Insertion sort, most idle first
+        size_t at = n++;
+        while (at > 0 && seen[at - 1].idle_s < s.idle_s) {
+            seen[at] = seen[at - 1];
+            at--;
+        }
+        seen[at] = s;
+    }
+
+    // Free slots up to the reserve, one station at a time
+    bool taken[ADMISSION_MAX_STATIONS] = {0};
+    int free_slots = (int)max_stations - list.num;
+    while (cfg.policy != ADMISSION_POLICY_OFF && free_slots < cfg.reserve) {
+        int v = pick_victim(seen, n, taken, cfg.policy);
+        if (v < 0) {
+            break;   // Everyone is in use - newcomers wait
+        }
+        taken[v] = true;
+        uint16_t aid = 0;
+        if (esp_wifi_ap_get_sta_aid(seen[v].mac, &aid) != ESP_OK || esp_wifi_deauth_sta(aid) != ESP_OK) {
+            continue;
+        }
+        free_slots++;
+        ESP_LOGI(TAG, "✓ Freed a slot: disconnected " MACSTR " (%s, idle %lus)", MAC2STR(seen[v].mac),
+                 seen[v].approved ? "approved" : "never approved", (unsigned long)seen[v].idle_s);
+
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        if (seen[v].approved) {
+            status.evicted_idle++;
+        } else {
+            status.evicted_unapproved++;
+        }
+        memcpy(status.last_mac, seen[v].mac, sizeof(status.last_mac));
+        status.last_at = now;
+        xSemaphoreGive(state_mutex);
+    }
+
+    // Full here while a peer stick has room: send the newest arrival on its
+    // way before it settles in. Its next scan finds the emptier AP
+    if (cfg.policy != ADMISSION_POLICY_OFF && free_slots <= cfg.reserve &&
+        fleet_sync_peer_has_room(free_slots)) {
+        int s = pick_steer(seen, n, taken);
+        uint16_t aid = 0;
+        if (s >= 0 && esp_wifi_ap_get_sta_aid(seen[s].mac, &aid) == ESP_OK && esp_wifi_deauth_sta(aid) == ESP_OK) {
+            taken[s] = true;
+            memcpy(steered_macs[steered_next], seen[s].mac, 6);
+            steered_next = (steered_next + 1) % ADMISSION_STEER_MEMORY;
+            ESP_LOGI(TAG, "✓ Steered " MACSTR " to a peer with room", MAC2STR(seen[s].mac));
+
+            xSemaphoreTake(state_mutex, portMAX_DELAY);
+            status.steered++;
+            memcpy(status.last_mac, seen[s].mac, sizeof(status.last_mac));
+            status.last_at = now;
+            xSemaphoreGive(state_mutex);
+        }
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    station_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!taken[i]) {
+            stations[station_count++] = seen[i];
+        }
+    }
+    status.stations = (uint8_t)station_count;
+    xSemaphoreGive(state_mutex);
+}
+
+static void check_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ADMISSION_PERIOD_S * 1000));
+        check();
+    }
+}
+
+esp_err_t admission_init(uint8_t max_stations)
+{
+    if (state_mutex) {
+        return ESP_OK;
+    }
+    state_mutex = xSemaphoreCreateMutex();
+    if (!state_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    load_config();
+    status.max_stations = max_stations;
+
+    if (xTaskCreate(check_task, "admission", 3072, NULL, 3, &check_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ Admission control: %s, %d slot(s) kept free of %d", policy_names[config.policy],
+             config.reserve, max_stations);
+    return ESP_OK;
+}
+
+void admission_station_joined(void)
+{
+    if (check_task_handle) {
+        xTaskNotifyGive(check_task_handle);
+    }
+}
+
+esp_err_t admission_set_config(const admission_config_t *cfg, bool persist)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    config = *cfg;
+    xSemaphoreGive(state_mutex);
+
+    admission_station_joined();   // Apply the new limits right away
+    return persist ? save_config(cfg) : ESP_OK;
+}
+
+void admission_get_config(admission_config_t *cfg)
+{
+    if (!state_mutex) {
+        *cfg = config;
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(state_mutex);
+}
+
+void admission_get_status(admission_status_t *out)
+{
+    if (!state_mutex) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *out = status;
+    xSemaphoreGive(state_mutex);
+}
+
+size_t admission_list(admission_station_t *out, size_t max)
+{
+    if (!state_mutex) {
+        return 0;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    size_t n = station_count < max ? station_count : max;
+    memcpy(out, stations, n * sizeof(out[0]));
+    xSemaphoreGive(state_mutex);
+    return n;
+}
+
+const char *admission_policy_name(admission_policy_t policy)
+{
+    return policy <= ADMISSION_POLICY_UNAPPROVED_FIRST ? policy_names[policy] : "?";
+}
@@ -0,0 +1,79 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// How often the AP's station list is checked (a join also triggers a check)
+#define ADMISSION_PERIOD_S 10
+
+// Stations shown by admission_list (the driver allows at most 10 associated)
+#define ADMISSION_MAX_STATIONS 16
+
+// With fleet steering, a never-approved station this fresh may be turned away
+// while a peer stick has room; a phone is steered at most once
+#define ADMISSION_STEER_WINDOW_S 15
+#define ADMISSION_STEER_MEMORY   16
+
+typedef enum {
+    ADMISSION_POLICY_OFF = 0,          // Track only, never disconnect anyone
+    ADMISSION_POLICY_IDLE,             // Longest idle first
+    ADMISSION_POLICY_UNAPPROVED_FIRST, // Stations that never tapped Connect go first
+} admission_policy_t;
+
+// A station is idle since max(join, last DNS/HTTP request, last forwarded packet).
+// It may be disconnected once idle past its grace, and only while the AP has
+// fewer than `reserve` free slots
+typedef struct {
+    admission_policy_t policy;
+    uint8_t reserve;       // Slots to keep free for newcomers, 1..4
+    uint16_t idle_s;       // Grace for approved stations, 60..7200
+    uint16_t grace_s;      // Grace for never-approved stations, 30..3600
+} admission_config_t;
+
+// One associated station as the admission manager sees it
+typedef struct {
+    uint8_t mac[6];
+    uint32_t ip;           // Network byte order, 0 = no lease yet
+    bool approved;
+    uint32_t connected_s;  // Since this association
+    uint32_t idle_s;
+    bool evictable;        // Past its grace period
+} admission_station_t;
+
+typedef struct {
+    uint8_t stations;      // Associated at the last check
+    uint8_t max_stations;
+    uint32_t evicted_idle;
+    uint32_t evicted_unapproved;
+    uint32_t steered;      // Newcomers turned away to a peer with room
+    uint8_t last_mac[6];   // Last station disconnected
+    uint32_t last_at;      // Uptime seconds of that, 0 = never
+} admission_status_t;
+
+/**
+ * Load the policy from NVS and start the check task
+ * max_stations is the AP's max_connection
+ */
+esp_err_t admission_init(uint8_t max_stations);
+
+/**
+ * A station just associated - check capacity now rather than at the next period
+ */
+void admission_station_joined(void);
+
+esp_err_t admission_set_config(const admission_config_t *config, bool persist);
+void admission_get_config(admission_config_t *config);
+void admission_get_status(admission_status_t *status);
+
+/**
+ * Copy the associated stations as of the last check, most idle first
+ * Returns the number of entries written
+ */
+size_t admission_list(admission_station_t *out, size_t max);
+
+const char *admission_policy_name(admission_policy_t policy);
+
+#endif // ADMISSION_H
@@ -0,0 +1,237 @@
+#include "ap_forward.h"
+#include "ap_forward_hooks.h"
+#include "client_stats.h"
+#include "dns_server.h"
+#include "mss_clamp.h"
+#include "napt_monitor.h"
+#include "pcap_ring.h"
+#include "shaper.h"
+#include "esp_log.h"
+#include "lwip/icmp.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip4.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/icmp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+
+static const char *TAG = "APForward";
+
+// Both hooks run on the tcpip thread; these are only written there too
+static struct netif *ap_netif = NULL;
+static netif_output_fn ap_output = NULL;   // Output function we wrapped (etharp_output)
+static bool reinjecting = false;           // Shaper releasing a held uplink packet into ip4_input
+static bool shaper_timer_armed = false;
+
+// Client address (local) on the AP subnet talking to something beyond it (remote)
+static inline bool is_forwarded(const struct netif *netif, uint32_t local, uint32_t remote)
+{
+    uint32_t mask = ip4_addr_get_u32(netif_ip4_netmask(netif));
+    uint32_t subnet = ip4_addr_get_u32(netif_ip4_addr(netif)) & mask;
+    ip4_addr_t remote_addr = { .addr = remote };
+
+    return (local & mask) == subnet &&
+           local != ip4_addr_get_u32(netif_ip4_addr(netif)) &&
+           (remote & mask) != subnet &&
+           remote != IPADDR_BROADCAST &&
+           !ip4_addr_ismulticast(&remote_addr);
+}
+
+static void shaper_release(void *pkt, int dir, uint8_t octet, void *ctx)
+{
+    struct pbuf *p = (struct pbuf *)pkt;
+
+    if (dir == SHAPER_DIR_UP) {
+        client_stats_uplink(octet, p->tot_len);
+        napt_monitor_outbound(p->payload, p->len);
+        reinjecting = true;
+        ip4_input(p, ap_netif);   // Takes ownership
+        reinjecting = false;
+    } else {
+        // Downlink next hop is the client itself (on-link)
+        const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+        ip4_addr_t next_hop = { .addr = iphdr->dest.addr };
+        client_stats_downlink(octet, p->tot_len);
+        napt_monitor_inbound(p->payload, p->len);
+        ap_output(ap_netif, p, &next_hop);
+        pbuf_free(p);
+    }
+}
+
+// Queue a private copy: the original may sit in one of the Wi-Fi driver's
+// few RX buffers, which a throttled client must not tie up. Headroom for the
+// link header etharp prepends on the way down
+static void *shaper_hold(void *pkt)
+{
+    return pbuf_clone(PBUF_LINK, PBUF_RAM, (struct pbuf *)pkt);
+}
+
+static void shaper_timer(void *arg)
+{
+    shaper_timer_armed = shaper_run(sys_now(), shaper_release, NULL);
+    if (shaper_timer_armed) {
+        sys_timeout(SHAPER_TICK_MS, shaper_timer, NULL);
+    }
+}
+
+static void shaper_timer_arm(void)
+{
+    if (!shaper_timer_armed) {
+        shaper_timer_armed = true;
+        sys_timeout(SHAPER_TICK_MS, shaper_timer, NULL);
+    }
+}
+
+// Answer an oversized DF packet from a client with frag-needed carrying the
+// uplink MTU. lwIP's own reply (ip4_forward) leaves the MTU field zero, and
+// only fires when the STA interface itself is smaller
+static void send_frag_needed(struct pbuf *p, struct netif *netif, uint16_t mtu)
+{
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+    u16_t quote = IPH_HL_BYTES(iphdr) + 8;   // Offending header plus 8 bytes (RFC 792)
+    if (quote > p->tot_len) {
+        quote = p->tot_len;
+    }
+
+    struct pbuf *q = pbuf_alloc(PBUF_IP, sizeof(struct icmp_echo_hdr) + quote, PBUF_RAM);
+    if (!q) {
+        return;
+    }
+    struct icmp_echo_hdr *icmp = (struct icmp_echo_hdr *)q->payload;
+    ICMPH_TYPE_SET(icmp, ICMP_DUR);
+    ICMPH_CODE_SET(icmp, ICMP_DUR_FRAG);
+    icmp->id = 0;
+    icmp->seqno = lwip_htons(mtu);   // Next-hop MTU (RFC 1191)
+    pbuf_copy_partial(p, (u8_t *)q->payload + sizeof(struct icmp_echo_hdr), quote, 0);
+    icmp->chksum = 0;
+    icmp->chksum = inet_chksum(icmp, q->len);
+
+    ip4_addr_t dest = { .addr = iphdr->src.addr };
+    ip4_output_if(q, netif_ip4_addr(netif), &dest, ICMP_TTL, 0, IP_PROTO_ICMP, netif);
+    pbuf_free(q);
+}
+
+int ap_forward_ip4_input(struct pbuf *p, struct netif *inp)
+{
+    if (reinjecting || p->len < IP_HLEN) {
+        return 0;
+    }
+    if (inp != ap_netif) {
+        // Frag-needed from routers beyond the uplink lowers the clamp for new
+        // flows to that host, if it quotes a flow we are actually forwarding
+        if (ap_netif && IPH_PROTO((const struct ip_hdr *)p->payload) == IP_PROTO_ICMP) {
+            mss_clamp_icmp(p->payload, p->len, ip4_addr_get_u32(netif_ip4_addr(inp)), napt_monitor_has_remote);
+        }
+        return 0;
+    }
+
+    // Captured as received, before the gate or shaper can drop it
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+    uint32_t src = iphdr->src.addr;
+    uint8_t octet = ((const uint8_t *)&src)[3];
+    pcap_ring_record(p->payload, p->len, p->tot_len, octet, PCAP_DIR_UP);
+
+    if (!is_forwarded(inp, src, iphdr->dest.addr)) {
+        return 0;
+    }
+
+    // Unapproved clients only reach the AP itself (DHCP, DNS proxy, portal),
+    // which is_forwarded() already let through
+    if (!dns_client_may_forward(octet)) {
+        pbuf_free(p);
+        return 1;
+    }
+
+    // Fit the uplink's path MTU: clamp the MSS of new flows, and turn back DF
+    // packets that would be black-holed further on
+    ip4_addr_t dest = { .addr = iphdr->dest.addr };
+    struct netif *out = ip4_route(&dest);
+    uint16_t mtu = mss_clamp_path_mtu(out && out != inp ? out->mtu : 0, dest.addr);
+    if (mtu) {
+        if (mss_clamp_too_big(p->payload, p->len, p->tot_len, mtu)) {
+            send_frag_needed(p, inp, mtu);
+            pbuf_free(p);
+            return 1;
+        }
+        mss_clamp_syn(p->payload, p->len, MSS_CLAMP_DIR_UP, mtu);
+    }
+
+    switch (shaper_admit(SHAPER_DIR_UP, octet, p, p->tot_len, sys_now(), shaper_hold)) {
+    case SHAPER_QUEUED:
+        pbuf_free(p);   // A copy is held; re-injected by shaper_release
+        shaper_timer_arm();
+        return 1;
+    case SHAPER_DROP:
+        pbuf_free(p);
+        return 1;
+    default:
+        client_stats_uplink(octet, p->tot_len);
+        napt_monitor_outbound(p->payload, p->len);
+        return 0;
+    }
+}
+
+static err_t ap_forward_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+    if (p->len < IP_HLEN) {
+        return ap_output(netif, p, ipaddr);
+    }
+
+    const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+    uint32_t dst = iphdr->dest.addr;
+    uint8_t octet = ((const uint8_t *)&dst)[3];
+    pcap_ring_record(p->payload, p->len, p->tot_len, octet, PCAP_DIR_DOWN);
+
+    if (!is_forwarded(netif, dst, iphdr->src.addr)) {
+        return ap_output(netif, p, ipaddr);
+    }
+
+    // The client's SYN was clamped on the way out; do the server's SYN-ACK too
+    uint16_t mtu = mss_clamp_path_mtu(0, iphdr->src.addr);
+    if (mtu) {
+        mss_clamp_syn(p->payload, p->len, MSS_CLAMP_DIR_DOWN, mtu);
+    }
+
+    switch (shaper_admit(SHAPER_DIR_DOWN, octet, p, p->tot_len, sys_now(), shaper_hold)) {
+    case SHAPER_QUEUED:
+        shaper_timer_arm();   // A copy is held; the caller frees the original
+        return ERR_OK;
+    case SHAPER_DROP:
+        return ERR_OK;   // Dropped like a full Wi-Fi TX queue would
+    default:
+        client_stats_downlink(octet, p->tot_len);
+        napt_monitor_inbound(p->payload, p->len);
+        return ap_output(netif, p, ipaddr);
+    }
+}
+
+static void attach_on_tcpip(void *ctx)
+{
+    struct netif *netif = (struct netif *)ctx;
+
+    if (netif->output != ap_forward_output) {
+        ap_output = netif->output;
+        netif->output = ap_forward_output;
+    }
+    ap_netif = netif;
+}
+
+esp_err_t ap_forward_attach(esp_netif_t *esp_netif)
+{
+    struct netif *netif = (struct netif *)esp_netif_get_netif_impl(esp_netif);
+    if (!netif) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (tcpip_callback(attach_on_tcpip, netif) != ERR_OK) {
+        ESP_LOGE(TAG, "Failed to queue attach on tcpip thread");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✓ Forward path tapped on AP netif");
+    return ESP_OK;
+}
@@ -0,0 +1,17 @@
+#ifndef AP_FORWARD_H
+#define AP_FORWARD_H
+
+#include "esp_err.h"
+#include "esp_netif.h"
+
+/**
+ * Tap the AP interface's forward path (approval gate, accounting, shaping,
+ * MSS clamping)
+ * Uplink packets are seen by the lwIP IPv4 input hook, downlink packets by
+ * wrapping the AP netif's output function. Call on every WIFI_EVENT_AP_START
+ * (lwIP re-initialises the netif each time the AP comes up); repeat calls are
+ * harmless.
+ */
+esp_err_t ap_forward_attach(esp_netif_t *ap_netif);
+
+#endif // AP_FORWARD_H
@@ -0,0 +1,17 @@
+#ifndef AP_FORWARD_HOOKS_H
+#define AP_FORWARD_HOOKS_H
+
+// Pulled into lwIP's own build through ESP_IDF_LWIP_HOOK_FILENAME,
+// so this header must not include anything
+
+struct pbuf;
+struct netif;
+
+/**
+ * IPv4 input hook - returns non-zero when the packet was consumed
+ */
+int ap_forward_ip4_input(struct pbuf *p, struct netif *inp);
+
+#define LWIP_HOOK_IP4_INPUT(p, inp) ap_forward_ip4_input((p), (inp))
+
+#endif // AP_FORWARD_HOOKS_H
@@ -0,0 +1,548 @@
+#include "bench_server.h"
+#include "client_stats.h"
+#include "client_table.h"
+#include "esp_freertos_hooks.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "Bench";
+
+#define BENCH_CORES  2      // ESP32: one idle hook per core
+#define IO_SIZE      1460   // One MSS per send/recv
+#define SAMPLE_MS    100    // Heap sampling and socket poll period
+#define TAIL_S       2      // Grace after the nominal duration for the client's last bytes
+
+static const char *mode_names[] = {
+    [BENCH_MODE_NONE] = "none",
+    [BENCH_MODE_TCP_SINK] = "tcp_sink",
+    [BENCH_MODE_TCP_SOURCE] = "tcp_source",
+    [BENCH_MODE_UDP_SINK] = "udp_sink",
+    [BENCH_MODE_UDP_SOURCE] = "udp_source",
+    [BENCH_MODE_RELAY] = "relay",
+};
+
+static uint8_t io_buf[BENCH_UDP_PAYLOAD];                     // Bench task only
+static client_stats_t stats_buf[CLIENT_STATS_MAX_TRACKED];    // Bench task only
+static bench_result_t last_result;
+static bool have_result = false;
+static SemaphoreHandle_t result_mutex = NULL;
+
+// Idle loops per core; returning false keeps the idle task spinning instead
+// of sleeping until the next tick, so the count tracks idle time
+static volatile uint32_t idle_count[BENCH_CORES];
+static bool idle_hook_0(void) { idle_count[0]++; return false; }
+static bool idle_hook_1(void) { idle_count[1]++; return false; }
+static const esp_freertos_idle_cb_t idle_hooks[BENCH_CORES] = { idle_hook_0, idle_hook_1 };
+
+typedef struct {
+    bench_result_t *result;
+    bool hooked[BENCH_CORES];
+    uint32_t base_rate[BENCH_CORES];   // Idle loops/s before traffic
+    uint32_t start_count[BENCH_CORES];
+    int64_t start_us;
+    int64_t next_sample_us;
+} run_t;
+
+static int64_t now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+static void run_begin(run_t *run)
+{
+    for (int core = 0; core < BENCH_CORES; core++) {
+        run->hooked[core] = esp_register_freertos_idle_hook_for_cpu(idle_hooks[core], core) == ESP_OK;
+    }
+
+    // Baseline: what the idle loops manage with only the usual background load
+    uint32_t before[BENCH_CORES];
+    for (int core = 0; core < BENCH_CORES; core++) {
+        before[core] = idle_count[core];
+    }
+    vTaskDelay(pdMS_TO_TICKS(BENCH_CALIBRATE_MS));
+    for (int core = 0; core < BENCH_CORES; core++) {
+        run->base_rate[core] = (idle_count[core] - before[core]) * 1000 / BENCH_CALIBRATE_MS;
+        run->start_count[core] = idle_count[core];
+    }
+
+    run->result->heap_free = esp_get_free_heap_size();
+    run->result->heap_min = run->result->heap_free;
+    run->start_us = now_us();
+    run->next_sample_us = run->start_us;
+}
+
+static void run_sample(run_t *run)
+{
+    int64_t now = now_us();
+    if (now < run->next_sample_us) {
+        return;
+    }
+    run->next_sample_us = now + SAMPLE_MS * 1000;
+    uint32_t heap = esp_get_free_heap_size();
+    if (heap < run->result->heap_min) {
+        run->result->heap_min = heap;
+    }
+}
+
+// end_us is when the traffic stopped, not when the tail grace ran out
+static void run_end(run_t *run, int64_t end_us)
+{
+    bench_result_t *r = run->result;
+    int64_t elapsed_us = end_us > run->start_us ? end_us - run->start_us : 1;
+    r->duration_ms = (uint32_t)(elapsed_us / 1000);
+
+    int64_t busy_us = now_us() - run->start_us;
+    for (int core = 0; core < BENCH_CORES; core++) {
+        r->cpu_pct[core] = -1;
+        if (!run->hooked[core]) {
+            continue;
+        }
+        esp_deregister_freertos_idle_hook_for_cpu(idle_hooks[core], core);
+        if (run->base_rate[core] == 0 || busy_us <= 0) {
+            continue;
+        }
+        uint64_t rate = (uint64_t)(idle_count[core] - run->start_count[core]) * 1000000 / busy_us;
+        int idle_pct = (int)(rate * 100 / run->base_rate[core]);
+        r->cpu_pct[core] = (int8_t)(idle_pct >= 100 ? 0 : 100 - idle_pct);
+    }
+
+    uint32_t ms = r->duration_ms > 0 ? r->duration_ms : 1;
+    r->kbps = (uint32_t)(r->bytes * 8 / ms);
+    r->pps = (uint32_t)((uint64_t)r->packets * 1000 / ms);
+}
+
+static void run_tcp_sink(int sock, uint32_t secs, run_t *run)
+{
+    bench_result_t *r = run->result;
+    int64_t deadline = run->start_us + (int64_t)(secs + TAIL_S) * 1000000;
+    int64_t last_rx = run->start_us;
+
+    while (now_us() < deadline) {
+        int n = recv(sock, io_buf, IO_SIZE, 0);
+        if (n > 0) {
+            r->bytes += n;
+            last_rx = now_us();
+        } else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            break;
+        }
+        run_sample(run);
+    }
+    r->packets = (uint32_t)((r->bytes + IO_SIZE - 1) / IO_SIZE);
+    run_end(run, last_rx);
+}
+
+static void run_tcp_source(int sock, uint32_t secs, run_t *run)
+{
+    bench_result_t *r = run->result;
+    int64_t deadline = run->start_us + (int64_t)secs * 1000000;
+
+    while (now_us() < deadline) {
+        int n = send(sock, io_buf, IO_SIZE, 0);
+        if (n > 0) {
+            r->bytes += n;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;   // Client went away
+        }
+        run_sample(run);
+    }
+    r->packets = (uint32_t)((r->bytes + IO_SIZE - 1) / IO_SIZE);
+    run_end(run, now_us());
+    shutdown(sock, SHUT_WR);
+}
+
+static int open_udp(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(BENCH_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Control socket readable: EOF (or anything) from the client ends the run
+static bool control_done(int ctrl)
+{
+    char c;
+    int n = recv(ctrl, &c, 1, MSG_DONTWAIT);
+    return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+static void run_udp_sink(int ctrl, int udp, uint32_t secs, run_t *run)
+{
+    bench_result_t *r = run->result;
+    int64_t deadline = run->start_us + (int64_t)(secs + TAIL_S) * 1000000;
+    int64_t last_rx = run->start_us;
+    uint32_t highest = 0;
+    bool any = false;
+
+    while (now_us() < deadline) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(ctrl, &fds);
+        FD_SET(udp, &fds);
+        struct timeval tv = { .tv_sec = 0, .tv_usec = SAMPLE_MS * 1000 };
+        int ready = select((ctrl > udp ? ctrl : udp) + 1, &fds, NULL, NULL, &tv);
+        run_sample(run);
+        if (ready <= 0) {
+            continue;
+        }
+        if (FD_ISSET(udp, &fds)) {
+            // The UDP port is open to everyone; only the client's datagrams count
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            int n = recvfrom(udp, io_buf, sizeof(io_buf), 0, (struct sockaddr *)&from, &from_len);
+            if (n >= 4 && from.sin_addr.s_addr == run->result->client_ip) {
+                uint32_t seq = (uint32_t)io_buf[0] << 24 | io_buf[1] << 16 | io_buf[2] << 8 | io_buf[3];
+                if (!any || seq > highest) {
+                    highest = seq;
+                }
+                any = true;
+                r->bytes += n;
+                r->packets++;
+                last_rx = now_us();
+            }
+        }
+        // Datagrams still queued are counted before the close is honoured
+        if (FD_ISSET(ctrl, &fds) && !FD_ISSET(udp, &fds) && control_done(ctrl)) {
+            break;
+        }
+    }
+    if (any && highest + 1 > r->packets) {
+        r->lost = highest + 1 - r->packets;
+    }
+    run_end(run, last_rx);
+}
+
+static void run_udp_source(int udp, uint32_t client_ip, uint16_t port, uint32_t secs,
+                           uint32_t kbps, run_t *run)
+{
+    bench_result_t *r = run->result;
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = client_ip,
+    };
+    int64_t deadline = run->start_us + (int64_t)secs * 1000000;
+    uint32_t seq = 0;
+    memset(io_buf, 0, BENCH_UDP_PAYLOAD);
+
+    for (int64_t now = now_us(); now < deadline; now = now_us()) {
+        // Pace against the rate budget; a tick of sleep is the finest we get
+        if (kbps > 0 && r->bytes * 8000 > (uint64_t)kbps * (uint64_t)(now - run->start_us)) {
+            vTaskDelay(1);
+            continue;
+        }
+        io_buf[0] = (uint8_t)(seq >> 24);
+        io_buf[1] = (uint8_t)(seq >> 16);
+        io_buf[2] = (uint8_t)(seq >> 8);
+        io_buf[3] = (uint8_t)seq;
+        if (sendto(udp, io_buf, BENCH_UDP_PAYLOAD, 0, (struct sockaddr *)&dest, sizeof(dest)) == BENCH_UDP_PAYLOAD) {
+            r->bytes += BENCH_UDP_PAYLOAD;
+            r->packets++;
+            seq++;
+        } else {
+            // lwIP out of pbufs: back off a tick rather than spin
+            r->errors++;
+            vTaskDelay(1);
+        }
+        run_sample(run);
+    }
+    run_end(run, now_us());
+}
+
+static bool find_client(uint32_t ip, client_stats_t *out)
+{
+    size_t n = client_stats_snapshot(stats_buf, CLIENT_STATS_MAX_TRACKED);
+    for (size_t i = 0; i < n; i++) {
+        if (stats_buf[i].ip == ip) {
+            *out = stats_buf[i];
+            return true;
+        }
+    }
+    memset(out, 0, sizeof(*out));
+    return false;
+}
+
+static void run_relay(int ctrl, uint32_t client_ip, uint32_t secs, run_t *run)
+{
+    bench_result_t *r = run->result;
+    client_stats_t before, after;
+    find_client(client_ip, &before);
+
+    int64_t deadline = run->start_us + (int64_t)(secs + TAIL_S) * 1000000;
+    while (now_us() < deadline) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(ctrl, &fds);
+        struct timeval tv = { .tv_sec = 0, .tv_usec = SAMPLE_MS * 1000 };
+        int ready = select(ctrl + 1, &fds, NULL, NULL, &tv);
+        run_sample(run);
+        if (ready > 0 && control_done(ctrl)) {
+            break;
+        }
+    }
+    int64_t end = now_us();
+
+    // Counters are published once per period; wait for the one covering the end
+    vTaskDelay(pdMS_TO_TICKS(CLIENT_STATS_PERIOD_MS + SAMPLE_MS));
+    find_client(client_ip, &after);
+    r->bytes = (after.up_bytes - before.up_bytes) + (after.down_bytes - before.down_bytes);
+    r->packets = (uint32_t)((after.up_packets - before.up_packets) + (after.down_packets - before.down_packets));
+    run_end(run, end);
+}
+
+static void send_line(int sock, const char *line)
+{
+    send(sock, line, strlen(line), 0);
+}
+
+static void send_result(int sock, const bench_result_t *r)
+{
+    char json[320];
+    int len = bench_result_json(r, json, sizeof(json) - 1);
+    json[len++] = '\n';
+    send(sock, json, len, 0);
+}
+
+// Read one command line (no newline) with a short timeout
+static bool read_command(int sock, char *line, size_t size)
+{
+    size_t len = 0;
+    while (len + 1 < size) {
+        char c;
+        if (recv(sock, &c, 1, 0) != 1) {
+            return false;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r') {
+            line[len++] = c;
+        }
+    }
+    line[len] = '\0';
+    return true;
+}
+
+static void handle_client(int sock, uint32_t client_ip)
+{
+    struct timeval tv = { .tv_sec = 3, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char line[64];
+    if (!read_command(sock, line, sizeof(line))) {
+        return;
+    }
+
+    if (strcmp(line, "RESULT") == 0) {
+        bench_result_t r;
+        if (bench_server_last_result(&r)) {
+            send_result(sock, &r);
+        } else {
+            send_line(sock, "ERR no result yet\n");
+        }
+        return;
+    }
+
+    char cmd[16];
+    unsigned secs = 0, kbps = 0, port = 0;
+    int fields = sscanf(line, "%15s %u %u %u", cmd, &secs, &kbps, &port);
+    bench_mode_t mode = BENCH_MODE_NONE;
+    for (int m = BENCH_MODE_TCP_SINK; m <= BENCH_MODE_RELAY; m++) {
+        if (fields >= 2 && strcasecmp(cmd, mode_names[m]) == 0) {
+            mode = (bench_mode_t)m;
+        }
+    }
+    if (mode == BENCH_MODE_NONE || secs == 0 || secs > BENCH_MAX_SECONDS ||
+        (mode == BENCH_MODE_UDP_SOURCE && (fields < 4 || port == 0 || port > 65535))) {
+        send_line(sock, "ERR usage: TCP_SINK|TCP_SOURCE|UDP_SINK|RELAY <1-60 s>, UDP_SOURCE <s> <kbps> <port>\n");
+        return;
+    }
+
+    int udp = -1;
+    if (mode == BENCH_MODE_UDP_SINK || mode == BENCH_MODE_UDP_SOURCE) {
+        udp = open_udp();
+        if (udp < 0) {
+            send_line(sock, "ERR no UDP socket\n");
+            return;
+        }
+    }
+
+    bench_result_t result = { .mode = mode, .client_ip = client_ip };
+    run_t run = { .result = &result };
+    ESP_LOGI(TAG, "%s for %us", mode_names[mode], secs);
+    run_begin(&run);
+    send_line(sock, "GO\n");
+
+    // Short timeouts so the loops can watch the clock and sample the heap
+    struct timeval poll_tv = { .tv_sec = 0, .tv_usec = SAMPLE_MS * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &poll_tv, sizeof(poll_tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &poll_tv, sizeof(poll_tv));
+
+    switch (mode) {
+    case BENCH_MODE_TCP_SINK:
+        run_tcp_sink(sock, secs, &run);
+        break;
+    case BENCH_MODE_TCP_SOURCE:
+        run_tcp_source(sock, secs, &run);
+        break;
+    case BENCH_MODE_UDP_SINK:
+        run_udp_sink(sock, udp, secs, &run);
+        break;
+    case BENCH_MODE_UDP_SOURCE:
+        run_udp_source(udp, client_ip, (uint16_t)port, secs, kbps, &run);
+        break;
+    default:
+        run_relay(sock, client_ip, secs, &run);
+        break;
+    }
+    if (udp >= 0) {
+        close(udp);
+    }
+
+    xSemaphoreTake(result_mutex, portMAX_DELAY);
+    last_result = result;
+    have_result = true;
+    xSemaphoreGive(result_mutex);
+
+    ESP_LOGI(TAG, "✓ %s: %lu kbit/s, %lu pkt/s, cpu %d/%d%%, heap min %lu", mode_names[mode],
+             (unsigned long)result.kbps, (unsigned long)result.pps, result.cpu_pct[0], result.cpu_pct[1],
+             (unsigned long)result.heap_min);
+
+    // TCP_SOURCE has shut its sending side; the client asks for RESULT separately
+    if (mode != BENCH_MODE_TCP_SOURCE) {
+        send_result(sock, &result);
+    }
+}
+
+// Approved stations, or hosts on the uplink side; an open-AP visitor who
+// hasn't tapped Connect must not be able to saturate the radio
+static bool peer_allowed(uint32_t ip)
+{
+    if (client_table_is_ip_approved(ip)) {
+        return true;
+    }
+    esp_netif_ip_info_t ap;
+    if (ip == 0 || esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ap) != ESP_OK) {
+        return false;
+    }
+    client_entry_t station;
+    return (ip & ap.netmask.addr) != (ap.ip.addr & ap.netmask.addr) && !client_table_find_ip(ip, &station);
+}
+
+static void bench_server_task(void *arg)
+{
+    int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (listen_sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int opt = 1;
+    setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(BENCH_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_sock, 1) != 0) {
+        ESP_LOGE(TAG, "Bench listener failed: errno %d", errno);
+        close(listen_sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "✓ Throughput bench on port %d", BENCH_SERVER_PORT);
+
+    while (1) {
+        struct sockaddr_in source_addr;
+        socklen_t addr_len = sizeof(source_addr);
+        int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (peer_allowed(source_addr.sin_addr.s_addr)) {
+            handle_client(sock, source_addr.sin_addr.s_addr);
+        } else {
+            send_line(sock, "ERR approved clients only\n");
+        }
+        close(sock);
+    }
+}
+
+esp_err_t bench_server_init(void)
+{
+    if (result_mutex) {
+        return ESP_OK;
+    }
+    result_mutex = xSemaphoreCreateMutex();
+    if (!result_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(bench_server_task, "bench", 4096, NULL, 2, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool bench_server_last_result(bench_result_t *out)
+{
+    if (!result_mutex) {
+        return false;
+    }
+    xSemaphoreTake(result_mutex, portMAX_DELAY);
+    bool ok = have_result;
+    if (ok) {
+        *out = last_result;
+    }
+    xSemaphoreGive(result_mutex);
+    return ok;
+}
+
+int bench_result_json(const bench_result_t *r, char *buf, size_t len)
+{
+    char ip[16];
+    struct in_addr addr = { .s_addr = r->client_ip };
+    inet_ntoa_r(addr, ip, sizeof(ip));
+
+    char cpu[2][8];
+    for (int core = 0; core < BENCH_CORES; core++) {
+        if (r->cpu_pct[core] < 0) {
+            snprintf(cpu[core], sizeof(cpu[core]), "null");
+        } else {
+            snprintf(cpu[core], sizeof(cpu[core]), "%d", r->cpu_pct[core]);
+        }
+    }
+
+    int n = snprintf(buf, len,
+        "{\"mode\":\"%s\",\"client\":\"%s\",\"ms\":%lu,\"bytes\":%llu,\"packets\":%lu,"
+        "\"lost\":%lu,\"errors\":%lu,\"kbps\":%lu,\"pps\":%lu,\"cpu\":[%s,%s],"
+        "\"heap_free\":%lu,\"heap_min\":%lu}",
+        mode_names[r->mode], ip, (unsigned long)r->duration_ms, (unsigned long long)r->bytes,
+        (unsigned long)r->packets, (unsigned long)r->lost, (unsigned long)r->errors,
+        (unsigned long)r->kbps, (unsigned long)r->pps, cpu[0], cpu[1],
+        (unsigned long)r->heap_free, (unsigned long)r->heap_min);
+    return n < (int)len ? n : (int)len - 1;
+}
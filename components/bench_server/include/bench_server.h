@@ -0,0 +1,68 @@
+#ifndef BENCH_SERVER_H
+#define BENCH_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Control and TCP data on one port, UDP data on the same number
+#define BENCH_SERVER_PORT 5201
+
+#define BENCH_MAX_SECONDS   60
+#define BENCH_UDP_PAYLOAD   1470   // Fits one 1500-byte frame with IP/UDP headers
+#define BENCH_CALIBRATE_MS  300    // Quiet idle-loop sample before traffic starts
+
+// One test at a time, driven by a one-line command on a TCP connection:
+//   TCP_SINK <s>                device reads and discards, result line after EOF
+//   TCP_SOURCE <s>              device writes for <s>, then closes (fetch RESULT)
+//   UDP_SINK <s>                client sends 4-byte sequence-numbered datagrams,
+//                               then closes its side; result line follows
+//   UDP_SOURCE <s> <kbps> <port> device sends to the client's <port> (0 kbps = flat out)
+//   RELAY <s>                   client pushes traffic through NAPT to a sink of its
+//                               own on the uplink; the device only reports the
+//                               client_stats delta for that client, it relays nothing
+//   RESULT                      last result as one JSON line
+// Every test answers "GO" once the CPU baseline is taken, or "ERR <why>".
+// Only approved stations and uplink hosts are served; anyone else gets
+// "ERR approved clients only"
+typedef enum {
+    BENCH_MODE_NONE = 0,
+    BENCH_MODE_TCP_SINK,
+    BENCH_MODE_TCP_SOURCE,
+    BENCH_MODE_UDP_SINK,
+    BENCH_MODE_UDP_SOURCE,
+    BENCH_MODE_RELAY,
+} bench_mode_t;
+
+typedef struct {
+    bench_mode_t mode;
+    uint32_t client_ip;     // Network byte order
+    uint32_t duration_ms;
+    uint64_t bytes;         // Payload moved (relay: forwarded both ways)
+    uint32_t packets;       // Datagrams, forwarded packets, or MSS-sized TCP segments
+    uint32_t lost;          // UDP sink: sequence numbers never seen
+    uint32_t errors;        // Sends the stack refused (out of buffers)
+    uint32_t kbps;
+    uint32_t pps;
+    int8_t cpu_pct[2];      // Per core over the run, -1 if idle hooks are unavailable
+    uint32_t heap_free;     // At the start
+    uint32_t heap_min;      // Lowest seen during the run
+} bench_result_t;
+
+/**
+ * Start the bench listener task
+ */
+esp_err_t bench_server_init(void);
+
+/**
+ * Copy the last completed result, false if none ran yet
+ */
+bool bench_server_last_result(bench_result_t *out);
+
+/**
+ * Format a result as one JSON object; returns the length written
+ */
+int bench_result_json(const bench_result_t *result, char *buf, size_t len);
+
+#endif // BENCH_SERVER_H
@@ -0,0 +1,250 @@
+#include "channel_plan.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "ChannelPlan";
+
+#define SCAN_MAX_RECORDS 32
+#define OVERLAP_SPAN     5    // 20 MHz channels 5 apart (25 MHz) no longer overlap
+
+static channel_plan_t plan = { .channel = CHANNEL_PLAN_DEFAULT, .source = CHANNEL_SOURCE_DEFAULT };
+static SemaphoreHandle_t plan_mutex = NULL;
+
+// Busy air heard on the sampled channel, added up by the Wi-Fi task
+static uint32_t air_us = 0;
+
+static const char *source_names[] = {
+    [CHANNEL_SOURCE_DEFAULT] = "default",
+    [CHANNEL_SOURCE_SCAN] = "scan",
+    [CHANNEL_SOURCE_UPLINK] = "uplink",
+};
+
+static uint32_t uptime_s(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Overlap of a 20 MHz channel with a transmitter on another, in fifths
+static int overlap(int channel, int other)
+{
+    int d = abs(channel - other);
+    return d < OVERLAP_SPAN ? OVERLAP_SPAN - d : 0;
+}
+
+// On-air time of one received frame from its length and PHY rate
+static uint32_t frame_airtime_us(const wifi_pkt_rx_ctrl_t *rx)
+{
+    // Rates in 100 kbit/s: legacy by driver rate code, HT by MCS (20 MHz, long GI)
+    static const uint16_t legacy_rate[16] = { 10, 20, 55, 110, 0, 20, 55, 110,
+                                              480, 240, 120, 60, 540, 360, 180, 90 };
+    static const uint16_t ht_rate[8] = { 65, 130, 195, 260, 390, 520, 585, 650 };
+    uint32_t bits = rx->sig_len * 8;
+
+    if (rx->sig_mode == 0) {
+        uint32_t rate = legacy_rate[rx->rate & 0x0f];
+        if (rate == 0) {
+            return 0;
+        }
+        uint32_t preamble = (rx->rate & 0x0f) < 8 ? 192 : 20;   // DSSS long vs OFDM
+        return preamble + bits * 10 / rate;
+    }
+    uint32_t rate = ht_rate[rx->mcs & 0x07] * (rx->cwb ? 2 : 1);
+    return 36 + bits * 10 / rate;
+}
+
+static void sniff_cb(void *buf, wifi_promiscuous_pkt_type_t type)
+{
+    (void)type;
+    const wifi_promiscuous_pkt_t *pkt = (const wifi_promiscuous_pkt_t *)buf;
+    __atomic_fetch_add(&air_us, frame_airtime_us(&pkt->rx_ctrl), __ATOMIC_RELAXED);
+}
+
+// Listen on each candidate in turn; any failure leaves that channel unmeasured
+static void measure_airtime(channel_candidate_t *cands, int count)
+{
+    for (int i = 0; i < count; i++) {
+        cands[i].airtime_pct = -1;
+    }
+
+    wifi_promiscuous_filter_t filter = { .filter_mask = WIFI_PROMIS_FILTER_MASK_ALL };
+    if (esp_wifi_set_promiscuous_rx_cb(sniff_cb) != ESP_OK ||
+        esp_wifi_set_promiscuous_filter(&filter) != ESP_OK ||
+        esp_wifi_set_promiscuous(true) != ESP_OK) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (esp_wifi_set_channel(cands[i].channel, WIFI_SECOND_CHAN_NONE) != ESP_OK) {
+            continue;
+        }
+        __atomic_store_n(&air_us, 0, __ATOMIC_RELAXED);
+        vTaskDelay(pdMS_TO_TICKS(CHANNEL_PLAN_DWELL_MS));
+        uint32_t busy = __atomic_load_n(&air_us, __ATOMIC_RELAXED);
+        uint32_t pct = busy / (CHANNEL_PLAN_DWELL_MS * 10);
+        cands[i].airtime_pct = (int8_t)(pct > 100 ? 100 : pct);
+    }
+    esp_wifi_set_promiscuous(false);
+}
+
+static int build_candidates(channel_candidate_t *cands)
+{
+    int count = 0;
+    for (int ch = 1; ch <= 13 && count < CHANNEL_PLAN_MAX_CANDIDATES; ch++) {
+        if (CHANNEL_PLAN_ALL_CHANNELS || ch == 1 || ch == 6 || ch == 11) {
+            cands[count++] = (channel_candidate_t){ .channel = (uint8_t)ch, .airtime_pct = -1 };
+        }
+    }
+    return count;
+}
+
+// BSS count and RSSI-weighted occupancy; a 40 MHz BSS also occupies its secondary
+static void score_scan(channel_candidate_t *cands, int count, const wifi_ap_record_t *records, int n)
+{
+    for (int i = 0; i < count; i++) {
+        int occupancy = 0;
+        int bss = 0;
+        for (int r = 0; r < n; r++) {
+            int primary = records[r].primary;
+            int secondary = records[r].second == WIFI_SECOND_CHAN_ABOVE ? primary + 4 :
+                            records[r].second == WIFI_SECOND_CHAN_BELOW ? primary - 4 : 0;
+            int share = overlap(cands[i].channel, primary);
+            if (secondary) {
+                int second_share = overlap(cands[i].channel, secondary);
+                share = share > second_share ? share : second_share;
+            }
+            if (share == 0) {
+                continue;
+            }
+            int weight = records[r].rssi + 100;
+            weight = weight < 1 ? 1 : weight > 70 ? 70 : weight;
+            occupancy += weight * share / OVERLAP_SPAN;
+            bss++;
+        }
+        cands[i].bss = (uint8_t)(bss > UINT8_MAX ? UINT8_MAX : bss);
+        cands[i].occupancy = (uint16_t)(occupancy > UINT16_MAX ? UINT16_MAX : occupancy);
+    }
+}
+
+// Airtime only counts if every candidate was measured - a gap would look idle
+static int pick(channel_candidate_t *cands, int count)
+{
+    bool use_air = true;
+    for (int i = 0; i < count; i++) {
+        if (cands[i].airtime_pct < 0) {
+            use_air = false;
+        }
+    }
+    int best = 0;
+    for (int i = 0; i < count; i++) {
+        cands[i].score = cands[i].bss * CHANNEL_PLAN_BSS_COST + cands[i].occupancy +
+                         (use_air ? cands[i].airtime_pct * CHANNEL_PLAN_AIRTIME_COST : 0);
+        if (cands[i].score < cands[best].score) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+esp_err_t channel_plan_init(void)
+{
+    if (plan_mutex) {
+        return ESP_OK;
+    }
+    plan_mutex = xSemaphoreCreateMutex();
+    return plan_mutex ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+uint8_t channel_plan_select(void)
+{
+    wifi_ap_record_t uplink;
+    if (esp_wifi_sta_get_ap_info(&uplink) == ESP_OK) {
+        channel_plan_follow_uplink();
+        return uplink.primary;
+    }
+
+    channel_candidate_t cands[CHANNEL_PLAN_MAX_CANDIDATES];
+    int count = build_candidates(cands);
+
+    wifi_scan_config_t scan_config = {
+        .show_hidden = true,               // Hidden networks use the air all the same
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+    };
+    uint16_t n = SCAN_MAX_RECORDS;
+    wifi_ap_record_t *records = malloc(n * sizeof(wifi_ap_record_t));
+    esp_err_t err = records ? esp_wifi_scan_start(&scan_config, true) : ESP_ERR_NO_MEM;
+    if (err == ESP_OK) {
+        err = esp_wifi_scan_get_ap_records(&n, records);
+    }
+    if (err != ESP_OK) {
+        // Usually wifi_sta mid-connect; keep whatever was planned before
+        free(records);
+        xSemaphoreTake(plan_mutex, portMAX_DELAY);
+        uint8_t channel = plan.channel;
+        xSemaphoreGive(plan_mutex);
+        ESP_LOGW(TAG, "Scan unavailable (%s), AP stays on channel %d", esp_err_to_name(err), channel);
+        return channel;
+    }
+    score_scan(cands, count, records, n);
+    free(records);
+
+    measure_airtime(cands, count);
+    int best = pick(cands, count);
+
+    for (int i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "  ch %2d: %d BSS, occupancy %d, airtime %d%%, score %lu", cands[i].channel,
+                 cands[i].bss, cands[i].occupancy, cands[i].airtime_pct, (unsigned long)cands[i].score);
+    }
+    ESP_LOGI(TAG, "✓ AP channel %d (least contended of %d, %d networks heard)",
+             cands[best].channel, count, n);
+
+    xSemaphoreTake(plan_mutex, portMAX_DELAY);
+    plan.channel = cands[best].channel;
+    plan.source = CHANNEL_SOURCE_SCAN;
+    plan.planned_s = uptime_s();
+    plan.count = (uint8_t)count;
+    memcpy(plan.candidates, cands, count * sizeof(cands[0]));
+    xSemaphoreGive(plan_mutex);
+    return cands[best].channel;
+}
+
+void channel_plan_follow_uplink(void)
+{
+    wifi_ap_record_t uplink;
+    if (esp_wifi_sta_get_ap_info(&uplink) != ESP_OK || !plan_mutex) {
+        return;
+    }
+    xSemaphoreTake(plan_mutex, portMAX_DELAY);
+    uint8_t was = plan.channel;
+    channel_source_t was_source = plan.source;
+    plan.channel = uplink.primary;
+    plan.source = CHANNEL_SOURCE_UPLINK;
+    plan.planned_s = uptime_s();
+    xSemaphoreGive(plan_mutex);
+
+    if (was != uplink.primary) {
+        ESP_LOGI(TAG, "✓ AP follows uplink to channel %d (was %d)", uplink.primary, was);
+    } else if (was_source != CHANNEL_SOURCE_UPLINK) {
+        ESP_LOGI(TAG, "✓ AP shares uplink channel %d", uplink.primary);
+    }
+}
+
+void channel_plan_get(channel_plan_t *out)
+{
+    if (!plan_mutex) {
+        *out = plan;
+        return;
+    }
+    xSemaphoreTake(plan_mutex, portMAX_DELAY);
+    *out = plan;
+    xSemaphoreGive(plan_mutex);
+}
+
+const char *channel_plan_source_name(channel_source_t source)
+{
+    return source <= CHANNEL_SOURCE_UPLINK ? source_names[source] : "?";
+}
@@ -0,0 +1,62 @@
+#ifndef CHANNEL_PLAN_H
+#define CHANNEL_PLAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Used when nothing better is known (scan refused, radio busy connecting)
+#define CHANNEL_PLAN_DEFAULT 1
+
+// 0 = score only the non-overlapping 1/6/11, 1 = score every channel 1-13
+#define CHANNEL_PLAN_ALL_CHANNELS 0
+#define CHANNEL_PLAN_MAX_CANDIDATES 13
+
+// Promiscuous listen per candidate to measure busy air
+#define CHANNEL_PLAN_DWELL_MS 150
+
+// Score weights (lower score wins): per overlapping BSS, per busy-air percent.
+// RSSI-weighted occupancy adds (rssi + 100) per BSS, scaled by spectral overlap
+#define CHANNEL_PLAN_BSS_COST     10
+#define CHANNEL_PLAN_AIRTIME_COST 4
+
+typedef enum {
+    CHANNEL_SOURCE_DEFAULT = 0,
+    CHANNEL_SOURCE_SCAN,      // Least contended candidate
+    CHANNEL_SOURCE_UPLINK,    // APSTA shares one radio: the AP sits on the STA's channel
+} channel_source_t;
+
+typedef struct {
+    uint8_t channel;
+    uint8_t bss;              // Networks whose 20 MHz overlaps this channel
+    uint16_t occupancy;       // Sum of (rssi + 100) x overlap fraction
+    int8_t airtime_pct;       // Measured busy air, -1 if not sampled
+    uint32_t score;
+} channel_candidate_t;
+
+typedef struct {
+    uint8_t channel;
+    channel_source_t source;
+    uint32_t planned_s;       // Uptime of the decision
+    uint8_t count;            // Candidates from the last scan (kept across uplink follows)
+    channel_candidate_t candidates[CHANNEL_PLAN_MAX_CANDIDATES];
+} channel_plan_t;
+
+esp_err_t channel_plan_init(void);
+
+/**
+ * Pick the AP channel: the uplink's if STA is associated, otherwise scan and
+ * score the candidates. Blocks for the scan (about 2 s); call before the AP
+ * comes up, since hopping channels would drop its clients
+ */
+uint8_t channel_plan_select(void);
+
+/**
+ * STA associated - record that the AP now shares the uplink's channel
+ */
+void channel_plan_follow_uplink(void);
+
+void channel_plan_get(channel_plan_t *plan);
+const char *channel_plan_source_name(channel_source_t source);
+
+#endif // CHANNEL_PLAN_H
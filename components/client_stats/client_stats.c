@@ -0,0 +1,232 @@
+#include "client_stats.h"
+#include "visitor_log.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "ClientStats";
+
+// Raw per-octet counters - 32-bit so the tcpip thread never tears a write;
+// the snapshot task turns wrapping differences into 64-bit totals.
+// Only the writer zeroes them: the snapshot task sets restart when it drops
+// an idle client and the next packet starts the counters over.
+typedef struct {
+    volatile uint32_t up_packets;
+    volatile uint32_t up_bytes;
+    volatile uint32_t down_packets;
+    volatile uint32_t down_bytes;
+    volatile uint32_t last_tick;
+    volatile uint8_t restart;
+} __attribute__((aligned(CLIENT_STATS_CACHE_LINE))) slot_counters_t;
+
+_Static_assert(sizeof(slot_counters_t) == CLIENT_STATS_CACHE_LINE, "counters must fill one cache line");
+
+// Per-client history kept by the snapshot task
+typedef struct {
+    uint8_t octet;
+    uint32_t up_packets;     // Raw counters at the previous snapshot
+    uint32_t up_bytes;
+    uint32_t down_packets;
+    uint32_t down_bytes;
+} tracked_t;
+
+static slot_counters_t counters[CLIENT_STATS_SLOTS];
+static uint8_t tracked_index[CLIENT_STATS_SLOTS];   // Octet -> tracked slot + 1 (0 = untracked)
+static tracked_t tracked[CLIENT_STATS_MAX_TRACKED];
+static client_stats_t published[CLIENT_STATS_MAX_TRACKED];   // Same order as tracked[]
+static int published_count = 0;
+
+static uint32_t subnet_addr = 0;
+static SemaphoreHandle_t snapshot_mutex = NULL;
+static TaskHandle_t snapshot_task_handle = NULL;
+
+static inline void restart_if_dropped(slot_counters_t *c)
+{
+    if (c->restart) {
+        c->up_packets = 0;
+        c->up_bytes = 0;
+        c->down_packets = 0;
+        c->down_bytes = 0;
+        c->restart = 0;
+    }
+}
+
+void client_stats_uplink(uint8_t octet, uint32_t bytes)
+{
+    slot_counters_t *c = &counters[octet];
+    restart_if_dropped(c);
+    c->up_packets++;
+    c->up_bytes += bytes;
+    c->last_tick = xTaskGetTickCount();
+}
+
+void client_stats_downlink(uint8_t octet, uint32_t bytes)
+{
+    slot_counters_t *c = &counters[octet];
+    restart_if_dropped(c);
+    c->down_packets++;
+    c->down_bytes += bytes;
+    c->last_tick = xTaskGetTickCount();
+}
+
+static uint32_t octet_ip(uint8_t octet)
+{
+    // Host octet is the last byte on the wire
+    return subnet_addr | ((uint32_t)octet << 24);
+}
+
+static int track_octet(uint8_t octet)
+{
+    for (int i = 0; i < CLIENT_STATS_MAX_TRACKED; i++) {
+        if (published[i].ip == 0) {
+            memset(&tracked[i], 0, sizeof(tracked[i]));
+            memset(&published[i], 0, sizeof(published[i]));
+            tracked[i].octet = octet;
+            published[i].ip = octet_ip(octet);
+            tracked_index[octet] = i + 1;
+            if (i >= published_count) {
+                published_count = i + 1;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void snapshot_once(uint32_t elapsed_ms)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+
+    // Start tracking octets that saw their first packet this period
+    for (int octet = 1; octet < CLIENT_STATS_SLOTS - 1; octet++) {
+        const slot_counters_t *c = &counters[octet];
+        if (tracked_index[octet] == 0 && !c->restart && (c->up_packets || c->down_packets)) {
+            if (track_octet((uint8_t)octet) < 0) {
+                break;   // Full - picked up once an idle client is dropped
+            }
+        }
+    }
+
+    for (int i = 0; i < published_count; i++) {
+        client_stats_t *pub = &published[i];
+        if (pub->ip == 0) {
+            continue;
+        }
+        tracked_t *t = &tracked[i];
+        const slot_counters_t *c = &counters[t->octet];
+
+        uint32_t up_packets = c->up_packets;
+        uint32_t up_bytes = c->up_bytes;
+        uint32_t down_packets = c->down_packets;
+        uint32_t down_bytes = c->down_bytes;
+
+        uint32_t d_up = up_bytes - t->up_bytes;
+        uint32_t d_down = down_bytes - t->down_bytes;
+        pub->up_packets += up_packets - t->up_packets;
+        pub->down_packets += down_packets - t->down_packets;
+        pub->up_bytes += d_up;
+        pub->down_bytes += d_down;
+        pub->up_rate = (uint32_t)((uint64_t)d_up * 1000 / elapsed_ms);
+        pub->down_rate = (uint32_t)((uint64_t)d_down * 1000 / elapsed_ms);
+        pub->idle_s = (uint32_t)((now - c->last_tick) * portTICK_PERIOD_MS / 1000);
+
+        t->up_packets = up_packets;
+        t->up_bytes = up_bytes;
+        t->down_packets = down_packets;
+        t->down_bytes = down_bytes;
+
+        if (d_up + d_down > 0) {
+            visitor_log_add_bytes(pub->ip, d_up + d_down);
+        }
+
+        // Forget idle clients; their next packet restarts the raw counters
+        if (pub->idle_s >= CLIENT_STATS_IDLE_S) {
+            counters[t->octet].restart = 1;
+            tracked_index[t->octet] = 0;
+            pub->ip = 0;
+        }
+    }
+
+    while (published_count > 0 && published[published_count - 1].ip == 0) {
+        published_count--;
+    }
+
+    xSemaphoreGive(snapshot_mutex);
+}
+
+static void snapshot_task(void *pvParameters)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(CLIENT_STATS_PERIOD_MS));
+        snapshot_once(CLIENT_STATS_PERIOD_MS);
+    }
+}
+
+esp_err_t client_stats_init(uint32_t subnet)
+{
+    if (snapshot_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    subnet_addr = subnet;
+    snapshot_mutex = xSemaphoreCreateMutex();
+    if (!snapshot_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(snapshot_task, "client_stats", 3072, NULL, 4, &snapshot_task_handle) != pdPASS) {
+        vSemaphoreDelete(snapshot_mutex);
+        snapshot_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "✓ Per-client accounting started (%d slots, %d ms snapshots)",
+             CLIENT_STATS_SLOTS, CLIENT_STATS_PERIOD_MS);
+    return ESP_OK;
+}
+
+static uint64_t busy(const client_stats_t *s)
+{
+    return (uint64_t)s->up_rate + s->down_rate;
+}
+
+size_t client_stats_snapshot(client_stats_t *out, size_t max)
+{
+    size_t n = 0;
+    if (!snapshot_mutex || max == 0) {
+        return 0;
+    }
+
+    xSemaphoreTake(snapshot_mutex, portMAX_DELAY);
+    for (int i = 0; i < published_count; i++) {
+        const client_stats_t *s = &published[i];
+        if (s->ip == 0) {
+            continue;
+        }
+
+        // Insertion into the sorted output, dropping the quietest when full
+        size_t pos = n;
+        while (pos > 0 && (busy(&out[pos - 1]) < busy(s) ||
+               (busy(&out[pos - 1]) == busy(s) &&
+                out[pos - 1].up_bytes + out[pos - 1].down_bytes < s->up_bytes + s->down_bytes))) {
+            pos--;
+        }
+        if (pos >= max) {
+            continue;
+        }
+        size_t last = (n < max) ? n : max - 1;
+        memmove(&out[pos + 1], &out[pos], (last - pos) * sizeof(*out));
+        out[pos] = *s;
+        if (n < max) {
+            n++;
+        }
+    }
+    xSemaphoreGive(snapshot_mutex);
+    return n;
+}
@@ -0,0 +1,50 @@
+#ifndef CLIENT_STATS_H
+#define CLIENT_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Hot counters: one cache line per 192.168.4.x octet, written only by the tcpip thread
+#define CLIENT_STATS_SLOTS      256
+#define CLIENT_STATS_CACHE_LINE 32
+
+// Clients with history (totals and rates); AP limit is 10, the rest covers recent leavers
+#define CLIENT_STATS_MAX_TRACKED 32
+
+// Snapshot period, and idle time after which a client's history is dropped
+#define CLIENT_STATS_PERIOD_MS 1000
+#define CLIENT_STATS_IDLE_S    600
+
+// Snapshot of one AP client (directions as seen from the client)
+typedef struct {
+    uint32_t ip;             // Network byte order
+    uint64_t up_bytes;       // Client -> uplink
+    uint64_t down_bytes;     // Uplink -> client
+    uint64_t up_packets;
+    uint64_t down_packets;
+    uint32_t up_rate;        // Bytes/s over the last period
+    uint32_t down_rate;
+    uint32_t idle_s;         // Since the last forwarded packet
+} client_stats_t;
+
+/**
+ * Start the snapshot task
+ * subnet is the AP network address (network byte order, e.g. 192.168.4.0)
+ */
+esp_err_t client_stats_init(uint32_t subnet);
+
+/**
+ * Count one forwarded packet - tcpip thread only, lock-free
+ */
+void client_stats_uplink(uint8_t octet, uint32_t bytes);
+void client_stats_downlink(uint8_t octet, uint32_t bytes);
+
+/**
+ * Copy the latest snapshot, busiest client first
+ * Returns the number of entries written
+ */
+size_t client_stats_snapshot(client_stats_t *out, size_t max);
+
+#endif // CLIENT_STATS_H
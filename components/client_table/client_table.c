@@ -0,0 +1,571 @@
+#include "client_table.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "ClientTable";
+
+#define NO_ENTRY 0xFF
+
+// Saved approvals: one version byte, then a record per approved station
+#define APPROVALS_KEY     "ct_approved"
+#define APPROVALS_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint8_t mac[6];
+    uint16_t ttl_min;      // Approval time left when saved, rounded up
+} approval_record_t;
+
+static client_entry_t entries[CLIENT_TABLE_SIZE];
+static bool in_use[CLIENT_TABLE_SIZE];
+
+// Lease octet (192.168.4.x) -> entry, so IP lookups never scan. The only
+// address -> station index: portal, DNS and the forward gate all read it
+static uint8_t ip_index[256];
+
+// One bit per lease octet whose current holder is approved; read lock-free
+// by the forward path, rewritten whenever a lease or an approval changes
+static uint32_t approved_bitmap[8];
+static client_table_approval_hook_t approval_hook = NULL;
+
+// Last request per lease octet, stamped lock-free by the DNS and HTTP servers
+static uint32_t octet_request[256];
+
+// The /24 leases are handed out from (host octet zeroed), learned from the
+// first binding; an address only maps to a lease octet if it is on it
+static uint32_t lease_net = 0;
+
+static SemaphoreHandle_t table_mutex = NULL;
+static TaskHandle_t saver_task_handle = NULL;
+
+// Unsaved approval changes (table_mutex held)
+static bool dirty = false;
+static uint32_t dirty_since = 0;
+static uint32_t last_change = 0;
+
+static inline uint8_t host_octet(uint32_t ip)
+{
+    return ((const uint8_t *)&ip)[3];   // Last byte on the wire
+}
+
+static inline uint32_t net_of(uint32_t ip)
+{
+    ((uint8_t *)&ip)[3] = 0;
+    return ip;
+}
+
+// Same octet on the uplink or venue side is someone else entirely
+static inline bool on_lease_net(uint32_t ip)
+{
+    return ip != 0 && net_of(ip) == __atomic_load_n(&lease_net, __ATOMIC_RELAXED);
+}
+
+static uint32_t now_s(void)
+{
+    return (uint32_t)((xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+}
+
+static void bitmap_set(uint8_t octet, bool approved)
+{
+    uint32_t bit = 1u << (octet & 31);
+    if (approved) {
+        __atomic_fetch_or(&approved_bitmap[octet >> 5], bit, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&approved_bitmap[octet >> 5], ~bit, __ATOMIC_RELAXED);
+    }
+}
+
+// Approval set changed - the saver task batches these into one commit
+static void mark_dirty(void)
+{
+    last_change = now_s();
+    if (!dirty) {
+        dirty = true;
+        dirty_since = last_change;
+        if (saver_task_handle) {
+            xTaskNotifyGive(saver_task_handle);
+        }
+    }
+}
+
+static int find_mac(const uint8_t mac[6])
+{
+    for (int i = 0; i < CLIENT_TABLE_SIZE; i++) {
+        if (in_use[i] && memcmp(entries[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Entry index for a MAC, recycling the stalest disconnected station when full
+// (unapproved ones first, so approvals outlive drive-by visitors)
+static int get_mac(const uint8_t mac[6])
+{
+    int i = find_mac(mac);
+    if (i >= 0) {
+        return i;
+    }
+
+    int victim = -1;
+    for (i = 0; i < CLIENT_TABLE_SIZE; i++) {
+        if (!in_use[i]) {
+            victim = i;
+            break;
+        }
+        const client_entry_t *e = &entries[i];
+        if (e->connected) {
+            continue;
+        }
+        if (victim < 0 ||
+            (entries[victim].approved && !e->approved) ||
+            (entries[victim].approved == e->approved && e->last_seen < entries[victim].last_seen)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return -1;
+    }
+
+    if (in_use[victim] && entries[victim].ip != 0 &&
+        ip_index[host_octet(entries[victim].ip)] == victim) {
+        ip_index[host_octet(entries[victim].ip)] = NO_ENTRY;
+        bitmap_set(host_octet(entries[victim].ip), false);
+    }
+    if (in_use[victim] && entries[victim].approved) {
+        mark_dirty();
+    }
+
+    memset(&entries[victim], 0, sizeof(entries[victim]));
+    memcpy(entries[victim].mac, mac, 6);
+    entries[victim].first_seen = now_s();
+    entries[victim].last_seen = entries[victim].first_seen;
+    in_use[victim] = true;
+    return victim;
+}
+
+// Point the lease octet at entry i and mirror its approval into the bitmap
+static void bind_ip(int i, uint32_t ip)
+{
+    client_entry_t *e = &entries[i];
+    if (e->ip != 0 && e->ip != ip && ip_index[host_octet(e->ip)] == i) {
+        ip_index[host_octet(e->ip)] = NO_ENTRY;
+        bitmap_set(host_octet(e->ip), false);
+    }
+
+    uint8_t octet = host_octet(ip);
+    uint8_t prev = ip_index[octet];
+    if (prev != NO_ENTRY && prev != i) {
+        entries[prev].ip = 0;   // DHCP gave that address to someone else
+    }
+    if (prev != i) {
+        __atomic_store_n(&octet_request[octet], 0, __ATOMIC_RELAXED);   // Previous holder's
+    }
+    e->ip = ip;
+    ip_index[octet] = i;
+    __atomic_store_n(&lease_net, net_of(ip), __ATOMIC_RELAXED);
+    bitmap_set(octet, e->approved);
+}
+
+// Copy an entry with its request stamp folded in (table_mutex held)
+static void copy_entry(int i, client_entry_t *out)
+{
+    *out = entries[i];
+    if (out->ip != 0 && ip_index[host_octet(out->ip)] == i) {
+        out->last_request = __atomic_load_n(&octet_request[host_octet(out->ip)], __ATOMIC_RELAXED);
+    }
+}
+
+// Drop approvals past their TTL (table_mutex held)
+static void sweep_expired(void)
+{
+    uint32_t now = now_s();
+    for (int i = 0; i < CLIENT_TABLE_SIZE; i++) {
+        client_entry_t *e = &entries[i];
+        if (!in_use[i] || !e->approved || (int32_t)(e->expires_at - now) > 0) {
+            continue;
+        }
+        e->approved = false;
+        if (e->ip != 0 && ip_index[host_octet(e->ip)] == i) {
+            bitmap_set(host_octet(e->ip), false);
+        }
+        ESP_LOGI(TAG, "Approval expired for " MACSTR, MAC2STR(e->mac));
+        mark_dirty();
+    }
+}
+
+// Restore approvals saved before the reboot; stations come back disconnected
+// and get their bit again from the next DHCP assignment
+static void load_approvals(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+
+    uint8_t blob[1 + CLIENT_TABLE_SIZE * sizeof(approval_record_t)];
+    size_t len = sizeof(blob);
+    esp_err_t err = nvs_get_blob(nvs, APPROVALS_KEY, blob, &len);
+    nvs_close(nvs);
+    if (err != ESP_OK || len < 1 || blob[0] != APPROVALS_VERSION ||
+        (len - 1) % sizeof(approval_record_t) != 0) {
+        return;
+    }
+
+    uint32_t now = now_s();
+    int restored = 0;
+    for (size_t off = 1; off < len; off += sizeof(approval_record_t)) {
+        approval_record_t rec;
+        memcpy(&rec, blob + off, sizeof(rec));
+        int i = rec.ttl_min > 0 ? get_mac(rec.mac) : -1;
+        if (i < 0) {
+            continue;
+        }
+        entries[i].approved = true;
+        entries[i].approved_at = now;
+        entries[i].expires_at = now + rec.ttl_min * 60u;
+        restored++;
+    }
+    dirty = false;   // get_mac may have flagged evictions - nothing new to write
+    ESP_LOGI(TAG, "✓ Restored %d approved stations", restored);
+}
+
+void client_table_flush(void)
+{
+    if (!table_mutex) return;
+
+    uint8_t blob[1 + CLIENT_TABLE_SIZE * sizeof(approval_record_t)];
+    size_t len = 1;
+
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    if (!dirty) {
+        xSemaphoreGive(table_mutex);
+        return;
+    }
+    uint32_t now = now_s();
+    blob[0] = APPROVALS_VERSION;
+    for (int i = 0; i < CLIENT_TABLE_SIZE; i++) {
+        const client_entry_t *e = &entries[i];
+        int32_t left = (int32_t)(e->expires_at - now);
+        if (!in_use[i] || !e->approved || left <= 0) {
+            continue;
+        }
+        approval_record_t rec;
+        memcpy(rec.mac, e->mac, 6);
+        rec.ttl_min = (uint16_t)((left + 59) / 60);
+        memcpy(blob + len, &rec, sizeof(rec));
+        len += sizeof(rec);
+    }
+    dirty = false;
+    xSemaphoreGive(table_mutex);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, APPROVALS_KEY, blob, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Saving approvals failed: %s", esp_err_to_name(err));
+        xSemaphoreTake(table_mutex, portMAX_DELAY);
+        mark_dirty();   // Retry on the next pass
+        xSemaphoreGive(table_mutex);
+        return;
+    }
+    ESP_LOGI(TAG, "✓ Saved %d approved stations", (int)((len - 1) / sizeof(approval_record_t)));
+}
+
+// True while a burst of approval changes is still settling
+static bool save_deferred(void)
+{
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    uint32_t now = now_s();
+    bool defer = dirty &&
+                 now - last_change < CLIENT_TABLE_SAVE_DELAY_S &&
+                 now - dirty_since < CLIENT_TABLE_SAVE_MAX_S;
+    xSemaphoreGive(table_mutex);
+    return defer;
+}
+
+static void saver_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CLIENT_TABLE_SWEEP_S * 1000));
+        while (save_deferred()) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+
+        xSemaphoreTake(table_mutex, portMAX_DELAY);
+        sweep_expired();
+        xSemaphoreGive(table_mutex);
+
+        client_table_flush();
+    }
+}
+
+esp_err_t client_table_init(void)
+{
+    if (table_mutex) {
+        return ESP_OK;
+    }
+    table_mutex = xSemaphoreCreateMutex();
+    if (!table_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(ip_index, NO_ENTRY, sizeof(ip_index));
+    load_approvals();
+
+    xTaskCreate(saver_task, "client_table", 3072, NULL, 2, &saver_task_handle);
+    esp_register_shutdown_handler(client_table_flush);   // OTA and portal restarts
+
+    ESP_LOGI(TAG, "✓ Client table ready (%d stations)", CLIENT_TABLE_SIZE);
+    return ESP_OK;
+}
+
+void client_table_station_joined(const uint8_t mac[6])
+{
+    if (!table_mutex) return;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    int i = get_mac(mac);
+    if (i >= 0) {
+        client_entry_t *e = &entries[i];
+        e->connected = true;
+        e->last_seen = now_s();
+        e->joined_at = e->last_seen;
+
+        // A returning phone often keeps its lease without a fresh DHCP
+        // exchange - reclaim the address if nobody else took it
+        if (e->ip != 0) {
+            uint8_t prev = ip_index[host_octet(e->ip)];
+            if (prev == NO_ENTRY || prev == i) {
+                bind_ip(i, e->ip);
+            } else {
+                e->ip = 0;
+            }
+        }
+        if (e->approved) {
+            ESP_LOGI(TAG, "Approved station " MACSTR " rejoined - skipping portal", MAC2STR(mac));
+        }
+    } else {
+        ESP_LOGW(TAG, "Table full, " MACSTR " not tracked", MAC2STR(mac));
+    }
+
+    xSemaphoreGive(table_mutex);
+}
+
+void client_table_station_left(const uint8_t mac[6])
+{
+    if (!table_mutex) return;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    int i = find_mac(mac);
+    if (i >= 0) {
+        client_entry_t *e = &entries[i];
+        e->connected = false;
+        e->last_seen = now_s();
+        // Keep the lease binding for a quick return, but stop forwarding for it
+        if (e->ip != 0 && ip_index[host_octet(e->ip)] == i) {
+            bitmap_set(host_octet(e->ip), false);
+        }
+    }
+
+    xSemaphoreGive(table_mutex);
+}
+
+void client_table_station_ip(const uint8_t mac[6], uint32_t ip)
+{
+    if (!table_mutex || ip == 0) return;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    int i = get_mac(mac);
+    if (i >= 0) {
+        entries[i].connected = true;
+        entries[i].last_seen = now_s();
+        bind_ip(i, ip);
+    }
+
+    xSemaphoreGive(table_mutex);
+}
+
+static void approve_entry(int i)
+{
+    client_entry_t *e = &entries[i];
+    if (!e->approved) {
+        e->approved = true;
+        e->approved_at = now_s();
+        ESP_LOGI(TAG, "✓ Approved " MACSTR, MAC2STR(e->mac));
+    }
+    e->expires_at = now_s() + CLIENT_TABLE_APPROVAL_TTL_S;
+    mark_dirty();
+    if (e->ip != 0 && e->connected && ip_index[host_octet(e->ip)] == i) {
+        bitmap_set(host_octet(e->ip), true);
+    }
+}
+
+static void notify_approved(const uint8_t mac[6])
+{
+    client_table_approval_hook_t hook = __atomic_load_n(&approval_hook, __ATOMIC_ACQUIRE);
+    if (hook) {
+        hook(mac, CLIENT_TABLE_APPROVAL_TTL_S);
+    }
+}
+
+esp_err_t client_table_approve_ip(uint32_t ip)
+{
+    if (!table_mutex) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    uint8_t i = ip_index[host_octet(ip)];
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    uint8_t mac[6];
+    if (i != NO_ENTRY && entries[i].ip == ip) {
+        approve_entry(i);
+        memcpy(mac, entries[i].mac, 6);
+        err = ESP_OK;
+    }
+
+    xSemaphoreGive(table_mutex);
+    if (err == ESP_OK) {
+        notify_approved(mac);
+    }
+    return err;
+}
+
+esp_err_t client_table_approve_mac(const uint8_t mac[6])
+{
+    if (!table_mutex) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    int i = get_mac(mac);
+    if (i >= 0) {
+        approve_entry(i);
+    }
+
+    xSemaphoreGive(table_mutex);
+    if (i >= 0) {
+        notify_approved(mac);
+    }
+    return i >= 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+void client_table_set_approval_hook(client_table_approval_hook_t hook)
+{
+    __atomic_store_n(&approval_hook, hook, __ATOMIC_RELEASE);
+}
+
+esp_err_t client_table_import_approval(const uint8_t mac[6], uint32_t expires_in_s)
+{
+    if (!table_mutex) return ESP_ERR_INVALID_STATE;
+    if (expires_in_s == 0) return ESP_ERR_INVALID_ARG;
+    if (expires_in_s > CLIENT_TABLE_APPROVAL_TTL_S) {
+        expires_in_s = CLIENT_TABLE_APPROVAL_TTL_S;   // Nobody grants more than a day
+    }
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    int i = find_mac(mac);
+    if (i >= 0) {
+        client_entry_t *e = &entries[i];
+        uint32_t expires_at = now_s() + expires_in_s;
+        if (!e->approved) {
+            e->approved = true;
+            e->approved_at = now_s();
+            e->expires_at = expires_at;
+            ESP_LOGI(TAG, "✓ Approved " MACSTR " (granted by the fleet)", MAC2STR(e->mac));
+        } else if ((int32_t)(expires_at - e->expires_at) > 0) {
+            e->expires_at = expires_at;
+        }
+        mark_dirty();
+        if (e->ip != 0 && e->connected && ip_index[host_octet(e->ip)] == i) {
+            bitmap_set(host_octet(e->ip), true);
+        }
+    }
+
+    xSemaphoreGive(table_mutex);
+    return i >= 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void client_table_clear_approvals(void)
+{
+    if (!table_mutex) return;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+
+    for (int i = 0; i < CLIENT_TABLE_SIZE; i++) {
+        if (entries[i].approved) {
+            mark_dirty();
+        }
+        entries[i].approved = false;
+        entries[i].approved_at = 0;
+        entries[i].expires_at = 0;
+    }
+    for (int w = 0; w < 8; w++) {
+        __atomic_store_n(&approved_bitmap[w], 0, __ATOMIC_RELAXED);
+    }
+
+    xSemaphoreGive(table_mutex);
+}
+
+void client_table_touch_ip(uint32_t ip)
+{
+    if (on_lease_net(ip)) {
+        __atomic_store_n(&octet_request[host_octet(ip)], now_s(), __ATOMIC_RELAXED);
+    }
+}
+
+bool client_table_is_octet_approved(uint8_t octet)
+{
+    return (__atomic_load_n(&approved_bitmap[octet >> 5], __ATOMIC_RELAXED) >> (octet & 31)) & 1;
+}
+
+bool client_table_is_ip_approved(uint32_t ip)
+{
+    return on_lease_net(ip) && client_table_is_octet_approved(host_octet(ip));
+}
+
+bool client_table_find_mac(const uint8_t mac[6], client_entry_t *out)
+{
+    if (!table_mutex) return false;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    int i = find_mac(mac);
+    if (i >= 0) {
+        copy_entry(i, out);
+    }
+    xSemaphoreGive(table_mutex);
+    return i >= 0;
+}
+
+bool client_table_find_ip(uint32_t ip, client_entry_t *out)
+{
+    if (!table_mutex || ip == 0) return false;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    uint8_t i = ip_index[host_octet(ip)];
+    bool found = i != NO_ENTRY && entries[i].ip == ip;
+    if (found) {
+        copy_entry(i, out);
+    }
+    xSemaphoreGive(table_mutex);
+    return found;
+}
+
+size_t client_table_list(client_entry_t *out, size_t max)
+{
+    size_t n = 0;
+    if (!table_mutex) return 0;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    for (int i = 0; i < CLIENT_TABLE_SIZE && n < max; i++) {
+        if (in_use[i]) {
+            copy_entry(i, &out[n++]);
+        }
+    }
+    xSemaphoreGive(table_mutex);
+    return n;
+}
@@ -0,0 +1,113 @@
+#ifndef CLIENT_TABLE_H
+#define CLIENT_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Stations remembered (AP limit is 10, the rest covers phones that left and may return)
+#define CLIENT_TABLE_SIZE 32
+
+// Approvals last a convention day, then the portal shows again
+#define CLIENT_TABLE_APPROVAL_TTL_S (24 * 3600)
+
+// Approval changes are batched into one NVS commit: written once the set has
+// been quiet for SAVE_DELAY, or SAVE_MAX after the first change at the latest
+#define CLIENT_TABLE_SAVE_DELAY_S 5
+#define CLIENT_TABLE_SAVE_MAX_S   30
+#define CLIENT_TABLE_SWEEP_S      60   // Expired approvals are dropped this often
+
+typedef struct {
+    uint8_t mac[6];
+    bool connected;        // Associated with the AP right now
+    bool approved;         // Tapped "Connect" - bound to the MAC, not the lease
+    uint32_t ip;           // Last DHCP lease, network byte order (0 = none yet)
+    uint32_t first_seen;   // Seconds since boot
+    uint32_t last_seen;
+    uint32_t joined_at;    // Start of the current (or last) association
+    uint32_t last_request; // Last DNS query or portal connection from its lease, 0 = none
+    uint32_t approved_at;
+    uint32_t expires_at;   // Approval end, seconds since boot
+} client_entry_t;
+
+/**
+ * Create the table and restore approvals saved before the last reboot
+ * Call after nvs_flash_init and before the AP comes up
+ */
+esp_err_t client_table_init(void);
+
+/**
+ * Write pending approval changes to NVS now (also runs on esp_restart)
+ */
+void client_table_flush(void);
+
+/**
+ * Wi-Fi / DHCP events: WIFI_EVENT_AP_STACONNECTED, WIFI_EVENT_AP_STADISCONNECTED
+ * and IP_EVENT_AP_STAIPASSIGNED
+ */
+void client_table_station_joined(const uint8_t mac[6]);
+void client_table_station_left(const uint8_t mac[6]);
+void client_table_station_ip(const uint8_t mac[6], uint32_t ip);
+
+/**
+ * A DNS query or HTTP connection came from this lease - lock-free, cheap
+ * enough for every request (keyed by host octet, like the approval bitmap;
+ * addresses off the lease subnet are ignored)
+ */
+void client_table_touch_ip(uint32_t ip);
+
+/**
+ * Approve the station currently holding this lease
+ * ESP_ERR_NOT_FOUND if no station is known at that address
+ */
+esp_err_t client_table_approve_ip(uint32_t ip);
+
+/**
+ * Approve a station by MAC (creates the entry if needed)
+ */
+esp_err_t client_table_approve_mac(const uint8_t mac[6]);
+
+/**
+ * Called after a local approval (portal tap, API) with the time it lasts;
+ * imported approvals don't call it. Runs on the approving task, keep it short
+ */
+typedef void (*client_table_approval_hook_t)(const uint8_t mac[6], uint32_t expires_in_s);
+void client_table_set_approval_hook(client_table_approval_hook_t hook);
+
+/**
+ * Approval granted elsewhere (another stick in the fleet) for a station this
+ * table already knows; extends, never shortens, an existing approval
+ * ESP_ERR_NOT_FOUND if the MAC has no entry
+ */
+esp_err_t client_table_import_approval(const uint8_t mac[6], uint32_t expires_in_s);
+
+/**
+ * Drop every approval
+ */
+void client_table_clear_approvals(void);
+
+/**
+ * Is the station holding this lease approved - O(1) through the IP index
+ * False for addresses outside the lease subnet, whatever their last octet
+ */
+bool client_table_is_ip_approved(uint32_t ip);
+
+/**
+ * Same, keyed by the host octet of the AP's /24 - a single bit test,
+ * safe to call per packet from the tcpip thread
+ */
+bool client_table_is_octet_approved(uint8_t octet);
+
+/**
+ * Copy the entry for a MAC / the station holding a lease
+ */
+bool client_table_find_mac(const uint8_t mac[6], client_entry_t *out);
+bool client_table_find_ip(uint32_t ip, client_entry_t *out);
+
+/**
+ * Copy all entries, returns the count
+ */
+size_t client_table_list(client_entry_t *out, size_t max);
+
+#endif // CLIENT_TABLE_H
@@ -0,0 +1,323 @@
+#include "dhcp_leases.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "DHCPLeases";
+
+// One slot per pool address. Address -> station lookups go through
+// client_table's lease index (fed by the same DHCPACK event), not these
+static dhcp_lease_t slots[DHCP_LEASES_POOL_MAX];
+static SemaphoreHandle_t lease_mutex = NULL;
+
+static esp_netif_t *ap_netif = NULL;
+static dhcp_leases_config_t config = {
+    .lease_min = DHCP_LEASES_TIME_DEFAULT,
+    .pool_size = DHCP_LEASES_POOL_MAX,
+};
+static bool config_pending = false;
+static uint16_t associated = 0;
+static uint32_t assigned_total = 0;
+static uint32_t reused_total = 0;
+
+static uint32_t now_s(void)
+{
+    return (uint32_t)((xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+}
+
+static bool lease_live(const dhcp_lease_t *l, uint32_t now)
+{
+    return l->ip != 0 && (l->associated || (int32_t)(l->expires_at - now) > 0);
+}
+
+static bool config_valid(const dhcp_leases_config_t *cfg)
+{
+    return cfg->lease_min >= DHCP_LEASES_TIME_MIN && cfg->lease_min <= DHCP_LEASES_TIME_MAX &&
+           cfg->pool_size >= DHCP_LEASES_POOL_MIN && cfg->pool_size <= DHCP_LEASES_POOL_MAX;
+}
+
+static void free_slot(int i)
+{
+    memset(&slots[i], 0, sizeof(slots[i]));
+}
+
+// Scans are fine here: only DHCPACKs and the leases page get this far
+static int find_mac(const uint8_t mac[6])
+{
+    for (int i = 0; i < DHCP_LEASES_POOL_MAX; i++) {
+        if (slots[i].ip != 0 && memcmp(slots[i].mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int find_ip(uint32_t ip)
+{
+    for (int i = 0; i < DHCP_LEASES_POOL_MAX; i++) {
+        if (slots[i].ip == ip) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Push the policy into the stopped server (lease_mutex not held)
+static esp_err_t write_options(const dhcp_leases_config_t *cfg)
+{
+    esp_netif_ip_info_t ip_info;
+    esp_err_t err = esp_netif_get_ip_info(ap_netif, &ip_info);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    dhcps_lease_t range = { .enable = true };
+    range.start_ip.addr = ip_info.ip.addr & ip_info.netmask.addr;
+    range.end_ip.addr = range.start_ip.addr;
+    ((uint8_t *)&range.start_ip.addr)[3] = DHCP_LEASES_FIRST_OCTET;
+    ((uint8_t *)&range.end_ip.addr)[3] = (uint8_t)(DHCP_LEASES_FIRST_OCTET + cfg->pool_size - 1);
+    err = esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_REQUESTED_IP_ADDRESS,
+                                 &range, sizeof(range));
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint32_t lease_units = cfg->lease_min;
+    return esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_IP_ADDRESS_LEASE_TIME,
+                                  &lease_units, sizeof(lease_units));
+}
+
+// Restart the server with the new policy. Its lease list goes with it, so
+// ours is cleared too - nobody is associated to miss theirs
+static void restart_with(const dhcp_leases_config_t *cfg)
+{
+    esp_netif_dhcps_stop(ap_netif);
+    esp_err_t err = write_options(cfg);
+    esp_netif_dhcps_start(ap_netif);
+
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    for (int i = 0; i < DHCP_LEASES_POOL_MAX; i++) {
+        free_slot(i);
+    }
+    xSemaphoreGive(lease_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "DHCP server rejected the lease policy: %s", esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGI(TAG, "✓ DHCP server restarted - %d min leases, %d addresses",
+             cfg->lease_min, cfg->pool_size);
+}
+
+esp_err_t dhcp_leases_init(esp_netif_t *ap)
+{
+    if (lease_mutex) {
+        return ESP_OK;
+    }
+    lease_mutex = xSemaphoreCreateMutex();
+    if (!lease_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    ap_netif = ap;
+
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        dhcp_leases_config_t cfg = config;
+        nvs_get_u16(nvs, "dhcp_lease", &cfg.lease_min);
+        nvs_get_u16(nvs, "dhcp_pool", &cfg.pool_size);
+        nvs_close(nvs);
+        if (config_valid(&cfg)) {
+            config = cfg;
+        }
+    }
+
+    if (ap_netif) {
+        esp_err_t err = write_options(&config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "DHCP server rejected the lease policy: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "✓ DHCP leases: %d min, %d addresses from .%d",
+             config.lease_min, config.pool_size, DHCP_LEASES_FIRST_OCTET);
+    return ESP_OK;
+}
+
+void dhcp_leases_station_joined(const uint8_t mac[6])
+{
+    if (!lease_mutex) {
+        return;
+    }
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    associated++;
+    int i = find_mac(mac);
+    if (i >= 0) {
+        slots[i].associated = true;   // Back within its lease, dhcps will hand out the same address
+    }
+    xSemaphoreGive(lease_mutex);
+}
+
+void dhcp_leases_station_left(const uint8_t mac[6])
+{
+    if (!lease_mutex) {
+        return;
+    }
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    if (associated > 0) {
+        associated--;
+    }
+    int i = find_mac(mac);
+    if (i >= 0) {
+        slots[i].associated = false;   // The lease itself runs on until it expires
+    }
+    bool apply = config_pending && associated == 0 && ap_netif;
+    dhcp_leases_config_t cfg = config;
+    if (apply) {
+        config_pending = false;
+    }
+    xSemaphoreGive(lease_mutex);
+
+    if (apply) {
+        restart_with(&cfg);
+    }
+}
+
+void dhcp_leases_assigned(const uint8_t mac[6], uint32_t ip)
+{
+    if (!lease_mutex || ip == 0) {
+        return;
+    }
+    uint32_t now = now_s();
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    assigned_total++;
+
+    // dhcps keeps one lease per MAC - a new address retires the old one
+    int i = find_mac(mac);
+    if (i >= 0 && slots[i].ip != ip) {
+        free_slot(i);
+        i = -1;
+    }
+
+    // Someone else's lease on this address has ended (or been reclaimed)
+    int prev = i < 0 ? find_ip(ip) : -1;
+    if (prev >= 0) {
+        free_slot(prev);
+    }
+
+    // Free slot first, then the lease that ran out longest ago
+    for (int s = 0; i < 0 && s < DHCP_LEASES_POOL_MAX; s++) {
+        if (slots[s].ip == 0) {
+            i = s;
+        }
+    }
+    if (i < 0) {
+        for (int s = 0; s < DHCP_LEASES_POOL_MAX; s++) {
+            if (!slots[s].associated &&
+                (i < 0 || (int32_t)(slots[s].expires_at - slots[i].expires_at) < 0)) {
+                i = s;
+            }
+        }
+        i = i < 0 ? 0 : i;
+        if (lease_live(&slots[i], now)) {
+            ESP_LOGW(TAG, "Lease table full - forgetting " MACSTR, MAC2STR(slots[i].mac));
+        }
+        reused_total++;
+        free_slot(i);
+    }
+
+    dhcp_lease_t *l = &slots[i];
+    memcpy(l->mac, mac, 6);
+    l->ip = ip;
+    l->assigned_at = now;
+    l->expires_at = now + (uint32_t)config.lease_min * 60;
+    l->associated = true;
+    xSemaphoreGive(lease_mutex);
+}
+
+size_t dhcp_leases_list(dhcp_lease_t *out, size_t max)
+{
+    if (!lease_mutex) {
+        return 0;
+    }
+    size_t n = 0;
+    uint32_t now = now_s();
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    for (int i = 0; i < DHCP_LEASES_POOL_MAX && n < max; i++) {
+        if (lease_live(&slots[i], now)) {
+            out[n++] = slots[i];
+        }
+    }
+    xSemaphoreGive(lease_mutex);
+    return n;
+}
+
+esp_err_t dhcp_leases_set_config(const dhcp_leases_config_t *cfg, bool persist)
+{
+    if (!lease_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    config = *cfg;
+    bool apply_now = associated == 0 && ap_netif;
+    config_pending = !apply_now && ap_netif;
+    xSemaphoreGive(lease_mutex);
+
+    if (apply_now) {
+        restart_with(cfg);
+    } else if (config_pending) {
+        ESP_LOGI(TAG, "Lease policy saved - applies once the AP is empty");
+    }
+
+    if (!persist) {
+        return ESP_OK;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u16(nvs, "dhcp_lease", cfg->lease_min);
+    nvs_set_u16(nvs, "dhcp_pool", cfg->pool_size);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+void dhcp_leases_get_config(dhcp_leases_config_t *cfg)
+{
+    if (!lease_mutex) {
+        *cfg = config;
+        return;
+    }
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(lease_mutex);
+}
+
+void dhcp_leases_get_status(dhcp_leases_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    if (!lease_mutex) {
+        return;
+    }
+    uint32_t now = now_s();
+    xSemaphoreTake(lease_mutex, portMAX_DELAY);
+    for (int i = 0; i < DHCP_LEASES_POOL_MAX; i++) {
+        if (lease_live(&slots[i], now)) {
+            status->active++;
+        }
+    }
+    status->associated = associated;
+    status->assigned = assigned_total;
+    status->reused = reused_total;
+    status->pending = config_pending;
+    xSemaphoreGive(lease_mutex);
+}
@@ -0,0 +1,70 @@
+#ifndef DHCP_LEASES_H
+#define DHCP_LEASES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+
+// Pool starts right after the AP's own address (.1); lwIP's dhcps caps a
+// range at 100 addresses (DHCPS_MAX_LEASE)
+#define DHCP_LEASES_FIRST_OCTET 2
+#define DHCP_LEASES_POOL_MIN    8
+#define DHCP_LEASES_POOL_MAX    100
+
+// Lease time in minutes - one CONFIG_LWIP_DHCPS_LEASE_UNIT each
+#define DHCP_LEASES_TIME_MIN     1
+#define DHCP_LEASES_TIME_MAX     1440
+#define DHCP_LEASES_TIME_DEFAULT 30
+
+typedef struct {
+    uint16_t lease_min;    // 1..1440
+    uint16_t pool_size;    // 8..100 addresses from .2
+} dhcp_leases_config_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t ip;           // Network byte order
+    uint32_t assigned_at;  // Last DHCPACK, seconds since boot
+    uint32_t expires_at;
+    bool associated;       // Station is on the AP right now
+} dhcp_lease_t;
+
+typedef struct {
+    uint16_t active;       // Leases not yet expired
+    uint16_t associated;   // Stations on the AP
+    uint32_t assigned;     // DHCPACKs seen since boot
+    uint32_t reused;       // Slots taken over from expired leases
+    bool pending;          // Config waits for the AP to empty
+} dhcp_leases_status_t;
+
+/**
+ * Load the lease policy from NVS and apply it to the AP's DHCP server
+ * Call while the server is stopped (before esp_netif_dhcps_start);
+ * ap may be NULL where no server runs (host build)
+ */
+esp_err_t dhcp_leases_init(esp_netif_t *ap);
+
+/**
+ * Wi-Fi / DHCP events: WIFI_EVENT_AP_STACONNECTED, WIFI_EVENT_AP_STADISCONNECTED
+ * and IP_EVENT_AP_STAIPASSIGNED (fires on every ACK, renewals included)
+ */
+void dhcp_leases_station_joined(const uint8_t mac[6]);
+void dhcp_leases_station_left(const uint8_t mac[6]);
+void dhcp_leases_assigned(const uint8_t mac[6], uint32_t ip);
+
+/**
+ * Copy the unexpired leases, returns the count
+ */
+size_t dhcp_leases_list(dhcp_lease_t *out, size_t max);
+
+/**
+ * dhcps only takes options while stopped: applied at once if no station is
+ * on the AP, otherwise when the last one leaves (pending in the status)
+ */
+esp_err_t dhcp_leases_set_config(const dhcp_leases_config_t *config, bool persist);
+void dhcp_leases_get_config(dhcp_leases_config_t *config);
+void dhcp_leases_get_status(dhcp_leases_status_t *status);
+
+#endif // DHCP_LEASES_H
@@ -1,4 +1,6 @@
 #include "dns_server.h"
+#include "client_table.h"
+#include "mdns_responder.h"
 #include "esp_log.h"
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
@@ -10,16 +12,19 @@ static const char *TAG = "DNS";
 
 #define DNS_PORT 53
 #define DNS_MAX_LEN 512
-#define UPSTREAM_DNS "8.8.8.8"
-#define MAX_APPROVED_CLIENTS 16
+#define DNS_TYPE_A    1
+#define DNS_TYPE_AAAA 28
+#define DNS_TYPE_ANY  255
+#ifndef UPSTREAM_DNS
+#define UPSTREAM_DNS "8.8.8.8"   // Host builds point this at a local resolver
+#endif
 
 // Global flag: enable/disable captive portal hijacking
 // Disabled by default - enabled when user selects a portal from menu
 static bool captive_mode_enabled = false;
 
-// Client approval tracking
-static uint32_t approved_clients[MAX_APPROVED_CLIENTS] = {0};
-static int approved_count = 0;
+// Where forwarded queries go; the uplink monitor moves this to the healthiest resolver
+static uint32_t upstream_ip = 0;
 
 // Server state tracking
 static TaskHandle_t dns_task_handle = NULL;
@@ -137,13 +142,40 @@ static int build_captive_response(char *tx_buffer, const char *rx_buffer, int rx
     return answer_offset;
 }
 
-// Forward DNS query to upstream DNS server (8.8.8.8)
+// NOERROR with no answer (NODATA): the name exists, just not with this type
+static int build_nodata_response(char *tx_buffer, const char *rx_buffer, int question_end, uint16_t flags)
+{
+    memcpy(tx_buffer, rx_buffer, question_end);
+    dns_header_t *resp_header = (dns_header_t *)tx_buffer;
+    resp_header->flags = htons(flags);
+    resp_header->ancount = 0;
+    resp_header->nscount = 0;
+    resp_header->arcount = 0;
+    return question_end;
+}
+
+// Names we answer for (labportal.local, hijacked probes): A (or ANY) ->
+// 192.168.4.1, other types NODATA. The reply ends after the question so an
+// EDNS record can't land ahead of the answer
+static int build_ap_response(char *tx_buffer, const char *rx_buffer, int question_end, uint16_t qtype)
+{
+    if (qtype != DNS_TYPE_A && qtype != DNS_TYPE_ANY) {
+        return build_nodata_response(tx_buffer, rx_buffer, question_end, 0x8400);
+    }
+    int len = build_captive_response(tx_buffer, rx_buffer, question_end);
+    dns_header_t *resp_header = (dns_header_t *)tx_buffer;
+    resp_header->nscount = 0;
+    resp_header->arcount = 0;
+    return len;
+}
+
+// Forward DNS query to upstream DNS server (8.8.8.8 unless the uplink monitor picked another)
 static int forward_dns_query(const char *query, int query_len, char *response, int max_response_len)
 {
     struct sockaddr_in upstream_addr;
     upstream_addr.sin_family = AF_INET;
     upstream_addr.sin_port = htons(DNS_PORT);
-    inet_pton(AF_INET, UPSTREAM_DNS, &upstream_addr.sin_addr);
+    upstream_addr.sin_addr.s_addr = dns_get_upstream();
 
     int upstream_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
     if (upstream_sock < 0) {
@@ -226,7 +258,10 @@ static void dns_server_task(void *pvParameters)
 
     ESP_LOGI(TAG, "DNS proxy server started on port 53");
     ESP_LOGI(TAG, "Captive portal domains -> 192.168.4.1");
-    ESP_LOGI(TAG, "All other domains -> forwarded to %s", UPSTREAM_DNS);
+    char upstream_str[16];
+    uint32_t upstream = dns_get_upstream();
+    inet_ntoa_r(upstream, upstream_str, sizeof(upstream_str));
+    ESP_LOGI(TAG, "All other domains -> forwarded to %s", upstream_str);
 
     while (dns_server_running) {
         struct sockaddr_in source_addr;
@@ -252,12 +287,39 @@ static void dns_server_task(void *pvParameters)
         }
 
         // Parse the domain name from the query
-        parse_dns_name(rx_buffer, sizeof(dns_header_t), domain, sizeof(domain));
+        int question_end = parse_dns_name(rx_buffer, sizeof(dns_header_t), domain, sizeof(domain)) + 4;
+        if (question_end > len) {
+            continue; // Truncated question
+        }
+        uint16_t qtype = ((uint8_t)rx_buffer[question_end - 4] << 8) | (uint8_t)rx_buffer[question_end - 3];
 
         inet_ntoa_r(source_addr.sin_addr, addr_str, sizeof(addr_str) - 1);
 
         uint32_t client_ip = source_addr.sin_addr.s_addr;
         bool client_approved = dns_is_client_approved(client_ip);
+        client_table_touch_ip(client_ip);   // Counts as activity for admission control
+
+        // The device's own name resolves for everyone, approved or not
+        if (mdns_responder_is_local_name(domain)) {
+            ESP_LOGD(TAG, "LOCAL: %s (type %d) -> 192.168.4.1", domain, qtype);
+            int tx_len = build_ap_response(tx_buffer, rx_buffer, question_end, qtype);
+            sendto(sock, tx_buffer, tx_len, 0,
+                  (struct sockaddr *)&source_addr, sizeof(source_addr));
+            continue;
+        }
+
+        // The AP is IPv4-only: lwIP never sends RAs and there is no NAT66, so
+        // a real AAAA answer only sends a dual-stack phone down a dead v6 path
+        // until happy eyeballs gives up on it. Answer NODATA straight away, as
+        // a recursive resolver would (RA set, RD echoed)
+        if (qtype == DNS_TYPE_AAAA) {
+            ESP_LOGD(TAG, "NODATA: %s AAAA (no IPv6 on the AP)", domain);
+            uint16_t flags = 0x8080 | (ntohs(header->flags) & 0x0100);
+            int tx_len = build_nodata_response(tx_buffer, rx_buffer, question_end, flags);
+            sendto(sock, tx_buffer, tx_len, 0,
+                  (struct sockaddr *)&source_addr, sizeof(source_addr));
+            continue;
+        }
 
         // Access control logic:
         // Only hijack captive detection domains for NON-approved clients
@@ -266,16 +328,16 @@ static void dns_server_task(void *pvParameters)
             // New client - hijack to show portal popup
             ESP_LOGI(TAG, "CAPTIVE: %s -> 192.168.4.1 (new client, trigger popup)", domain);
 
-            int tx_len = build_captive_response(tx_buffer, rx_buffer, len);
+            int tx_len = build_ap_response(tx_buffer, rx_buffer, question_end, qtype);
 
             sendto(sock, tx_buffer, tx_len, 0,
                   (struct sockaddr *)&source_addr, sizeof(source_addr));
         } else {
             // Forward to upstream DNS - NAT will handle the traffic
             if (client_approved && is_captive_portal_domain(domain)) {
-                ESP_LOGI(TAG, "APPROVED: %s -> %s (client approved, releasing)", domain, UPSTREAM_DNS);
+                ESP_LOGI(TAG, "APPROVED: %s -> upstream (client approved, releasing)", domain);
             } else {
-                ESP_LOGD(TAG, "FORWARD: %s -> %s", domain, UPSTREAM_DNS);
+                ESP_LOGD(TAG, "FORWARD: %s -> upstream", domain);
             }
 
             int response_len = forward_dns_query(rx_buffer, len, tx_buffer, sizeof(tx_buffer));
@@ -337,10 +399,6 @@ void dns_server_stop(void)
         dns_task_handle = NULL;
     }
 
-    // Clear approved clients for fresh start
-    approved_count = 0;
-    memset(approved_clients, 0, sizeof(approved_clients));
-
     ESP_LOGI(TAG, "✓ DNS server stopped");
 }
 
@@ -354,34 +412,47 @@ void dns_set_captive_mode(bool enable)
     }
 }
 
-void dns_approve_client(uint32_t client_ip)
+void dns_set_upstream(uint32_t resolver_ip)
 {
-    // Check if already approved
-    for (int i = 0; i < approved_count; i++) {
-        if (approved_clients[i] == client_ip) {
-            uint8_t *ip_bytes = (uint8_t*)&client_ip;
-            ESP_LOGI(TAG, "Client already approved: %d.%d.%d.%d", ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3]);
-            return;
-        }
+    __atomic_store_n(&upstream_ip, resolver_ip, __ATOMIC_RELAXED);
+}
+
+uint32_t dns_get_upstream(void)
+{
+    uint32_t ip = __atomic_load_n(&upstream_ip, __ATOMIC_RELAXED);
+    if (ip == 0) {
+        struct in_addr def;
+        inet_pton(AF_INET, UPSTREAM_DNS, &def);
+        ip = def.s_addr;
     }
+    return ip;
+}
 
-    // Add to approved list
-    if (approved_count < MAX_APPROVED_CLIENTS) {
-        approved_clients[approved_count++] = client_ip;
-        uint8_t *ip_bytes = (uint8_t*)&client_ip;
+// Approvals live in the client table, bound to the station MAC so they
+// survive reconnects and DHCP handing the phone a different address
+esp_err_t dns_approve_client(uint32_t client_ip)
+{
+    uint8_t *ip_bytes = (uint8_t*)&client_ip;
+    esp_err_t err = client_table_approve_ip(client_ip);
+    if (err == ESP_OK) {
         ESP_LOGI(TAG, "✓ APPROVED client for internet access: %d.%d.%d.%d", ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3]);
     } else {
-        uint8_t *ip_bytes = (uint8_t*)&client_ip;
-        ESP_LOGW(TAG, "Approved client list full! Cannot approve: %d.%d.%d.%d", ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3]);
+        ESP_LOGW(TAG, "No station holds %d.%d.%d.%d - not approved", ip_bytes[0], ip_bytes[1], ip_bytes[2], ip_bytes[3]);
     }
+    return err;
 }
 
 bool dns_is_client_approved(uint32_t client_ip)
 {
-    for (int i = 0; i < approved_count; i++) {
-        if (approved_clients[i] == client_ip) {
-            return true;
-        }
-    }
-    return false;
+    return client_table_is_ip_approved(client_ip);
+}
+
+bool dns_is_octet_approved(uint8_t octet)
+{
+    return client_table_is_octet_approved(octet);
+}
+
+bool dns_client_may_forward(uint8_t octet)
+{
+    return !captive_mode_enabled || dns_is_octet_approved(octet);
 }
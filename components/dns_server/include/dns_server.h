@@ -3,17 +3,19 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "esp_err.h"
 
 /**
  * Start DNS hijack server
  * All DNS queries will be answered with 192.168.4.1
  * This triggers captive portal popup on phones
+ * AAAA queries always get NODATA - the AP has no IPv6 path
  */
 void dns_server_start(void);
 
 /**
  * Stop DNS server and release socket
- * Also clears approved client list
+ * Approvals are kept (client table) so a restart doesn't re-prompt everyone
  */
 void dns_server_stop(void);
 
@@ -24,16 +26,36 @@ void dns_server_stop(void);
  */
 void dns_set_captive_mode(bool enable);
 
+/**
+ * Resolver approved clients' queries are forwarded to (network byte order)
+ * 0 restores the build default (8.8.8.8)
+ */
+void dns_set_upstream(uint32_t resolver_ip);
+uint32_t dns_get_upstream(void);
+
 /**
  * Approve a client for internet access
  * Approved clients get DNS forwarded to 8.8.8.8
  * Unapproved clients get captive portal redirects
+ * The approval follows the station's MAC, not the address
+ * Returns ESP_ERR_NOT_FOUND if no associated station holds client_ip
  */
-void dns_approve_client(uint32_t client_ip);
+esp_err_t dns_approve_client(uint32_t client_ip);
 
 /**
  * Check if a client is approved for internet access
  */
 bool dns_is_client_approved(uint32_t client_ip);
 
+/**
+ * Same check keyed by the host octet of the AP's /24 (192.168.4.x)
+ */
+bool dns_is_octet_approved(uint8_t octet);
+
+/**
+ * IP-layer gate for forwarded traffic: true when captive mode is off
+ * or the client is approved. Safe to call per packet from the tcpip thread.
+ */
+bool dns_client_may_forward(uint8_t octet);
+
 #endif // DNS_SERVER_H
@@ -0,0 +1,237 @@
+#include "event_worker.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "EventWorker";
+
+typedef struct {
+    int64_t due_us;
+    uint32_t seq;          // Post order, breaks ties between equal due times
+    event_work_fn fn;
+    uint8_t len;
+    uint8_t arg[EVENT_WORKER_ARG_MAX];
+} work_item_t;
+
+// One binary min-heap per priority, ordered by (due_us, seq)
+typedef struct {
+    work_item_t *items;
+    size_t depth;
+    size_t count;
+    event_worker_stats_t stats;
+} work_queue_t;
+
+static work_item_t link_items[EVENT_WORKER_DEPTH];
+static work_item_t client_items[EVENT_WORKER_CLIENT_DEPTH];
+static work_item_t feedback_items[EVENT_WORKER_DEPTH];
+static work_queue_t queues[EVENT_PRIO_COUNT] = {
+    [EVENT_PRIO_LINK] = { .items = link_items, .depth = EVENT_WORKER_DEPTH },
+    [EVENT_PRIO_CLIENT] = { .items = client_items, .depth = EVENT_WORKER_CLIENT_DEPTH },
+    [EVENT_PRIO_FEEDBACK] = { .items = feedback_items, .depth = EVENT_WORKER_DEPTH },
+};
+static uint32_t next_seq = 0;
+static SemaphoreHandle_t queue_mutex = NULL;
+static TaskHandle_t worker_task_handle = NULL;
+
+static bool item_before(const work_item_t *a, const work_item_t *b)
+{
+    return a->due_us != b->due_us ? a->due_us < b->due_us : (int32_t)(a->seq - b->seq) < 0;
+}
+
+static void swap_items(work_item_t *a, work_item_t *b)
+{
+    work_item_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void heap_push(work_queue_t *q, const work_item_t *item)
+{
+    size_t i = q->count++;
+    q->items[i] = *item;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!item_before(&q->items[i], &q->items[parent])) {
+            break;
+        }
+        swap_items(&q->items[i], &q->items[parent]);
+        i = parent;
+    }
+}
+
+static void heap_pop(work_queue_t *q, work_item_t *out)
+{
+    *out = q->items[0];
+    q->items[0] = q->items[--q->count];
+    size_t i = 0;
+    while (1) {
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        size_t least = i;
+        if (left < q->count && item_before(&q->items[left], &q->items[least])) {
+            least = left;
+        }
+        if (right < q->count && item_before(&q->items[right], &q->items[least])) {
+            least = right;
+        }
+        if (least == i) {
+            break;
+        }
+        swap_items(&q->items[i], &q->items[least]);
+        i = least;
+    }
+}
+
+// Take the due head of the highest priority that has one, or report the
+// earliest future due time across all queues (INT64_MAX if all are empty)
+static bool take_next(work_item_t *out, event_prio_t *prio, int64_t now, int64_t *next_due)
+{
+    *next_due = INT64_MAX;
+    for (int p = 0; p < EVENT_PRIO_COUNT; p++) {
+        work_queue_t *q = &queues[p];
+        if (q->count == 0) {
+            continue;
+        }
+        if (q->items[0].due_us <= now) {
+            heap_pop(q, out);
+            *prio = (event_prio_t)p;
+            return true;
+        }
+        if (q->items[0].due_us < *next_due) {
+            *next_due = q->items[0].due_us;
+        }
+    }
+    return false;
+}
+
+static void record_run(event_prio_t prio, uint32_t wait_us, uint32_t run_us)
+{
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    event_worker_stats_t *s = &queues[prio].stats;
+    if (wait_us > s->max_wait_us) {
+        s->max_wait_us = wait_us;
+    }
+    if (run_us > s->max_run_us) {
+        s->max_run_us = run_us;
+    }
+    xSemaphoreGive(queue_mutex);
+}
+
+static void worker_task(void *pvParameters)
+{
+    while (1) {
+        work_item_t item;
+        event_prio_t prio;
+        int64_t next_due;
+
+        xSemaphoreTake(queue_mutex, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        bool ready = take_next(&item, &prio, now, &next_due);
+        xSemaphoreGive(queue_mutex);
+
+        if (!ready) {
+            // Sleep until the earliest deadline, or until a post wakes us
+            TickType_t ticks = portMAX_DELAY;
+            if (next_due != INT64_MAX) {
+                ticks = pdMS_TO_TICKS((next_due - now + 999) / 1000);
+                ticks = ticks ? ticks : 1;
+            }
+            ulTaskNotifyTake(pdTRUE, ticks);
+            continue;
+        }
+
+        int64_t started = esp_timer_get_time();
+        item.fn(item.arg, item.len);
+        int64_t finished = esp_timer_get_time();
+        record_run(prio, (uint32_t)(started - item.due_us), (uint32_t)(finished - started));
+    }
+}
+
+esp_err_t event_worker_init(void)
+{
+    if (queue_mutex) {
+        return ESP_OK;
+    }
+    queue_mutex = xSemaphoreCreateMutex();
+    if (!queue_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Below the default event loop (20) so handlers always get to enqueue first
+    if (xTaskCreate(worker_task, "event_worker", 4096, NULL, 6, &worker_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ Event worker started (%d priorities, %d client slots)", EVENT_PRIO_COUNT,
+             EVENT_WORKER_CLIENT_DEPTH);
+    return ESP_OK;
+}
+
+// Queue one item; when the priority is full, count it as dropped or as run
+// inline depending on what the caller does next
+static esp_err_t enqueue(event_prio_t prio, event_work_fn fn, const void *arg, size_t len,
+                         uint32_t delay_ms, bool run_inline)
+{
+    if (!queue_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (prio >= EVENT_PRIO_COUNT || !fn || len > EVENT_WORKER_ARG_MAX || (len && !arg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    work_item_t item = {
+        .due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000,
+        .fn = fn,
+        .len = (uint8_t)len,
+    };
+    if (len) {
+        memcpy(item.arg, arg, len);
+    }
+
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    work_queue_t *q = &queues[prio];
+    if (q->count == q->depth) {
+        if (run_inline) {
+            q->stats.ran_inline++;
+        } else {
+            q->stats.dropped++;
+        }
+        xSemaphoreGive(queue_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+    item.seq = next_seq++;
+    heap_push(q, &item);
+    q->stats.posted++;
+    xSemaphoreGive(queue_mutex);
+
+    xTaskNotifyGive(worker_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t event_worker_post(event_prio_t prio, event_work_fn fn, const void *arg, size_t len,
+                            uint32_t delay_ms)
+{
+    return enqueue(prio, fn, arg, len, delay_ms, false);
+}
+
+void event_worker_post_or_run(event_prio_t prio, event_work_fn fn, const void *arg, size_t len)
+{
+    esp_err_t err = enqueue(prio, fn, arg, len, 0, true);
+    if (err == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Priority %d full - running inline", prio);
+    } else if (err != ESP_ERR_INVALID_STATE) {
+        return;   // Queued, or a caller bug that running it wouldn't fix
+    }
+    fn(arg, len);   // Full, or no worker yet
+}
+
+void event_worker_get_stats(event_prio_t prio, event_worker_stats_t *stats)
+{
+    if (!queue_mutex || prio >= EVENT_PRIO_COUNT) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(queue_mutex, portMAX_DELAY);
+    *stats = queues[prio].stats;
+    xSemaphoreGive(queue_mutex);
+}
@@ -0,0 +1,58 @@
+#ifndef EVENT_WORKER_H
+#define EVENT_WORKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Pending actions per priority, and the event payload copied with each.
+// Station bookkeeping gets room for a join and a leave from every station
+// the DHCP server remembers (2 x CONFIG_LWIP_DHCPS_MAX_STATION_NUM)
+#define EVENT_WORKER_DEPTH        16
+#define EVENT_WORKER_CLIENT_DEPTH 128
+#define EVENT_WORKER_ARG_MAX      48
+
+// A ready action always runs before any ready action of a lower priority;
+// within a priority, actions run in due-time order, FIFO for equal times
+typedef enum {
+    EVENT_PRIO_LINK = 0,   // Uplink/AP state: NAT, forward path, probes
+    EVENT_PRIO_CLIENT,     // Station bookkeeping, logs, debug output
+    EVENT_PRIO_FEEDBACK,   // Sounds and other things a human notices later
+    EVENT_PRIO_COUNT,
+} event_prio_t;
+
+// Runs on the worker task with a copy of the payload given to post
+typedef void (*event_work_fn)(const void *arg, size_t len);
+
+typedef struct {
+    uint32_t posted;
+    uint32_t dropped;        // Queue full
+    uint32_t ran_inline;     // Queue full, run on the caller by event_worker_post_or_run
+    uint32_t max_wait_us;    // Due time to start, worst seen
+    uint32_t max_run_us;
+} event_worker_stats_t;
+
+/**
+ * Start the worker task
+ */
+esp_err_t event_worker_init(void);
+
+/**
+ * Queue fn(arg) to run no sooner than delay_ms from now
+ * Copies up to EVENT_WORKER_ARG_MAX bytes of arg; never blocks on the worker,
+ * so it is safe from event handlers. ESP_ERR_NO_MEM if that priority is full
+ */
+esp_err_t event_worker_post(event_prio_t prio, event_work_fn fn, const void *arg, size_t len,
+                            uint32_t delay_ms);
+
+/**
+ * For work that must never be lost (station and link bookkeeping): queue
+ * fn(arg) to run now, or if that priority is full run it right here on the
+ * caller instead. That can overtake queued items, so it is a last resort
+ */
+void event_worker_post_or_run(event_prio_t prio, event_work_fn fn, const void *arg, size_t len);
+
+void event_worker_get_stats(event_prio_t prio, event_worker_stats_t *stats);
+
+#endif // EVENT_WORKER_H
@@ -0,0 +1,764 @@
+#include "fleet_sync.h"
+#include "client_stats.h"
+#include "client_table.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "mbedtls/md.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "Fleet";
+
+// Wire format, big-endian:
+//   magic "LPF1" | type | count | sender STA MAC | boot id | sequence
+//   payload (count records) | first 16 bytes of HMAC-SHA256 over all of the above
+// The boot id is a counter kept in NVS and bumped every boot, so a restarted
+// stick's sequence numbers may start over while its older packets stay
+// refused: receivers keep the highest boot id heard from each sender (in NVS
+// too) and, within that boot, the highest sequence number
+#define FLEET_MAGIC       0x4C504631
+#define FLEET_HEADER_LEN  20
+#define FLEET_TAG_LEN     16
+#define FLEET_TYPE_APPROVALS 1
+#define FLEET_TYPE_LOAD      2
+#define FLEET_APPROVAL_LEN   10   // MAC + seconds left
+#define FLEET_LOAD_LEN       10   // Stations, max, up and down bytes/s
+#define FLEET_APPROVALS_PER_PACKET 48
+#define FLEET_MAX_PACKET (FLEET_HEADER_LEN + FLEET_APPROVALS_PER_PACKET * FLEET_APPROVAL_LEN + FLEET_TAG_LEN)
+
+// Local approvals queued by the client_table hook for the task to send
+#define FLEET_PENDING_MAX 16
+#define FLEET_RESEND_MS   200    // Multicast on Wi-Fi is unacknowledged - send twice
+
+// Senders whose replay window is remembered; twice the peer slots, so a
+// stick that drops out of the peer list keeps its window
+#define FLEET_MAX_WINDOWS (FLEET_MAX_PEERS * 2)
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t ip;
+    uint8_t stations;
+    uint8_t max_stations;       // 0 = no beacon yet
+    uint32_t up_rate;
+    uint32_t down_rate;
+    uint32_t heard_at;
+    bool in_use;
+} peer_slot_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t expires_at;        // Seconds since boot, 0 = free
+} cached_approval_t;
+
+// Highest boot id and, within it, sequence number accepted from a sender.
+// mac and boot_id are what gets persisted; seq restarts at 0 after our own
+// reboot, which lets each packet of the sender's current boot through at most once more
+typedef struct {
+    uint8_t mac[6];
+    uint32_t boot_id;
+    uint32_t seq;
+    uint32_t heard_at;
+    bool in_use;
+} replay_window_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t expires_in_s;
+} approval_rec_t;
+
+static fleet_sync_config_t config = { .enabled = false, .steer = true };
+static uint8_t fleet_key[FLEET_KEY_LEN];
+static bool key_set = false;
+static SemaphoreHandle_t state_mutex = NULL;
+static TaskHandle_t sync_task_handle = NULL;
+static uint8_t our_max_stations = 0;
+static uint8_t self_mac[6];
+static uint32_t boot_id = 0;
+
+static peer_slot_t peers[FLEET_MAX_PEERS];
+static cached_approval_t cache[FLEET_MAX_APPROVALS];
+static replay_window_t windows[FLEET_MAX_WINDOWS];
+static approval_rec_t pending[FLEET_PENDING_MAX];
+static size_t pending_count = 0;
+static fleet_sync_status_t counters;
+
+static uint32_t pending_ip = 0;
+static bool address_dirty = false;
+
+// Task-owned
+static int sync_sock = -1;
+static uint32_t sta_ip = 0;
+static bool joined = false;
+static uint32_t tx_seq = 0;
+static client_stats_t stats_buf[CLIENT_STATS_MAX_TRACKED];
+static client_entry_t table_buf[CLIENT_TABLE_SIZE];
+
+static uint32_t now_s(void)
+{
+    return (uint32_t)((xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool compute_tag(const uint8_t *data, size_t len, uint8_t tag[FLEET_TAG_LEN])
+{
+    uint8_t full[32];
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (!md || mbedtls_md_hmac(md, fleet_key, sizeof(fleet_key), data, len, full) != 0) {
+        return false;
+    }
+    memcpy(tag, full, FLEET_TAG_LEN);
+    return true;
+}
+
+// Constant time, so a forger learns nothing from how fast a guess fails
+static bool tag_equal(const uint8_t *a, const uint8_t *b)
+{
+    uint8_t diff = 0;
+    for (int i = 0; i < FLEET_TAG_LEN; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+static void send_packet(uint8_t type, const uint8_t *payload, uint8_t count, size_t payload_len)
+{
+    uint8_t pkt[FLEET_MAX_PACKET];
+    if (!joined || FLEET_HEADER_LEN + payload_len + FLEET_TAG_LEN > sizeof(pkt)) {
+        return;
+    }
+    put_u32(pkt, FLEET_MAGIC);
+    pkt[4] = type;
+    pkt[5] = count;
+    memcpy(pkt + 6, self_mac, 6);
+    put_u32(pkt + 12, boot_id);
+    put_u32(pkt + 16, ++tx_seq);
+    memcpy(pkt + FLEET_HEADER_LEN, payload, payload_len);
+    size_t len = FLEET_HEADER_LEN + payload_len;
+    if (!compute_tag(pkt, len, pkt + len)) {
+        return;
+    }
+    len += FLEET_TAG_LEN;
+
+    struct sockaddr_in group = {
+        .sin_family = AF_INET,
+        .sin_port = htons(FLEET_PORT),
+    };
+    inet_pton(AF_INET, FLEET_GROUP, &group.sin_addr);
+    if (sendto(sync_sock, pkt, len, 0, (struct sockaddr *)&group, sizeof(group)) == (int)len) {
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        counters.sent++;
+        xSemaphoreGive(state_mutex);
+    }
+}
+
+static void send_approvals(const approval_rec_t *recs, size_t n)
+{
+    uint8_t payload[FLEET_APPROVALS_PER_PACKET * FLEET_APPROVAL_LEN];
+    while (n > 0) {
+        size_t batch = n < FLEET_APPROVALS_PER_PACKET ? n : FLEET_APPROVALS_PER_PACKET;
+        for (size_t i = 0; i < batch; i++) {
+            memcpy(payload + i * FLEET_APPROVAL_LEN, recs[i].mac, 6);
+            put_u32(payload + i * FLEET_APPROVAL_LEN + 6, recs[i].expires_in_s);
+        }
+        send_packet(FLEET_TYPE_APPROVALS, payload, (uint8_t)batch, batch * FLEET_APPROVAL_LEN);
+        recs += batch;
+        n -= batch;
+    }
+}
+
+// Every approval this stick holds, so a stick that just came up catches up
+static void send_full_sync(void)
+{
+    approval_rec_t recs[FLEET_APPROVALS_PER_PACKET];
+    size_t n = 0;
+    uint32_t now = now_s();
+    size_t count = client_table_list(table_buf, CLIENT_TABLE_SIZE);
+    for (size_t i = 0; i < count; i++) {
+        const client_entry_t *e = &table_buf[i];
+        if (!e->approved || (int32_t)(e->expires_at - now) <= 0) {
+            continue;
+        }
+        memcpy(recs[n].mac, e->mac, 6);
+        recs[n].expires_in_s = e->expires_at - now;
+        if (++n == FLEET_APPROVALS_PER_PACKET) {
+            send_approvals(recs, n);
+            n = 0;
+        }
+    }
+    send_approvals(recs, n);
+}
+
+static void send_load(void)
+{
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK) {
+        list.num = 0;   // AP not running
+    }
+    uint32_t up = 0, down = 0;
+    size_t n = client_stats_snapshot(stats_buf, CLIENT_STATS_MAX_TRACKED);
+    for (size_t i = 0; i < n; i++) {
+        up += stats_buf[i].up_rate;
+        down += stats_buf[i].down_rate;
+    }
+
+    uint8_t payload[FLEET_LOAD_LEN];
+    payload[0] = (uint8_t)list.num;
+    payload[1] = our_max_stations;
+    put_u32(payload + 2, up);
+    put_u32(payload + 6, down);
+    send_packet(FLEET_TYPE_LOAD, payload, 1, sizeof(payload));
+}
+
+// Peer slot for a sender, recycling the stalest when full (state_mutex held)
+static peer_slot_t *peer_for(const uint8_t mac[6])
+{
+    peer_slot_t *victim = NULL;
+    for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+        peer_slot_t *p = &peers[i];
+        if (p->in_use && memcmp(p->mac, mac, 6) == 0) {
+            return p;
+        }
+        if (!victim || (victim->in_use && (!p->in_use || p->heard_at < victim->heard_at))) {
+            victim = p;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    memcpy(victim->mac, mac, 6);
+    victim->in_use = true;
+    return victim;
+}
+
+static bool peer_live(const peer_slot_t *p, uint32_t now)
+{
+    return p->in_use && p->max_stations && now - p->heard_at < FLEET_PEER_TIMEOUT_S;
+}
+
+// Replay window for a sender, recycling the longest silent when full (state_mutex held)
+static replay_window_t *window_for(const uint8_t mac[6])
+{
+    replay_window_t *victim = NULL;
+    for (int i = 0; i < FLEET_MAX_WINDOWS; i++) {
+        replay_window_t *w = &windows[i];
+        if (w->in_use && memcmp(w->mac, mac, 6) == 0) {
+            return w;
+        }
+        if (!victim || (victim->in_use && (!w->in_use || w->heard_at < victim->heard_at))) {
+            victim = w;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    memcpy(victim->mac, mac, 6);
+    victim->in_use = true;
+    return victim;
+}
+
+// Boot ids per sender, so a reboot here doesn't reopen old boots to replay
+#define WINDOW_RECORD_LEN 10   // MAC + boot id
+
+static void load_windows(void)
+{
+    uint8_t blob[FLEET_MAX_WINDOWS * WINDOW_RECORD_LEN];
+    size_t len = sizeof(blob);
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_blob(nvs, "fleet_seen", blob, &len) == ESP_OK) {
+        for (size_t i = 0; i < len / WINDOW_RECORD_LEN; i++) {
+            memcpy(windows[i].mac, blob + i * WINDOW_RECORD_LEN, 6);
+            windows[i].boot_id = get_u32(blob + i * WINDOW_RECORD_LEN + 6);
+            windows[i].in_use = true;
+        }
+    }
+    nvs_close(nvs);
+}
+
+// Only when a sender's boot id moves on - once per peer reboot, not per packet
+static void save_windows(void)
+{
+    uint8_t blob[FLEET_MAX_WINDOWS * WINDOW_RECORD_LEN];
+    size_t len = 0;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < FLEET_MAX_WINDOWS; i++) {
+        if (windows[i].in_use) {
+            memcpy(blob + len, windows[i].mac, 6);
+            put_u32(blob + len + 6, windows[i].boot_id);
+            len += WINDOW_RECORD_LEN;
+        }
+    }
+    xSemaphoreGive(state_mutex);
+
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    nvs_set_blob(nvs, "fleet_seen", blob, len);
+    if (nvs_commit(nvs) != ESP_OK) {
+        ESP_LOGW(TAG, "Saving peer boot ids failed");
+    }
+    nvs_close(nvs);
+}
+
+// Remember a peer's approval for a phone that may join here later (state_mutex held)
+static void cache_approval(const uint8_t mac[6], uint32_t expires_at, uint32_t now)
+{
+    // Free or expired slot first, else the approval that runs out soonest
+    cached_approval_t *slot = NULL;
+    bool slot_free = false;
+    for (int i = 0; i < FLEET_MAX_APPROVALS; i++) {
+        cached_approval_t *c = &cache[i];
+        if (c->expires_at && memcmp(c->mac, mac, 6) == 0) {
+            if ((int32_t)(expires_at - c->expires_at) > 0) {
+                c->expires_at = expires_at;
+            }
+            return;
+        }
+        bool c_free = !c->expires_at || (int32_t)(c->expires_at - now) <= 0;
+        if (slot_free) {
+            continue;
+        }
+        if (c_free || !slot || (int32_t)(c->expires_at - slot->expires_at) < 0) {
+            slot = c;
+            slot_free = c_free;
+        }
+    }
+    memcpy(slot->mac, mac, 6);
+    slot->expires_at = expires_at;
+}
+
+static void handle_packet(const uint8_t *pkt, int len, uint32_t from_ip)
+{
+    if (len < FLEET_HEADER_LEN + FLEET_TAG_LEN || get_u32(pkt) != FLEET_MAGIC) {
+        return;   // Not ours
+    }
+    uint8_t tag[FLEET_TAG_LEN];
+    size_t body = (size_t)len - FLEET_TAG_LEN;
+    uint8_t type = pkt[4];
+    uint8_t count = pkt[5];
+    size_t expect = type == FLEET_TYPE_APPROVALS ? count * FLEET_APPROVAL_LEN :
+                    type == FLEET_TYPE_LOAD ? FLEET_LOAD_LEN : SIZE_MAX;
+    bool valid = expect != SIZE_MAX && body == FLEET_HEADER_LEN + expect &&
+                 compute_tag(pkt, body, tag) && tag_equal(tag, pkt + body);
+    const uint8_t *sender = pkt + 6;
+    if (valid && memcmp(sender, self_mac, 6) == 0) {
+        return;   // Our own, looped back
+    }
+
+    uint32_t now = now_s();
+    uint32_t peer_boot = get_u32(pkt + 12);
+    uint32_t seq = get_u32(pkt + 16);
+    const uint8_t *payload = pkt + FLEET_HEADER_LEN;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (!valid) {
+        counters.rejected++;
+        xSemaphoreGive(state_mutex);
+        return;
+    }
+    // Boot ids only go up; a lower one is a recording of an earlier boot
+    replay_window_t *w = window_for(sender);
+    if (w->boot_id > peer_boot || (w->boot_id == peer_boot && w->seq && (int32_t)(seq - w->seq) <= 0)) {
+        counters.replayed++;
+        xSemaphoreGive(state_mutex);
+        return;
+    }
+    bool new_boot = w->boot_id != peer_boot;
+    w->boot_id = peer_boot;
+    w->seq = seq;
+    w->heard_at = now;
+    counters.received++;
+    peer_slot_t *p = peer_for(sender);
+    p->ip = from_ip;
+    p->heard_at = now;
+
+    approval_rec_t recs[FLEET_APPROVALS_PER_PACKET];
+    size_t n = 0;
+    if (type == FLEET_TYPE_LOAD) {
+        p->stations = payload[0];
+        p->max_stations = payload[1];
+        p->up_rate = get_u32(payload + 2);
+        p->down_rate = get_u32(payload + 6);
+    } else {
+        for (size_t i = 0; i < count && n < FLEET_APPROVALS_PER_PACKET; i++) {
+            const uint8_t *r = payload + i * FLEET_APPROVAL_LEN;
+            uint32_t left = get_u32(r + 6);
+            if (left == 0) {
+                continue;
+            }
+            if (left > CLIENT_TABLE_APPROVAL_TTL_S) {
+                left = CLIENT_TABLE_APPROVAL_TTL_S;
+            }
+            cache_approval(r, now + left, now);
+            memcpy(recs[n].mac, r, 6);
+            recs[n].expires_in_s = left;
+            n++;
+        }
+        counters.approvals_learned += n;
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (new_boot) {
+        save_windows();
+    }
+
+    // A phone already known here is approved right away (client_table takes
+    // its own lock, so outside ours); the rest wait in the cache for a join
+    for (size_t i = 0; i < n; i++) {
+        client_table_import_approval(recs[i].mac, recs[i].expires_in_s);
+    }
+}
+
+// Join or leave the group to match address, enable flag and key
+static void update_membership(void)
+{
+    uint32_t ip = __atomic_load_n(&pending_ip, __ATOMIC_RELAXED);
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    bool want = config.enabled && key_set && ip != 0;
+    xSemaphoreGive(state_mutex);
+
+    struct ip_mreq mreq = {0};
+    inet_pton(AF_INET, FLEET_GROUP, &mreq.imr_multiaddr);
+    if (joined && (!want || ip != sta_ip)) {
+        mreq.imr_interface.s_addr = sta_ip;
+        setsockopt(sync_sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+        joined = false;
+        ESP_LOGI(TAG, "Left the fleet group");
+    }
+    sta_ip = ip;
+    if (!want || joined) {
+        return;
+    }
+
+    mreq.imr_interface.s_addr = ip;
+    if (setsockopt(sync_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        ESP_LOGW(TAG, "Joining %s failed: errno %d", FLEET_GROUP, errno);
+        return;
+    }
+    struct in_addr iface = { .s_addr = ip };
+    setsockopt(sync_sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+    joined = true;
+    ESP_LOGI(TAG, "✓ Joined fleet group %s:%d as " MACSTR, FLEET_GROUP, FLEET_PORT, MAC2STR(self_mac));
+}
+
+static void sync_task(void *pvParameters)
+{
+    uint8_t pkt[FLEET_MAX_PACKET];
+    approval_rec_t batch[FLEET_PENDING_MAX];
+    size_t resend_count = 0;
+    TickType_t resend_at = 0;
+    TickType_t next_load = 0;
+    TickType_t next_sync = 0;
+
+    while (1) {
+        if (__atomic_exchange_n(&address_dirty, false, __ATOMIC_ACQUIRE)) {
+            bool was_joined = joined;
+            update_membership();
+            if (joined && !was_joined) {
+                next_load = next_sync = xTaskGetTickCount();   // Introduce ourselves right away
+            }
+        }
+
+        if (joined) {
+            // Fresh local approvals go out at once, and once more shortly after
+            xSemaphoreTake(state_mutex, portMAX_DELAY);
+            size_t n = pending_count;
+            memcpy(batch, pending, n * sizeof(batch[0]));
+            pending_count = 0;
+            xSemaphoreGive(state_mutex);
+
+            TickType_t now = xTaskGetTickCount();
+            if (n) {
+                send_approvals(batch, n);
+                resend_count = n;
+                resend_at = now + pdMS_TO_TICKS(FLEET_RESEND_MS);
+            } else if (resend_count && (int32_t)(now - resend_at) >= 0) {
+                send_approvals(batch, resend_count);
+                resend_count = 0;
+            }
+            if ((int32_t)(now - next_load) >= 0) {
+                send_load();
+                next_load = now + pdMS_TO_TICKS(FLEET_LOAD_PERIOD_S * 1000);
+            }
+            if ((int32_t)(now - next_sync) >= 0) {
+                send_full_sync();
+                next_sync = now + pdMS_TO_TICKS(FLEET_SYNC_PERIOD_S * 1000);
+            }
+        }
+
+        // Short receive timeout keeps outgoing approvals well under a second
+        struct sockaddr_in src;
+        socklen_t src_len = sizeof(src);
+        int len = recvfrom(sync_sock, pkt, sizeof(pkt), 0, (struct sockaddr *)&src, &src_len);
+        if (len > 0 && joined) {
+            handle_packet(pkt, len, src.sin_addr.s_addr);
+        }
+    }
+}
+
+// client_table hook - any task, so only queue
+static void on_local_approval(const uint8_t mac[6], uint32_t expires_in_s)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (pending_count < FLEET_PENDING_MAX) {
+        memcpy(pending[pending_count].mac, mac, 6);
+        pending[pending_count].expires_in_s = expires_in_s;
+        pending_count++;
+    }   // Else the next full sync carries it
+    xSemaphoreGive(state_mutex);
+}
+
+esp_err_t fleet_sync_init(uint8_t max_stations)
+{
+    if (state_mutex) {
+        return ESP_OK;
+    }
+    state_mutex = xSemaphoreCreateMutex();
+    if (!state_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    our_max_stations = max_stations;
+    esp_read_mac(self_mac, ESP_MAC_WIFI_STA);
+    load_windows();
+
+    // Count this boot before sending anything; peers refuse ids they have
+    // already seen, so an id that can't be stored can't be trusted to go up
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_get_u32(nvs, "fleet_boot", &boot_id);
+        boot_id++;
+        nvs_set_u32(nvs, "fleet_boot", boot_id);
+        if (nvs_commit(nvs) != ESP_OK) {
+            boot_id = 0;
+        }
+        nvs_close(nvs);
+    }
+    if (boot_id == 0) {
+        ESP_LOGW(TAG, "Boot counter not saved - fleet sync stays off this boot");
+    }
+
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        uint8_t enabled = 0, steer = 1;
+        nvs_get_u8(nvs, "fleet_on", &enabled);
+        nvs_get_u8(nvs, "fleet_steer", &steer);
+        size_t len = sizeof(fleet_key);
+        key_set = nvs_get_blob(nvs, "fleet_key", fleet_key, &len) == ESP_OK && len == sizeof(fleet_key);
+        nvs_close(nvs);
+        config.enabled = enabled && key_set && boot_id != 0;
+        config.steer = steer != 0;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(FLEET_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+    uint8_t ttl = 1;        // Venue subnet only
+    uint8_t loop = 0;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = 100000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sync_sock = sock;
+
+    client_table_set_approval_hook(on_local_approval);
+    if (xTaskCreate(sync_task, "fleet_sync", 4096, NULL, 4, &sync_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ Fleet sync %s%s, boot #%lu", config.enabled ? "on" : "off",
+             key_set ? "" : " (no key set)", (unsigned long)boot_id);
+    return ESP_OK;
+}
+
+void fleet_sync_set_address(uint32_t ip)
+{
+    __atomic_store_n(&pending_ip, ip, __ATOMIC_RELAXED);
+    __atomic_store_n(&address_dirty, true, __ATOMIC_RELEASE);
+}
+
+void fleet_sync_station_joined(const uint8_t mac[6])
+{
+    if (!state_mutex) {
+        return;
+    }
+    uint32_t now = now_s();
+    uint32_t left = 0;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < FLEET_MAX_APPROVALS && config.enabled; i++) {
+        const cached_approval_t *c = &cache[i];
+        if (c->expires_at && (int32_t)(c->expires_at - now) > 0 && memcmp(c->mac, mac, 6) == 0) {
+            left = c->expires_at - now;
+            break;
+        }
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (left && client_table_import_approval(mac, left) == ESP_OK) {
+        ESP_LOGI(TAG, MACSTR " roamed in - approved by the fleet (%lus left)", MAC2STR(mac),
+                 (unsigned long)left);
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        counters.approvals_applied++;
+        xSemaphoreGive(state_mutex);
+    }
+}
+
+bool fleet_sync_peer_has_room(int our_free)
+{
+    if (!state_mutex) {
+        return false;
+    }
+    bool room = false;
+    uint32_t now = now_s();
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < FLEET_MAX_PEERS && config.enabled && config.steer && !room; i++) {
+        const peer_slot_t *p = &peers[i];
+        room = peer_live(p, now) && (int)p->max_stations - p->stations >= our_free + FLEET_STEER_MARGIN;
+    }
+    xSemaphoreGive(state_mutex);
+    return room;
+}
+
+esp_err_t fleet_sync_set_config(const fleet_sync_config_t *cfg, bool persist)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (cfg->enabled && (!key_set || boot_id == 0)) {
+        xSemaphoreGive(state_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    config = *cfg;
+    xSemaphoreGive(state_mutex);
+    __atomic_store_n(&address_dirty, true, __ATOMIC_RELEASE);
+
+    if (!persist) {
+        return ESP_OK;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u8(nvs, "fleet_on", cfg->enabled ? 1 : 0);
+    nvs_set_u8(nvs, "fleet_steer", cfg->steer ? 1 : 0);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+void fleet_sync_get_config(fleet_sync_config_t *cfg)
+{
+    if (!state_mutex) {
+        *cfg = config;
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(state_mutex);
+}
+
+esp_err_t fleet_sync_set_key(const uint8_t key[FLEET_KEY_LEN])
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The task reads the key without the lock; a packet tagged with half of
+    // each key just fails verification
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    memcpy(fleet_key, key, FLEET_KEY_LEN);
+    key_set = true;
+    xSemaphoreGive(state_mutex);
+    __atomic_store_n(&address_dirty, true, __ATOMIC_RELEASE);
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_blob(nvs, "fleet_key", key, FLEET_KEY_LEN);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+void fleet_sync_get_status(fleet_sync_status_t *out)
+{
+    if (!state_mutex) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    uint32_t now = now_s();
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *out = counters;
+    out->enabled = config.enabled;
+    out->key_set = key_set;
+    out->joined = joined;
+    out->peers = 0;
+    out->approvals_cached = 0;
+    for (int i = 0; i < FLEET_MAX_PEERS; i++) {
+        if (peer_live(&peers[i], now)) {
+            out->peers++;
+        }
+    }
+    for (int i = 0; i < FLEET_MAX_APPROVALS; i++) {
+        if (cache[i].expires_at && (int32_t)(cache[i].expires_at - now) > 0) {
+            out->approvals_cached++;
+        }
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+size_t fleet_sync_list_peers(fleet_peer_t *out, size_t max)
+{
+    if (!state_mutex) {
+        return 0;
+    }
+    size_t n = 0;
+    uint32_t now = now_s();
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    for (int i = 0; i < FLEET_MAX_PEERS && n < max; i++) {
+        const peer_slot_t *p = &peers[i];
+        if (!peer_live(p, now)) {
+            continue;
+        }
+        memcpy(out[n].mac, p->mac, 6);
+        out[n].ip = p->ip;
+        out[n].stations = p->stations;
+        out[n].max_stations = p->max_stations;
+        out[n].up_rate = p->up_rate;
+        out[n].down_rate = p->down_rate;
+        out[n].age_s = now - p->heard_at;
+        n++;
+    }
+    xSemaphoreGive(state_mutex);
+    return n;
+}
@@ -0,0 +1,91 @@
+#ifndef FLEET_SYNC_H
+#define FLEET_SYNC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Sticks on one venue network find each other on an admin-scoped group
+// (RFC 2365), joined on the STA interface only
+#define FLEET_GROUP "239.255.76.80"
+#define FLEET_PORT  47476
+
+#define FLEET_KEY_LEN        32
+#define FLEET_MAX_PEERS      8
+#define FLEET_MAX_APPROVALS  256   // Approvals learned from peers, for phones not seen here yet
+#define FLEET_LOAD_PERIOD_S  2     // Load beacon
+#define FLEET_SYNC_PERIOD_S  30    // Full approval list, for sticks that just joined
+#define FLEET_PEER_TIMEOUT_S 10    // Peer dropped after this long without a beacon
+
+// A peer is worth steering a newcomer to if it has this many more free slots
+#define FLEET_STEER_MARGIN 2
+
+typedef struct {
+    bool enabled;          // Off by default; needs a key
+    bool steer;            // Let admission turn newcomers away while a peer has room
+} fleet_sync_config_t;
+
+typedef struct {
+    uint8_t mac[6];        // Peer's STA MAC
+    uint32_t ip;           // Network byte order
+    uint8_t stations;
+    uint8_t max_stations;
+    uint32_t up_rate;      // Bytes/s forwarded, all clients
+    uint32_t down_rate;
+    uint32_t age_s;        // Since its last beacon
+} fleet_peer_t;
+
+typedef struct {
+    bool enabled;
+    bool key_set;
+    bool joined;           // On the group (uplink up)
+    uint8_t peers;
+    uint16_t approvals_cached;
+    uint32_t sent;
+    uint32_t received;
+    uint32_t rejected;     // Bad length or authentication tag
+    uint32_t replayed;     // Valid tag, earlier boot id or stale sequence number
+    uint32_t approvals_learned;
+    uint32_t approvals_applied;   // Cached approvals handed to a phone that joined here
+} fleet_sync_status_t;
+
+/**
+ * Load config and key from NVS and start the gossip task
+ * max_stations is the AP's max_connection, reported in load beacons
+ */
+esp_err_t fleet_sync_init(uint8_t max_stations);
+
+/**
+ * STA address from IP_EVENT_STA_GOT_IP (network byte order), 0 when the uplink drops
+ */
+void fleet_sync_set_address(uint32_t sta_ip);
+
+/**
+ * WIFI_EVENT_AP_STACONNECTED, after client_table has the station:
+ * applies an approval a peer granted it
+ */
+void fleet_sync_station_joined(const uint8_t mac[6]);
+
+/**
+ * Some live peer has FLEET_STEER_MARGIN more free slots than our_free
+ * Always false unless enabled with steering on
+ */
+bool fleet_sync_peer_has_room(int our_free);
+
+esp_err_t fleet_sync_set_config(const fleet_sync_config_t *config, bool persist);
+void fleet_sync_get_config(fleet_sync_config_t *config);
+
+/**
+ * Shared secret authenticating every packet; the same on every stick (persisted)
+ */
+esp_err_t fleet_sync_set_key(const uint8_t key[FLEET_KEY_LEN]);
+
+void fleet_sync_get_status(fleet_sync_status_t *status);
+
+/**
+ * Copy the live peers, returns the count
+ */
+size_t fleet_sync_list_peers(fleet_peer_t *out, size_t max);
+
+#endif // FLEET_SYNC_H
@@ -0,0 +1,481 @@
+#include "form_parser.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "FormParser";
+
+// Multipart states
+enum {
+    MP_PREAMBLE,      // Before the first boundary
+    MP_AFTER_DELIM,   // Boundary seen, expecting "\r\n" or "--"
+    MP_HEADERS,       // Part headers up to the blank line
+    MP_DATA,          // Part body up to the next delimiter
+    MP_DONE           // Closing boundary seen, ignore epilogue
+};
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decode one character at raw.ptr[*i]; -1 on a malformed escape
+static int decode_char(form_span_t raw, size_t *i)
+{
+    char c = raw.ptr[*i];
+    if (raw.verbatim) {
+        (*i)++;
+        return (uint8_t)c;
+    }
+    if (c == '+') {
+        (*i)++;
+        return ' ';
+    }
+    if (c != '%') {
+        (*i)++;
+        return (uint8_t)c;
+    }
+    if (*i + 2 >= raw.len) {
+        return -1;
+    }
+    int hi = hex_value(raw.ptr[*i + 1]);
+    int lo = hex_value(raw.ptr[*i + 2]);
+    if (hi < 0 || lo < 0) {
+        return -1;
+    }
+    *i += 3;
+    return (hi << 4) | lo;
+}
+
+static const char *span_find(const char *hay, size_t hay_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0 || hay_len < needle_len) {
+        return NULL;
+    }
+    const char *last = hay + hay_len - needle_len;
+    for (const char *p = hay; p <= last; p++) {
+        p = memchr(p, needle[0], last - p + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, needle_len) == 0) return p;
+    }
+    return NULL;
+}
+
+bool form_next_field(form_span_t src, const char **cursor, form_field_t *field)
+{
+    const char *end = src.ptr + src.len;
+    const char *p = *cursor ? *cursor : src.ptr;
+
+    // Skip empty pairs ("a=1&&b=2")
+    while (p < end && *p == '&') p++;
+    if (p >= end) {
+        *cursor = end;
+        return false;
+    }
+
+    const char *amp = memchr(p, '&', end - p);
+    if (!amp) amp = end;
+    const char *eq = memchr(p, '=', amp - p);
+
+    field->name.ptr = p;
+    field->name.len = (eq ? eq : amp) - p;
+    field->value.ptr = eq ? eq + 1 : amp;
+    field->value.len = eq ? (size_t)(amp - eq - 1) : 0;
+    field->name.verbatim = src.verbatim;
+    field->value.verbatim = src.verbatim;
+    *cursor = amp;
+    return true;
+}
+
+bool form_find(form_span_t src, const char *name, form_span_t *value)
+{
+    const char *cursor = NULL;
+    form_field_t field;
+    while (form_next_field(src, &cursor, &field)) {
+        if (form_span_eq(field.name, name)) {
+            *value = field.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+form_span_t form_query(httpd_req_t *req)
+{
+    const char *q = strchr(req->uri, '?');
+    form_span_t span = { .ptr = q ? q + 1 : req->uri, .len = q ? strlen(q + 1) : 0 };
+    return span;
+}
+
+esp_err_t form_decode(form_span_t raw, char *out, size_t out_size, size_t *out_len)
+{
+    size_t n = 0;
+    size_t i = 0;
+
+    if (!out || out_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (i < raw.len) {
+        int c = decode_char(raw, &i);
+        if (c < 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (n + 1 >= out_size) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        out[n++] = (char)c;
+    }
+    out[n] = '\0';
+    if (out_len) {
+        *out_len = n;
+    }
+    return ESP_OK;
+}
+
+bool form_span_eq(form_span_t raw, const char *literal)
+{
+    size_t i = 0;
+    while (i < raw.len) {
+        int c = decode_char(raw, &i);
+        if (c < 0 || *literal == '\0' || (uint8_t)*literal != c) {
+            return false;
+        }
+        literal++;
+    }
+    return *literal == '\0';
+}
+
+esp_err_t form_decode_long(form_span_t raw, long min, long max, long *out)
+{
+    char digits[24];
+    esp_err_t err = form_decode(raw, digits, sizeof(digits), NULL);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Plain decimal only: no spaces, '+', hex or trailing junk
+    const char *p = digits[0] == '-' ? digits + 1 : digits;
+    if (!isdigit((unsigned char)*p)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char *end;
+    errno = 0;
+    long value = strtol(digits, &end, 10);
+    if (*end != '\0' || errno == ERANGE || value < min || value > max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = value;
+    return ESP_OK;
+}
+
+// Copy a quoted or bare header parameter (e.g. name="ssid") into out
+static esp_err_t header_param(const char *line, size_t line_len, const char *key,
+                              char *out, size_t out_size)
+{
+    size_t key_len = strlen(key);
+    const char *end = line + line_len;
+    out[0] = '\0';
+
+    for (const char *p = line; p + key_len < end; p++) {
+        // Match "; key=" and not a longer parameter ending in key (filename vs name)
+        if ((p == line || p[-1] == ' ' || p[-1] == ';') &&
+            strncasecmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            const char *v = p + key_len + 1;
+            const char *v_end;
+            if (v < end && *v == '"') {
+                v++;
+                v_end = memchr(v, '"', end - v);
+                if (!v_end) return ESP_ERR_INVALID_ARG;
+            } else {
+                v_end = v;
+                while (v_end < end && *v_end != ';' && *v_end != ' ') v_end++;
+            }
+            if ((size_t)(v_end - v) >= out_size) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(out, v, v_end - v);
+            out[v_end - v] = '\0';
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t form_parser_init(form_parser_t *parser, const char *content_type,
+                           char *scratch, size_t scratch_size,
+                           const form_handlers_t *handlers, void *ctx)
+{
+    if (!parser || !scratch || scratch_size < 16 || !handlers) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(parser, 0, sizeof(*parser));
+    parser->buf = scratch;
+    parser->size = scratch_size;
+    parser->handlers = handlers;
+    parser->ctx = ctx;
+    parser->kind = FORM_URLENCODED;
+
+    if (content_type && strncasecmp(content_type, "multipart/form-data", 19) == 0) {
+        char boundary[FORM_BOUNDARY_MAX + 1];
+        esp_err_t err = header_param(content_type, strlen(content_type), "boundary",
+                                     boundary, sizeof(boundary));
+        if (err != ESP_OK || boundary[0] == '\0') {
+            ESP_LOGW(TAG, "Multipart body without a usable boundary");
+            return ESP_ERR_INVALID_ARG;
+        }
+        parser->kind = FORM_MULTIPART;
+        parser->state = MP_PREAMBLE;
+        parser->delim_len = snprintf(parser->delim, sizeof(parser->delim), "\r\n--%s", boundary);
+        // Part headers plus a delimiter must fit, or no progress is possible
+        if (scratch_size < parser->delim_len * 2 + 64) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    return ESP_OK;
+}
+
+char *form_parser_space(form_parser_t *parser, size_t *avail)
+{
+    *avail = parser->size - parser->len;
+    return parser->buf + parser->len;
+}
+
+static void consume(form_parser_t *parser, size_t n)
+{
+    // Only an incomplete field or a partial delimiter is ever moved
+    parser->len -= n;
+    memmove(parser->buf, parser->buf + n, parser->len);
+}
+
+static esp_err_t emit_field(form_parser_t *parser, const char *p, size_t len)
+{
+    form_span_t span = { .ptr = p, .len = len };
+    const char *cursor = NULL;
+    form_field_t field;
+    if (!form_next_field(span, &cursor, &field) || !parser->handlers->field) {
+        return ESP_OK;
+    }
+    return parser->handlers->field(&field, parser->ctx);
+}
+
+static esp_err_t feed_urlencoded(form_parser_t *parser)
+{
+    const char *p = parser->buf;
+    const char *end = parser->buf + parser->len;
+    const char *amp;
+
+    while ((amp = memchr(p, '&', end - p)) != NULL) {
+        esp_err_t err = emit_field(parser, p, amp - p);
+        if (err != ESP_OK) return err;
+        p = amp + 1;
+    }
+
+    consume(parser, p - parser->buf);
+    if (parser->len == parser->size) {
+        return ESP_ERR_INVALID_SIZE;   // One field larger than the whole scratch buffer
+    }
+    return ESP_OK;
+}
+
+static esp_err_t parse_part_headers(form_parser_t *parser, const char *p, const char *end)
+{
+    form_part_t *part = &parser->part;
+    memset(part, 0, sizeof(*part));
+    strcpy(part->content_type, "text/plain");
+
+    while (p < end) {
+        const char *eol = span_find(p, end - p, "\r\n", 2);
+        if (!eol) eol = end;
+        size_t len = eol - p;
+
+        if (len > 20 && strncasecmp(p, "Content-Disposition:", 20) == 0) {
+            esp_err_t err = header_param(p + 20, len - 20, "name", part->name, sizeof(part->name));
+            if (err != ESP_OK) return err == ESP_ERR_NOT_FOUND ? ESP_ERR_INVALID_ARG : err;
+            err = header_param(p + 20, len - 20, "filename", part->filename, sizeof(part->filename));
+            if (err != ESP_OK && err != ESP_ERR_NOT_FOUND) return err;
+        } else if (len > 13 && strncasecmp(p, "Content-Type:", 13) == 0) {
+            const char *v = p + 13;
+            while (v < eol && *v == ' ') v++;
+            if ((size_t)(eol - v) >= sizeof(part->content_type)) return ESP_ERR_INVALID_SIZE;
+            memcpy(part->content_type, v, eol - v);
+            part->content_type[eol - v] = '\0';
+        }
+        p = eol + 2;
+    }
+
+    if (parser->handlers->part_begin) {
+        return parser->handlers->part_begin(part, parser->ctx);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t emit_data(form_parser_t *parser, size_t len)
+{
+    if (len == 0) {
+        return ESP_OK;
+    }
+    parser->part.size += len;
+    esp_err_t err = ESP_OK;
+    if (parser->handlers->part_data) {
+        err = parser->handlers->part_data(&parser->part, parser->buf, len, parser->ctx);
+    }
+    consume(parser, len);
+    return err;
+}
+
+static esp_err_t emit_part_field(form_parser_t *parser, size_t len)
+{
+    form_part_t *part = &parser->part;
+    form_field_t field = {
+        .name = { .ptr = part->name, .len = strlen(part->name), .verbatim = true },
+        .value = { .ptr = parser->buf, .len = len, .verbatim = true },
+    };
+    part->size = len;
+
+    esp_err_t err = ESP_OK;
+    if (parser->handlers->field) {
+        err = parser->handlers->field(&field, parser->ctx);
+    }
+    if (err == ESP_OK && parser->handlers->part_end) {
+        err = parser->handlers->part_end(part, parser->ctx);
+    }
+    return err;
+}
+
+static esp_err_t feed_multipart(form_parser_t *parser)
+{
+    while (1) {
+        const char *buf = parser->buf;
+        size_t len = parser->len;
+        const char *hit;
+        esp_err_t err;
+
+        switch (parser->state) {
+        case MP_PREAMBLE:
+            // The first boundary has no leading CRLF
+            hit = span_find(buf, len, parser->delim + 2, parser->delim_len - 2);
+            if (!hit) {
+                size_t keep = parser->delim_len - 3;
+                if (len > keep) consume(parser, len - keep);
+                return ESP_OK;
+            }
+            consume(parser, (hit - buf) + parser->delim_len - 2);
+            parser->state = MP_AFTER_DELIM;
+            break;
+
+        case MP_AFTER_DELIM:
+            if (len < 2) return ESP_OK;
+            if (buf[0] == '-' && buf[1] == '-') {
+                parser->state = MP_DONE;
+                parser->len = 0;
+                return ESP_OK;
+            }
+            if (buf[0] != '\r' || buf[1] != '\n') return ESP_ERR_INVALID_ARG;
+            consume(parser, 2);
+            parser->state = MP_HEADERS;
+            break;
+
+        case MP_HEADERS:
+            hit = span_find(buf, len, "\r\n\r\n", 4);
+            if (!hit) {
+                return len == parser->size ? ESP_ERR_INVALID_SIZE : ESP_OK;
+            }
+            err = parse_part_headers(parser, buf, hit);
+            if (err != ESP_OK) return err;
+            consume(parser, (hit - buf) + 4);
+            parser->state = MP_DATA;
+            break;
+
+        case MP_DATA:
+            hit = span_find(buf, len, parser->delim, parser->delim_len);
+            if (parser->part.filename[0] == '\0' && !parser->handlers->part_data) {
+                // Plain field: hand the whole value to the field handler
+                if (!hit) {
+                    return len == parser->size ? ESP_ERR_INVALID_SIZE : ESP_OK;
+                }
+                err = emit_part_field(parser, hit - buf);
+                if (err != ESP_OK) return err;
+                consume(parser, (hit - buf) + parser->delim_len);
+                parser->state = MP_AFTER_DELIM;
+                break;
+            }
+            if (!hit) {
+                // Hold back what could be the start of a split delimiter
+                size_t keep = parser->delim_len - 1;
+                return len > keep ? emit_data(parser, len - keep) : ESP_OK;
+            }
+            err = emit_data(parser, hit - buf);
+            if (err != ESP_OK) return err;
+            if (parser->handlers->part_end) {
+                err = parser->handlers->part_end(&parser->part, parser->ctx);
+                if (err != ESP_OK) return err;
+            }
+            consume(parser, parser->delim_len);
+            parser->state = MP_AFTER_DELIM;
+            break;
+
+        default:
+            parser->len = 0;   // Epilogue
+            return ESP_OK;
+        }
+    }
+}
+
+esp_err_t form_parser_feed(form_parser_t *parser, size_t n)
+{
+    if (n > parser->size - parser->len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    parser->len += n;
+    return parser->kind == FORM_MULTIPART ? feed_multipart(parser) : feed_urlencoded(parser);
+}
+
+esp_err_t form_parser_finish(form_parser_t *parser)
+{
+    if (parser->kind == FORM_MULTIPART) {
+        return parser->state == MP_DONE ? ESP_OK : ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = emit_field(parser, parser->buf, parser->len);
+    parser->len = 0;
+    return err;
+}
+
+esp_err_t form_parse_request(httpd_req_t *req, char *scratch, size_t scratch_size,
+                             const form_handlers_t *handlers, void *ctx)
+{
+    char content_type[128] = {0};
+    if (httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type)) == ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    form_parser_t parser;
+    esp_err_t err = form_parser_init(&parser, content_type, scratch, scratch_size, handlers, ctx);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t remaining = req->content_len;
+    while (remaining > 0) {
+        size_t avail;
+        char *space = form_parser_space(&parser, &avail);
+        int ret = httpd_req_recv(req, space, remaining < avail ? remaining : avail);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            return ESP_FAIL;
+        }
+        remaining -= ret;
+        err = form_parser_feed(&parser, ret);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return form_parser_finish(&parser);
+}
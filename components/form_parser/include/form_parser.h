@@ -0,0 +1,134 @@
+#ifndef FORM_PARSER_H
+#define FORM_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Multipart limits (part headers must fit in the scratch buffer)
+#define FORM_BOUNDARY_MAX      70   // RFC 2046
+#define FORM_PART_NAME_MAX     32
+#define FORM_PART_FILENAME_MAX 64
+#define FORM_PART_TYPE_MAX     48
+
+// View into a buffer owned by someone else - not NUL-terminated
+// Urlencoded spans are still percent-encoded; multipart values are verbatim
+typedef struct {
+    const char *ptr;
+    size_t len;
+    bool verbatim;
+} form_span_t;
+
+// One name=value pair of an urlencoded body or query string, or a
+// multipart part without a filename when no part_data handler is set
+typedef struct {
+    form_span_t name;
+    form_span_t value;
+} form_field_t;
+
+// Metadata of the current multipart part (decoded, NUL-terminated copies)
+typedef struct {
+    char name[FORM_PART_NAME_MAX];
+    char filename[FORM_PART_FILENAME_MAX];    // Empty for plain fields
+    char content_type[FORM_PART_TYPE_MAX];
+    size_t size;                              // Bytes delivered so far
+} form_part_t;
+
+// Callbacks for form_parse_request / form_parser_feed
+// Spans and data pointers are only valid during the call
+// Returning anything but ESP_OK stops parsing and is passed back to the caller
+typedef struct {
+    esp_err_t (*field)(const form_field_t *field, void *ctx);                  // urlencoded
+    esp_err_t (*part_begin)(const form_part_t *part, void *ctx);               // multipart
+    esp_err_t (*part_data)(const form_part_t *part, const char *data, size_t len, void *ctx);
+    esp_err_t (*part_end)(const form_part_t *part, void *ctx);
+} form_handlers_t;
+
+typedef enum {
+    FORM_URLENCODED,
+    FORM_MULTIPART
+} form_kind_t;
+
+// Push parser state - bytes are received straight into the caller's scratch buffer
+typedef struct {
+    form_kind_t kind;
+    const form_handlers_t *handlers;
+    void *ctx;
+    char *buf;
+    size_t size;
+    size_t len;             // Unconsumed bytes at buf[0..len)
+    int state;
+    char delim[FORM_BOUNDARY_MAX + 4];   // "\r\n--" + boundary
+    size_t delim_len;
+    form_part_t part;
+} form_parser_t;
+
+/**
+ * Iterate fields of an urlencoded span (body or query string)
+ * Usage: const char *p = NULL; while (form_next_field(src, &p, &field)) { ... }
+ */
+bool form_next_field(form_span_t src, const char **cursor, form_field_t *field);
+
+/**
+ * Find the first field with this (plain ASCII) name; value stays encoded
+ */
+bool form_find(form_span_t src, const char *name, form_span_t *value);
+
+/**
+ * Query string of the request as a span over req->uri (empty if none)
+ */
+form_span_t form_query(httpd_req_t *req);
+
+/**
+ * Percent- and '+'-decode into out (always NUL-terminated on success)
+ * Verbatim spans are copied as-is
+ * ESP_ERR_INVALID_SIZE if the decoded value does not fit - never truncates
+ * ESP_ERR_INVALID_ARG on a malformed %XY escape
+ */
+esp_err_t form_decode(form_span_t raw, char *out, size_t out_size, size_t *out_len);
+
+/**
+ * Compare the decoded form of raw against a literal without copying
+ */
+bool form_span_eq(form_span_t raw, const char *literal);
+
+/**
+ * Decode a base-10 integer and check it lies in [min, max]
+ */
+esp_err_t form_decode_long(form_span_t raw, long min, long max, long *out);
+
+/**
+ * Start a parser for a body with this Content-Type header value
+ * Types other than multipart/form-data are treated as urlencoded
+ */
+esp_err_t form_parser_init(form_parser_t *parser, const char *content_type,
+                           char *scratch, size_t scratch_size,
+                           const form_handlers_t *handlers, void *ctx);
+
+/**
+ * Free space at the end of the scratch buffer to receive into
+ */
+char *form_parser_space(form_parser_t *parser, size_t *avail);
+
+/**
+ * Account for n bytes written at form_parser_space() and emit what is complete
+ * ESP_ERR_INVALID_SIZE if a single field or part header cannot fit in scratch
+ */
+esp_err_t form_parser_feed(form_parser_t *parser, size_t n);
+
+/**
+ * End of body: emit the last field / check the multipart terminator was seen
+ */
+esp_err_t form_parser_finish(form_parser_t *parser);
+
+/**
+ * Receive the whole request body through a parser in a single pass
+ * Bodies of any length stream through scratch; only one field (urlencoded)
+ * or one part header block (multipart) must fit at a time
+ */
+esp_err_t form_parse_request(httpd_req_t *req, char *scratch, size_t scratch_size,
+                             const form_handlers_t *handlers, void *ctx);
+
+#endif // FORM_PARSER_H
@@ -0,0 +1,48 @@
+#ifndef MDNS_RESPONDER_H
+#define MDNS_RESPONDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Shared name, answered by the DNS proxy on the AP side. On the venue network
+// every stick advertises its own name so a fleet doesn't collide:
+// labportal-<last two STA MAC bytes>.local
+#define MDNS_HOST_NAME   "labportal"
+#define MDNS_LOCAL_NAME  MDNS_HOST_NAME ".local"
+
+#define MDNS_PORT        5353
+#define MDNS_GROUP       "224.0.0.251"
+
+// RFC 6762 section 10: records naming the host expire quickly, the rest
+// (PTR, TXT) may be cached for over an hour
+#define MDNS_HOST_TTL_S  120
+#define MDNS_OTHER_TTL_S 4500
+
+// DNS-SD service types; the debug port streams plain-text logs (nc <host> 8888)
+#define MDNS_HTTP_SERVICE  "_http._tcp.local"
+#define MDNS_DEBUG_SERVICE "_labportal-dbg._tcp.local"
+
+/**
+ * Derive this stick's names from the STA MAC and start the responder task
+ * Nothing is answered until mdns_responder_set_address gives it an address
+ */
+esp_err_t mdns_responder_init(void);
+
+/**
+ * STA address from IP_EVENT_STA_GOT_IP (network byte order), 0 when the
+ * uplink drops. Rebuilds every answer, rejoins the group and announces
+ */
+void mdns_responder_set_address(uint32_t sta_ip);
+
+/**
+ * This stick's unique name, e.g. "labportal-a1b2.local"
+ */
+const char *mdns_responder_hostname(void);
+
+/**
+ * labportal.local or this stick's unique name (case-insensitive, trailing dot ok)
+ */
+bool mdns_responder_is_local_name(const char *name);
+
+#endif // MDNS_RESPONDER_H
@@ -0,0 +1,543 @@
+#include "mdns_responder.h"
+#include "tcp_debug.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "mDNS";
+
+#define MDNS_MAX_PACKET   512
+#define MDNS_NAME_MAX     96
+#define MDNS_ANSWER_MAX   480
+#define MDNS_ANNOUNCE_COUNT 2     // RFC 6762 section 8.3: at least two, a second apart
+#define MDNS_HTTP_PORT    80
+#define MDNS_LEGACY_TTL_S 10      // RFC 6762 section 6.7
+
+#define TYPE_A    1
+#define TYPE_PTR  12
+#define TYPE_TXT  16
+#define TYPE_SRV  33
+#define TYPE_ANY  255
+#define CLASS_IN  1
+#define CLASS_TOP_BIT 0x8000      // Cache-flush in answers, unicast-response (QU) in questions
+
+#define DNS_SD_SERVICES "_services._dns-sd._udp.local"
+
+// A prebuilt reply: answer and additional records, names written out in full
+// so a question can be put in front of them for legacy unicast replies
+typedef struct {
+    char name[MDNS_NAME_MAX];     // Question it answers
+    uint16_t qtype[2];            // Types that select it, besides ANY
+    uint16_t an;
+    uint16_t ar;
+    uint16_t len;
+    uint8_t body[MDNS_ANSWER_MAX];
+} answer_t;
+
+enum {
+    ANSWER_HOST,
+    ANSWER_SERVICES,
+    ANSWER_HTTP_PTR,
+    ANSWER_HTTP_INSTANCE,
+    ANSWER_DEBUG_PTR,
+    ANSWER_DEBUG_INSTANCE,
+    ANSWER_COUNT,
+};
+
+// Names are fixed at init; answers are rebuilt by the task on address changes
+static char host_name[32];
+static char http_instance[MDNS_NAME_MAX];
+static char debug_instance[MDNS_NAME_MAX];
+static answer_t answers[ANSWER_COUNT];
+static answer_t announcement;
+
+static uint32_t pending_ip = 0;
+static bool address_dirty = false;
+static uint32_t sta_ip = 0;       // Task-owned copy, 0 = not answering
+static int mdns_sock = -1;
+static TaskHandle_t mdns_task_handle = NULL;
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    bool overflow;
+} writer_t;
+
+static void put_bytes(writer_t *w, const void *data, size_t n)
+{
+    if (w->len + n > w->cap) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+static void put_u16(writer_t *w, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    put_bytes(w, b, 2);
+}
+
+static void put_u32(writer_t *w, uint32_t v)
+{
+    put_u16(w, (uint16_t)(v >> 16));
+    put_u16(w, (uint16_t)v);
+}
+
+// Dotted name as uncompressed labels
+static void put_name(writer_t *w, const char *dotted)
+{
+    while (*dotted) {
+        const char *dot = strchr(dotted, '.');
+        size_t n = dot ? (size_t)(dot - dotted) : strlen(dotted);
+        uint8_t label = (uint8_t)(n > 63 ? 63 : n);
+        put_bytes(w, &label, 1);
+        put_bytes(w, dotted, label);
+        dotted += n + (dot ? 1 : 0);
+    }
+    put_bytes(w, "", 1);
+}
+
+// Record header with an RDLENGTH placeholder; returns where to patch it
+static size_t rr_begin(writer_t *w, const char *name, uint16_t type, bool flush, uint32_t ttl)
+{
+    put_name(w, name);
+    put_u16(w, type);
+    put_u16(w, CLASS_IN | (flush ? CLASS_TOP_BIT : 0));
+    put_u32(w, ttl);
+    size_t at = w->len;
+    put_u16(w, 0);
+    return at;
+}
+
+static void rr_end(writer_t *w, size_t at)
+{
+    if (w->overflow) {
+        return;
+    }
+    uint16_t rdlen = (uint16_t)(w->len - at - 2);
+    w->buf[at] = (uint8_t)(rdlen >> 8);
+    w->buf[at + 1] = (uint8_t)rdlen;
+}
+
+static void put_a(writer_t *w, uint32_t ip)
+{
+    size_t at = rr_begin(w, host_name, TYPE_A, true, MDNS_HOST_TTL_S);
+    put_bytes(w, &ip, 4);   // Already in network order
+    rr_end(w, at);
+}
+
+static void put_ptr(writer_t *w, const char *name, const char *target)
+{
+    size_t at = rr_begin(w, name, TYPE_PTR, false, MDNS_OTHER_TTL_S);
+    put_name(w, target);
+    rr_end(w, at);
+}
+
+static void put_srv(writer_t *w, const char *instance, uint16_t port)
+{
+    size_t at = rr_begin(w, instance, TYPE_SRV, true, MDNS_HOST_TTL_S);
+    put_u16(w, 0);   // Priority
+    put_u16(w, 0);   // Weight
+    put_u16(w, port);
+    put_name(w, host_name);
+    rr_end(w, at);
+}
+
+// One key=value string; NULL writes the single empty string RFC 6763 wants
+static void put_txt(writer_t *w, const char *instance, const char *kv)
+{
+    size_t at = rr_begin(w, instance, TYPE_TXT, true, MDNS_OTHER_TTL_S);
+    uint8_t n = (uint8_t)(kv ? strlen(kv) : 0);
+    put_bytes(w, &n, 1);
+    if (n) {
+        put_bytes(w, kv, n);
+    }
+    rr_end(w, at);
+}
+
+static writer_t answer_begin(answer_t *a, const char *name, uint16_t qtype0, uint16_t qtype1)
+{
+    snprintf(a->name, sizeof(a->name), "%s", name);
+    a->qtype[0] = qtype0;
+    a->qtype[1] = qtype1;
+    a->an = 0;
+    a->ar = 0;
+    a->len = 0;
+    return (writer_t){ .buf = a->body, .cap = sizeof(a->body) };
+}
+
+static void answer_end(answer_t *a, const writer_t *w)
+{
+    if (w->overflow) {
+        ESP_LOGE(TAG, "Answer for %s does not fit", a->name);
+        a->len = 0;
+        return;
+    }
+    a->len = (uint16_t)w->len;
+}
+
+// Every reply this responder can give, for the current address
+static void build_answers(uint32_t ip)
+{
+    answer_t *a = &answers[ANSWER_HOST];
+    writer_t w = answer_begin(a, host_name, TYPE_A, TYPE_A);
+    put_a(&w, ip);
+    a->an = 1;
+    answer_end(a, &w);
+
+    a = &answers[ANSWER_SERVICES];
+    w = answer_begin(a, DNS_SD_SERVICES, TYPE_PTR, TYPE_PTR);
+    put_ptr(&w, DNS_SD_SERVICES, MDNS_HTTP_SERVICE);
+    put_ptr(&w, DNS_SD_SERVICES, MDNS_DEBUG_SERVICE);
+    a->an = 2;
+    answer_end(a, &w);
+
+    // Browsing a type gets the instance, and everything needed to connect
+    a = &answers[ANSWER_HTTP_PTR];
+    w = answer_begin(a, MDNS_HTTP_SERVICE, TYPE_PTR, TYPE_PTR);
+    put_ptr(&w, MDNS_HTTP_SERVICE, http_instance);
+    put_srv(&w, http_instance, MDNS_HTTP_PORT);
+    put_txt(&w, http_instance, "path=/");
+    put_a(&w, ip);
+    a->an = 1;
+    a->ar = 3;
+    answer_end(a, &w);
+
+    a = &answers[ANSWER_HTTP_INSTANCE];
+    w = answer_begin(a, http_instance, TYPE_SRV, TYPE_TXT);
+    put_srv(&w, http_instance, MDNS_HTTP_PORT);
+    put_txt(&w, http_instance, "path=/");
+    put_a(&w, ip);
+    a->an = 2;
+    a->ar = 1;
+    answer_end(a, &w);
+
+    a = &answers[ANSWER_DEBUG_PTR];
+    w = answer_begin(a, MDNS_DEBUG_SERVICE, TYPE_PTR, TYPE_PTR);
+    put_ptr(&w, MDNS_DEBUG_SERVICE, debug_instance);
+    put_srv(&w, debug_instance, TCP_DEBUG_PORT);
+    put_txt(&w, debug_instance, NULL);
+    put_a(&w, ip);
+    a->an = 1;
+    a->ar = 3;
+    answer_end(a, &w);
+
+    a = &answers[ANSWER_DEBUG_INSTANCE];
+    w = answer_begin(a, debug_instance, TYPE_SRV, TYPE_TXT);
+    put_srv(&w, debug_instance, TCP_DEBUG_PORT);
+    put_txt(&w, debug_instance, NULL);
+    put_a(&w, ip);
+    a->an = 2;
+    a->ar = 1;
+    answer_end(a, &w);
+
+    a = &announcement;
+    w = answer_begin(a, host_name, 0, 0);
+    put_a(&w, ip);
+    put_ptr(&w, MDNS_HTTP_SERVICE, http_instance);
+    put_srv(&w, http_instance, MDNS_HTTP_PORT);
+    put_txt(&w, http_instance, "path=/");
+    put_ptr(&w, MDNS_DEBUG_SERVICE, debug_instance);
+    put_srv(&w, debug_instance, TCP_DEBUG_PORT);
+    put_txt(&w, debug_instance, NULL);
+    a->an = 7;
+    answer_end(a, &w);
+}
+
+// Read a possibly compressed name as dotted text; returns the offset after
+// it, or -1 if it runs off the packet or loops
+static int read_name(const uint8_t *pkt, int len, int off, char *out, size_t out_len)
+{
+    size_t pos = 0;
+    int next = -1;
+    for (int hops = 0; hops < 16;) {
+        if (off >= len) {
+            return -1;
+        }
+        uint8_t n = pkt[off];
+        if ((n & 0xC0) == 0xC0) {
+            if (off + 1 >= len) {
+                return -1;
+            }
+            if (next < 0) {
+                next = off + 2;
+            }
+            off = ((n & 0x3F) << 8) | pkt[off + 1];
+            hops++;
+            continue;
+        }
+        if (n == 0) {
+            out[pos] = '\0';
+            return next < 0 ? off + 1 : next;
+        }
+        if (n > 63 || off + 1 + n > len || pos + n + 2 > out_len) {
+            return -1;
+        }
+        if (pos > 0) {
+            out[pos++] = '.';
+        }
+        memcpy(out + pos, pkt + off + 1, n);
+        pos += n;
+        off += 1 + n;
+    }
+    return -1;
+}
+
+static const answer_t *find_answer(const char *name, uint16_t qtype)
+{
+    for (int i = 0; i < ANSWER_COUNT; i++) {
+        const answer_t *a = &answers[i];
+        if (a->len && strcasecmp(name, a->name) == 0 &&
+            (qtype == TYPE_ANY || qtype == a->qtype[0] || qtype == a->qtype[1])) {
+            return a;
+        }
+    }
+    return NULL;
+}
+
+static void send_to(const uint8_t *pkt, size_t len, const struct sockaddr_in *dest)
+{
+    sendto(mdns_sock, pkt, len, 0, (const struct sockaddr *)dest, sizeof(*dest));
+}
+
+static void send_multicast(const answer_t *a)
+{
+    uint8_t pkt[MDNS_MAX_PACKET];
+    writer_t w = { .buf = pkt, .cap = sizeof(pkt) };
+    put_u16(&w, 0);          // ID
+    put_u16(&w, 0x8400);     // Response, authoritative
+    put_u16(&w, 0);
+    put_u16(&w, a->an);
+    put_u16(&w, 0);
+    put_u16(&w, a->ar);
+    put_bytes(&w, a->body, a->len);
+
+    struct sockaddr_in group = {
+        .sin_family = AF_INET,
+        .sin_port = htons(MDNS_PORT),
+    };
+    inet_pton(AF_INET, MDNS_GROUP, &group.sin_addr);
+    if (!w.overflow) {
+        send_to(pkt, w.len, &group);
+    }
+}
+
+// Legacy resolvers get no cache-flush bits and short TTLs (RFC 6762 6.7,
+// 10.2); the prebuilt records are patched in the outgoing copy
+static void legacy_fixup(uint8_t *rr, size_t len)
+{
+    size_t off = 0;
+    while (off < len) {
+        while (off < len && rr[off] != 0) {
+            off += 1 + rr[off];   // Names here are never compressed
+        }
+        off++;
+        if (off + 10 > len) {
+            return;
+        }
+        rr[off + 2] &= 0x7F;
+        uint32_t ttl = ((uint32_t)rr[off + 4] << 24) | ((uint32_t)rr[off + 5] << 16) |
+                       ((uint32_t)rr[off + 6] << 8) | rr[off + 7];
+        if (ttl > MDNS_LEGACY_TTL_S) {
+            memset(rr + off + 4, 0, 3);
+            rr[off + 7] = MDNS_LEGACY_TTL_S;
+        }
+        off += 10 + ((rr[off + 8] << 8) | rr[off + 9]);
+    }
+}
+
+// Answer one question: legacy resolvers (source port not 5353) get a plain
+// DNS reply with their ID and question; QU questions a unicast reply;
+// everything else goes to the group. No known-answer suppression or response
+// delay - each name here has exactly one owner
+static void reply(const answer_t *a, uint16_t id, const char *qname, uint16_t qtype,
+                  const struct sockaddr_in *src, bool unicast)
+{
+    bool legacy = ntohs(src->sin_port) != MDNS_PORT;
+    if (!legacy && !unicast) {
+        send_multicast(a);
+        return;
+    }
+
+    uint8_t pkt[MDNS_MAX_PACKET];
+    writer_t w = { .buf = pkt, .cap = sizeof(pkt) };
+    put_u16(&w, legacy ? id : 0);
+    put_u16(&w, 0x8400);
+    put_u16(&w, legacy ? 1 : 0);
+    put_u16(&w, a->an);
+    put_u16(&w, 0);
+    put_u16(&w, a->ar);
+    if (legacy) {
+        put_name(&w, qname);
+        put_u16(&w, qtype);
+        put_u16(&w, CLASS_IN);
+    }
+    size_t body_at = w.len;
+    put_bytes(&w, a->body, a->len);
+    if (legacy && !w.overflow) {
+        legacy_fixup(pkt + body_at, a->len);
+    }
+    if (!w.overflow) {
+        send_to(pkt, w.len, src);
+    }
+}
+
+static void handle_query(const uint8_t *pkt, int len, const struct sockaddr_in *src)
+{
+    if (len < 12 || (pkt[2] & 0xF8) != 0) {
+        return;   // Response, or not a standard query
+    }
+    uint16_t id = (uint16_t)((pkt[0] << 8) | pkt[1]);
+    int qdcount = (pkt[4] << 8) | pkt[5];
+    int off = 12;
+
+    for (int q = 0; q < qdcount; q++) {
+        char name[MDNS_NAME_MAX];
+        off = read_name(pkt, len, off, name, sizeof(name));
+        if (off < 0 || off + 4 > len) {
+            return;
+        }
+        uint16_t qtype = (uint16_t)((pkt[off] << 8) | pkt[off + 1]);
+        uint16_t qclass = (uint16_t)((pkt[off + 2] << 8) | pkt[off + 3]);
+        off += 4;
+
+        const answer_t *a = find_answer(name, qtype);
+        if (a) {
+            reply(a, id, name, qtype, src, (qclass & CLASS_TOP_BIT) != 0);
+        }
+    }
+}
+
+static void apply_address(uint32_t ip)
+{
+    struct ip_mreq mreq = {0};
+    inet_pton(AF_INET, MDNS_GROUP, &mreq.imr_multiaddr);
+
+    if (sta_ip) {
+        mreq.imr_interface.s_addr = sta_ip;
+        setsockopt(mdns_sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+    }
+    sta_ip = ip;
+    if (!ip) {
+        ESP_LOGI(TAG, "Uplink down - %s withdrawn", host_name);
+        return;
+    }
+
+    build_answers(ip);
+
+    // Join on the STA interface only; the AP side resolves through the DNS proxy
+    mreq.imr_interface.s_addr = ip;
+    if (setsockopt(mdns_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        ESP_LOGW(TAG, "Joining %s failed (errno %d) - unicast queries only", MDNS_GROUP, errno);
+    }
+    struct in_addr iface = { .s_addr = ip };
+    setsockopt(mdns_sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+
+    char ip_str[16];
+    inet_ntoa_r(iface, ip_str, sizeof(ip_str));
+    ESP_LOGI(TAG, "✓ %s -> %s (portal :%d, debug :%d)", host_name, ip_str, MDNS_HTTP_PORT, TCP_DEBUG_PORT);
+}
+
+static void mdns_task(void *pvParameters)
+{
+    uint8_t pkt[MDNS_MAX_PACKET];
+    int announcements_left = 0;
+    TickType_t next_announce = 0;
+
+    while (1) {
+        if (__atomic_exchange_n(&address_dirty, false, __ATOMIC_ACQUIRE)) {
+            apply_address(__atomic_load_n(&pending_ip, __ATOMIC_RELAXED));
+            announcements_left = sta_ip ? MDNS_ANNOUNCE_COUNT : 0;
+            next_announce = xTaskGetTickCount();
+        }
+        if (announcements_left > 0 && (int32_t)(xTaskGetTickCount() - next_announce) >= 0) {
+            send_multicast(&announcement);
+            announcements_left--;
+            next_announce = xTaskGetTickCount() + pdMS_TO_TICKS(1000);
+        }
+
+        // Short receive timeout so address changes and announcements aren't held up
+        struct sockaddr_in src;
+        socklen_t src_len = sizeof(src);
+        int len = recvfrom(mdns_sock, pkt, sizeof(pkt), 0, (struct sockaddr *)&src, &src_len);
+        if (len > 0 && sta_ip) {
+            handle_query(pkt, len, &src);
+        }
+    }
+}
+
+esp_err_t mdns_responder_init(void)
+{
+    if (mdns_task_handle) {
+        return ESP_OK;
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(host_name, sizeof(host_name), "%s-%02x%02x.local", MDNS_HOST_NAME, mac[4], mac[5]);
+    snprintf(http_instance, sizeof(http_instance), "labPORTAL %02x%02x.%s", mac[4], mac[5], MDNS_HTTP_SERVICE);
+    snprintf(debug_instance, sizeof(debug_instance), "labPORTAL %02x%02x.%s", mac[4], mac[5], MDNS_DEBUG_SERVICE);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return ESP_FAIL;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(MDNS_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    uint8_t ttl = 255;   // RFC 6762 section 11, receivers check it
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    struct timeval timeout = { .tv_sec = 0, .tv_usec = 250000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    mdns_sock = sock;
+
+    if (xTaskCreate(mdns_task, "mdns", 4096, NULL, 5, &mdns_task_handle) != pdPASS) {
+        close(sock);
+        mdns_sock = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ mDNS responder ready as %s (AP side: %s)", host_name, MDNS_LOCAL_NAME);
+    return ESP_OK;
+}
+
+void mdns_responder_set_address(uint32_t ip)
+{
+    __atomic_store_n(&pending_ip, ip, __ATOMIC_RELAXED);
+    __atomic_store_n(&address_dirty, true, __ATOMIC_RELEASE);
+}
+
+const char *mdns_responder_hostname(void)
+{
+    return host_name;
+}
+
+static bool name_eq(const char *name, const char *local)
+{
+    size_t n = strlen(local);
+    return local[0] && strncasecmp(name, local, n) == 0 && (name[n] == '\0' || strcmp(name + n, ".") == 0);
+}
+
+bool mdns_responder_is_local_name(const char *name)
+{
+    return name_eq(name, MDNS_LOCAL_NAME) || name_eq(name, host_name);
+}
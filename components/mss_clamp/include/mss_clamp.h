@@ -0,0 +1,99 @@
+#ifndef MSS_CLAMP_H
+#define MSS_CLAMP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Directions as seen from the AP client (same values as SHAPER_DIR_*)
+#define MSS_CLAMP_DIR_UP   0   // Client SYN -> uplink
+#define MSS_CLAMP_DIR_DOWN 1   // Server SYN-ACK -> client
+
+// Path MTU bounds; frag-needed reports below the floor are ignored (RFC 1191
+// lets routers claim 68, which only an attacker would)
+#define MSS_CLAMP_MIN_MTU 576
+#define MSS_CLAMP_MAX_MTU 1500
+
+// IPv4 + TCP headers without options: MSS = MTU - 40
+#define MSS_CLAMP_HEADERS 40
+
+// A learned path MTU is forgotten after this long (RFC 1191 aging)
+#define MSS_CLAMP_PMTU_AGE_S 600
+
+// Remote hosts with a learned path MTU; the stalest gives way when full
+#define MSS_CLAMP_PMTU_ENTRIES 16
+
+typedef struct {
+    bool enabled;
+    uint16_t mtu;          // Uplink MTU, 0 = auto (link MTU, lowered by frag-needed)
+} mss_clamp_config_t;
+
+typedef enum {
+    MSS_MTU_SOURCE_DEFAULT = 0,   // Nothing known, 1500
+    MSS_MTU_SOURCE_LINK,          // STA interface MTU (DHCP option 26)
+    MSS_MTU_SOURCE_LEARNED,       // ICMP frag-needed from a router on the uplink, per remote host
+    MSS_MTU_SOURCE_MANUAL,
+} mss_mtu_source_t;
+
+typedef struct {
+    uint16_t mtu;                 // In effect for new flows to hosts without a learned path MTU
+    mss_mtu_source_t source;
+    uint16_t link_mtu;            // 0 = no uplink seen yet
+    uint16_t learned_paths;       // Remote hosts with a fresh path MTU
+    uint16_t learned_mtu;         // Lowest of them, 0 = none
+    uint32_t learned_dst;         // Its remote host, network byte order
+    uint32_t learned_age_s;
+    uint32_t syns;                // SYNs and SYN-ACKs inspected
+    uint32_t clamped[2];          // Per direction, MSS option lowered
+    uint32_t frag_needed_heard;   // Reports accepted from the uplink
+    uint32_t frag_needed_rejected;   // Quoting no packet of a live flow of ours
+    uint32_t frag_needed_sent;    // Sent to clients for oversized DF packets
+} mss_clamp_status_t;
+
+/**
+ * Load the config from NVS (default: on, auto MTU)
+ */
+esp_err_t mss_clamp_init(void);
+
+esp_err_t mss_clamp_set_config(const mss_clamp_config_t *config, bool persist);
+void mss_clamp_get_config(mss_clamp_config_t *config);
+void mss_clamp_get_status(mss_clamp_status_t *status);
+const char *mss_clamp_source_name(mss_mtu_source_t source);
+
+// Forward path - all calls from one thread (lwIP's tcpip thread on the device).
+// Packets are raw IPv4 with at least `len` contiguous bytes
+
+/**
+ * Live NAPT mapping check: does some client have an open flow to remote_ip
+ * (network byte order) and remote_port of protocol proto?
+ */
+typedef bool (*mss_clamp_flow_fn)(uint8_t proto, uint32_t remote_ip, uint16_t remote_port);
+
+/**
+ * MTU toward the uplink for a packet to or from remote (network byte order),
+ * 0 while clamping is off
+ * egress_mtu is the outgoing interface's MTU, 0 = reuse the last one given
+ */
+uint16_t mss_clamp_path_mtu(uint16_t egress_mtu, uint32_t remote);
+
+/**
+ * Lower the MSS option of a TCP SYN to fit mtu, fixing the checksum
+ * Returns true if the packet was rewritten
+ */
+bool mss_clamp_syn(uint8_t *ip, size_t len, int dir, uint16_t mtu);
+
+/**
+ * Packet of tot_len bytes has DF set and will not fit mtu - the caller answers
+ * with ICMP frag-needed carrying mtu instead of forwarding it
+ */
+bool mss_clamp_too_big(const uint8_t *ip, size_t len, size_t tot_len, uint16_t mtu);
+
+/**
+ * ICMP arriving from the uplink; learns the path MTU to one remote host from
+ * a frag-needed addressed to sta_ip that quotes a packet of a flow live_flow
+ * still knows
+ */
+void mss_clamp_icmp(const uint8_t *ip, size_t len, uint32_t sta_ip, mss_clamp_flow_fn live_flow);
+
+#endif // MSS_CLAMP_H
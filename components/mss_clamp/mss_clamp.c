@@ -0,0 +1,404 @@
+#include "mss_clamp.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "MSSClamp";
+
+#define IP_PROTO_ICMP 1
+#define IP_PROTO_TCP  6
+#define IP_PROTO_UDP  17
+#define ICMP_DEST_UNREACH 3
+#define ICMP_FRAG_NEEDED  4
+#define TCP_FLAG_SYN 0x02
+#define TCP_OPT_END 0
+#define TCP_OPT_NOP 1
+#define TCP_OPT_MSS 2
+
+// Forward-path state, only touched by the forwarding thread
+static mss_clamp_config_t active = { .enabled = true, .mtu = 0 };
+static uint16_t link_mtu = 0;
+static mss_clamp_status_t stats = {0};
+
+// Path MTUs learned from frag-needed, one per remote host (RFC 1191 keeps
+// them per destination - a report about one path says nothing about others)
+typedef struct {
+    uint32_t dst;         // Network byte order, 0 = free
+    uint16_t mtu;
+    int64_t learned_at_us;
+} pmtu_entry_t;
+
+static pmtu_entry_t pmtu[MSS_CLAMP_PMTU_ENTRIES];
+
+// Config handoff from other tasks
+static mss_clamp_config_t config = { .enabled = true, .mtu = 0 };
+static volatile bool config_dirty = false;
+static SemaphoreHandle_t config_mutex = NULL;
+
+static const char *source_names[] = {
+    [MSS_MTU_SOURCE_DEFAULT] = "default",
+    [MSS_MTU_SOURCE_LINK] = "link",
+    [MSS_MTU_SOURCE_LEARNED] = "learned",
+    [MSS_MTU_SOURCE_MANUAL] = "manual",
+};
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static bool config_valid(const mss_clamp_config_t *cfg)
+{
+    return cfg->mtu == 0 || (cfg->mtu >= MSS_CLAMP_MIN_MTU && cfg->mtu <= MSS_CLAMP_MAX_MTU);
+}
+
+static void apply_pending_config(void)
+{
+    // Never block the forward path - a busy mutex just means next packet
+    if (!config_dirty || !config_mutex || xSemaphoreTake(config_mutex, 0) != pdTRUE) {
+        return;
+    }
+    active = config;
+    config_dirty = false;
+    xSemaphoreGive(config_mutex);
+}
+
+static bool pmtu_fresh(const pmtu_entry_t *e, int64_t now_us)
+{
+    return e->dst != 0 && now_us - e->learned_at_us < (int64_t)MSS_CLAMP_PMTU_AGE_S * 1000000;
+}
+
+static const pmtu_entry_t *pmtu_find(uint32_t dst, int64_t now_us)
+{
+    for (int i = 0; dst && i < MSS_CLAMP_PMTU_ENTRIES; i++) {
+        if (pmtu[i].dst == dst) {
+            return pmtu_fresh(&pmtu[i], now_us) ? &pmtu[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
+// Record a report for dst; lower always wins, higher only once the old one aged out.
+// Returns true if the MTU in effect for dst changed
+static bool pmtu_learn(uint32_t dst, uint16_t mtu, int64_t now_us)
+{
+    pmtu_entry_t *slot = NULL;
+    for (int i = 0; i < MSS_CLAMP_PMTU_ENTRIES && !slot; i++) {
+        if (pmtu[i].dst == dst) {
+            slot = &pmtu[i];
+        }
+    }
+    if (slot && pmtu_fresh(slot, now_us) && mtu >= slot->mtu) {
+        if (mtu == slot->mtu) {
+            slot->learned_at_us = now_us;   // Still true - age from now
+        }
+        return false;
+    }
+    if (!slot) {
+        // Free or aged-out entry, else the stalest one
+        slot = &pmtu[0];
+        for (int i = 0; i < MSS_CLAMP_PMTU_ENTRIES; i++) {
+            if (!pmtu_fresh(&pmtu[i], now_us)) {
+                slot = &pmtu[i];
+                break;
+            }
+            if (pmtu[i].learned_at_us < slot->learned_at_us) {
+                slot = &pmtu[i];
+            }
+        }
+    }
+    slot->dst = dst;
+    slot->mtu = mtu;
+    slot->learned_at_us = now_us;
+    return true;
+}
+
+// Effective MTU toward dst (0 = no particular host) and where it came from
+static uint16_t resolve(const mss_clamp_config_t *cfg, uint32_t dst, int64_t now_us, mss_mtu_source_t *source)
+{
+    if (cfg->mtu) {
+        *source = MSS_MTU_SOURCE_MANUAL;
+        return cfg->mtu;
+    }
+    uint16_t mtu = MSS_CLAMP_MAX_MTU;
+    *source = MSS_MTU_SOURCE_DEFAULT;
+    if (link_mtu >= MSS_CLAMP_MIN_MTU && link_mtu < mtu) {
+        mtu = link_mtu;
+        *source = MSS_MTU_SOURCE_LINK;
+    }
+    const pmtu_entry_t *e = pmtu_find(dst, now_us);
+    if (e && e->mtu < mtu) {
+        mtu = e->mtu;
+        *source = MSS_MTU_SOURCE_LEARNED;
+    }
+    return mtu;
+}
+
+// RFC 1624 incremental update of a ones' complement checksum for one 16-bit word
+static uint16_t csum_update(uint16_t csum, uint16_t old_word, uint16_t new_word)
+{
+    uint32_t sum = (uint16_t)~csum + (uint32_t)(uint16_t)~old_word + new_word;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+// 16-bit checksum word starting at an even offset into the segment; bytes past
+// the end count as the zero padding the checksum uses
+static uint16_t seg_word(const uint8_t *seg, size_t seg_len, size_t off)
+{
+    uint8_t hi = off < seg_len ? seg[off] : 0;
+    uint8_t lo = off + 1 < seg_len ? seg[off + 1] : 0;
+    return (uint16_t)((hi << 8) | lo);
+}
+
+// Rewrite the 2-byte MSS value at an arbitrary offset in the TCP segment.
+// Options are byte-aligned, so the value may straddle two checksum words
+static void rewrite_mss(uint8_t *tcp, size_t seg_len, size_t at, uint16_t mss)
+{
+    size_t first = at & ~(size_t)1;
+    size_t last = (at + 1) & ~(size_t)1;
+    uint16_t old_first = seg_word(tcp, seg_len, first);
+    uint16_t old_last = seg_word(tcp, seg_len, last);
+
+    put_u16(tcp + at, mss);
+
+    uint16_t csum = get_u16(tcp + 16);
+    csum = csum_update(csum, old_first, seg_word(tcp, seg_len, first));
+    if (last != first) {
+        csum = csum_update(csum, old_last, seg_word(tcp, seg_len, last));
+    }
+    put_u16(tcp + 16, csum);
+}
+
+esp_err_t mss_clamp_init(void)
+{
+    if (!config_mutex) {
+        config_mutex = xSemaphoreCreateMutex();
+        if (!config_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    mss_clamp_config_t cfg = { .enabled = true, .mtu = 0 };
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        uint8_t enabled = 1;
+        nvs_get_u8(nvs, "mss_on", &enabled);
+        nvs_get_u16(nvs, "mss_mtu", &cfg.mtu);
+        nvs_close(nvs);
+        cfg.enabled = enabled != 0;
+    }
+    if (!config_valid(&cfg)) {
+        cfg.mtu = 0;
+    }
+
+    if (cfg.mtu) {
+        ESP_LOGI(TAG, "✓ MSS clamping %s - uplink MTU %d (manual)", cfg.enabled ? "on" : "off", cfg.mtu);
+    } else {
+        ESP_LOGI(TAG, "✓ MSS clamping %s - uplink MTU auto", cfg.enabled ? "on" : "off");
+    }
+    return mss_clamp_set_config(&cfg, false);
+}
+
+esp_err_t mss_clamp_set_config(const mss_clamp_config_t *cfg, bool persist)
+{
+    if (!config_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!config_valid(cfg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    config = *cfg;
+    config_dirty = true;
+    xSemaphoreGive(config_mutex);
+
+    if (!persist) {
+        return ESP_OK;
+    }
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u8(nvs, "mss_on", cfg->enabled ? 1 : 0);
+    nvs_set_u16(nvs, "mss_mtu", cfg->mtu);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+void mss_clamp_get_config(mss_clamp_config_t *cfg)
+{
+    if (!config_mutex) {
+        *cfg = config;
+        return;
+    }
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(config_mutex);
+}
+
+void mss_clamp_get_status(mss_clamp_status_t *out)
+{
+    // Counters and last-seen values only, a torn read is harmless
+    mss_clamp_config_t cfg;
+    mss_clamp_get_config(&cfg);   // As configured, even before the next packet applies it
+    int64_t now = esp_timer_get_time();
+    *out = stats;
+    out->link_mtu = link_mtu;
+    out->learned_paths = 0;
+    out->learned_mtu = 0;
+    out->learned_dst = 0;
+    out->learned_age_s = 0;
+    const pmtu_entry_t *lowest = NULL;
+    for (int i = 0; i < MSS_CLAMP_PMTU_ENTRIES; i++) {
+        if (pmtu_fresh(&pmtu[i], now)) {
+            out->learned_paths++;
+            if (!lowest || pmtu[i].mtu < lowest->mtu) {
+                lowest = &pmtu[i];
+            }
+        }
+    }
+    if (lowest) {
+        out->learned_mtu = lowest->mtu;
+        out->learned_dst = lowest->dst;
+        out->learned_age_s = (uint32_t)((now - lowest->learned_at_us) / 1000000);
+    }
+    out->mtu = resolve(&cfg, 0, now, &out->source);
+}
+
+const char *mss_clamp_source_name(mss_mtu_source_t source)
+{
+    return source <= MSS_MTU_SOURCE_MANUAL ? source_names[source] : "?";
+}
+
+uint16_t mss_clamp_path_mtu(uint16_t egress_mtu, uint32_t remote)
+{
+    apply_pending_config();
+    if (egress_mtu) {
+        link_mtu = egress_mtu;
+    }
+    if (!active.enabled) {
+        return 0;
+    }
+    mss_mtu_source_t source;
+    return resolve(&active, remote, esp_timer_get_time(), &source);
+}
+
+bool mss_clamp_syn(uint8_t *ip, size_t len, int dir, uint16_t mtu)
+{
+    if (len < 20 || (ip[0] >> 4) != 4 || ip[9] != IP_PROTO_TCP || (get_u16(ip + 6) & 0x1fff) != 0) {
+        return false;   // Not IPv4 TCP, or not the first fragment
+    }
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    if (ihl < 20 || len < ihl + 20) {
+        return false;
+    }
+    uint8_t *tcp = ip + ihl;
+    size_t doff = (tcp[12] >> 4) * 4;
+    if (!(tcp[13] & TCP_FLAG_SYN) || doff < 20 || len < ihl + doff) {
+        return false;
+    }
+    stats.syns++;
+
+    // The checksum covers the whole segment, which ends at the IP total length
+    size_t tot_len = get_u16(ip + 2);
+    size_t seg_len = tot_len > ihl ? tot_len - ihl : 0;
+    uint16_t mss = (uint16_t)(mtu - MSS_CLAMP_HEADERS);
+
+    // No MSS option means 536, which is already below any MTU we clamp to
+    for (size_t i = 20; i < doff;) {
+        uint8_t kind = tcp[i];
+        if (kind == TCP_OPT_END) {
+            break;
+        }
+        if (kind == TCP_OPT_NOP) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= doff || tcp[i + 1] < 2 || i + tcp[i + 1] > doff) {
+            break;   // Malformed - leave it to the endpoints
+        }
+        if (kind == TCP_OPT_MSS && tcp[i + 1] == 4) {
+            if (get_u16(tcp + i + 2) <= mss) {
+                return false;
+            }
+            rewrite_mss(tcp, seg_len, i + 2, mss);
+            stats.clamped[dir == MSS_CLAMP_DIR_DOWN ? 1 : 0]++;
+            return true;
+        }
+        i += tcp[i + 1];
+    }
+    return false;
+}
+
+bool mss_clamp_too_big(const uint8_t *ip, size_t len, size_t tot_len, uint16_t mtu)
+{
+    if (len < 20 || (ip[0] >> 4) != 4 || tot_len <= mtu || !(get_u16(ip + 6) & 0x4000)) {
+        return false;   // Fits, or the router may fragment it (no DF)
+    }
+    stats.frag_needed_sent++;
+    return true;
+}
+
+void mss_clamp_icmp(const uint8_t *ip, size_t len, uint32_t sta_ip, mss_clamp_flow_fn live_flow)
+{
+    if (len < 20 || (ip[0] >> 4) != 4 || ip[9] != IP_PROTO_ICMP) {
+        return;
+    }
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    if (ihl < 20 || len < ihl + 8) {
+        return;
+    }
+    const uint8_t *icmp = ip + ihl;
+    if (icmp[0] != ICMP_DEST_UNREACH || icmp[1] != ICMP_FRAG_NEEDED) {
+        return;
+    }
+
+    // Next-hop MTU in the low half of the second word (RFC 1191); 0 = pre-1191 router
+    uint16_t mtu = get_u16(icmp + 6);
+    if (mtu < MSS_CLAMP_MIN_MTU || mtu >= MSS_CLAMP_MAX_MTU) {
+        return;
+    }
+
+    // The quoted header must be one of our own translated packets: sent from
+    // the STA address, bigger than the MTU claimed, to a remote endpoint a
+    // client has a live mapping with. Anyone can send us frag-needed; few
+    // can guess a flow that is open right now
+    const uint8_t *inner = icmp + 8;
+    size_t inner_len = len - ihl - 8;
+    size_t inner_ihl = inner_len >= 20 ? (inner[0] & 0x0f) * 4 : 0;
+    uint32_t outer_dst, inner_src, inner_dst;
+    if (inner_ihl < 20 || (inner[0] >> 4) != 4 || inner_len < inner_ihl + 4) {
+        stats.frag_needed_rejected++;
+        return;
+    }
+    memcpy(&outer_dst, ip + 16, 4);
+    memcpy(&inner_src, inner + 12, 4);
+    memcpy(&inner_dst, inner + 16, 4);
+    uint8_t proto = inner[9];
+    uint16_t dport = get_u16(inner + inner_ihl + 2);
+    if (outer_dst != sta_ip || inner_src != sta_ip || get_u16(inner + 2) <= mtu ||
+        (proto != IP_PROTO_TCP && proto != IP_PROTO_UDP) || !live_flow || !live_flow(proto, inner_dst, dport)) {
+        stats.frag_needed_rejected++;
+        return;
+    }
+    stats.frag_needed_heard++;
+
+    if (pmtu_learn(inner_dst, mtu, esp_timer_get_time())) {
+        const uint8_t *d = (const uint8_t *)&inner_dst;
+        ESP_LOGI(TAG, "Path MTU %d to %d.%d.%d.%d (frag-needed from the uplink)", mtu, d[0], d[1], d[2], d[3]);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef NAPT_MONITOR_H
+#define NAPT_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Shadow of lwIP's NAPT table, one mapping per forwarded 5-tuple. Keep equal
+// to CONFIG_LWIP_NAPT_MAX (sdkconfig.defaults) so "full" means the same thing
+#define NAPT_MONITOR_CAPACITY 512
+
+// Clients broken out in the report (AP limit is 10)
+#define NAPT_MONITOR_MAX_CLIENTS 16
+
+// Mapping age histogram upper bounds in seconds; the last bucket is open-ended
+#define NAPT_MONITOR_AGE_BUCKETS 6
+#define NAPT_MONITOR_AGE_BOUNDS { 10, 60, 300, 1800, 7200 }
+
+// Idle timeouts of the shadow: esp-lwip's compile-time IP_NAPT_TIMEOUT_MS_*
+// (lwip_napt.h). lwIP can't change them at runtime, so neither can the shadow
+#define NAPT_MONITOR_TCP_S         (30 * 60)
+#define NAPT_MONITOR_TCP_CLOSING_S 20
+#define NAPT_MONITOR_UDP_S         2
+#define NAPT_MONITOR_ICMP_S        2
+
+typedef struct {
+    uint32_t tcp_s;           // Established
+    uint32_t tcp_closing_s;   // SYN-only, FIN and RST
+    uint32_t udp_s;
+    uint32_t icmp_s;
+} napt_monitor_timeouts_t;
+
+typedef struct {
+    uint32_t ip;              // Network byte order
+    uint16_t tcp;
+    uint16_t udp;
+    uint16_t icmp;
+} napt_monitor_client_t;
+
+typedef struct {
+    uint16_t capacity;
+    uint16_t active;
+    uint16_t peak;
+    uint16_t tcp;
+    uint16_t udp;
+    uint16_t icmp;
+    uint16_t tcp_opening;     // SYN sent, no answer yet
+    uint16_t tcp_closing;     // FIN or RST seen
+    uint32_t created;
+    uint32_t expired;
+    uint32_t evicted;         // Reclaimed to make room - a live flow lost its mapping
+    uint32_t table_full;      // Creates refused
+    uint32_t unmatched;       // Replies with no mapping (expired here but not in lwIP, or vice versa)
+    uint32_t skipped;         // Packets not recorded because a report held the table
+    uint16_t age[NAPT_MONITOR_AGE_BUCKETS];
+    uint8_t client_count;
+    napt_monitor_client_t clients[NAPT_MONITOR_MAX_CLIENTS];   // Most mappings first
+} napt_monitor_report_t;
+
+/**
+ * Allocate the shadow table
+ */
+esp_err_t napt_monitor_init(void);
+
+/**
+ * Forward path - raw IPv4 packets with at least len contiguous bytes, once
+ * they are actually forwarded (not dropped or still held by the shaper)
+ * Outbound: client -> uplink, before translation
+ * Inbound: uplink -> client, after translation back to the client's address
+ * Never blocks: while a report holds the table the packet is only counted
+ */
+void napt_monitor_outbound(const uint8_t *ip, size_t len);
+void napt_monitor_inbound(const uint8_t *ip, size_t len);
+
+/**
+ * Some client has a live mapping to this remote endpoint (IP in network byte
+ * order, port in host order); vets ICMP errors that quote one of our flows
+ */
+bool napt_monitor_has_remote(uint8_t proto, uint32_t remote_ip, uint16_t remote_port);
+
+void napt_monitor_get_timeouts(napt_monitor_timeouts_t *timeouts);
+
+/**
+ * Expire idle mappings and summarise the table
+ */
+void napt_monitor_get_report(napt_monitor_report_t *report);
+
+#endif // NAPT_MONITOR_H
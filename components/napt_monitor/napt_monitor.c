@@ -0,0 +1,282 @@
+#include "napt_monitor.h"
+#include "napt_table.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static const char *TAG = "NAPTMonitor";
+
+// Shadow table: written by the forwarding thread, read by the report. The
+// report holds the mutex for a whole pass over the table; the forward path
+// never waits for it and counts the packet as skipped instead
+static napt_table_t table;
+static SemaphoreHandle_t table_mutex = NULL;
+static uint32_t skipped = 0;   // Forward-path packets not recorded (tcpip thread only)
+
+// lwIP's own, so the shadow expires mappings when the real table does
+static const napt_monitor_timeouts_t timeouts = {
+    .tcp_s = NAPT_MONITOR_TCP_S,
+    .tcp_closing_s = NAPT_MONITOR_TCP_CLOSING_S,
+    .udp_s = NAPT_MONITOR_UDP_S,
+    .icmp_s = NAPT_MONITOR_ICMP_S,
+};
+
+static const uint32_t age_bounds[NAPT_MONITOR_AGE_BUCKETS - 1] = NAPT_MONITOR_AGE_BOUNDS;
+
+static uint32_t now_ms(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// 5-tuple of a TCP/UDP packet or ICMP echo; false for anything NAPT doesn't map
+static bool parse(const uint8_t *ip, size_t len, uint8_t *proto, uint16_t *sport, uint16_t *dport,
+                  uint8_t *flags)
+{
+    if (len < 20 || (ip[0] >> 4) != 4 || (((ip[6] << 8) | ip[7]) & 0x1fff) != 0) {
+        return false;   // Later fragments carry no ports
+    }
+    size_t ihl = (ip[0] & 0x0f) * 4;
+    if (ihl < 20 || len < ihl + 8) {
+        return false;
+    }
+    const uint8_t *l4 = ip + ihl;
+    *proto = ip[9];
+    *flags = 0;
+    switch (*proto) {
+    case NAPT_PROTO_TCP:
+        if (len < ihl + 14) {
+            return false;
+        }
+        *flags = l4[13];
+        // fall through
+    case NAPT_PROTO_UDP:
+        *sport = (uint16_t)((l4[0] << 8) | l4[1]);
+        *dport = (uint16_t)((l4[2] << 8) | l4[3]);
+        return true;
+    case NAPT_PROTO_ICMP:
+        if (l4[0] != 8 && l4[0] != 0) {
+            return false;   // Only echo request/reply get their own mapping
+        }
+        *sport = (uint16_t)((l4[4] << 8) | l4[5]);   // Query identifier
+        *dport = 0;
+        return true;
+    default:
+        return false;
+    }
+}
+
+esp_err_t napt_monitor_init(void)
+{
+    if (table_mutex) {
+        return ESP_OK;
+    }
+
+    // Mapped ports are never seen on the wire here; a small range keeps the
+    // port bitmaps tiny while still outnumbering the entries
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.capacity = NAPT_MONITOR_CAPACITY;
+    cfg.port_min = 1;
+    cfg.port_max = NAPT_MONITOR_CAPACITY * 2;
+    cfg.preserve_ports = false;
+    cfg.evict_lru = true;   // As lwIP does when its table is full
+    cfg.tcp_established_ms = timeouts.tcp_s * 1000;
+    cfg.tcp_transitory_ms = timeouts.tcp_closing_s * 1000;
+    cfg.tcp_reset_ms = timeouts.tcp_closing_s * 1000;
+    cfg.udp_ms = timeouts.udp_s * 1000;
+    cfg.icmp_ms = timeouts.icmp_s * 1000;
+    esp_err_t err = napt_table_init(&table, &cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    table_mutex = xSemaphoreCreateMutex();
+    if (!table_mutex) {
+        napt_table_deinit(&table);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ NAPT monitor shadowing %d mappings (tcp %lus, udp %lus, icmp %lus)",
+             NAPT_MONITOR_CAPACITY, (unsigned long)timeouts.tcp_s, (unsigned long)timeouts.udp_s,
+             (unsigned long)timeouts.icmp_s);
+    return ESP_OK;
+}
+
+void napt_monitor_outbound(const uint8_t *ip, size_t len)
+{
+    uint8_t proto, flags;
+    uint16_t sport, dport;
+    if (!table_mutex || !parse(ip, len, &proto, &sport, &dport, &flags)) {
+        return;
+    }
+    uint32_t src, dst;
+    memcpy(&src, ip + 12, 4);
+    memcpy(&dst, ip + 16, 4);
+
+    uint32_t now = now_ms();
+    if (xSemaphoreTake(table_mutex, 0) != pdTRUE) {
+        skipped++;   // A report is mid-pass; never stall forwarding for it
+        return;
+    }
+    napt_table_tick(&table, now);
+    napt_table_outbound(&table, proto, src, sport, dst, dport, flags, now, true);
+    xSemaphoreGive(table_mutex);
+}
+
+void napt_monitor_inbound(const uint8_t *ip, size_t len)
+{
+    uint8_t proto, flags;
+    uint16_t sport, dport;
+    if (!table_mutex || !parse(ip, len, &proto, &sport, &dport, &flags)) {
+        return;
+    }
+    uint32_t src, dst;
+    memcpy(&src, ip + 12, 4);
+    memcpy(&dst, ip + 16, 4);
+    if (proto == NAPT_PROTO_ICMP) {
+        dport = sport;   // Echo reply carries the client's identifier
+        sport = 0;
+    }
+
+    uint32_t now = now_ms();
+    if (xSemaphoreTake(table_mutex, 0) != pdTRUE) {
+        skipped++;   // A report is mid-pass; never stall forwarding for it
+        return;
+    }
+    napt_table_tick(&table, now);
+    napt_table_reply(&table, proto, dst, dport, src, sport, flags, now);
+    xSemaphoreGive(table_mutex);
+}
+
+typedef struct {
+    uint8_t proto;
+    uint32_t ip;
+    uint16_t port;
+    bool found;
+} remote_ctx_t;
+
+static bool match_remote(const napt_entry_t *e, void *arg)
+{
+    remote_ctx_t *ctx = (remote_ctx_t *)arg;
+    ctx->found = e->proto == ctx->proto && e->dst_ip == ctx->ip && e->dst_port == ctx->port;
+    return !ctx->found;
+}
+
+bool napt_monitor_has_remote(uint8_t proto, uint32_t remote_ip, uint16_t remote_port)
+{
+    if (!table_mutex) {
+        return false;
+    }
+    // A linear pass, but only for the odd ICMP error, never per packet.
+    // Busy counts as no flow: the sender repeats a genuine frag-needed
+    remote_ctx_t ctx = { .proto = proto, .ip = remote_ip, .port = remote_port };
+    uint32_t now = now_ms();
+    if (xSemaphoreTake(table_mutex, 0) != pdTRUE) {
+        skipped++;
+        return false;
+    }
+    napt_table_tick(&table, now);
+    napt_table_foreach(&table, match_remote, &ctx);
+    xSemaphoreGive(table_mutex);
+    return ctx.found;
+}
+
+void napt_monitor_get_timeouts(napt_monitor_timeouts_t *t)
+{
+    *t = timeouts;
+}
+
+typedef struct {
+    napt_monitor_report_t *report;
+    uint32_t now;
+} report_ctx_t;
+
+static bool tally(const napt_entry_t *e, void *arg)
+{
+    report_ctx_t *ctx = (report_ctx_t *)arg;
+    napt_monitor_report_t *r = ctx->report;
+
+    if (e->proto == NAPT_PROTO_TCP) {
+        r->tcp++;
+        if (e->tcp_state == NAPT_TCP_STATE_SYN_SENT) {
+            r->tcp_opening++;
+        } else if (e->tcp_state != NAPT_TCP_STATE_ESTABLISHED) {
+            r->tcp_closing++;
+        }
+    } else if (e->proto == NAPT_PROTO_UDP) {
+        r->udp++;
+    } else {
+        r->icmp++;
+    }
+
+    uint32_t age_s = (ctx->now - e->created_ms) / 1000;
+    int bucket = 0;
+    while (bucket < NAPT_MONITOR_AGE_BUCKETS - 1 && age_s >= age_bounds[bucket]) {
+        bucket++;
+    }
+    r->age[bucket]++;
+
+    napt_monitor_client_t *c = NULL;
+    for (int i = 0; i < r->client_count; i++) {
+        if (r->clients[i].ip == e->src_ip) {
+            c = &r->clients[i];
+            break;
+        }
+    }
+    if (!c && r->client_count < NAPT_MONITOR_MAX_CLIENTS) {
+        c = &r->clients[r->client_count++];
+        c->ip = e->src_ip;
+    }
+    if (c) {
+        if (e->proto == NAPT_PROTO_TCP) {
+            c->tcp++;
+        } else if (e->proto == NAPT_PROTO_UDP) {
+            c->udp++;
+        } else {
+            c->icmp++;
+        }
+    }
+    return true;
+}
+
+static uint32_t client_total(const napt_monitor_client_t *c)
+{
+    return (uint32_t)c->tcp + c->udp + c->icmp;
+}
+
+void napt_monitor_get_report(napt_monitor_report_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->capacity = NAPT_MONITOR_CAPACITY;
+    if (!table_mutex) {
+        return;
+    }
+
+    report_ctx_t ctx = { .report = r, .now = now_ms() };
+    napt_stats_t st;
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+    napt_table_tick(&table, ctx.now);   // Quiet link: nothing else advances the wheel
+    napt_table_foreach(&table, tally, &ctx);
+    napt_table_get_stats(&table, &st);
+    xSemaphoreGive(table_mutex);
+
+    r->active = (uint16_t)st.active;
+    r->peak = (uint16_t)st.peak;
+    r->created = st.created;
+    r->expired = st.expired;
+    r->evicted = st.evicted;
+    r->table_full = st.table_full;
+    r->unmatched = st.inbound_miss;
+    r->skipped = __atomic_load_n(&skipped, __ATOMIC_RELAXED);
+
+    // Insertion sort, most mappings first
+    for (int i = 1; i < r->client_count; i++) {
+        napt_monitor_client_t c = r->clients[i];
+        int j = i;
+        while (j > 0 && client_total(&r->clients[j - 1]) < client_total(&c)) {
+            r->clients[j] = r->clients[j - 1];
+            j--;
+        }
+        r->clients[j] = c;
+    }
+}
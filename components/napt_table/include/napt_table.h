@@ -0,0 +1,193 @@
+#ifndef NAPT_TABLE_H
+#define NAPT_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// IP protocol numbers handled by the table
+#define NAPT_PROTO_ICMP 1
+#define NAPT_PROTO_TCP  6
+#define NAPT_PROTO_UDP  17
+
+// TCP header flags (as on the wire) for state tracking
+#define NAPT_TCP_FIN 0x01
+#define NAPT_TCP_SYN 0x02
+#define NAPT_TCP_RST 0x04
+#define NAPT_TCP_ACK 0x10
+
+// Timer wheel: 3 levels x 64 slots covers 2^18 ticks (~72 h at 1 s ticks)
+#define NAPT_WHEEL_LEVELS 3
+#define NAPT_WHEEL_BITS   6
+#define NAPT_WHEEL_SLOTS  (1 << NAPT_WHEEL_BITS)
+
+#define NAPT_NONE 0xFFFF   // Null entry index
+
+// Per-mapping TCP state, only used to pick a timeout
+typedef enum {
+    NAPT_TCP_STATE_SYN_SENT,      // Outbound SYN, no reply yet
+    NAPT_TCP_STATE_ESTABLISHED,   // Traffic seen both ways
+    NAPT_TCP_STATE_CLOSING,       // FIN seen
+    NAPT_TCP_STATE_RESET          // RST seen
+} napt_tcp_state_t;
+
+// One translation - IPs in network byte order, ports in host byte order
+// For ICMP echo the "port" is the query identifier
+typedef struct {
+    uint32_t src_ip;          // Inside client
+    uint32_t dst_ip;          // Remote host
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t mapped_port;     // Port on the upstream address
+    uint8_t  proto;
+    uint8_t  tcp_state;       // napt_tcp_state_t
+    uint32_t created_ms;
+    uint32_t last_active_ms;
+    uint32_t expire_tick;     // Wheel tick the entry is filed under (re-checked when it fires)
+    uint32_t packets_out;
+    uint32_t packets_in;
+    uint16_t wheel_next;      // Timer wheel links (NAPT_NONE terminated)
+    uint16_t wheel_prev;
+    uint8_t  in_use;
+    uint8_t  wheel_slot;      // level * NAPT_WHEEL_SLOTS + slot
+} napt_entry_t;
+
+typedef struct {
+    uint16_t capacity;               // Max mappings (<= 32768)
+    uint16_t port_min;               // Mapped port range, inclusive
+    uint16_t port_max;
+    bool preserve_ports;             // Keep the client's source port when free
+    bool filter_inbound;             // Inbound must come from the mapped remote (address+port dependent)
+    bool evict_lru;                  // When full, reclaim the longest idle mapping instead of refusing
+    uint32_t tick_ms;                // Timer wheel resolution
+    uint32_t tcp_established_ms;
+    uint32_t tcp_transitory_ms;      // SYN-only and FIN states
+    uint32_t tcp_reset_ms;
+    uint32_t udp_ms;
+    uint32_t icmp_ms;
+    uint32_t hash_seed;              // Randomize on device to resist hash flooding
+    void (*on_expire)(const napt_entry_t *entry, void *ctx);
+    void *ctx;
+} napt_config_t;
+
+#define NAPT_CONFIG_DEFAULT() {                 \
+        .capacity           = 512,              \
+        .port_min           = 49152,            \
+        .port_max           = 65535,            \
+        .preserve_ports     = true,             \
+        .filter_inbound     = true,             \
+        .evict_lru          = false,            \
+        .tick_ms            = 1000,             \
+        .tcp_established_ms = 30 * 60 * 1000,   \
+        .tcp_transitory_ms  = 60 * 1000,        \
+        .tcp_reset_ms       = 2 * 1000,         \
+        .udp_ms             = 60 * 1000,        \
+        .icmp_ms            = 10 * 1000,        \
+        .hash_seed          = 0x9e3779b9,       \
+        .on_expire          = NULL,             \
+        .ctx                = NULL,             \
+}
+
+typedef struct {
+    uint32_t active;
+    uint32_t peak;
+    uint32_t created;
+    uint32_t expired;
+    uint32_t removed;
+    uint32_t table_full;        // Creates refused for lack of entries
+    uint32_t evicted;           // Mappings reclaimed early to make room (evict_lru)
+    uint32_t ports_exhausted;   // Creates refused for lack of ports
+    uint32_t inbound_miss;      // No mapping (or filtered) for an inbound packet
+    uint64_t lookups;
+    uint64_t probes;            // Hash slots inspected by all lookups
+    uint16_t max_probe;
+} napt_stats_t;
+
+typedef struct {
+    napt_config_t cfg;
+    napt_entry_t *entries;
+    uint16_t free_head;               // Free list threaded through wheel_next
+    uint16_t *out_index;              // Open-addressed, entry index + 1 (0 = empty)
+    uint16_t *in_index;
+    uint32_t index_mask;
+    uint32_t *port_bitmap[3];         // ICMP, TCP, UDP - bit set = mapped port in use
+    uint16_t port_cursor[3];
+    uint32_t port_words;
+    uint16_t wheel[NAPT_WHEEL_LEVELS][NAPT_WHEEL_SLOTS];
+    uint32_t wheel_tick;              // Last processed tick
+    uint32_t wheel_ms;                // Time of wheel_tick
+    bool wheel_started;
+    napt_stats_t stats;
+} napt_table_t;
+
+/**
+ * Allocate entries, indexes and port bitmaps (one allocation each, no later heap use)
+ */
+esp_err_t napt_table_init(napt_table_t *table, const napt_config_t *config);
+
+/**
+ * Free everything allocated by napt_table_init
+ */
+void napt_table_deinit(napt_table_t *table);
+
+/**
+ * Outbound packet: find the mapping for this 5-tuple, creating it if asked
+ * tcp_flags is ignored for other protocols; NULL if absent or no room
+ */
+napt_entry_t *napt_table_outbound(napt_table_t *table, uint8_t proto,
+                                  uint32_t src_ip, uint16_t src_port,
+                                  uint32_t dst_ip, uint16_t dst_port,
+                                  uint8_t tcp_flags, uint32_t now_ms, bool create);
+
+/**
+ * Inbound packet to mapped_port from remote_ip:remote_port
+ * NULL if no mapping (or filtered by address+port dependent filtering)
+ */
+napt_entry_t *napt_table_inbound(napt_table_t *table, uint8_t proto, uint16_t mapped_port,
+                                 uint32_t remote_ip, uint16_t remote_port,
+                                 uint8_t tcp_flags, uint32_t now_ms);
+
+/**
+ * Reply seen after translation, keyed like the outbound packet it answers
+ * (inside address and port, remote address and port). For a table that
+ * shadows another NAT and never sees mapped ports. NULL if no mapping
+ */
+napt_entry_t *napt_table_reply(napt_table_t *table, uint8_t proto,
+                               uint32_t inside_ip, uint16_t inside_port,
+                               uint32_t remote_ip, uint16_t remote_port,
+                               uint8_t tcp_flags, uint32_t now_ms);
+
+/**
+ * Drop one mapping now (frees its port)
+ */
+void napt_table_remove(napt_table_t *table, napt_entry_t *entry);
+
+/**
+ * Expire idle mappings up to now_ms - cost is per elapsed tick, not per entry
+ */
+void napt_table_tick(napt_table_t *table, uint32_t now_ms);
+
+/**
+ * Change idle timeouts; every mapping is re-filed against the new values
+ */
+void napt_table_set_timeouts(napt_table_t *table, uint32_t tcp_established_ms, uint32_t tcp_transitory_ms,
+                             uint32_t tcp_reset_ms, uint32_t udp_ms, uint32_t icmp_ms);
+
+/**
+ * Idle timeout that applies to this entry right now
+ */
+uint32_t napt_table_timeout(const napt_table_t *table, const napt_entry_t *entry);
+
+/**
+ * Visit every active mapping; stop early when visit returns false
+ */
+void napt_table_foreach(const napt_table_t *table,
+                        bool (*visit)(const napt_entry_t *entry, void *ctx), void *ctx);
+
+/**
+ * Counters (copied)
+ */
+void napt_table_get_stats(const napt_table_t *table, napt_stats_t *stats);
+
+#endif // NAPT_TABLE_H
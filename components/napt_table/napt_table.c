@@ -0,0 +1,576 @@
+#include "napt_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Ported from src_arduino_backup/simple_napt.cpp, which scanned all 256
+// entries for every lookup, expired inline and allocated ports from a
+// wrapping counter. Here both directions are O(1) hash lookups, expiry is
+// driven by a timer wheel and ports come from a bitmap so they never collide.
+
+#define PROTO_SLOTS 3
+
+static int proto_slot(uint8_t proto)
+{
+    switch (proto) {
+    case NAPT_PROTO_ICMP: return 0;
+    case NAPT_PROTO_TCP:  return 1;
+    case NAPT_PROTO_UDP:  return 2;
+    default:              return -1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Hashing
+
+static uint32_t mix32(uint32_t h)
+{
+    // murmur3 finalizer
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t hash_outbound(const napt_table_t *t, uint8_t proto, uint32_t src_ip, uint16_t src_port,
+                              uint32_t dst_ip, uint16_t dst_port)
+{
+    uint32_t h = t->cfg.hash_seed;
+    h = mix32(h ^ src_ip);
+    h = mix32(h ^ dst_ip);
+    h = mix32(h ^ ((uint32_t)src_port << 16 | dst_port));
+    return mix32(h ^ proto);
+}
+
+static uint32_t hash_inbound(const napt_table_t *t, uint8_t proto, uint16_t mapped_port)
+{
+    return mix32(t->cfg.hash_seed ^ ((uint32_t)proto << 16 | mapped_port));
+}
+
+static uint32_t entry_hash_out(const napt_table_t *t, const napt_entry_t *e)
+{
+    return hash_outbound(t, e->proto, e->src_ip, e->src_port, e->dst_ip, e->dst_port);
+}
+
+static uint32_t entry_hash_in(const napt_table_t *t, const napt_entry_t *e)
+{
+    return hash_inbound(t, e->proto, e->mapped_port);
+}
+
+static void index_insert(napt_table_t *t, uint16_t *index, uint32_t hash, uint16_t idx)
+{
+    uint32_t slot = hash & t->index_mask;
+    while (index[slot] != 0) {
+        slot = (slot + 1) & t->index_mask;
+    }
+    index[slot] = idx + 1;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void index_delete(napt_table_t *t, uint16_t *index, uint32_t hash, uint16_t idx,
+                         uint32_t (*rehash)(const napt_table_t *, const napt_entry_t *))
+{
+    uint32_t mask = t->index_mask;
+    uint32_t i = hash & mask;
+    while (index[i] != idx + 1) {
+        if (index[i] == 0) return;   // Not indexed
+        i = (i + 1) & mask;
+    }
+
+    uint32_t j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (index[j] == 0) break;
+        uint32_t home = rehash(t, &t->entries[index[j] - 1]) & mask;
+        // Move j back into the hole unless its home lies cyclically in (i, j]
+        bool stays = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!stays) {
+            index[i] = index[j];
+            i = j;
+        }
+    }
+    index[i] = 0;
+}
+
+static void note_probes(napt_table_t *t, uint32_t probes)
+{
+    t->stats.lookups++;
+    t->stats.probes += probes;
+    if (probes > t->stats.max_probe) {
+        t->stats.max_probe = (uint16_t)probes;
+    }
+}
+
+static napt_entry_t *find_outbound(napt_table_t *t, uint8_t proto, uint32_t src_ip, uint16_t src_port,
+                                   uint32_t dst_ip, uint16_t dst_port)
+{
+    uint32_t slot = hash_outbound(t, proto, src_ip, src_port, dst_ip, dst_port) & t->index_mask;
+    uint32_t probes = 1;
+    uint16_t v;
+    while ((v = t->out_index[slot]) != 0) {
+        napt_entry_t *e = &t->entries[v - 1];
+        if (e->src_ip == src_ip && e->dst_ip == dst_ip && e->src_port == src_port &&
+            e->dst_port == dst_port && e->proto == proto) {
+            note_probes(t, probes);
+            return e;
+        }
+        slot = (slot + 1) & t->index_mask;
+        probes++;
+    }
+    note_probes(t, probes);
+    return NULL;
+}
+
+static napt_entry_t *find_inbound(napt_table_t *t, uint8_t proto, uint16_t mapped_port)
+{
+    uint32_t slot = hash_inbound(t, proto, mapped_port) & t->index_mask;
+    uint32_t probes = 1;
+    uint16_t v;
+    while ((v = t->in_index[slot]) != 0) {
+        napt_entry_t *e = &t->entries[v - 1];
+        if (e->mapped_port == mapped_port && e->proto == proto) {
+            note_probes(t, probes);
+            return e;
+        }
+        slot = (slot + 1) & t->index_mask;
+        probes++;
+    }
+    note_probes(t, probes);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Port bitmap
+
+static bool port_take(napt_table_t *t, int ps, uint16_t port)
+{
+    uint32_t off = port - t->cfg.port_min;
+    uint32_t *word = &t->port_bitmap[ps][off >> 5];
+    uint32_t bit = 1u << (off & 31);
+    if (*word & bit) {
+        return false;
+    }
+    *word |= bit;
+    return true;
+}
+
+static void port_release(napt_table_t *t, int ps, uint16_t port)
+{
+    uint32_t off = port - t->cfg.port_min;
+    t->port_bitmap[ps][off >> 5] &= ~(1u << (off & 31));
+}
+
+static bool port_alloc(napt_table_t *t, int ps, uint16_t preferred, uint16_t *out)
+{
+    if (t->cfg.preserve_ports && preferred >= t->cfg.port_min && preferred <= t->cfg.port_max &&
+        port_take(t, ps, preferred)) {
+        *out = preferred;
+        return true;
+    }
+
+    // Next free bit after the last allocation, one 32-port word at a time
+    uint32_t start = t->port_cursor[ps];
+    for (uint32_t n = 0; n < t->port_words; n++) {
+        uint32_t w = (start + n) % t->port_words;
+        uint32_t free_bits = ~t->port_bitmap[ps][w];
+        if (free_bits) {
+            uint32_t bit = (uint32_t)__builtin_ctz(free_bits);
+            t->port_bitmap[ps][w] |= 1u << bit;
+            t->port_cursor[ps] = (uint16_t)w;
+            *out = (uint16_t)(t->cfg.port_min + w * 32 + bit);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Timer wheel
+
+uint32_t napt_table_timeout(const napt_table_t *t, const napt_entry_t *e)
+{
+    switch (e->proto) {
+    case NAPT_PROTO_TCP:
+        switch (e->tcp_state) {
+        case NAPT_TCP_STATE_ESTABLISHED: return t->cfg.tcp_established_ms;
+        case NAPT_TCP_STATE_RESET:       return t->cfg.tcp_reset_ms;
+        default:                         return t->cfg.tcp_transitory_ms;
+        }
+    case NAPT_PROTO_UDP:
+        return t->cfg.udp_ms;
+    default:
+        return t->cfg.icmp_ms;
+    }
+}
+
+// Tick at which the entry's idle timeout runs out (always in the future)
+static uint32_t expiry_tick(const napt_table_t *t, const napt_entry_t *e)
+{
+    int32_t remaining = (int32_t)(e->last_active_ms + napt_table_timeout(t, e) - t->wheel_ms);
+    if (remaining <= 0) {
+        return t->wheel_tick + 1;
+    }
+    return t->wheel_tick + ((uint32_t)remaining + t->cfg.tick_ms - 1) / t->cfg.tick_ms;
+}
+
+static void wheel_link(napt_table_t *t, uint16_t idx, uint32_t tick)
+{
+    napt_entry_t *e = &t->entries[idx];
+    uint32_t delta = tick - t->wheel_tick;
+    const uint32_t span = 1u << (NAPT_WHEEL_BITS * NAPT_WHEEL_LEVELS);
+    int level;
+
+    if (delta >= span) {
+        tick = t->wheel_tick + span - 1;   // Re-filed when it fires
+        delta = span - 1;
+    }
+    for (level = 0; level < NAPT_WHEEL_LEVELS - 1; level++) {
+        if (delta < (1u << (NAPT_WHEEL_BITS * (level + 1)))) break;
+    }
+    uint32_t slot = (tick >> (NAPT_WHEEL_BITS * level)) & (NAPT_WHEEL_SLOTS - 1);
+
+    e->expire_tick = tick;
+    e->wheel_slot = (uint8_t)(level * NAPT_WHEEL_SLOTS + slot);
+    e->wheel_prev = NAPT_NONE;
+    e->wheel_next = t->wheel[level][slot];
+    if (e->wheel_next != NAPT_NONE) {
+        t->entries[e->wheel_next].wheel_prev = idx;
+    }
+    t->wheel[level][slot] = idx;
+}
+
+static void wheel_unlink(napt_table_t *t, uint16_t idx)
+{
+    napt_entry_t *e = &t->entries[idx];
+    uint16_t *head = &t->wheel[e->wheel_slot / NAPT_WHEEL_SLOTS][e->wheel_slot % NAPT_WHEEL_SLOTS];
+    if (e->wheel_prev != NAPT_NONE) {
+        t->entries[e->wheel_prev].wheel_next = e->wheel_next;
+    } else {
+        *head = e->wheel_next;
+    }
+    if (e->wheel_next != NAPT_NONE) {
+        t->entries[e->wheel_next].wheel_prev = e->wheel_prev;
+    }
+}
+
+static void entry_release(napt_table_t *t, uint16_t idx, bool on_wheel)
+{
+    napt_entry_t *e = &t->entries[idx];
+    if (on_wheel) {
+        wheel_unlink(t, idx);
+    }
+    index_delete(t, t->out_index, entry_hash_out(t, e), idx, entry_hash_out);
+    index_delete(t, t->in_index, entry_hash_in(t, e), idx, entry_hash_in);
+    port_release(t, proto_slot(e->proto), e->mapped_port);
+    e->in_use = 0;
+    e->wheel_next = t->free_head;
+    t->free_head = idx;
+    t->stats.active--;
+}
+
+// Empty one slot: expire what has been idle for its whole timeout and
+// re-file the rest (touched since filing, or cascading down a level)
+static void wheel_run_slot(napt_table_t *t, int level, uint32_t slot)
+{
+    uint16_t idx = t->wheel[level][slot];
+    t->wheel[level][slot] = NAPT_NONE;
+
+    while (idx != NAPT_NONE) {
+        napt_entry_t *e = &t->entries[idx];
+        uint16_t next = e->wheel_next;
+
+        if ((int32_t)(e->last_active_ms + napt_table_timeout(t, e) - t->wheel_ms) <= 0) {
+            t->stats.expired++;
+            if (t->cfg.on_expire) {
+                t->cfg.on_expire(e, t->cfg.ctx);
+            }
+            entry_release(t, idx, false);
+        } else {
+            wheel_link(t, idx, expiry_tick(t, e));
+        }
+        idx = next;
+    }
+}
+
+static void wheel_advance(napt_table_t *t)
+{
+    t->wheel_tick++;
+    t->wheel_ms += t->cfg.tick_ms;
+    uint32_t tick = t->wheel_tick;
+
+    // Cascade coarse levels first so entries due this tick reach level 0 in time
+    for (int level = NAPT_WHEEL_LEVELS - 1; level > 0; level--) {
+        uint32_t low_mask = (1u << (NAPT_WHEEL_BITS * level)) - 1;
+        if ((tick & low_mask) == 0) {
+            wheel_run_slot(t, level, (tick >> (NAPT_WHEEL_BITS * level)) & (NAPT_WHEEL_SLOTS - 1));
+        }
+    }
+    wheel_run_slot(t, 0, tick & (NAPT_WHEEL_SLOTS - 1));
+}
+
+static void wheel_start(napt_table_t *t, uint32_t now_ms)
+{
+    if (!t->wheel_started) {
+        t->wheel_started = true;
+        t->wheel_ms = now_ms;
+    }
+}
+
+void napt_table_tick(napt_table_t *t, uint32_t now_ms)
+{
+    wheel_start(t, now_ms);
+    while ((int32_t)(now_ms - t->wheel_ms) >= (int32_t)t->cfg.tick_ms) {
+        wheel_advance(t);
+    }
+}
+
+// Shorter timeout after a state change (FIN/RST): pull the entry forward
+static void refile_if_sooner(napt_table_t *t, napt_entry_t *e)
+{
+    uint32_t due = expiry_tick(t, e);
+    if ((int32_t)(due - e->expire_tick) < 0) {
+        uint16_t idx = (uint16_t)(e - t->entries);
+        wheel_unlink(t, idx);
+        wheel_link(t, idx, due);
+    }
+}
+
+// Make room by dropping the mapping idle the longest (full table only)
+static bool evict_lru(napt_table_t *t, uint32_t now_ms)
+{
+    int32_t oldest = -1;
+    uint32_t longest = 0;
+    for (uint16_t i = 0; i < t->cfg.capacity; i++) {
+        uint32_t idle = now_ms - t->entries[i].last_active_ms;
+        if (t->entries[i].in_use && (oldest < 0 || idle > longest)) {
+            oldest = i;
+            longest = idle;
+        }
+    }
+    if (oldest < 0) {
+        return false;
+    }
+    t->stats.evicted++;
+    entry_release(t, (uint16_t)oldest, true);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+
+esp_err_t napt_table_init(napt_table_t *t, const napt_config_t *cfg)
+{
+    if (!t || !cfg || cfg->capacity == 0 || cfg->capacity > 32768 ||
+        cfg->port_min == 0 || cfg->port_max < cfg->port_min || cfg->tick_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->cfg = *cfg;
+
+    uint32_t index_size = 1;
+    while (index_size < (uint32_t)cfg->capacity * 2) index_size <<= 1;   // Load factor <= 0.5
+    t->index_mask = index_size - 1;
+
+    uint32_t ports = (uint32_t)cfg->port_max - cfg->port_min + 1;
+    t->port_words = (ports + 31) / 32;
+
+    t->entries = calloc(cfg->capacity, sizeof(napt_entry_t));
+    t->out_index = calloc(index_size, sizeof(uint16_t));
+    t->in_index = calloc(index_size, sizeof(uint16_t));
+    bool ok = t->entries && t->out_index && t->in_index;
+    for (int p = 0; p < PROTO_SLOTS; p++) {
+        t->port_bitmap[p] = calloc(t->port_words, sizeof(uint32_t));
+        ok = ok && t->port_bitmap[p];
+    }
+    if (!ok) {
+        napt_table_deinit(t);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Bits past port_max in the last word are permanently taken
+    if (ports % 32) {
+        for (int p = 0; p < PROTO_SLOTS; p++) {
+            t->port_bitmap[p][t->port_words - 1] |= ~((1u << (ports % 32)) - 1);
+        }
+    }
+
+    for (uint16_t i = 0; i < cfg->capacity; i++) {
+        t->entries[i].wheel_next = (i + 1 < cfg->capacity) ? i + 1 : NAPT_NONE;
+    }
+    t->free_head = 0;
+    memset(t->wheel, 0xFF, sizeof(t->wheel));
+    return ESP_OK;
+}
+
+void napt_table_deinit(napt_table_t *t)
+{
+    free(t->entries);
+    free(t->out_index);
+    free(t->in_index);
+    for (int p = 0; p < PROTO_SLOTS; p++) {
+        free(t->port_bitmap[p]);
+    }
+    memset(t, 0, sizeof(*t));
+}
+
+static void tcp_track(napt_table_t *t, napt_entry_t *e, uint8_t flags, bool inbound)
+{
+    if (e->proto != NAPT_PROTO_TCP) {
+        return;
+    }
+    uint8_t before = e->tcp_state;
+    if (flags & NAPT_TCP_RST) {
+        e->tcp_state = NAPT_TCP_STATE_RESET;
+    } else if (flags & NAPT_TCP_FIN) {
+        e->tcp_state = NAPT_TCP_STATE_CLOSING;
+    } else if (!inbound && (flags & NAPT_TCP_SYN) && !(flags & NAPT_TCP_ACK)) {
+        e->tcp_state = NAPT_TCP_STATE_SYN_SENT;    // New connection reusing the tuple
+    } else if (inbound && e->tcp_state == NAPT_TCP_STATE_SYN_SENT && (flags & NAPT_TCP_ACK)) {
+        e->tcp_state = NAPT_TCP_STATE_ESTABLISHED;
+    }
+    if (e->tcp_state != before) {
+        refile_if_sooner(t, e);
+    }
+}
+
+napt_entry_t *napt_table_outbound(napt_table_t *t, uint8_t proto,
+                                  uint32_t src_ip, uint16_t src_port,
+                                  uint32_t dst_ip, uint16_t dst_port,
+                                  uint8_t tcp_flags, uint32_t now_ms, bool create)
+{
+    int ps = proto_slot(proto);
+    if (ps < 0) {
+        return NULL;
+    }
+    wheel_start(t, now_ms);
+
+    napt_entry_t *e = find_outbound(t, proto, src_ip, src_port, dst_ip, dst_port);
+    if (e) {
+        e->last_active_ms = now_ms;
+        e->packets_out++;
+        tcp_track(t, e, tcp_flags, false);
+        return e;
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    if (t->free_head == NAPT_NONE && !(t->cfg.evict_lru && evict_lru(t, now_ms))) {
+        t->stats.table_full++;
+        return NULL;
+    }
+    uint16_t mapped;
+    if (!port_alloc(t, ps, src_port, &mapped)) {
+        t->stats.ports_exhausted++;
+        return NULL;
+    }
+
+    uint16_t idx = t->free_head;
+    e = &t->entries[idx];
+    t->free_head = e->wheel_next;
+
+    memset(e, 0, sizeof(*e));
+    e->src_ip = src_ip;
+    e->dst_ip = dst_ip;
+    e->src_port = src_port;
+    e->dst_port = dst_port;
+    e->mapped_port = mapped;
+    e->proto = proto;
+    e->tcp_state = (tcp_flags & NAPT_TCP_SYN) ? NAPT_TCP_STATE_SYN_SENT : NAPT_TCP_STATE_ESTABLISHED;
+    e->created_ms = now_ms;
+    e->last_active_ms = now_ms;
+    e->packets_out = 1;
+    e->in_use = 1;
+
+    index_insert(t, t->out_index, entry_hash_out(t, e), idx);
+    index_insert(t, t->in_index, entry_hash_in(t, e), idx);
+    wheel_link(t, idx, expiry_tick(t, e));
+
+    t->stats.created++;
+    if (++t->stats.active > t->stats.peak) {
+        t->stats.peak = t->stats.active;
+    }
+    return e;
+}
+
+napt_entry_t *napt_table_inbound(napt_table_t *t, uint8_t proto, uint16_t mapped_port,
+                                 uint32_t remote_ip, uint16_t remote_port,
+                                 uint8_t tcp_flags, uint32_t now_ms)
+{
+    napt_entry_t *e = find_inbound(t, proto, mapped_port);
+    if (e && t->cfg.filter_inbound &&
+        (e->dst_ip != remote_ip || (proto != NAPT_PROTO_ICMP && e->dst_port != remote_port))) {
+        e = NULL;
+    }
+    if (!e) {
+        t->stats.inbound_miss++;
+        return NULL;
+    }
+    e->last_active_ms = now_ms;
+    e->packets_in++;
+    tcp_track(t, e, tcp_flags, true);
+    return e;
+}
+
+napt_entry_t *napt_table_reply(napt_table_t *t, uint8_t proto,
+                               uint32_t inside_ip, uint16_t inside_port,
+                               uint32_t remote_ip, uint16_t remote_port,
+                               uint8_t tcp_flags, uint32_t now_ms)
+{
+    if (proto_slot(proto) < 0) {
+        return NULL;
+    }
+    napt_entry_t *e = find_outbound(t, proto, inside_ip, inside_port, remote_ip, remote_port);
+    if (!e) {
+        t->stats.inbound_miss++;
+        return NULL;
+    }
+    e->last_active_ms = now_ms;
+    e->packets_in++;
+    tcp_track(t, e, tcp_flags, true);
+    return e;
+}
+
+void napt_table_set_timeouts(napt_table_t *t, uint32_t tcp_established_ms, uint32_t tcp_transitory_ms,
+                             uint32_t tcp_reset_ms, uint32_t udp_ms, uint32_t icmp_ms)
+{
+    t->cfg.tcp_established_ms = tcp_established_ms;
+    t->cfg.tcp_transitory_ms = tcp_transitory_ms;
+    t->cfg.tcp_reset_ms = tcp_reset_ms;
+    t->cfg.udp_ms = udp_ms;
+    t->cfg.icmp_ms = icmp_ms;
+
+    // Filed under the old timeouts - a shorter one must not wait for the old slot
+    for (uint16_t i = 0; i < t->cfg.capacity; i++) {
+        if (t->entries[i].in_use) {
+            wheel_unlink(t, i);
+            wheel_link(t, i, expiry_tick(t, &t->entries[i]));
+        }
+    }
+}
+
+void napt_table_remove(napt_table_t *t, napt_entry_t *e)
+{
+    if (!e || !e->in_use) {
+        return;
+    }
+    t->stats.removed++;
+    entry_release(t, (uint16_t)(e - t->entries), true);
+}
+
+void napt_table_foreach(const napt_table_t *t,
+                        bool (*visit)(const napt_entry_t *entry, void *ctx), void *ctx)
+{
+    for (uint16_t i = 0; i < t->cfg.capacity; i++) {
+        if (t->entries[i].in_use && !visit(&t->entries[i], ctx)) {
+            return;
+        }
+    }
+}
+
+void napt_table_get_stats(const napt_table_t *t, napt_stats_t *stats)
+{
+    *stats = t->stats;
+}
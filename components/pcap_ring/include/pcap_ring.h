@@ -0,0 +1,55 @@
+#ifndef PCAP_RING_H
+#define PCAP_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Fixed ring of truncated IPv4 packets: the oldest is overwritten, nothing
+// is allocated after boot. 96 bytes covers IPv4 + TCP with options
+#define PCAP_RING_SLOTS   128
+#define PCAP_RING_SNAPLEN 96
+
+// Directions as seen from the AP client (exported as Linux cooked capture
+// packet types: up = incoming, down = outgoing)
+#define PCAP_DIR_UP   0   // Client -> AP
+#define PCAP_DIR_DOWN 1   // AP -> client
+
+// Capture filter, 0 fields match anything
+typedef struct {
+    uint8_t octet;       // Client 192.168.4.x
+    uint8_t proto;       // IP protocol (6 TCP, 17 UDP, 1 ICMP)
+    uint16_t port;       // TCP/UDP source or destination port
+} pcap_filter_t;
+
+typedef struct {
+    bool enabled;
+    pcap_filter_t filter;
+    uint32_t captured;   // Since boot, including those already overwritten
+    uint32_t held;       // In the ring now
+} pcap_ring_status_t;
+
+// Receives pcap file bytes; return false to stop the export
+typedef bool (*pcap_ring_emit_fn)(const void *data, size_t len, void *ctx);
+
+/**
+ * Start or stop capturing, and set what is kept
+ * Stopping keeps the ring for export; starting clears it
+ */
+void pcap_ring_set(bool enable, const pcap_filter_t *filter);
+void pcap_ring_get_status(pcap_ring_status_t *status);
+
+/**
+ * Offer one packet to the ring - single writer (the tcpip thread), lock-free
+ * ip/avail is the contiguous start of the IPv4 packet, len its full length
+ */
+void pcap_ring_record(const void *ip, size_t avail, size_t len, uint8_t octet, int dir);
+
+/**
+ * Stream the ring, oldest first, as a pcap file
+ * Packets overwritten while the export runs are skipped
+ */
+esp_err_t pcap_ring_export(pcap_ring_emit_fn emit, void *ctx);
+
+#endif // PCAP_RING_H
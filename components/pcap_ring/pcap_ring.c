@@ -0,0 +1,202 @@
+#include "pcap_ring.h"
+#include "esp_timer.h"
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define EPOCH_VALID 1600000000   // time() above this means SNTP has set the clock
+
+#define LINKTYPE_LINUX_SLL 113
+#define SLL_HOST           0       // Packet type: sent to us
+#define SLL_OUTGOING       4       // Packet type: sent by us
+#define SLL_ARPHRD_NONE    0xFFFE  // No link-layer header, as on a tun device
+#define SLL_HLEN           16
+
+typedef struct {
+    uint32_t seq;        // 2n+1 while packet n is written, 2n+2 once it is complete
+    uint32_t len;        // Original length
+    int64_t ts_us;       // Since boot
+    uint8_t caplen;
+    uint8_t dir;
+    uint8_t data[PCAP_RING_SNAPLEN];
+} slot_t;
+
+_Static_assert(PCAP_RING_SNAPLEN <= UINT8_MAX, "caplen is stored in a byte");
+
+static slot_t ring[PCAP_RING_SLOTS];
+static uint32_t head = 0;       // Packets written since boot (tcpip thread)
+static uint32_t base = 0;       // First packet of the current capture
+static bool enabled = false;
+static uint32_t filter_word = 0; // octet << 24 | proto << 16 | port
+
+static uint32_t pack_filter(const pcap_filter_t *f)
+{
+    return (uint32_t)f->octet << 24 | (uint32_t)f->proto << 16 | f->port;
+}
+
+void pcap_ring_set(bool enable, const pcap_filter_t *filter)
+{
+    pcap_filter_t none = {0};
+    __atomic_store_n(&filter_word, pack_filter(filter ? filter : &none), __ATOMIC_RELAXED);
+    if (enable && !__atomic_load_n(&enabled, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&base, __atomic_load_n(&head, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&enabled, enable, __ATOMIC_RELEASE);
+}
+
+void pcap_ring_get_status(pcap_ring_status_t *status)
+{
+    uint32_t word = __atomic_load_n(&filter_word, __ATOMIC_RELAXED);
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint32_t start = __atomic_load_n(&base, __ATOMIC_RELAXED);
+
+    status->enabled = __atomic_load_n(&enabled, __ATOMIC_RELAXED);
+    status->filter.octet = (uint8_t)(word >> 24);
+    status->filter.proto = (uint8_t)(word >> 16);
+    status->filter.port = (uint16_t)word;
+    status->captured = end;
+    status->held = end - start < PCAP_RING_SLOTS ? end - start : PCAP_RING_SLOTS;
+}
+
+// Filter check on the raw header; a filtered port never matches a later fragment
+static bool matches(const uint8_t *ip, size_t avail, uint8_t octet, uint32_t word)
+{
+    uint8_t want_octet = (uint8_t)(word >> 24);
+    uint8_t want_proto = (uint8_t)(word >> 16);
+    uint16_t want_port = (uint16_t)word;
+
+    if (want_octet && octet != want_octet) {
+        return false;
+    }
+    if (want_proto && ip[9] != want_proto) {
+        return false;
+    }
+    if (want_port) {
+        size_t ihl = (ip[0] & 0x0f) * 4;
+        bool first_fragment = ((ip[6] & 0x1f) | ip[7]) == 0;
+        if ((ip[9] != 6 && ip[9] != 17) || !first_fragment || avail < ihl + 4) {
+            return false;
+        }
+        uint16_t sport = (uint16_t)(ip[ihl] << 8 | ip[ihl + 1]);
+        uint16_t dport = (uint16_t)(ip[ihl + 2] << 8 | ip[ihl + 3]);
+        if (sport != want_port && dport != want_port) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void pcap_ring_record(const void *ip, size_t avail, size_t len, uint8_t octet, int dir)
+{
+    if (!__atomic_load_n(&enabled, __ATOMIC_ACQUIRE) || avail < 20) {
+        return;
+    }
+    if (!matches((const uint8_t *)ip, avail, octet, __atomic_load_n(&filter_word, __ATOMIC_RELAXED))) {
+        return;
+    }
+
+    // Single writer: the sequence number tells readers a slot is mid-write
+    uint32_t n = head;
+    slot_t *slot = &ring[n % PCAP_RING_SLOTS];
+    __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    size_t caplen = avail < PCAP_RING_SNAPLEN ? avail : PCAP_RING_SNAPLEN;
+    slot->ts_us = esp_timer_get_time();
+    slot->len = (uint32_t)len;
+    slot->caplen = (uint8_t)caplen;
+    slot->dir = (uint8_t)dir;
+    memcpy(slot->data, ip, caplen);
+
+    __atomic_store_n(&slot->seq, 2 * n + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, n + 1, __ATOMIC_RELEASE);
+}
+
+static void put16be(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+esp_err_t pcap_ring_export(pcap_ring_emit_fn emit, void *ctx)
+{
+    // Boot-relative stamps become wall-clock ones once SNTP has run
+    int64_t offset_us = 0;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec > EPOCH_VALID) {
+        offset_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec - esp_timer_get_time();
+    }
+
+    struct __attribute__((packed)) {
+        uint32_t magic;
+        uint16_t version_major;
+        uint16_t version_minor;
+        int32_t thiszone;
+        uint32_t sigfigs;
+        uint32_t snaplen;
+        uint32_t network;
+    } file_header = {
+        .magic = 0xa1b2c3d4,   // Microsecond stamps, writer's byte order
+        .version_major = 2,
+        .version_minor = 4,
+        .snaplen = SLL_HLEN + PCAP_RING_SNAPLEN,
+        .network = LINKTYPE_LINUX_SLL,
+    };
+    if (!emit(&file_header, sizeof(file_header), ctx)) {
+        return ESP_FAIL;
+    }
+
+    // Bounds fixed up front so a busy link can't keep the export going
+    uint32_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    uint32_t start = __atomic_load_n(&base, __ATOMIC_RELAXED);
+    if (end - start > PCAP_RING_SLOTS) {
+        start = end - PCAP_RING_SLOTS;
+    }
+
+    // Records are batched so the HTTP side sends a few large chunks
+    uint8_t batch[768];
+    size_t used = 0;
+    for (uint32_t n = start; n != end; n++) {
+        const slot_t *slot = &ring[n % PCAP_RING_SLOTS];
+        slot_t copy;
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != 2 * n + 2) {
+            continue;   // Already overwritten
+        }
+        memcpy(&copy, slot, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            continue;   // Overwritten while we copied it
+        }
+
+        size_t record_len = 16 + SLL_HLEN + copy.caplen;
+        if (used + record_len > sizeof(batch)) {
+            if (!emit(batch, used, ctx)) {
+                return ESP_FAIL;
+            }
+            used = 0;
+        }
+
+        int64_t ts = copy.ts_us + offset_us;
+        uint32_t header[4] = {
+            (uint32_t)(ts / 1000000),
+            (uint32_t)(ts % 1000000),
+            SLL_HLEN + copy.caplen,
+            SLL_HLEN + copy.len,
+        };
+        uint8_t *out = batch + used;
+        memcpy(out, header, sizeof(header));
+        uint8_t *sll = out + sizeof(header);
+        memset(sll, 0, SLL_HLEN);
+        put16be(&sll[0], copy.dir == PCAP_DIR_UP ? SLL_HOST : SLL_OUTGOING);
+        put16be(&sll[2], SLL_ARPHRD_NONE);
+        put16be(&sll[14], 0x0800);   // IPv4; address length and address stay 0
+        memcpy(sll + SLL_HLEN, copy.data, copy.caplen);
+        used += record_len;
+    }
+    if (used > 0 && !emit(batch, used, ctx)) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -4,7 +4,10 @@
 #include "mpu6886.h"
 #include "boot_animation.h"
 #include "dns_server.h"
+#include "client_stats.h"
+#include "uplink_monitor.h"
 #include "ota_manager.h"
+#include "wifi_sta.h"
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "freertos/FreeRTOS.h"
@@ -32,6 +35,7 @@ static ui_state_t current_state = UI_MAIN_MENU;
 static int selected_main_item = 0;
 static int selected_portal_item = 0;
 static int selected_settings_item = 0;
+static int selected_network = 0;
 static int visitor_count = 0;
 static bool portal_running = false;
 static bool dim_enabled = false;  // Default: bright (dim OFF)
@@ -151,7 +155,8 @@ typedef struct {
     int dns_ms;
     int https_ms;
     int ping_ms;
-    bool running;
+    bool running;     // Uplink monitor has results
+    bool degraded;
 } nat_test_state_t;
 
 static nat_test_state_t nat_test = {0};
@@ -376,31 +381,28 @@ void portal_ui_button_a_pressed(void)
                 }
             } else if (selected_settings_item == 3) {
                 // Networks
+                selected_network = 0;
                 current_state = UI_SAVED_NETWORKS;
                 ESP_LOGI(TAG, "Networks opened");
             }
             break;
 
         case UI_SAVED_NETWORKS:
-            // Delete saved network
+            // Forget the selected network
             {
-                nvs_handle_t nvs;
-                if (nvs_open("storage", NVS_READWRITE, &nvs) == ESP_OK) {
-                    // Check if there's actually a saved network
-                    char ssid[33] = {0};
-                    size_t ssid_len = sizeof(ssid);
-                    if (nvs_get_str(nvs, "wifi_ssid", ssid, &ssid_len) == ESP_OK && strlen(ssid) > 0) {
-                        // Delete both ssid and password
-                        nvs_erase_key(nvs, "wifi_ssid");
-                        nvs_erase_key(nvs, "wifi_pass");
-                        nvs_commit(nvs);
-                        ESP_LOGI(TAG, "Deleted saved network: %s", ssid);
-                        sound_system_play(SOUND_SUCCESS);
-
-                        // Go back to settings submenu after deletion
+                wifi_sta_network_t networks[WIFI_STA_MAX_NETWORKS];
+                size_t count = wifi_sta_list(networks, WIFI_STA_MAX_NETWORKS);
+                if (selected_network < (int)count &&
+                    wifi_sta_forget(networks[selected_network].ssid) == ESP_OK) {
+                    ESP_LOGI(TAG, "Deleted saved network: %s", networks[selected_network].ssid);
+                    sound_system_play(SOUND_SUCCESS);
+
+                    // Stay on the list while anything is left
+                    if (count == 1) {
                         current_state = UI_SETTINGS_SUBMENU;
+                    } else if (selected_network == (int)count - 1) {
+                        selected_network--;
                     }
-                    nvs_close(nvs);
                 }
             }
             break;
@@ -478,6 +480,14 @@ void portal_ui_button_c_pressed(void)
             selected_settings_item = (selected_settings_item + 1) % SETTINGS_MENU_COUNT;
             break;
 
+        case UI_SAVED_NETWORKS:
+            {
+                wifi_sta_network_t networks[WIFI_STA_MAX_NETWORKS];
+                size_t count = wifi_sta_list(networks, WIFI_STA_MAX_NETWORKS);
+                selected_network = count > 0 ? (selected_network + 1) % (int)count : 0;
+            }
+            break;
+
         default:
             break;
     }
@@ -721,7 +731,7 @@ static void draw_settings_submenu(void)
     m5_display_flush(&display);
 }
 
-// Draw Saved Networks screen
+// Draw Saved Networks screen - best candidate first, as the device would pick
 static void draw_saved_networks(void)
 {
     m5_display_clear(&display, COLOR_BLACK);
@@ -729,48 +739,43 @@ static void draw_saved_networks(void)
     // Title
     m5_display_draw_string_scaled(&display, 5, 10, "SAVED NETWORKS", COLOR_YELLOW, COLOR_BLACK, 2);
 
-    // Try to load saved WiFi credentials from NVS
-    nvs_handle_t nvs;
-    char ssid[33] = {0};
-    bool has_saved = false;
-
-    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
-        size_t ssid_len = sizeof(ssid);
-        if (nvs_get_str(nvs, "wifi_ssid", ssid, &ssid_len) == ESP_OK && strlen(ssid) > 0) {
-            has_saved = true;
-        }
-        nvs_close(nvs);
+    wifi_sta_network_t networks[WIFI_STA_MAX_NETWORKS];
+    int count = (int)wifi_sta_list(networks, WIFI_STA_MAX_NETWORKS);
+    if (selected_network >= count) {
+        selected_network = count > 0 ? count - 1 : 0;
     }
 
-    int y = 45;
-
-    if (has_saved) {
-        // Show saved network
-        bool connected = is_wifi_connected();
-        const char *current_ssid = get_wifi_ssid();
-        bool is_current = (strcmp(ssid, current_ssid) == 0);
-
-        // Network name with status indicator
-        uint16_t text_color = (connected && is_current) ? COLOR_GREEN : COLOR_WHITE;
-        m5_display_draw_string(&display, 10, y, ssid, text_color, COLOR_BLACK);
+    int y = 35;
+
+    if (count > 0) {
+        // Five rows fit; scroll so the selection stays visible
+        int first = selected_network > 4 ? selected_network - 4 : 0;
+        for (int i = first; i < count && i < first + 5; i++) {
+            char status[8];
+            if (networks[i].connected) {
+                snprintf(status, sizeof(status), "ON");
+            } else if (networks[i].rssi != 0) {
+                snprintf(status, sizeof(status), "%d", networks[i].rssi);
+            } else {
+                snprintf(status, sizeof(status), "--");
+            }
 
-        y += 15;
+            char line[32];
+            snprintf(line, sizeof(line), "%c%-17.17s P%d %4s", i == selected_network ? '>' : ' ',
+                     networks[i].ssid, networks[i].priority, status);
 
-        // Status
-        if (connected && is_current) {
-            m5_display_draw_string(&display, 10, y, "Connected", COLOR_GREEN, COLOR_BLACK);
-        } else {
-            m5_display_draw_string(&display, 10, y, "Saved", COLOR_YELLOW, COLOR_BLACK);
+            uint16_t text_color = networks[i].connected ? COLOR_GREEN :
+                                  (i == selected_network ? COLOR_YELLOW : COLOR_WHITE);
+            m5_display_draw_string(&display, 5, y, line, text_color, COLOR_BLACK);
+            y += 15;
         }
 
-        y += 25;
-
-        // Delete option
-        m5_display_draw_string_scaled(&display, 10, y, "A: Delete Network", COLOR_RED, COLOR_BLACK, 1);
+        // Forget option
+        m5_display_draw_string(&display, 115, 120, "A:Forget C:Next", COLOR_RED, COLOR_BLACK);
     } else {
         // No saved networks
-        m5_display_draw_string_scaled(&display, 10, y, "No saved", COLOR_YELLOW, COLOR_BLACK, 2);
-        m5_display_draw_string_scaled(&display, 10, y + 20, "networks", COLOR_YELLOW, COLOR_BLACK, 2);
+        m5_display_draw_string_scaled(&display, 10, y + 10, "No saved", COLOR_YELLOW, COLOR_BLACK, 2);
+        m5_display_draw_string_scaled(&display, 10, y + 30, "networks", COLOR_YELLOW, COLOR_BLACK, 2);
     }
 
     // Back instruction
@@ -821,6 +826,17 @@ static void draw_portal_running(void)
     m5_display_draw_string(&display, 10, 90, "labPORTAL", COLOR_YELLOW, COLOR_BLACK);
     m5_display_draw_string(&display, 10, 105, "192.168.4.1", COLOR_YELLOW, COLOR_BLACK);
 
+    // Busiest client on the uplink right now
+    client_stats_t top;
+    if (client_stats_snapshot(&top, 1) == 1 && top.up_rate + top.down_rate > 0) {
+        char top_str[40];
+        uint32_t rate = top.up_rate + top.down_rate;
+        snprintf(top_str, sizeof(top_str), "Top: .%u %lu.%luKB/s",
+                 (unsigned)((const uint8_t *)&top.ip)[3],
+                 (unsigned long)(rate / 1024), (unsigned long)((rate % 1024) * 10 / 1024));
+        m5_display_draw_string(&display, 10, 120, top_str, COLOR_WHITE, COLOR_BLACK);
+    }
+
     m5_display_flush(&display);
 }
 
@@ -952,7 +968,7 @@ static void draw_screensaver(void)
     m5_display_flush(&display);
 }
 
-// Draw NAT test screen (legacy)
+// Draw NAT test screen - smoothed RTTs from the uplink monitor
 static void draw_nat_test(void)
 {
     m5_display_clear(&display, COLOR_BLACK);
@@ -1004,13 +1020,14 @@ static void draw_nat_test(void)
 
     // Status
     if (nat_test.running) {
-        m5_display_draw_string(&display, 60, 95, "TESTING...", COLOR_YELLOW, COLOR_BLACK);
+        m5_display_draw_string(&display, 60, 95, nat_test.degraded ? "DEGRADED" : "HEALTHY",
+                               nat_test.degraded ? COLOR_RED : COLOR_GREEN, COLOR_BLACK);
     } else {
-        m5_display_draw_string(&display, 40, 95, "Press A to Test", COLOR_LILAC, COLOR_BLACK);
+        m5_display_draw_string(&display, 50, 95, "No uplink", COLOR_LILAC, COLOR_BLACK);
     }
 
     // Help
-    m5_display_draw_string(&display, 30, 120, "A:Test B:Back", COLOR_LILAC, COLOR_BLACK);
+    m5_display_draw_string(&display, 60, 120, "B:Back", COLOR_LILAC, COLOR_BLACK);
 
     m5_display_flush(&display);
 }
@@ -1138,16 +1155,19 @@ static void ui_task(void *param)
         btn_b_last = btn_b;
         btn_c_last = btn_c;
 
-        // Run NAT tests if active
-        if (current_state == UI_NAT_TEST && nat_test.running) {
-            // Simulate tests (in real implementation, call actual network functions)
-            // For now, just show fake results
-            nat_test.dns_ok = true;
-            nat_test.dns_ms = 45;
-            nat_test.https_ok = true;
-            nat_test.https_ms = 230;
-            nat_test.ping_ok = true;
-            nat_test.ping_ms = 12;
+        // NAT test screen shows the uplink monitor's live probe results
+        if (current_state == UI_NAT_TEST) {
+            uplink_status_t uplink;
+            uplink_monitor_get_status(&uplink);
+            const uplink_metric_t *dns = &uplink.dns[uplink.resolver >= 0 ? uplink.resolver : 0];
+            nat_test.running = uplink.link_up && uplink.rounds > 0;
+            nat_test.degraded = uplink.degraded;
+            nat_test.dns_ok = dns->last_ms > 0;
+            nat_test.dns_ms = (int)dns->ewma_ms;
+            nat_test.https_ok = uplink.tcp.last_ms > 0;
+            nat_test.https_ms = (int)uplink.tcp.ewma_ms;
+            nat_test.ping_ok = uplink.icmp.last_ms > 0;
+            nat_test.ping_ms = (int)uplink.icmp.ewma_ms;
         }
 
         // Check for screensaver timeout
@@ -0,0 +1,86 @@
+#ifndef SHAPER_H
+#define SHAPER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Directions as seen from the AP client
+#define SHAPER_DIR_UP   0   // Client -> uplink
+#define SHAPER_DIR_DOWN 1   // Uplink -> client
+#define SHAPER_DIRS     2
+
+// Per-direction flow pool: AP limit is 10 clients, flows are reclaimed once idle
+#define SHAPER_MAX_FLOWS   16
+#define SHAPER_QUEUE_DEPTH 8      // Packets held per flow before tail drop
+#define SHAPER_QUANTUM     1514   // Deficit round robin bytes per round (one full frame)
+#define SHAPER_BURST_MS    50     // Bucket depth, in time at the configured rate
+#define SHAPER_TICK_MS     10     // Release timer period while packets are queued
+
+// Bytes held across every flow and both directions. Held packets are copies
+// in heap RAM (see shaper_hold_fn), so this bounds heap, not Wi-Fi RX buffers
+#define SHAPER_HELD_BYTES  (24 * 1024)
+
+// Limits in kbit/s, 0 = unlimited
+typedef struct {
+    uint32_t client_up_kbps;      // Each client
+    uint32_t client_down_kbps;
+    uint32_t uplink_up_kbps;      // Whole AP
+    uint32_t uplink_down_kbps;
+} shaper_config_t;
+
+typedef enum {
+    SHAPER_PASS,     // Send now
+    SHAPER_QUEUED,   // Shaper holds the packet until shaper_run releases it
+    SHAPER_DROP      // Queue or budget full - caller frees the packet
+} shaper_verdict_t;
+
+typedef struct {
+    uint32_t passed;     // Sent without delay
+    uint32_t delayed;    // Queued, released later
+    uint32_t dropped;
+    uint32_t backlog;    // Packets queued right now
+} shaper_dir_stats_t;
+
+typedef struct {
+    shaper_dir_stats_t dir[SHAPER_DIRS];
+    uint32_t flows_exhausted;   // Packets let through unshaped for lack of a flow
+    uint32_t held_bytes;        // Queued right now, both directions
+    uint32_t budget_drops;      // Dropped because SHAPER_HELD_BYTES was reached
+} shaper_stats_t;
+
+// Receives packets released by shaper_run
+typedef void (*shaper_release_fn)(void *pkt, int dir, uint8_t octet, void *ctx);
+
+// Called when a packet is about to be queued: returns what the shaper should
+// hold (e.g. a copy that frees the driver's buffer), or NULL to drop it
+typedef void *(*shaper_hold_fn)(void *pkt);
+
+/**
+ * Load limits from NVS (default: unlimited)
+ */
+esp_err_t shaper_init(void);
+
+/**
+ * Change limits from any task; the forward path picks them up on its next packet
+ */
+esp_err_t shaper_set_config(const shaper_config_t *config, bool persist);
+void shaper_get_config(shaper_config_t *config);
+void shaper_get_stats(shaper_stats_t *stats);
+
+/**
+ * Forward path - all calls from one thread (lwIP's tcpip thread on the device)
+ * pkt is opaque; octet is the client's 192.168.4.x host part
+ * On SHAPER_QUEUED the shaper holds what hold(pkt) returned, and the caller
+ * still owns pkt itself
+ */
+shaper_verdict_t shaper_admit(int dir, uint8_t octet, void *pkt, uint32_t len, uint32_t now_ms,
+                              shaper_hold_fn hold);
+
+/**
+ * Refill buckets and release queued packets in deficit round robin order
+ * Returns true while packets remain queued (call again after SHAPER_TICK_MS)
+ */
+bool shaper_run(uint32_t now_ms, shaper_release_fn release, void *ctx);
+
+#endif // SHAPER_H
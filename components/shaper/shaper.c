@@ -0,0 +1,349 @@
+#include "shaper.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "Shaper";
+
+typedef struct {
+    uint32_t rate;       // Bytes/s, 0 = unlimited
+    uint32_t burst;      // Bytes
+    uint32_t tokens;
+    uint32_t last_ms;
+} bucket_t;
+
+typedef struct {
+    void *pkt;
+    uint32_t len;
+} queued_t;
+
+// One client in one direction
+typedef struct {
+    bool in_use;
+    uint8_t octet;
+    uint8_t head;
+    uint8_t count;
+    uint32_t deficit;
+    uint32_t last_ms;    // Last admit, for reclaiming idle flows
+    bucket_t bucket;
+    queued_t queue[SHAPER_QUEUE_DEPTH];
+} flow_t;
+
+typedef struct {
+    flow_t flows[SHAPER_MAX_FLOWS];
+    uint8_t flow_index[256];    // Octet -> flow + 1 (0 = none)
+    bucket_t uplink;
+    uint32_t client_rate;       // Bytes/s for new and existing flows
+    uint8_t rr;                 // Flow the next DRR pass starts at
+} direction_t;
+
+// Forward-path state, only touched by the forwarding thread
+static direction_t dirs[SHAPER_DIRS];
+static shaper_stats_t stats = {0};
+
+// Config handoff from other tasks
+static shaper_config_t config = {0};
+static volatile bool config_dirty = false;
+static SemaphoreHandle_t config_mutex = NULL;
+
+static uint32_t kbps_to_rate(uint32_t kbps)
+{
+    return kbps * 125;   // 1000 / 8
+}
+
+static void bucket_setup(bucket_t *b, uint32_t rate, uint32_t now_ms)
+{
+    uint32_t burst = (uint32_t)((uint64_t)rate * SHAPER_BURST_MS / 1000);
+    if (burst < 2 * SHAPER_QUANTUM) {
+        burst = 2 * SHAPER_QUANTUM;
+    }
+    b->rate = rate;
+    b->burst = burst;
+    if (b->tokens > burst) {
+        b->tokens = burst;
+    }
+    b->last_ms = now_ms;
+}
+
+static void bucket_refill(bucket_t *b, uint32_t now_ms)
+{
+    if (b->rate == 0) {
+        return;
+    }
+    uint32_t elapsed = now_ms - b->last_ms;
+    if (elapsed == 0) {
+        return;
+    }
+    uint64_t tokens = b->tokens + (uint64_t)b->rate * elapsed / 1000;
+    b->tokens = tokens > b->burst ? b->burst : (uint32_t)tokens;
+    b->last_ms = now_ms;
+}
+
+static inline bool bucket_allows(const bucket_t *b, uint32_t len)
+{
+    return b->rate == 0 || b->tokens >= len;
+}
+
+static inline void bucket_take(bucket_t *b, uint32_t len)
+{
+    if (b->rate != 0) {
+        b->tokens -= len;
+    }
+}
+
+static void apply_config(uint32_t now_ms)
+{
+    if (!config_dirty || !config_mutex || xSemaphoreTake(config_mutex, 0) != pdTRUE) {
+        return;   // Retried on the next packet
+    }
+    shaper_config_t cfg = config;
+    config_dirty = false;
+    xSemaphoreGive(config_mutex);
+
+    uint32_t client[SHAPER_DIRS] = { kbps_to_rate(cfg.client_up_kbps), kbps_to_rate(cfg.client_down_kbps) };
+    uint32_t uplink[SHAPER_DIRS] = { kbps_to_rate(cfg.uplink_up_kbps), kbps_to_rate(cfg.uplink_down_kbps) };
+
+    for (int d = 0; d < SHAPER_DIRS; d++) {
+        direction_t *dir = &dirs[d];
+        dir->client_rate = client[d];
+        bucket_setup(&dir->uplink, uplink[d], now_ms);
+        for (int i = 0; i < SHAPER_MAX_FLOWS; i++) {
+            if (dir->flows[i].in_use) {
+                bucket_setup(&dir->flows[i].bucket, client[d], now_ms);
+            }
+        }
+    }
+}
+
+static flow_t *flow_get(direction_t *dir, uint8_t octet, uint32_t now_ms)
+{
+    if (dir->flow_index[octet]) {
+        return &dir->flows[dir->flow_index[octet] - 1];
+    }
+
+    // Free slot, else the longest-idle empty flow (its bucket has refilled by now)
+    int pick = -1;
+    uint32_t idlest = 0;
+    for (int i = 0; i < SHAPER_MAX_FLOWS; i++) {
+        flow_t *f = &dir->flows[i];
+        if (!f->in_use) {
+            pick = i;
+            break;
+        }
+        uint32_t idle = now_ms - f->last_ms;
+        if (f->count == 0 && idle >= 1000 && idle > idlest) {
+            pick = i;
+            idlest = idle;
+        }
+    }
+    if (pick < 0) {
+        return NULL;
+    }
+
+    flow_t *f = &dir->flows[pick];
+    if (f->in_use) {
+        dir->flow_index[f->octet] = 0;
+    }
+    memset(f, 0, sizeof(*f));
+    f->in_use = true;
+    f->octet = octet;
+    bucket_setup(&f->bucket, dir->client_rate, now_ms);
+    f->bucket.tokens = f->bucket.burst;
+    dir->flow_index[octet] = pick + 1;
+    return f;
+}
+
+shaper_verdict_t shaper_admit(int dir_id, uint8_t octet, void *pkt, uint32_t len, uint32_t now_ms,
+                              shaper_hold_fn hold)
+{
+    apply_config(now_ms);
+
+    direction_t *dir = &dirs[dir_id];
+    shaper_dir_stats_t *st = &stats.dir[dir_id];
+
+    // Unlimited - but packets still queued from before go out first
+    if (dir->client_rate == 0 && dir->uplink.rate == 0 && st->backlog == 0) {
+        st->passed++;
+        return SHAPER_PASS;
+    }
+
+    flow_t *f = flow_get(dir, octet, now_ms);
+    if (!f) {
+        stats.flows_exhausted++;
+        st->passed++;
+        return SHAPER_PASS;   // Fail open rather than stall a client
+    }
+    f->last_ms = now_ms;
+    bucket_refill(&f->bucket, now_ms);
+    bucket_refill(&dir->uplink, now_ms);
+
+    // In-profile and nothing queued ahead of it: no delay
+    if (f->count == 0 && bucket_allows(&f->bucket, len) && bucket_allows(&dir->uplink, len)) {
+        bucket_take(&f->bucket, len);
+        bucket_take(&dir->uplink, len);
+        st->passed++;
+        return SHAPER_PASS;
+    }
+
+    if (f->count >= SHAPER_QUEUE_DEPTH) {
+        st->dropped++;
+        return SHAPER_DROP;
+    }
+    if (stats.held_bytes + len > SHAPER_HELD_BYTES) {
+        stats.budget_drops++;
+        st->dropped++;
+        return SHAPER_DROP;
+    }
+    void *held = hold ? hold(pkt) : pkt;
+    if (!held) {
+        st->dropped++;
+        return SHAPER_DROP;
+    }
+
+    queued_t *q = &f->queue[(f->head + f->count) % SHAPER_QUEUE_DEPTH];
+    q->pkt = held;
+    q->len = len;
+    f->count++;
+    stats.held_bytes += len;
+    st->delayed++;
+    st->backlog++;
+    return SHAPER_QUEUED;
+}
+
+bool shaper_run(uint32_t now_ms, shaper_release_fn release, void *ctx)
+{
+    apply_config(now_ms);
+
+    uint32_t backlog = 0;
+    for (int d = 0; d < SHAPER_DIRS; d++) {
+        direction_t *dir = &dirs[d];
+        shaper_dir_stats_t *st = &stats.dir[d];
+        if (st->backlog == 0) {
+            continue;
+        }
+        bucket_refill(&dir->uplink, now_ms);
+
+        // Deficit round robin: every backlogged flow earns a quantum per round,
+        // so a bulk download cannot take more than its share of the uplink
+        bool progress = true;
+        while (progress && st->backlog > 0) {
+            progress = false;
+            for (int n = 0; n < SHAPER_MAX_FLOWS; n++) {
+                flow_t *f = &dir->flows[(dir->rr + n) % SHAPER_MAX_FLOWS];
+                if (!f->in_use || f->count == 0) {
+                    continue;
+                }
+                bucket_refill(&f->bucket, now_ms);
+
+                queued_t *q = &f->queue[f->head];
+                if (f->deficit < q->len) {
+                    f->deficit += SHAPER_QUANTUM;
+                }
+                while (f->count > 0 && q->len <= f->deficit &&
+                       bucket_allows(&f->bucket, q->len) && bucket_allows(&dir->uplink, q->len)) {
+                    bucket_take(&f->bucket, q->len);
+                    bucket_take(&dir->uplink, q->len);
+                    f->deficit -= q->len;
+                    f->head = (f->head + 1) % SHAPER_QUEUE_DEPTH;
+                    f->count--;
+                    st->backlog--;
+                    stats.held_bytes -= q->len;
+                    progress = true;
+                    release(q->pkt, d, f->octet, ctx);
+                    q = &f->queue[f->head];
+                }
+                if (f->count == 0) {
+                    f->deficit = 0;
+                } else if (f->deficit > 2 * SHAPER_QUANTUM) {
+                    f->deficit = 2 * SHAPER_QUANTUM;   // Blocked by a bucket, don't bank credit
+                }
+            }
+        }
+        dir->rr = (dir->rr + 1) % SHAPER_MAX_FLOWS;
+        backlog += st->backlog;
+    }
+    return backlog > 0;
+}
+
+static esp_err_t save_config(const shaper_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u32(nvs, "shp_cli_up", cfg->client_up_kbps);
+    nvs_set_u32(nvs, "shp_cli_down", cfg->client_down_kbps);
+    nvs_set_u32(nvs, "shp_wan_up", cfg->uplink_up_kbps);
+    nvs_set_u32(nvs, "shp_wan_down", cfg->uplink_down_kbps);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+esp_err_t shaper_init(void)
+{
+    if (!config_mutex) {
+        config_mutex = xSemaphoreCreateMutex();
+        if (!config_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    shaper_config_t cfg = {0};
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        nvs_get_u32(nvs, "shp_cli_up", &cfg.client_up_kbps);
+        nvs_get_u32(nvs, "shp_cli_down", &cfg.client_down_kbps);
+        nvs_get_u32(nvs, "shp_wan_up", &cfg.uplink_up_kbps);
+        nvs_get_u32(nvs, "shp_wan_down", &cfg.uplink_down_kbps);
+        nvs_close(nvs);
+    }
+
+    ESP_LOGI(TAG, "✓ Shaper ready - client %lu/%lu kbps, uplink %lu/%lu kbps (up/down, 0 = unlimited)",
+             (unsigned long)cfg.client_up_kbps, (unsigned long)cfg.client_down_kbps,
+             (unsigned long)cfg.uplink_up_kbps, (unsigned long)cfg.uplink_down_kbps);
+    return shaper_set_config(&cfg, false);
+}
+
+esp_err_t shaper_set_config(const shaper_config_t *cfg, bool persist)
+{
+    if (!config_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    config = *cfg;
+    config_dirty = true;
+    xSemaphoreGive(config_mutex);
+
+    if (persist) {
+        esp_err_t err = save_config(cfg);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to save limits: %s", esp_err_to_name(err));
+            return err;
+        }
+        ESP_LOGI(TAG, "Limits saved - client %lu/%lu kbps, uplink %lu/%lu kbps",
+                 (unsigned long)cfg->client_up_kbps, (unsigned long)cfg->client_down_kbps,
+                 (unsigned long)cfg->uplink_up_kbps, (unsigned long)cfg->uplink_down_kbps);
+    }
+    return ESP_OK;
+}
+
+void shaper_get_config(shaper_config_t *cfg)
+{
+    if (!config_mutex) {
+        memset(cfg, 0, sizeof(*cfg));
+        return;
+    }
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(config_mutex);
+}
+
+void shaper_get_stats(shaper_stats_t *out)
+{
+    *out = stats;   // Counters only, a torn read is harmless
+}
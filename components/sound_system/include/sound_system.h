@@ -28,6 +28,9 @@ bool sound_system_is_enabled(void);
 // Play a sound (only if sound is enabled)
 void sound_system_play(sound_type_t type);
 
+// Play a sound on the sound task - for callers that can't wait out a melody
+void sound_system_play_async(sound_type_t type);
+
 // Load sound preference from NVS
 void sound_system_load_preference(void);
 
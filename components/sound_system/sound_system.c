@@ -3,6 +3,7 @@
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "nvs_flash.h"
 #include "esp_log.h"
 
@@ -12,6 +13,10 @@ static const char *TAG = "Sound";
 static bool sound_enabled = true;  // Default: ON
 static bool initialized = false;
 
+// Sounds requested from tasks that must not block on the buzzer
+#define SOUND_QUEUE_DEPTH 4
+static QueueHandle_t sound_queue = NULL;
+
 // LEDC configuration
 #define LEDC_TIMER              LEDC_TIMER_0
 #define LEDC_MODE               LEDC_LOW_SPEED_MODE
@@ -19,6 +24,16 @@ static bool initialized = false;
 #define LEDC_DUTY_RES           LEDC_TIMER_10_BIT
 #define LEDC_DUTY               (384)  // ~37% duty cycle for moderate volume
 
+static void sound_task(void *pvParameters)
+{
+    sound_type_t type;
+    while (1) {
+        if (xQueueReceive(sound_queue, &type, portMAX_DELAY) == pdTRUE) {
+            sound_system_play(type);
+        }
+    }
+}
+
 // Initialize sound system (buzzer PWM)
 esp_err_t sound_system_init(void)
 {
@@ -53,6 +68,11 @@ esp_err_t sound_system_init(void)
         return ret;
     }
 
+    sound_queue = xQueueCreate(SOUND_QUEUE_DEPTH, sizeof(sound_type_t));
+    if (!sound_queue || xTaskCreate(sound_task, "sound", 2048, NULL, 2, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "No sound task - async sounds disabled");
+    }
+
     initialized = true;
     ESP_LOGI(TAG, "Sound system initialized");
 
@@ -171,3 +191,12 @@ void sound_system_save_preference(void)
         nvs_close(nvs);
     }
 }
+
+// Queue a sound for the sound task; never blocks, a full queue skips it
+void sound_system_play_async(sound_type_t type)
+{
+    if (!sound_enabled || !initialized || !sound_queue) {
+        return;
+    }
+    xQueueSend(sound_queue, &type, 0);
+}
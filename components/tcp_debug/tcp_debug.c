@@ -94,6 +94,9 @@ static void tcp_server_task(void *pvParameters)
 
 void tcp_debug_init(void)
 {
+    if (clients_mutex != NULL) {
+        return;   // Already serving - called again on every uplink reconnect
+    }
     ESP_LOGI(TAG, "Initializing TCP debug server...");
 
     clients_mutex = xSemaphoreCreateMutex();
@@ -0,0 +1,58 @@
+#ifndef UPLINK_MONITOR_H
+#define UPLINK_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define UPLINK_MONITOR_MAX_RESOLVERS 3
+#define UPLINK_MONITOR_PERIOD_S      15     // Default time between probe rounds
+#define UPLINK_MONITOR_TIMEOUT_MS    2000   // A probe slower than this counts as lost
+#define UPLINK_MONITOR_PROBE_NAME    "connectivitycheck.gstatic.com"
+#define UPLINK_MONITOR_SKETCH_BUCKETS 24    // Half-octave latency buckets, 1 ms .. 4 s
+
+// Probe targets, addresses in network byte order (0 = probe disabled)
+typedef struct {
+    uint32_t ping_target;                              // ICMP echo
+    uint32_t resolvers[UPLINK_MONITOR_MAX_RESOLVERS];  // A query for UPLINK_MONITOR_PROBE_NAME
+    uint32_t tcp_target;                               // TCP handshake time
+    uint16_t tcp_port;
+    uint16_t period_s;                                 // 5..3600
+} uplink_monitor_config_t;
+
+// One probe stream: smoothed values plus percentiles from a decaying histogram
+typedef struct {
+    uint32_t sent;
+    uint32_t lost;
+    uint32_t last_ms;      // 0 = last probe lost
+    uint32_t ewma_ms;      // RTT smoothed 1/8 per sample, like TCP's SRTT
+    uint32_t p50_ms;
+    uint32_t p95_ms;
+    uint8_t loss_pct;      // Loss smoothed 1/8 per probe
+} uplink_metric_t;
+
+typedef struct {
+    bool link_up;          // STA has an address, probes are running
+    bool degraded;         // Loss or latency past the alert thresholds
+    uint32_t rounds;
+    uplink_metric_t icmp;
+    uplink_metric_t dns[UPLINK_MONITOR_MAX_RESOLVERS];
+    uplink_metric_t tcp;
+    int8_t resolver;       // Index dns_server forwards to, -1 = build default
+} uplink_status_t;
+
+/**
+ * Load targets from NVS and start the (idle) probe task
+ */
+esp_err_t uplink_monitor_init(void);
+
+/**
+ * STA got / lost its address - probing only runs while the link is up
+ */
+void uplink_monitor_set_link(bool up);
+
+esp_err_t uplink_monitor_set_config(const uplink_monitor_config_t *config, bool persist);
+void uplink_monitor_get_config(uplink_monitor_config_t *config);
+void uplink_monitor_get_status(uplink_status_t *status);
+
+#endif // UPLINK_MONITOR_H
@@ -0,0 +1,527 @@
+#include "uplink_monitor.h"
+#include "dns_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "Uplink";
+
+#define DNS_PORT 53
+#define ICMP_ECHO_ID 0x4C50               // "LP"
+#define SKETCH_DECAY_AT 256               // Halve the histogram once it holds this many samples
+
+// Alert thresholds for the "degraded" flag
+#define DEGRADED_LOSS_PCT 20
+#define DEGRADED_RTT_MS   500
+
+// Resolver choice: a lost percent costs as much as 20 ms of latency, and a
+// new resolver must beat the current one by 20% before queries move
+#define RESOLVER_LOSS_WEIGHT_MS 20
+#define RESOLVER_UNHEALTHY_PCT  50
+
+typedef struct {
+    uplink_metric_t pub;
+    uint32_t srtt_x8;                     // ewma_ms << 3
+    uint32_t loss_x256;                   // loss_pct << 8
+    uint16_t sketch[UPLINK_MONITOR_SKETCH_BUCKETS];
+    uint16_t sketch_total;
+} metric_state_t;
+
+static uplink_monitor_config_t config;
+static metric_state_t icmp_metric;
+static metric_state_t dns_metric[UPLINK_MONITOR_MAX_RESOLVERS];
+static metric_state_t tcp_metric;
+static bool link_up = false;
+static bool degraded = false;
+static uint32_t rounds = 0;
+static int8_t resolver = -1;
+static uint16_t probe_seq = 0;
+
+static SemaphoreHandle_t state_mutex = NULL;
+static TaskHandle_t probe_task_handle = NULL;
+
+// --- Latency sketch: bucket b covers [2^(b/2), ...) in half-octave steps ---
+
+static int sketch_bucket(uint32_t ms)
+{
+    if (ms < 1) ms = 1;
+    int e = 31 - __builtin_clz(ms);
+    int b = 2 * e + (e > 0 ? (int)((ms >> (e - 1)) & 1) : 0);
+    return b < UPLINK_MONITOR_SKETCH_BUCKETS ? b : UPLINK_MONITOR_SKETCH_BUCKETS - 1;
+}
+
+static uint32_t bucket_low(int b)
+{
+    uint32_t base = 1u << (b / 2);
+    return (b & 1) ? base + base / 2 : base;
+}
+
+static uint32_t sketch_percentile(const metric_state_t *m, int pct)
+{
+    if (m->sketch_total == 0) {
+        return 0;
+    }
+    uint32_t rank = (m->sketch_total * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < UPLINK_MONITOR_SKETCH_BUCKETS; b++) {
+        seen += m->sketch[b];
+        if (seen >= rank) {
+            return (bucket_low(b) + bucket_low(b + 1)) / 2;
+        }
+    }
+    return bucket_low(UPLINK_MONITOR_SKETCH_BUCKETS - 1);
+}
+
+// rtt_ms < 0 = probe lost
+static void metric_add(metric_state_t *m, int rtt_ms)
+{
+    bool lost = rtt_ms < 0;
+    m->pub.sent++;
+    m->loss_x256 = m->loss_x256 - (m->loss_x256 >> 3) + (lost ? (100u << 8) >> 3 : 0);
+    m->pub.loss_pct = (uint8_t)((m->loss_x256 + 128) >> 8);
+
+    if (lost) {
+        m->pub.lost++;
+        m->pub.last_ms = 0;
+        return;
+    }
+
+    uint32_t ms = rtt_ms > 0 ? (uint32_t)rtt_ms : 1;
+    m->pub.last_ms = ms;
+    if (m->srtt_x8 == 0) {
+        m->srtt_x8 = ms << 3;
+    } else {
+        m->srtt_x8 = m->srtt_x8 - (m->srtt_x8 >> 3) + ms;
+    }
+    m->pub.ewma_ms = m->srtt_x8 >> 3;
+
+    // Exponential decay keeps the percentiles tracking recent conditions
+    if (++m->sketch_total > SKETCH_DECAY_AT) {
+        m->sketch_total = 0;
+        for (int b = 0; b < UPLINK_MONITOR_SKETCH_BUCKETS; b++) {
+            m->sketch[b] >>= 1;
+            m->sketch_total += m->sketch[b];
+        }
+        m->sketch_total++;
+    }
+    m->sketch[sketch_bucket(ms)]++;
+    m->pub.p50_ms = sketch_percentile(m, 50);
+    m->pub.p95_ms = sketch_percentile(m, 95);
+}
+
+// --- Probes, each returns the RTT in ms or -1 ---
+
+static int64_t now_us(void)
+{
+    return esp_timer_get_time();
+}
+
+static int elapsed_ms(int64_t start)
+{
+    return (int)((now_us() - start + 500) / 1000);
+}
+
+// Wait until sock is readable/writable or the probe deadline passes
+static bool wait_socket(int sock, bool for_write, int64_t deadline)
+{
+    int64_t left = deadline - now_us();
+    if (left <= 0) {
+        return false;
+    }
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv = { .tv_sec = left / 1000000, .tv_usec = left % 1000000 };
+    return select(sock + 1, for_write ? NULL : &fds, for_write ? &fds : NULL, NULL, &tv) > 0;
+}
+
+static uint16_t inet_checksum(const uint8_t *data, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (len & 1) {
+        sum += data[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static int probe_icmp(uint32_t target)
+{
+    int sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (sock < 0) {
+        ESP_LOGD(TAG, "No raw socket for ICMP: errno %d", errno);
+        return -1;
+    }
+
+    uint16_t seq = ++probe_seq;
+    uint8_t pkt[24] = { 8, 0, 0, 0, ICMP_ECHO_ID >> 8, ICMP_ECHO_ID & 0xFF, seq >> 8, seq & 0xFF };
+    memcpy(pkt + 8, "labportal uplink", 16);
+    uint16_t csum = inet_checksum(pkt, sizeof(pkt));
+    pkt[2] = csum >> 8;
+    pkt[3] = csum & 0xFF;
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_addr.s_addr = target };
+    int64_t start = now_us();
+    int64_t deadline = start + UPLINK_MONITOR_TIMEOUT_MS * 1000LL;
+    int rtt = -1;
+
+    if (sendto(sock, pkt, sizeof(pkt), 0, (struct sockaddr *)&to, sizeof(to)) == sizeof(pkt)) {
+        uint8_t buf[128];
+        while (wait_socket(sock, false, deadline)) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            int len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len);
+            if (len <= 0) break;
+
+            // Raw IPv4 sockets hand over the IP header too
+            int ihl = (buf[0] & 0x0F) * 4;
+            if (len < ihl + 8 || from.sin_addr.s_addr != target) continue;
+            const uint8_t *icmp = buf + ihl;
+            if (icmp[0] == 0 && ((icmp[4] << 8) | icmp[5]) == ICMP_ECHO_ID &&
+                ((icmp[6] << 8) | icmp[7]) == seq) {
+                rtt = elapsed_ms(start);
+                break;
+            }
+        }
+    }
+
+    close(sock);
+    return rtt;
+}
+
+static int probe_dns(uint32_t resolver_ip)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+
+    // Standard recursive A query for the probe name
+    uint16_t id = ++probe_seq;
+    uint8_t query[96] = { id >> 8, id & 0xFF, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0 };
+    size_t len = 12;
+    const char *label = UPLINK_MONITOR_PROBE_NAME;
+    while (*label) {
+        size_t n = strcspn(label, ".");
+        query[len++] = (uint8_t)n;
+        memcpy(query + len, label, n);
+        len += n;
+        label += n;
+        if (*label == '.') label++;
+    }
+    query[len++] = 0;
+    query[len++] = 0; query[len++] = 1;   // QTYPE A
+    query[len++] = 0; query[len++] = 1;   // QCLASS IN
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(DNS_PORT),
+                              .sin_addr.s_addr = resolver_ip };
+    int64_t start = now_us();
+    int64_t deadline = start + UPLINK_MONITOR_TIMEOUT_MS * 1000LL;
+    int rtt = -1;
+
+    if (sendto(sock, query, len, 0, (struct sockaddr *)&to, sizeof(to)) == (int)len) {
+        uint8_t buf[512];
+        while (wait_socket(sock, false, deadline)) {
+            int n = recv(sock, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            if (n < 12 || ((buf[0] << 8) | buf[1]) != id || !(buf[2] & 0x80)) continue;
+            int rcode = buf[3] & 0x0F;
+            if (rcode == 0 || rcode == 3) {   // NOERROR / NXDOMAIN - the resolver works
+                rtt = elapsed_ms(start);
+            }
+            break;
+        }
+    }
+
+    close(sock);
+    return rtt;
+}
+
+static int probe_tcp(uint32_t target, uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in to = { .sin_family = AF_INET, .sin_port = htons(port),
+                              .sin_addr.s_addr = target };
+    int64_t start = now_us();
+    int64_t deadline = start + UPLINK_MONITOR_TIMEOUT_MS * 1000LL;
+    int rtt = -1;
+
+    int err = connect(sock, (struct sockaddr *)&to, sizeof(to));
+    if (err == 0) {
+        rtt = elapsed_ms(start);
+    } else if (errno == EINPROGRESS && wait_socket(sock, true, deadline)) {
+        int so_error = 0;
+        socklen_t so_len = sizeof(so_error);
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_error, &so_len);
+        if (so_error == 0) {
+            rtt = elapsed_ms(start);
+        }
+    }
+
+    close(sock);
+    return rtt;
+}
+
+// --- Round bookkeeping (state_mutex held) ---
+
+static uint32_t resolver_score(const metric_state_t *m)
+{
+    return m->pub.ewma_ms + m->pub.loss_pct * RESOLVER_LOSS_WEIGHT_MS;
+}
+
+static bool resolver_healthy(int i)
+{
+    const metric_state_t *m = &dns_metric[i];
+    return config.resolvers[i] != 0 && m->pub.sent > m->pub.lost &&
+           m->pub.loss_pct < RESOLVER_UNHEALTHY_PCT;
+}
+
+static void select_resolver(void)
+{
+    int best = -1;
+    for (int i = 0; i < UPLINK_MONITOR_MAX_RESOLVERS; i++) {
+        if (resolver_healthy(i) &&
+            (best < 0 || resolver_score(&dns_metric[i]) < resolver_score(&dns_metric[best]))) {
+            best = i;
+        }
+    }
+    if (best < 0 || best == resolver) {
+        return;   // Nothing answers - leave queries where they are
+    }
+    if (resolver >= 0 && resolver_healthy(resolver) &&
+        resolver_score(&dns_metric[best]) * 5 >= resolver_score(&dns_metric[resolver]) * 4) {
+        return;
+    }
+
+    resolver = best;
+    dns_set_upstream(config.resolvers[best]);
+    char ip[16];
+    inet_ntoa_r(config.resolvers[best], ip, sizeof(ip));
+    ESP_LOGI(TAG, "✓ DNS upstream -> %s (%lums, %u%% loss)", ip,
+             (unsigned long)dns_metric[best].pub.ewma_ms, dns_metric[best].pub.loss_pct);
+}
+
+static bool metric_degraded(const metric_state_t *m)
+{
+    return m->pub.sent > 0 &&
+           (m->pub.loss_pct >= DEGRADED_LOSS_PCT || m->pub.ewma_ms >= DEGRADED_RTT_MS);
+}
+
+static void update_degraded(void)
+{
+    bool now = (config.ping_target && metric_degraded(&icmp_metric)) ||
+               (config.tcp_target && metric_degraded(&tcp_metric)) ||
+               (resolver >= 0 && metric_degraded(&dns_metric[resolver]));
+    if (now != degraded) {
+        degraded = now;
+        if (now) {
+            ESP_LOGW(TAG, "Uplink DEGRADED: ping %lums/%u%%, tcp %lums/%u%%",
+                     (unsigned long)icmp_metric.pub.ewma_ms, icmp_metric.pub.loss_pct,
+                     (unsigned long)tcp_metric.pub.ewma_ms, tcp_metric.pub.loss_pct);
+        } else {
+            ESP_LOGI(TAG, "✓ Uplink recovered");
+        }
+    }
+}
+
+static void reset_metrics(void)
+{
+    memset(&icmp_metric, 0, sizeof(icmp_metric));
+    memset(dns_metric, 0, sizeof(dns_metric));
+    memset(&tcp_metric, 0, sizeof(tcp_metric));
+    rounds = 0;
+    degraded = false;
+    resolver = -1;
+}
+
+// One probe of each kind, sequential so at most one is in flight
+static void run_round(void)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    uplink_monitor_config_t cfg = config;
+    xSemaphoreGive(state_mutex);
+
+    int icmp_rtt = cfg.ping_target ? probe_icmp(cfg.ping_target) : -1;
+    int dns_rtt[UPLINK_MONITOR_MAX_RESOLVERS];
+    for (int i = 0; i < UPLINK_MONITOR_MAX_RESOLVERS; i++) {
+        dns_rtt[i] = cfg.resolvers[i] ? probe_dns(cfg.resolvers[i]) : -1;
+    }
+    int tcp_rtt = cfg.tcp_target ? probe_tcp(cfg.tcp_target, cfg.tcp_port) : -1;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (memcmp(&cfg, &config, sizeof(cfg)) == 0) {   // Targets unchanged mid-round
+        if (cfg.ping_target) metric_add(&icmp_metric, icmp_rtt);
+        for (int i = 0; i < UPLINK_MONITOR_MAX_RESOLVERS; i++) {
+            if (cfg.resolvers[i]) metric_add(&dns_metric[i], dns_rtt[i]);
+        }
+        if (cfg.tcp_target) metric_add(&tcp_metric, tcp_rtt);
+        rounds++;
+        select_resolver();
+        update_degraded();
+    }
+    xSemaphoreGive(state_mutex);
+
+    ESP_LOGD(TAG, "Round: ping %dms, dns %d/%d/%dms, tcp %dms",
+             icmp_rtt, dns_rtt[0], dns_rtt[1], dns_rtt[2], tcp_rtt);
+}
+
+static void probe_task(void *pvParameters)
+{
+    while (1) {
+        if (!link_up) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        run_round();
+        // A link change or new targets wake the task early
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config.period_s * 1000));
+    }
+}
+
+// --- Public API ---
+
+static esp_err_t save_config(const uplink_monitor_config_t *cfg)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    nvs_set_u32(nvs, "upl_ping", cfg->ping_target);
+    nvs_set_u32(nvs, "upl_dns0", cfg->resolvers[0]);
+    nvs_set_u32(nvs, "upl_dns1", cfg->resolvers[1]);
+    nvs_set_u32(nvs, "upl_dns2", cfg->resolvers[2]);
+    nvs_set_u32(nvs, "upl_tcp", cfg->tcp_target);
+    nvs_set_u16(nvs, "upl_tport", cfg->tcp_port);
+    nvs_set_u16(nvs, "upl_period", cfg->period_s);
+    err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
+
+esp_err_t uplink_monitor_init(void)
+{
+    if (state_mutex) {
+        return ESP_OK;
+    }
+    state_mutex = xSemaphoreCreateMutex();
+    if (!state_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uplink_monitor_config_t cfg = {
+        .ping_target = inet_addr("8.8.8.8"),
+        .resolvers = { inet_addr("8.8.8.8"), inet_addr("1.1.1.1"), inet_addr("9.9.9.9") },
+        .tcp_target = inet_addr("1.1.1.1"),
+        .tcp_port = 443,
+        .period_s = UPLINK_MONITOR_PERIOD_S,
+    };
+
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
+        nvs_get_u32(nvs, "upl_ping", &cfg.ping_target);
+        nvs_get_u32(nvs, "upl_dns0", &cfg.resolvers[0]);
+        nvs_get_u32(nvs, "upl_dns1", &cfg.resolvers[1]);
+        nvs_get_u32(nvs, "upl_dns2", &cfg.resolvers[2]);
+        nvs_get_u32(nvs, "upl_tcp", &cfg.tcp_target);
+        nvs_get_u16(nvs, "upl_tport", &cfg.tcp_port);
+        nvs_get_u16(nvs, "upl_period", &cfg.period_s);
+        nvs_close(nvs);
+    }
+
+    esp_err_t err = uplink_monitor_set_config(&cfg, false);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (xTaskCreate(probe_task, "uplink_mon", 3072, NULL, 2, &probe_task_handle) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "✓ Uplink monitor ready (every %us)", cfg.period_s);
+    return ESP_OK;
+}
+
+void uplink_monitor_set_link(bool up)
+{
+    if (!state_mutex) return;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (up && !link_up) {
+        reset_metrics();   // New network - old numbers say nothing about it
+    }
+    link_up = up;
+    xSemaphoreGive(state_mutex);
+
+    if (up && probe_task_handle) {
+        xTaskNotifyGive(probe_task_handle);   // First round right away
+    }
+}
+
+esp_err_t uplink_monitor_set_config(const uplink_monitor_config_t *cfg, bool persist)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cfg->period_s < 5 || cfg->period_s > 3600 || (cfg->tcp_target && cfg->tcp_port == 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    bool changed = memcmp(cfg, &config, sizeof(config)) != 0;
+    if (changed) {
+        config = *cfg;
+        reset_metrics();
+        dns_set_upstream(0);
+    }
+    xSemaphoreGive(state_mutex);
+
+    if (changed && probe_task_handle) {
+        xTaskNotifyGive(probe_task_handle);
+    }
+    return persist ? save_config(cfg) : ESP_OK;
+}
+
+void uplink_monitor_get_config(uplink_monitor_config_t *cfg)
+{
+    if (!state_mutex) {
+        memset(cfg, 0, sizeof(*cfg));
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *cfg = config;
+    xSemaphoreGive(state_mutex);
+}
+
+void uplink_monitor_get_status(uplink_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+    status->resolver = -1;
+    if (!state_mutex) {
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    status->link_up = link_up;
+    status->degraded = degraded;
+    status->rounds = rounds;
+    status->icmp = icmp_metric.pub;
+    for (int i = 0; i < UPLINK_MONITOR_MAX_RESOLVERS; i++) {
+        status->dns[i] = dns_metric[i].pub;
+    }
+    status->tcp = tcp_metric.pub;
+    status->resolver = resolver;
+    xSemaphoreGive(state_mutex);
+}
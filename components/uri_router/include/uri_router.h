@@ -0,0 +1,103 @@
+#ifndef URI_ROUTER_H
+#define URI_ROUTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Capacity of one router (static, no heap)
+#define URI_ROUTER_MAX_NODES   64   // Distinct path segments across all routes + root
+#define URI_ROUTER_EDGE_SLOTS  128  // Open-addressed segment table, power of 2
+#define URI_ROUTER_MAX_PARAMS  4    // ":name" captures per route
+#define URI_ROUTER_METHODS     8    // httpd_method_t values 0..7 (DELETE..TRACE)
+
+// One route in a static table
+// Pattern syntax (segments split on '/'):
+//   "/wifi/scan"        exact match
+//   "/debug/*"          prefix match, '*' must be the last segment
+//   "/api/client/:ip"   ':name' captures exactly one segment
+typedef struct {
+    httpd_method_t method;
+    const char *pattern;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+} uri_route_t;
+
+// Result of a lookup - captures point into the request URI (no copies)
+typedef struct {
+    const uri_route_t *route;
+    int param_count;
+    struct {
+        const char *name;      // Points into the route pattern
+        size_t name_len;
+        const char *value;     // Points into the request URI
+        size_t len;
+    } params[URI_ROUTER_MAX_PARAMS];
+    const char *rest;      // Path remainder consumed by '*'
+    size_t rest_len;
+} uri_match_t;
+
+typedef enum {
+    URI_ROUTE_FOUND,
+    URI_ROUTE_NOT_FOUND,
+    URI_ROUTE_METHOD_NOT_ALLOWED
+} uri_route_result_t;
+
+typedef struct {
+    int16_t param_child;                   // -1 = none
+    int8_t exact[URI_ROUTER_METHODS];      // Route index or -1
+    int8_t prefix[URI_ROUTER_METHODS];
+    const char *param_name;
+    uint8_t param_name_len;
+} uri_router_node_t;
+
+typedef struct {
+    const char *segment;                   // NULL = empty slot
+    uint8_t segment_len;
+    int16_t parent;
+    int16_t child;
+} uri_router_edge_t;
+
+typedef struct {
+    const uri_route_t *routes;
+    size_t route_count;
+    esp_err_t (*not_found)(httpd_req_t *req);   // Unmatched path (captive redirect)
+    uri_router_node_t nodes[URI_ROUTER_MAX_NODES];
+    uri_router_edge_t edges[URI_ROUTER_EDGE_SLOTS];
+    int node_count;
+} uri_router_t;
+
+/**
+ * Build the segment trie for a route table
+ * The table must outlive the router (normally static const)
+ * Lookup cost afterwards depends on path depth, not route count
+ */
+esp_err_t uri_router_build(uri_router_t *router, const uri_route_t *routes, size_t count,
+                           esp_err_t (*not_found)(httpd_req_t *req));
+
+/**
+ * Match a path (without query string) against the built table
+ */
+uri_route_result_t uri_router_match(const uri_router_t *router, int method,
+                                    const char *path, size_t path_len, uri_match_t *match);
+
+/**
+ * Register one wildcard catch-all handler per method used by the table
+ * Server must be configured with httpd_uri_match_wildcard
+ */
+esp_err_t uri_router_mount(httpd_handle_t server, uri_router_t *router);
+
+/**
+ * Copy a ':name' capture of the current request into buf (NUL-terminated)
+ * Only valid inside a handler called by the router
+ */
+esp_err_t uri_router_get_param(httpd_req_t *req, const char *name, char *buf, size_t buf_size);
+
+/**
+ * user_ctx of the route that matched the current request
+ */
+void *uri_router_route_ctx(httpd_req_t *req);
+
+#endif // URI_ROUTER_H
@@ -0,0 +1,308 @@
+#include "uri_router.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "URIRouter";
+
+static uint32_t segment_hash(int parent, const char *seg, size_t len)
+{
+    uint32_t hash = 2166136261u ^ (uint32_t)parent;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)seg[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int edge_find(const uri_router_t *router, int parent, const char *seg, size_t len)
+{
+    uint32_t slot = segment_hash(parent, seg, len) & (URI_ROUTER_EDGE_SLOTS - 1);
+    for (int probe = 0; probe < URI_ROUTER_EDGE_SLOTS; probe++) {
+        const uri_router_edge_t *e = &router->edges[slot];
+        if (e->segment == NULL) {
+            return -1;
+        }
+        if (e->parent == parent && e->segment_len == len && memcmp(e->segment, seg, len) == 0) {
+            return e->child;
+        }
+        slot = (slot + 1) & (URI_ROUTER_EDGE_SLOTS - 1);
+    }
+    return -1;
+}
+
+static int node_new(uri_router_t *router)
+{
+    if (router->node_count >= URI_ROUTER_MAX_NODES) {
+        return -1;
+    }
+    int id = router->node_count++;
+    uri_router_node_t *n = &router->nodes[id];
+    n->param_child = -1;
+    n->param_name = NULL;
+    n->param_name_len = 0;
+    memset(n->exact, -1, sizeof(n->exact));
+    memset(n->prefix, -1, sizeof(n->prefix));
+    return id;
+}
+
+static int edge_insert(uri_router_t *router, int parent, const char *seg, size_t len)
+{
+    int child = edge_find(router, parent, seg, len);
+    if (child >= 0) {
+        return child;
+    }
+
+    child = node_new(router);
+    if (child < 0) {
+        return -1;
+    }
+
+    uint32_t slot = segment_hash(parent, seg, len) & (URI_ROUTER_EDGE_SLOTS - 1);
+    for (int probe = 0; probe < URI_ROUTER_EDGE_SLOTS; probe++) {
+        uri_router_edge_t *e = &router->edges[slot];
+        if (e->segment == NULL) {
+            e->segment = seg;
+            e->segment_len = len;
+            e->parent = parent;
+            e->child = child;
+            return child;
+        }
+        slot = (slot + 1) & (URI_ROUTER_EDGE_SLOTS - 1);
+    }
+    return -1;
+}
+
+static esp_err_t insert_route(uri_router_t *router, int index)
+{
+    const uri_route_t *route = &router->routes[index];
+    const char *p = route->pattern;
+    const char *end = p + strlen(p);
+    int node = 0;
+    bool prefix = false;
+
+    if (route->method < 0 || route->method >= URI_ROUTER_METHODS || *p != '/') {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    p++;
+    while (p < end) {
+        const char *seg_end = memchr(p, '/', end - p);
+        if (!seg_end) seg_end = end;
+        size_t len = seg_end - p;
+
+        if (len == 1 && *p == '*') {
+            if (seg_end != end) {
+                return ESP_ERR_INVALID_ARG;  // '*' only as last segment
+            }
+            prefix = true;
+            break;
+        }
+
+        if (len > 0 && *p == ':') {
+            uri_router_node_t *n = &router->nodes[node];
+            if (n->param_child < 0) {
+                int child = node_new(router);
+                if (child < 0) return ESP_ERR_NO_MEM;
+                n = &router->nodes[node];
+                n->param_child = child;
+                n->param_name = p + 1;
+                n->param_name_len = len - 1;
+            } else if (n->param_name_len != len - 1 || memcmp(n->param_name, p + 1, len - 1) != 0) {
+                return ESP_ERR_INVALID_STATE;  // Two names for one capture position
+            }
+            node = n->param_child;
+        } else if (len > 0) {
+            if (len > UINT8_MAX) return ESP_ERR_INVALID_ARG;
+            node = edge_insert(router, node, p, len);
+            if (node < 0) return ESP_ERR_NO_MEM;
+        }
+
+        p = (seg_end < end) ? seg_end + 1 : end;
+    }
+
+    int8_t *slot = prefix ? &router->nodes[node].prefix[route->method]
+                          : &router->nodes[node].exact[route->method];
+    if (*slot >= 0) {
+        return ESP_ERR_INVALID_STATE;  // Duplicate route
+    }
+    *slot = (int8_t)index;
+    return ESP_OK;
+}
+
+esp_err_t uri_router_build(uri_router_t *router, const uri_route_t *routes, size_t count,
+                           esp_err_t (*not_found)(httpd_req_t *req))
+{
+    if (!router || !routes || count > INT8_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(router, 0, sizeof(*router));
+    router->routes = routes;
+    router->route_count = count;
+    router->not_found = not_found;
+    node_new(router);  // Root
+
+    for (size_t i = 0; i < count; i++) {
+        esp_err_t err = insert_route(router, (int)i);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Route %s failed: %s", routes[i].pattern, esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "Built %d routes into %d nodes", (int)count, router->node_count);
+    return ESP_OK;
+}
+
+uri_route_result_t uri_router_match(const uri_router_t *router, int method,
+                                    const char *path, size_t path_len, uri_match_t *match)
+{
+    const char *p = path;
+    const char *end = path + path_len;
+    int node = 0;
+    int best_prefix = -1;
+    const char *best_rest = NULL;
+    int best_params = 0;
+    bool path_exists = false;
+
+    memset(match, 0, sizeof(*match));
+    if (method < 0 || method >= URI_ROUTER_METHODS || path_len == 0 || *p != '/') {
+        return URI_ROUTE_NOT_FOUND;
+    }
+    p++;
+
+    while (1) {
+        const uri_router_node_t *n = &router->nodes[node];
+
+        // Deepest prefix route wins if the exact walk fails further down
+        if (n->prefix[method] >= 0) {
+            best_prefix = n->prefix[method];
+            best_rest = p;
+            best_params = match->param_count;
+        }
+
+        if (p >= end) {
+            if (n->exact[method] >= 0) {
+                match->route = &router->routes[(int)n->exact[method]];
+                return URI_ROUTE_FOUND;
+            }
+            for (int m = 0; m < URI_ROUTER_METHODS; m++) {
+                if (n->exact[m] >= 0) path_exists = true;
+            }
+            break;
+        }
+
+        const char *seg_end = memchr(p, '/', end - p);
+        if (!seg_end) seg_end = end;
+        size_t len = seg_end - p;
+
+        int child = edge_find(router, node, p, len);
+        if (child < 0 && n->param_child >= 0 && len > 0 && match->param_count < URI_ROUTER_MAX_PARAMS) {
+            int i = match->param_count++;
+            match->params[i].name = n->param_name;
+            match->params[i].name_len = n->param_name_len;
+            match->params[i].value = p;
+            match->params[i].len = len;
+            child = n->param_child;
+        }
+        if (child < 0) {
+            break;
+        }
+
+        node = child;
+        p = (seg_end < end) ? seg_end + 1 : end;
+    }
+
+    if (best_prefix >= 0) {
+        match->route = &router->routes[best_prefix];
+        match->param_count = best_params;
+        match->rest = best_rest;
+        match->rest_len = end - best_rest;
+        return URI_ROUTE_FOUND;
+    }
+
+    match->param_count = 0;
+    return path_exists ? URI_ROUTE_METHOD_NOT_ALLOWED : URI_ROUTE_NOT_FOUND;
+}
+
+// Catch-all handler: req->user_ctx is the router until a route matches,
+// then it is swapped for the match so handlers can read captures
+static esp_err_t uri_router_dispatch(httpd_req_t *req)
+{
+    uri_router_t *router = (uri_router_t *)req->user_ctx;
+    uri_match_t match;
+
+    size_t len = strcspn(req->uri, "?");
+    uri_route_result_t result = uri_router_match(router, req->method, req->uri, len, &match);
+
+    if (result == URI_ROUTE_FOUND) {
+        req->user_ctx = &match;
+        esp_err_t err = match.route->handler(req);
+        req->user_ctx = router;
+        return err;
+    }
+
+    if (result == URI_ROUTE_METHOD_NOT_ALLOWED) {
+        httpd_resp_set_status(req, "405 Method Not Allowed");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    if (router->not_found) {
+        return router->not_found(req);
+    }
+    httpd_resp_send_404(req);
+    return ESP_OK;
+}
+
+esp_err_t uri_router_mount(httpd_handle_t server, uri_router_t *router)
+{
+    bool used[URI_ROUTER_METHODS] = {false};
+    for (size_t i = 0; i < router->route_count; i++) {
+        used[router->routes[i].method] = true;
+    }
+
+    for (int m = 0; m < URI_ROUTER_METHODS; m++) {
+        if (!used[m]) continue;
+        httpd_uri_t catch_all = {
+            .uri      = "/*",
+            .method   = (httpd_method_t)m,
+            .handler  = uri_router_dispatch,
+            .user_ctx = router
+        };
+        esp_err_t err = httpd_register_uri_handler(server, &catch_all);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to mount catch-all for method %d: %s", m, esp_err_to_name(err));
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t uri_router_get_param(httpd_req_t *req, const char *name, char *buf, size_t buf_size)
+{
+    const uri_match_t *match = (const uri_match_t *)req->user_ctx;
+    if (!match || !buf || buf_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t name_len = strlen(name);
+    for (int i = 0; i < match->param_count; i++) {
+        if (match->params[i].name_len == name_len &&
+            memcmp(match->params[i].name, name, name_len) == 0) {
+            if (match->params[i].len >= buf_size) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            memcpy(buf, match->params[i].value, match->params[i].len);
+            buf[match->params[i].len] = '\0';
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+void *uri_router_route_ctx(httpd_req_t *req)
+{
+    const uri_match_t *match = (const uri_match_t *)req->user_ctx;
+    return match ? match->route->user_ctx : NULL;
+}
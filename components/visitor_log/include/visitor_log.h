@@ -0,0 +1,120 @@
+#ifndef VISITOR_LOG_H
+#define VISITOR_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Flash partition holding the append-only visitor log (see partitions_ota.csv)
+#define VISITOR_LOG_PARTITION_LABEL "analytics"
+#define VISITOR_LOG_PARTITION_SUBTYPE 0x40
+
+// Live sessions kept in RAM (AP limit is 10, the rest covers recent leavers)
+#define VISITOR_LOG_MAX_SESSIONS 32
+
+// Records buffered in RAM before they are written to flash
+#define VISITOR_LOG_BATCH_RECORDS 16
+
+// Batched flush period and minimum interval between checkpoints of a live session
+#define VISITOR_LOG_FLUSH_INTERVAL_S 60
+#define VISITOR_LOG_CHECKPOINT_S 300
+
+// MAC hashes are HMAC-SHA256 (first 32 bits) under a random key made on
+// first boot and kept in NVS; without the key exports can't be matched to MACs
+#define VISITOR_LOG_MAC_KEY_LEN 32
+
+// Record kinds
+#define VISITOR_RECORD_CHECKPOINT 1   // Session still open when written
+#define VISITOR_RECORD_CLOSED     2   // Station left the AP
+
+// Record flags
+#define VISITOR_FLAG_APPROVED 0x01    // Visitor tapped "Connect"
+#define VISITOR_FLAG_EPOCH    0x02    // Timestamps are UNIX time (else seconds since boot)
+
+// Fixed 32-byte on-flash record
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  kind;
+    uint8_t  flags;
+    uint32_t session_id;   // (boot_id << 16) | per-boot sequence
+    uint32_t mac_hash;     // Keyed hash of the station MAC (see VISITOR_LOG_MAC_KEY_LEN)
+    uint32_t first_seen;
+    uint32_t last_seen;
+    uint32_t approved_at;  // 0 = never approved
+    uint32_t bytes;        // Forwarded bytes (both directions)
+    uint16_t page_hits;    // Portal HTTP requests
+    uint16_t crc;          // CRC16 over the preceding 30 bytes
+} visitor_record_t;
+
+// Aggregate counters for the UI and diagnostics
+typedef struct {
+    uint32_t unique_visitors;   // Sessions opened since boot
+    uint32_t active_sessions;
+    uint32_t approved;          // Sessions approved since boot
+    uint32_t records_on_flash;
+    uint32_t records_pending;
+    uint32_t sectors_erased;    // Since boot, for wear monitoring
+    uint32_t dropped;           // Records lost: flash unavailable, or a batch full of closed records
+} visitor_log_stats_t;
+
+// Receives CSV chunks during export; return false to abort
+typedef bool (*visitor_log_emit_fn)(const char *data, size_t len, void *ctx);
+
+/**
+ * Mount the analytics partition and start the batched writer task
+ * Scans sector headers to resume appending after the newest record
+ */
+esp_err_t visitor_log_init(void);
+
+/**
+ * Station associated with the AP - opens a session
+ */
+void visitor_log_station_joined(const uint8_t mac[6]);
+
+/**
+ * Station left the AP - closes its session and queues the final record
+ */
+void visitor_log_station_left(const uint8_t mac[6]);
+
+/**
+ * DHCP handed an address to a station (binds IP for hit/byte attribution)
+ */
+void visitor_log_station_ip(const uint8_t mac[6], uint32_t ip);
+
+/**
+ * Portal approved the client at this IP
+ */
+void visitor_log_approved(uint32_t ip);
+
+/**
+ * Count one portal HTTP request from this IP
+ */
+void visitor_log_page_hit(uint32_t ip);
+
+/**
+ * Add forwarded bytes for the client at this IP
+ */
+void visitor_log_add_bytes(uint32_t ip, uint32_t bytes);
+
+/**
+ * Write pending records to flash now (normally done by the writer task)
+ */
+void visitor_log_flush(void);
+
+/**
+ * Stream every stored record, pending record and live session as CSV
+ */
+esp_err_t visitor_log_export_csv(visitor_log_emit_fn emit, void *ctx);
+
+/**
+ * Erase all stored analytics
+ */
+esp_err_t visitor_log_erase(void);
+
+/**
+ * Get aggregate counters
+ */
+void visitor_log_get_stats(visitor_log_stats_t *stats);
+
+#endif // VISITOR_LOG_H
@@ -0,0 +1,731 @@
+#include "visitor_log.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "mbedtls/md.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+static const char *TAG = "VisitorLog";
+
+#define VLOG_SECTOR_SIZE 4096
+#define VLOG_RECORD_SIZE sizeof(visitor_record_t)
+#define VLOG_RECORDS_PER_SECTOR ((VLOG_SECTOR_SIZE / VLOG_RECORD_SIZE) - 1)  // Slot 0 is the header
+#define VLOG_SECTOR_MAGIC 0x474F4C56  // "VLOG"
+#define VLOG_RECORD_MAGIC 0x5652
+#define VLOG_ERASED_MAGIC 0xFFFF
+#define VLOG_EPOCH_VALID 1600000000   // time() above this means SNTP has set the clock
+
+// Sector header occupies the first record slot so records stay 32-byte aligned
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;        // Monotonic, highest = sector currently being appended
+    uint16_t boot_id;
+    uint8_t  reserved[22];
+} sector_header_t;
+
+_Static_assert(sizeof(visitor_record_t) == 32, "visitor record must be 32 bytes");
+_Static_assert(sizeof(sector_header_t) == 32, "sector header must fill one record slot");
+
+// Live session tracked in RAM
+typedef struct {
+    bool in_use;
+    bool dirty;            // Changed since last checkpoint
+    bool epoch;            // Timestamps are UNIX time
+    uint8_t mac[6];
+    uint8_t flags;
+    uint32_t ip;
+    uint32_t session_id;
+    uint32_t mac_hash;
+    uint32_t first_seen;
+    uint32_t last_seen;
+    uint32_t approved_at;
+    uint32_t bytes;
+    uint16_t page_hits;
+    uint32_t last_checkpoint;
+} session_t;
+
+static const esp_partition_t *log_partition = NULL;
+static uint32_t sector_count = 0;
+static uint32_t head_sector = 0;      // Sector being appended
+static uint32_t head_seq = 0;
+static uint32_t head_used = 0;        // Records already in head sector
+static uint32_t full_sectors = 0;     // Valid sectors other than head
+
+static session_t sessions[VISITOR_LOG_MAX_SESSIONS];
+static visitor_record_t pending[VISITOR_LOG_BATCH_RECORDS];
+static int pending_count = 0;
+
+static uint16_t boot_id = 0;
+static uint16_t session_seq = 0;
+static uint8_t mac_key[VISITOR_LOG_MAC_KEY_LEN];
+static visitor_log_stats_t stats = {0};
+
+static SemaphoreHandle_t state_mutex = NULL;   // Sessions, pending buffer, stats
+static SemaphoreHandle_t flash_mutex = NULL;   // Partition reads/writes
+static SemaphoreHandle_t export_mutex = NULL;  // One CSV export at a time
+static TaskHandle_t writer_task_handle = NULL;
+
+// CRC16-CCITT, enough to reject torn writes after a brownout
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Same value for a station on every boot of this stick, 0 if mbedtls fails
+static uint32_t hash_mac(const uint8_t mac[6])
+{
+    uint8_t full[32];
+    const mbedtls_md_info_t *md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (!md || mbedtls_md_hmac(md, mac_key, sizeof(mac_key), mac, 6, full) != 0) {
+        return 0;
+    }
+    return ((uint32_t)full[0] << 24) | ((uint32_t)full[1] << 16) | ((uint32_t)full[2] << 8) | full[3];
+}
+
+static bool clock_is_epoch(void)
+{
+    return time(NULL) > VLOG_EPOCH_VALID;
+}
+
+static uint32_t now_seconds(bool epoch)
+{
+    if (epoch) {
+        return (uint32_t)time(NULL);
+    }
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+static bool record_is_valid(const visitor_record_t *rec)
+{
+    return rec->magic == VLOG_RECORD_MAGIC &&
+           rec->crc == crc16((const uint8_t *)rec, VLOG_RECORD_SIZE - sizeof(rec->crc));
+}
+
+static size_t sector_offset(uint32_t sector)
+{
+    return (size_t)sector * VLOG_SECTOR_SIZE;
+}
+
+static size_t slot_offset(uint32_t sector, uint32_t slot)
+{
+    return sector_offset(sector) + (slot + 1) * VLOG_RECORD_SIZE;
+}
+
+// Erase the next sector in the ring and stamp it as the new head (flash_mutex held)
+static esp_err_t start_sector(uint32_t sector, uint32_t seq)
+{
+    esp_err_t err = esp_partition_erase_range(log_partition, sector_offset(sector), VLOG_SECTOR_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Erase of sector %lu failed: %s", (unsigned long)sector, esp_err_to_name(err));
+        return err;
+    }
+    stats.sectors_erased++;
+
+    sector_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = VLOG_SECTOR_MAGIC;
+    header.seq = seq;
+    header.boot_id = boot_id;
+    err = esp_partition_write(log_partition, sector_offset(sector), &header, sizeof(header));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Header write failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    head_sector = sector;
+    head_seq = seq;
+    head_used = 0;
+    return ESP_OK;
+}
+
+// Find newest sector and the first free slot in it (flash_mutex held)
+static esp_err_t scan_partition(void)
+{
+    bool found = false;
+    uint32_t valid = 0;
+
+    for (uint32_t s = 0; s < sector_count; s++) {
+        sector_header_t header;
+        if (esp_partition_read(log_partition, sector_offset(s), &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        if (header.magic != VLOG_SECTOR_MAGIC) {
+            continue;
+        }
+        valid++;
+        if (!found || header.seq > head_seq) {
+            head_sector = s;
+            head_seq = header.seq;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "Empty analytics partition - starting fresh log");
+        full_sectors = 0;
+        return start_sector(0, 1);
+    }
+
+    full_sectors = valid - 1;
+
+    // Locate first erased slot in the head sector
+    visitor_record_t chunk[16];
+    head_used = VLOG_RECORDS_PER_SECTOR;
+    for (uint32_t slot = 0; slot < VLOG_RECORDS_PER_SECTOR; slot += 16) {
+        uint32_t n = VLOG_RECORDS_PER_SECTOR - slot;
+        if (n > 16) n = 16;
+        esp_partition_read(log_partition, slot_offset(head_sector, slot), chunk, n * VLOG_RECORD_SIZE);
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i].magic == VLOG_ERASED_MAGIC) {
+                head_used = slot + i;
+                return ESP_OK;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+// Append records to flash, rotating to the next sector when full
+static void write_records(const visitor_record_t *recs, int count)
+{
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+
+    while (count > 0) {
+        if (head_used >= VLOG_RECORDS_PER_SECTOR) {
+            uint32_t next = (head_sector + 1) % sector_count;
+            sector_header_t old;
+            esp_partition_read(log_partition, sector_offset(next), &old, sizeof(old));
+            bool overwrote = (old.magic == VLOG_SECTOR_MAGIC);
+            if (start_sector(next, head_seq + 1) != ESP_OK) {
+                break;
+            }
+            if (!overwrote) {
+                full_sectors++;
+            }
+        }
+
+        uint32_t room = VLOG_RECORDS_PER_SECTOR - head_used;
+        uint32_t n = (uint32_t)count < room ? (uint32_t)count : room;
+        esp_err_t err = esp_partition_write(log_partition, slot_offset(head_sector, head_used),
+                                            recs, n * VLOG_RECORD_SIZE);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(err));
+            break;
+        }
+        head_used += n;
+        recs += n;
+        count -= n;
+    }
+
+    xSemaphoreGive(flash_mutex);
+
+    if (count > 0) {
+        xSemaphoreTake(state_mutex, portMAX_DELAY);
+        stats.dropped += count;
+        xSemaphoreGive(state_mutex);
+    }
+}
+
+static void fill_record(visitor_record_t *rec, const session_t *s, uint8_t kind)
+{
+    rec->magic = VLOG_RECORD_MAGIC;
+    rec->kind = kind;
+    rec->flags = s->flags | (s->epoch ? VISITOR_FLAG_EPOCH : 0);
+    rec->session_id = s->session_id;
+    rec->mac_hash = s->mac_hash;
+    rec->first_seen = s->first_seen;
+    rec->last_seen = s->last_seen;
+    rec->approved_at = s->approved_at;
+    rec->bytes = s->bytes;
+    rec->page_hits = s->page_hits;
+    rec->crc = crc16((const uint8_t *)rec, VLOG_RECORD_SIZE - sizeof(rec->crc));
+}
+
+static session_t *find_by_session(uint32_t session_id)
+{
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        if (sessions[i].in_use && sessions[i].session_id == session_id) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+// Queue a record for the next batch (state_mutex held)
+static void queue_record(const session_t *s, uint8_t kind)
+{
+    visitor_record_t *slot = NULL;
+    if (pending_count < VISITOR_LOG_BATCH_RECORDS) {
+        slot = &pending[pending_count++];
+    } else if (kind == VISITOR_RECORD_CLOSED) {
+        // Writer is behind. A closed record is the session's last word, so it
+        // takes the place of a checkpoint; that session is still open and is
+        // checkpointed again on the next flush
+        for (int i = 0; i < pending_count && !slot; i++) {
+            if (pending[i].kind == VISITOR_RECORD_CHECKPOINT) {
+                slot = &pending[i];
+            }
+        }
+        session_t *open = slot ? find_by_session(slot->session_id) : NULL;
+        if (open) {
+            open->dirty = true;
+            open->last_checkpoint = now_seconds(open->epoch) - VISITOR_LOG_CHECKPOINT_S;
+        }
+    }
+    if (!slot) {
+        // Batch is all closed records - nothing left to give way, this one is lost
+        stats.dropped++;
+        return;
+    }
+    fill_record(slot, s, kind);
+    if (pending_count >= VISITOR_LOG_BATCH_RECORDS && writer_task_handle) {
+        xTaskNotifyGive(writer_task_handle);
+    }
+}
+
+static session_t *find_by_mac(const uint8_t mac[6])
+{
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        if (sessions[i].in_use && memcmp(sessions[i].mac, mac, 6) == 0) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static session_t *find_by_ip(uint32_t ip)
+{
+    if (ip == 0) {
+        return NULL;
+    }
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        if (sessions[i].in_use && sessions[i].ip == ip) {
+            return &sessions[i];
+        }
+    }
+    return NULL;
+}
+
+// Close a session and release its slot (state_mutex held)
+static void close_session(session_t *s)
+{
+    s->last_seen = now_seconds(s->epoch);
+    queue_record(s, VISITOR_RECORD_CLOSED);
+    stats.active_sessions--;
+    memset(s, 0, sizeof(*s));
+}
+
+static void writer_task(void *pvParameters)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(VISITOR_LOG_FLUSH_INTERVAL_S * 1000));
+        visitor_log_flush();
+    }
+}
+
+esp_err_t visitor_log_init(void)
+{
+    if (log_partition) {
+        return ESP_OK;
+    }
+
+    log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                             (esp_partition_subtype_t)VISITOR_LOG_PARTITION_SUBTYPE,
+                                             VISITOR_LOG_PARTITION_LABEL);
+    if (!log_partition) {
+        ESP_LOGW(TAG, "No '%s' partition - visitor analytics disabled", VISITOR_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_count = log_partition->size / VLOG_SECTOR_SIZE;
+    if (sector_count < 2) {
+        ESP_LOGE(TAG, "Analytics partition too small (%lu bytes)", (unsigned long)log_partition->size);
+        log_partition = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    state_mutex = xSemaphoreCreateMutex();
+    flash_mutex = xSemaphoreCreateMutex();
+    export_mutex = xSemaphoreCreateMutex();
+    if (!state_mutex || !flash_mutex || !export_mutex) {
+        ESP_LOGE(TAG, "Failed to create mutex");
+        log_partition = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // One NVS write per boot gives every session a globally unique id
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_get_u16(nvs, "vlog_boot", &boot_id);
+        boot_id++;
+        nvs_set_u16(nvs, "vlog_boot", boot_id);
+
+        // MAC hash key: drawn once, kept so hashes match across reboots
+        size_t len = sizeof(mac_key);
+        if (nvs_get_blob(nvs, "vlog_key", mac_key, &len) != ESP_OK || len != sizeof(mac_key)) {
+            esp_fill_random(mac_key, sizeof(mac_key));
+            nvs_set_blob(nvs, "vlog_key", mac_key, sizeof(mac_key));
+        }
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    } else {
+        esp_fill_random(mac_key, sizeof(mac_key));   // Hashes only match within this boot
+    }
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    esp_err_t err = scan_partition();
+    xSemaphoreGive(flash_mutex);
+    if (err != ESP_OK) {
+        log_partition = NULL;
+        return err;
+    }
+
+    xTaskCreate(writer_task, "visitor_log", 3072, NULL, 2, &writer_task_handle);
+
+    ESP_LOGI(TAG, "✓ Visitor log: %lu sectors, head=%lu seq=%lu used=%lu, boot #%u",
+             (unsigned long)sector_count, (unsigned long)head_sector,
+             (unsigned long)head_seq, (unsigned long)head_used, boot_id);
+    return ESP_OK;
+}
+
+void visitor_log_station_joined(const uint8_t mac[6])
+{
+    if (!log_partition) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+
+    session_t *s = find_by_mac(mac);
+    if (s) {
+        // Re-association without a disconnect event - treat as the same session
+        s->last_seen = now_seconds(s->epoch);
+        s->dirty = true;
+        xSemaphoreGive(state_mutex);
+        return;
+    }
+
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        if (!sessions[i].in_use) {
+            s = &sessions[i];
+            break;
+        }
+    }
+    if (!s) {
+        // Table full - close the stalest session to make room
+        s = &sessions[0];
+        for (int i = 1; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+            if (sessions[i].last_seen < s->last_seen) {
+                s = &sessions[i];
+            }
+        }
+        close_session(s);
+    }
+
+    s->in_use = true;
+    s->dirty = true;
+    s->epoch = clock_is_epoch();
+    memcpy(s->mac, mac, 6);
+    s->mac_hash = hash_mac(mac);
+    s->session_id = ((uint32_t)boot_id << 16) | ++session_seq;
+    s->first_seen = now_seconds(s->epoch);
+    s->last_seen = s->first_seen;
+    s->last_checkpoint = s->first_seen;
+
+    stats.unique_visitors++;
+    stats.active_sessions++;
+
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_station_left(const uint8_t mac[6])
+{
+    if (!log_partition) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    session_t *s = find_by_mac(mac);
+    if (s) {
+        close_session(s);
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_station_ip(const uint8_t mac[6], uint32_t ip)
+{
+    if (!log_partition) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    // DHCP may have recycled this address from a departed station
+    session_t *stale = find_by_ip(ip);
+    if (stale) {
+        stale->ip = 0;
+    }
+    session_t *s = find_by_mac(mac);
+    if (s) {
+        s->ip = ip;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_approved(uint32_t ip)
+{
+    if (!log_partition) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    session_t *s = find_by_ip(ip);
+    if (s && !(s->flags & VISITOR_FLAG_APPROVED)) {
+        s->flags |= VISITOR_FLAG_APPROVED;
+        s->approved_at = now_seconds(s->epoch);
+        s->last_seen = s->approved_at;
+        s->dirty = true;
+        stats.approved++;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_page_hit(uint32_t ip)
+{
+    if (!log_partition) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    session_t *s = find_by_ip(ip);
+    if (s) {
+        if (s->page_hits < UINT16_MAX) {
+            s->page_hits++;
+        }
+        s->last_seen = now_seconds(s->epoch);
+        s->dirty = true;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_add_bytes(uint32_t ip, uint32_t bytes)
+{
+    if (!log_partition || bytes == 0) return;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    session_t *s = find_by_ip(ip);
+    if (s) {
+        s->bytes = (s->bytes > UINT32_MAX - bytes) ? UINT32_MAX : s->bytes + bytes;
+        s->last_seen = now_seconds(s->epoch);
+        s->dirty = true;
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+void visitor_log_flush(void)
+{
+    if (!log_partition) return;
+
+    visitor_record_t batch[VISITOR_LOG_BATCH_RECORDS];
+    int count;
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+
+    // Checkpoint long-lived sessions so a power cut loses at most one interval
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        session_t *s = &sessions[i];
+        if (!s->in_use || !s->dirty) continue;
+        uint32_t now = now_seconds(s->epoch);
+        if (now - s->last_checkpoint >= VISITOR_LOG_CHECKPOINT_S &&
+            pending_count < VISITOR_LOG_BATCH_RECORDS) {
+            queue_record(s, VISITOR_RECORD_CHECKPOINT);
+            s->last_checkpoint = now;
+            s->dirty = false;
+        }
+    }
+
+    count = pending_count;
+    memcpy(batch, pending, count * sizeof(visitor_record_t));
+    pending_count = 0;
+
+    xSemaphoreGive(state_mutex);
+
+    if (count > 0) {
+        write_records(batch, count);
+        ESP_LOGD(TAG, "Flushed %d records (sector %lu, %lu used)",
+                 count, (unsigned long)head_sector, (unsigned long)head_used);
+    }
+}
+
+// CSV writer with a small staging buffer so emit() sees ~1KB chunks
+typedef struct {
+    char buf[1024];
+    size_t len;
+    visitor_log_emit_fn emit;
+    void *ctx;
+    bool failed;
+} csv_writer_t;
+
+static void csv_flush(csv_writer_t *w)
+{
+    if (w->len > 0 && !w->failed) {
+        w->failed = !w->emit(w->buf, w->len, w->ctx);
+    }
+    w->len = 0;
+}
+
+static void csv_row(csv_writer_t *w, const visitor_record_t *rec, const char *kind)
+{
+    if (w->len > sizeof(w->buf) - 160) {
+        csv_flush(w);
+    }
+    w->len += snprintf(w->buf + w->len, sizeof(w->buf) - w->len,
+                       "%lu,%u,%08lx,%s,%d,%lu,%lu,%lu,%lu,%u,%s\n",
+                       (unsigned long)rec->session_id,
+                       (unsigned)(rec->session_id >> 16),
+                       (unsigned long)rec->mac_hash,
+                       kind,
+                       (rec->flags & VISITOR_FLAG_APPROVED) ? 1 : 0,
+                       (unsigned long)rec->first_seen,
+                       (unsigned long)rec->last_seen,
+                       (unsigned long)rec->approved_at,
+                       (unsigned long)rec->bytes,
+                       rec->page_hits,
+                       (rec->flags & VISITOR_FLAG_EPOCH) ? "unix" : "uptime");
+}
+
+static const char *kind_name(uint8_t kind)
+{
+    return kind == VISITOR_RECORD_CLOSED ? "closed" : "checkpoint";
+}
+
+// Sequence number of a valid log sector (flash_mutex held)
+static bool read_sector_seq(uint32_t sector, uint32_t *seq)
+{
+    sector_header_t header;
+    if (esp_partition_read(log_partition, sector_offset(sector), &header, sizeof(header)) != ESP_OK ||
+        header.magic != VLOG_SECTOR_MAGIC) {
+        return false;
+    }
+    *seq = header.seq;
+    return true;
+}
+
+esp_err_t visitor_log_export_csv(visitor_log_emit_fn emit, void *ctx)
+{
+    if (!log_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Too large for the httpd stack; export_mutex serializes their use. No
+    // other lock is held while emit() waits on the client, so a slow download
+    // never stalls the writer task or the station events
+    static csv_writer_t writer;
+    static visitor_record_t tail[VISITOR_LOG_BATCH_RECORDS + VISITOR_LOG_MAX_SESSIONS];
+    visitor_record_t chunk[16];
+
+    xSemaphoreTake(export_mutex, portMAX_DELAY);
+
+    // Snapshot where the log ends, with the records not yet flushed and the
+    // sessions still on the AP - both locks, so no batch moves in between
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    uint32_t end_sector = head_sector;
+    uint32_t end_seq = head_seq;
+    uint32_t end_used = head_used;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int tail_pending = pending_count;
+    int tail_count = pending_count;
+    memcpy(tail, pending, pending_count * sizeof(visitor_record_t));
+    for (int i = 0; i < VISITOR_LOG_MAX_SESSIONS; i++) {
+        if (!sessions[i].in_use) continue;
+        visitor_record_t *live = &tail[tail_count++];
+        fill_record(live, &sessions[i], VISITOR_RECORD_CHECKPOINT);
+        live->last_seen = now_seconds(sessions[i].epoch);
+    }
+    xSemaphoreGive(state_mutex);
+    xSemaphoreGive(flash_mutex);
+
+    csv_writer_t *w = &writer;
+    w->len = 0;
+    w->emit = emit;
+    w->ctx = ctx;
+    w->failed = false;
+    w->len = snprintf(w->buf, sizeof(w->buf),
+                      "session,boot,mac_hash,kind,approved,first_seen,last_seen,approved_at,bytes,page_hits,clock\n");
+
+    // Oldest sector first: the one after head in the ring. Read one chunk per
+    // lock; a sector the ring reuses meanwhile is left out from there on
+    for (uint32_t n = 1; n <= sector_count && !w->failed; n++) {
+        uint32_t sector = (end_sector + n) % sector_count;
+        uint32_t used = (sector == end_sector) ? end_used : VLOG_RECORDS_PER_SECTOR;
+        uint32_t seq = 0;
+
+        for (uint32_t slot = 0; slot < used && !w->failed; slot += 16) {
+            uint32_t count = used - slot;
+            if (count > 16) count = 16;
+
+            xSemaphoreTake(flash_mutex, portMAX_DELAY);
+            uint32_t now_seq;
+            bool same = read_sector_seq(sector, &now_seq) && now_seq <= end_seq && (slot == 0 || now_seq == seq);
+            if (same) {
+                esp_partition_read(log_partition, slot_offset(sector, slot), chunk, count * VLOG_RECORD_SIZE);
+            }
+            xSemaphoreGive(flash_mutex);
+            if (!same) {
+                break;
+            }
+            seq = now_seq;
+
+            for (uint32_t i = 0; i < count; i++) {
+                if (record_is_valid(&chunk[i])) {
+                    csv_row(w, &chunk[i], kind_name(chunk[i].kind));
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < tail_count && !w->failed; i++) {
+        csv_row(w, &tail[i], i < tail_pending ? kind_name(tail[i].kind) : "live");
+    }
+
+    csv_flush(w);
+    bool failed = w->failed;
+    xSemaphoreGive(export_mutex);
+
+    return failed ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t visitor_log_erase(void)
+{
+    if (!log_partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    esp_err_t err = esp_partition_erase_range(log_partition, 0, sector_count * VLOG_SECTOR_SIZE);
+    if (err == ESP_OK) {
+        full_sectors = 0;
+        err = start_sector(0, head_seq + 1);
+    }
+    xSemaphoreGive(flash_mutex);
+
+    ESP_LOGI(TAG, "Analytics erased: %s", esp_err_to_name(err));
+    return err;
+}
+
+void visitor_log_get_stats(visitor_log_stats_t *out)
+{
+    if (!out) return;
+    if (!log_partition) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    *out = stats;
+    out->records_pending = pending_count;
+    xSemaphoreGive(state_mutex);
+    out->records_on_flash = full_sectors * VLOG_RECORDS_PER_SECTOR + head_used;
+}
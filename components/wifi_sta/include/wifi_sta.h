@@ -0,0 +1,73 @@
+#ifndef WIFI_STA_H
+#define WIFI_STA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Reconnect backoff: attempt n waits a random time in [d/2, d] with
+// d = MIN << (n-1), capped at MAX - retries never stop
+#define WIFI_STA_BACKOFF_MIN_MS 250
+#define WIFI_STA_BACKOFF_MAX_MS 30000
+
+// A rejoin that changes nothing else only rewrites the saved list once its
+// last-success stamp is this stale, so a flapping uplink doesn't wear flash
+#define WIFI_STA_STAMP_SAVE_S (6 * 3600)
+
+// Saved networks; adding one more evicts the lowest priority, least recently used
+#define WIFI_STA_MAX_NETWORKS 8
+
+// Priority 0-9, each step is worth 6 dB of signal when ranking
+#define WIFI_STA_PRIORITY_MAX     9
+#define WIFI_STA_PRIORITY_DEFAULT 5
+
+// One saved network, as listed for the UI and API
+typedef struct {
+    char ssid[33];
+    uint8_t priority;
+    uint32_t last_success;     // Unix time of the last address, 0 if never or clock unset
+    uint32_t throughput_kbps;  // Decaying peak measured while connected, 0 if unknown
+    int8_t rssi;               // From the last scan, 0 if not seen
+    bool connected;
+} wifi_sta_network_t;
+
+/**
+ * Load the saved networks and take over STA connects and retries
+ * (call after esp_wifi_init, before esp_wifi_start)
+ * ESP_ERR_NOT_FOUND if no network is saved (setup mode)
+ */
+esp_err_t wifi_sta_init(void);
+
+/**
+ * Save (or update) credentials and connect to them now
+ */
+esp_err_t wifi_sta_connect(const char *ssid, const char *password);
+
+/**
+ * Remove a saved network, disconnecting first if it is the current one
+ */
+esp_err_t wifi_sta_forget(const char *ssid);
+
+/**
+ * Change a saved network's priority (0-WIFI_STA_PRIORITY_MAX)
+ */
+esp_err_t wifi_sta_set_priority(const char *ssid, uint8_t priority);
+
+/**
+ * Copy the saved networks, best candidate first
+ * Returns the number of entries written
+ */
+size_t wifi_sta_list(wifi_sta_network_t *out, size_t max);
+
+/**
+ * Feed a throughput sample for the current network (kbit/s)
+ */
+void wifi_sta_report_throughput(uint32_t kbps);
+
+/**
+ * Time from the last connect attempt to an address, 0 until connected
+ */
+uint32_t wifi_sta_last_connect_ms(void);
+
+#endif // WIFI_STA_H
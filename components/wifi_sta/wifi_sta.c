@@ -0,0 +1,802 @@
+#include "wifi_sta.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "event_worker.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "WiFiSTA";
+
+#define NETS_KEY         "wifi_nets"
+#define NETS_VERSION     1
+#define LEGACY_CACHE_KEY "wifi_fast"
+#define SCAN_MAX_RECORDS 32
+#define EPOCH_VALID      1600000000   // time() above this means SNTP has set the clock
+#define TPUT_IDLE_KBPS   256          // Samples below this are idle time, not a measurement
+
+// On-flash record, followed by the SSID and password bytes (unterminated)
+typedef struct __attribute__((packed)) {
+    uint8_t ssid_len;
+    uint8_t pass_len;
+    uint8_t priority;
+    uint8_t channel;          // Where it was last joined, 0 = unknown
+    uint8_t authmode;
+    uint8_t bssid[6];
+    uint16_t success_seq;     // Orders successes even when the clock was never set
+    uint32_t last_success;
+    uint16_t throughput_kbps; // Saturates at 65 Mbit/s, well past what the radio does
+} net_record_t;
+
+// Blob: version, count, then up to MAX variable-length records
+#define NETS_BLOB_MAX (2 + WIFI_STA_MAX_NETWORKS * (sizeof(net_record_t) + 32 + 64))
+
+// Single-network cache written before the list existed (migrated once)
+typedef struct __attribute__((packed)) {
+    uint8_t ssid[32];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;
+} legacy_cache_t;
+
+typedef struct {
+    char ssid[33];
+    char password[65];
+    uint8_t priority;
+    uint8_t channel;
+    uint8_t authmode;
+    uint8_t bssid[6];
+    uint16_t success_seq;
+    uint32_t last_success;
+    uint32_t throughput_kbps;
+    uint32_t saved_kbps;      // Value last written to flash
+    uint32_t saved_success;   // Likewise for last_success
+    bool moved;               // BSSID/channel/auth differ from flash
+    int8_t rssi;              // Last scan, 0 if not seen
+} saved_net_t;
+
+// Where STA_CONNECTED says we joined, copied off the event loop
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;
+} sta_location_t;
+
+// One visible saved network from the last scan, best first
+typedef struct {
+    int net;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;
+    int score;
+} candidate_t;
+
+typedef enum {
+    ATTEMPT_NONE,
+    ATTEMPT_FAST,       // Last good network at its cached BSSID/channel
+    ATTEMPT_CANDIDATE,  // Next entry of the ranked scan
+    ATTEMPT_DIRECT,     // Credentials just entered, the driver scans for them
+} attempt_kind_t;
+
+static saved_net_t nets[WIFI_STA_MAX_NETWORKS];
+static int net_count = 0;
+static int current = -1;               // Network being joined or joined
+static bool link_up = false;
+static uint8_t blob[NETS_BLOB_MAX];    // Flash image scratch (state_mutex)
+
+static candidate_t candidates[WIFI_STA_MAX_NETWORKS];
+static int cand_count = 0;
+static int cand_next = 0;
+static bool scanning = false;          // The next SCAN_DONE is ours, not the portal's
+
+static uint32_t attempt = 0;           // Consecutive rounds that found nothing to join
+static attempt_kind_t attempt_kind = ATTEMPT_NONE;
+static bool ignore_disconnect = false; // Our own esp_wifi_disconnect()
+static int64_t round_started_us = 0;
+static uint32_t last_connect_ms = 0;
+
+static esp_timer_handle_t retry_timer = NULL;
+static SemaphoreHandle_t state_mutex = NULL;
+
+static bool clock_is_epoch(void)
+{
+    return time(NULL) > EPOCH_VALID;
+}
+
+static int find_net(const char *ssid)
+{
+    for (int i = 0; i < net_count; i++) {
+        if (strcmp(nets[i].ssid, ssid) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Most recently joined network, -1 if none ever worked
+static int newest_net(void)
+{
+    int best = -1;
+    for (int i = 0; i < net_count; i++) {
+        if (nets[i].success_seq != 0 && (best < 0 || nets[i].success_seq > nets[best].success_seq)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// Signal first, then what the user asked for and what worked before:
+// each priority step is worth 6 dB, the last good network gets 5 dB,
+// one that never worked loses 5 dB, and up to 10 dB for throughput
+static int score(int net, int rssi, int newest)
+{
+    const saved_net_t *n = &nets[net];
+    int s = rssi + 6 * n->priority;
+    if (n->success_seq == 0) {
+        s -= 5;
+    } else if (net == newest) {
+        s += 5;
+    }
+    uint32_t mbps = n->throughput_kbps / 1000;
+    s += (mbps > 20 ? 20 : mbps) / 2;
+    return s;
+}
+
+static esp_err_t save_networks(void)
+{
+    size_t off = 0;
+    blob[off++] = NETS_VERSION;
+    blob[off++] = (uint8_t)net_count;
+    for (int i = 0; i < net_count; i++) {
+        saved_net_t *n = &nets[i];
+        net_record_t rec = {
+            .ssid_len = (uint8_t)strlen(n->ssid),
+            .pass_len = (uint8_t)strlen(n->password),
+            .priority = n->priority,
+            .channel = n->channel,
+            .authmode = n->authmode,
+            .success_seq = n->success_seq,
+            .last_success = n->last_success,
+            .throughput_kbps = n->throughput_kbps > UINT16_MAX ? UINT16_MAX : (uint16_t)n->throughput_kbps,
+        };
+        memcpy(rec.bssid, n->bssid, sizeof(rec.bssid));
+        memcpy(blob + off, &rec, sizeof(rec));
+        off += sizeof(rec);
+        memcpy(blob + off, n->ssid, rec.ssid_len);
+        off += rec.ssid_len;
+        memcpy(blob + off, n->password, rec.pass_len);
+        off += rec.pass_len;
+        n->saved_kbps = n->throughput_kbps;
+        n->saved_success = n->last_success;
+        n->moved = false;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NETS_KEY, blob, off);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save networks: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+static void load_networks(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(blob);
+    if (nvs_get_blob(nvs, NETS_KEY, blob, &len) == ESP_OK && len >= 2 && blob[0] == NETS_VERSION) {
+        size_t off = 2;
+        for (int i = 0; i < blob[1] && net_count < WIFI_STA_MAX_NETWORKS; i++) {
+            net_record_t rec;
+            if (off + sizeof(rec) > len) {
+                break;
+            }
+            memcpy(&rec, blob + off, sizeof(rec));
+            off += sizeof(rec);
+            if (rec.ssid_len == 0 || rec.ssid_len > 32 || rec.pass_len > 64 ||
+                off + rec.ssid_len + rec.pass_len > len) {
+                break;
+            }
+            saved_net_t *n = &nets[net_count++];
+            memset(n, 0, sizeof(*n));
+            memcpy(n->ssid, blob + off, rec.ssid_len);
+            off += rec.ssid_len;
+            memcpy(n->password, blob + off, rec.pass_len);
+            off += rec.pass_len;
+            n->priority = rec.priority > WIFI_STA_PRIORITY_MAX ? WIFI_STA_PRIORITY_MAX : rec.priority;
+            n->channel = rec.channel <= 14 ? rec.channel : 0;
+            n->authmode = rec.authmode;
+            memcpy(n->bssid, rec.bssid, sizeof(n->bssid));
+            n->success_seq = rec.success_seq;
+            n->last_success = rec.last_success;
+            n->throughput_kbps = rec.throughput_kbps;
+            n->saved_kbps = rec.throughput_kbps;
+            n->saved_success = rec.last_success;
+        }
+    }
+    nvs_close(nvs);
+}
+
+// Pull the old wifi_ssid/wifi_pass pair and its BSSID cache into the list
+static void migrate_legacy(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open("storage", NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    saved_net_t *n = &nets[0];
+    memset(n, 0, sizeof(*n));
+    size_t ssid_len = sizeof(n->ssid);
+    size_t pass_len = sizeof(n->password);
+    if (nvs_get_str(nvs, "wifi_ssid", n->ssid, &ssid_len) == ESP_OK && n->ssid[0] != '\0' &&
+        nvs_get_str(nvs, "wifi_pass", n->password, &pass_len) == ESP_OK) {
+        n->priority = WIFI_STA_PRIORITY_DEFAULT;
+        legacy_cache_t cache;
+        size_t len = sizeof(cache);
+        if (nvs_get_blob(nvs, LEGACY_CACHE_KEY, &cache, &len) == ESP_OK && len == sizeof(cache) &&
+            strncmp((const char *)cache.ssid, n->ssid, sizeof(cache.ssid)) == 0 &&
+            cache.channel >= 1 && cache.channel <= 14) {
+            memcpy(n->bssid, cache.bssid, sizeof(n->bssid));
+            n->channel = cache.channel;
+            n->authmode = cache.authmode;
+            n->success_seq = 1;   // The cache was only written by a connect that worked
+        }
+        net_count = 1;
+    }
+    nvs_close(nvs);
+
+    if (net_count == 1 && save_networks() == ESP_OK &&
+        nvs_open("storage", NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, "wifi_ssid");
+        nvs_erase_key(nvs, "wifi_pass");
+        nvs_erase_key(nvs, LEGACY_CACHE_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+        ESP_LOGI(TAG, "✓ Migrated saved network %s", n->ssid);
+    }
+}
+
+static void remove_net(int i)
+{
+    memmove(&nets[i], &nets[i + 1], (net_count - i - 1) * sizeof(nets[0]));
+    net_count--;
+    if (current == i) {
+        current = -1;
+    } else if (current > i) {
+        current--;
+    }
+    // Candidate indexes are stale now; the next failure rescans
+    cand_count = 0;
+    cand_next = 0;
+}
+
+// Full jitter in the upper half of the window keeps a room full of devices
+// from retrying in lockstep after the venue AP reboots
+static uint32_t backoff_ms(uint32_t n)
+{
+    if (n == 0) {
+        return 0;
+    }
+    uint32_t shift = n - 1 < 16 ? n - 1 : 16;
+    uint32_t window = WIFI_STA_BACKOFF_MIN_MS << shift;
+    if (window > WIFI_STA_BACKOFF_MAX_MS) {
+        window = WIFI_STA_BACKOFF_MAX_MS;
+    }
+    return window / 2 + esp_random() % (window / 2 + 1);
+}
+
+// Configure and start one connect (state_mutex held); bssid NULL lets the driver scan
+static void connect_to(int net, const uint8_t *bssid, uint8_t channel, uint8_t authmode, attempt_kind_t kind)
+{
+    const saved_net_t *n = &nets[net];
+    wifi_config_t cfg = {0};
+    memcpy(cfg.sta.ssid, n->ssid, strlen(n->ssid));
+    memcpy(cfg.sta.password, n->password, strlen(n->password));
+    if (bssid) {
+        cfg.sta.bssid_set = true;
+        memcpy(cfg.sta.bssid, bssid, sizeof(cfg.sta.bssid));
+        cfg.sta.channel = channel;
+        cfg.sta.scan_method = WIFI_FAST_SCAN;
+        cfg.sta.threshold.authmode = (wifi_auth_mode_t)authmode;
+    } else {
+        cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        cfg.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+
+    current = net;
+    attempt_kind = kind;
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    esp_wifi_connect();
+}
+
+static void schedule_retry(void);
+
+static void start_scan(void)
+{
+    wifi_scan_config_t scan_config = {
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+    };
+    attempt_kind = ATTEMPT_NONE;
+    scanning = true;
+    esp_err_t err = esp_wifi_scan_start(&scan_config, false);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Scan failed to start: %s", esp_err_to_name(err));
+        scanning = false;
+        attempt++;
+        schedule_retry();
+    }
+}
+
+// Try the next ranked candidate, or back off and rescan once all have failed
+static void try_next_candidate(void)
+{
+    if (cand_next >= cand_count) {
+        attempt++;
+        schedule_retry();
+        return;
+    }
+    const candidate_t *c = &candidates[cand_next++];
+    ESP_LOGI(TAG, "Joining %s (" MACSTR " ch %d, %d dBm, score %d)", nets[c->net].ssid,
+             MAC2STR(c->bssid), c->channel, nets[c->net].rssi, c->score);
+    connect_to(c->net, c->bssid, c->channel, c->authmode, ATTEMPT_CANDIDATE);
+}
+
+// One connect round: the last good network at its cached location first,
+// otherwise a single scan ranks every visible saved network
+static void begin_round(void)
+{
+    cand_count = 0;
+    cand_next = 0;
+    if (net_count == 0) {
+        current = -1;
+        attempt_kind = ATTEMPT_NONE;
+        return;
+    }
+    if (round_started_us == 0) {
+        round_started_us = esp_timer_get_time();
+    }
+
+    int newest = newest_net();
+    if (attempt == 0 && newest >= 0 && nets[newest].channel != 0) {
+        connect_to(newest, nets[newest].bssid, nets[newest].channel, nets[newest].authmode, ATTEMPT_FAST);
+        return;
+    }
+    start_scan();
+}
+
+static void retry_timer_cb(void *arg)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    begin_round();
+    xSemaphoreGive(state_mutex);
+}
+
+static void schedule_retry(void)
+{
+    uint32_t delay = backoff_ms(attempt);
+    esp_timer_stop(retry_timer);
+    if (delay == 0) {
+        begin_round();
+    } else {
+        ESP_LOGI(TAG, "Retry %lu in %lums", (unsigned long)attempt, (unsigned long)delay);
+        esp_timer_start_once(retry_timer, (uint64_t)delay * 1000);
+    }
+}
+
+static void handle_scan_done(void)
+{
+    scanning = false;
+    cand_count = 0;
+    cand_next = 0;
+
+    uint16_t count = SCAN_MAX_RECORDS;
+    wifi_ap_record_t *records = malloc(count * sizeof(wifi_ap_record_t));
+    if (!records) {
+        attempt++;
+        schedule_retry();
+        return;
+    }
+    esp_wifi_scan_get_ap_records(&count, records);
+
+    // Strongest BSSID of each saved network, inserted in score order
+    int newest = newest_net();
+    for (int i = 0; i < net_count; i++) {
+        int best = -1;
+        for (int r = 0; r < count; r++) {
+            if (strncmp((const char *)records[r].ssid, nets[i].ssid, sizeof(records[r].ssid)) == 0 &&
+                (best < 0 || records[r].rssi > records[best].rssi)) {
+                best = r;
+            }
+        }
+        nets[i].rssi = best >= 0 ? records[best].rssi : 0;
+        if (best < 0) {
+            continue;
+        }
+
+        candidate_t c = {
+            .net = i,
+            .channel = records[best].primary,
+            .authmode = (uint8_t)records[best].authmode,
+            .score = score(i, records[best].rssi, newest),
+        };
+        memcpy(c.bssid, records[best].bssid, sizeof(c.bssid));
+        int pos = cand_count++;
+        while (pos > 0 && candidates[pos - 1].score < c.score) {
+            candidates[pos] = candidates[pos - 1];
+            pos--;
+        }
+        candidates[pos] = c;
+    }
+    free(records);
+
+    if (cand_count == 0) {
+        ESP_LOGW(TAG, "No saved network in range (%d APs seen)", count);
+    }
+    try_next_candidate();
+}
+
+static void sta_started(const void *arg, size_t len)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    attempt = 0;
+    begin_round();
+    xSemaphoreGive(state_mutex);
+}
+
+static void scan_done(const void *arg, size_t len)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (scanning) {
+        handle_scan_done();
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+static void sta_connected(const void *arg, size_t len)
+{
+    const sta_location_t *at = arg;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (current >= 0) {
+        // Next reconnect goes straight here; saved with the success below
+        saved_net_t *n = &nets[current];
+        if (memcmp(n->bssid, at->bssid, sizeof(n->bssid)) != 0 || n->channel != at->channel ||
+            n->authmode != at->authmode) {
+            memcpy(n->bssid, at->bssid, sizeof(n->bssid));
+            n->channel = at->channel;
+            n->authmode = at->authmode;
+            n->moved = true;
+        }
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+static void sta_disconnected(const void *arg, size_t len)
+{
+    const wifi_event_sta_disconnected_t *event = arg;
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    bool was_up = link_up;
+    link_up = false;
+    last_connect_ms = 0;
+    if (ignore_disconnect) {
+        ignore_disconnect = false;
+    } else if (was_up) {
+        if (current >= 0) {
+            ESP_LOGW(TAG, "Lost %s (reason %d)", nets[current].ssid, event->reason);
+            if (nets[current].throughput_kbps != nets[current].saved_kbps) {
+                save_networks();
+            }
+        }
+        // A drop from a working link starts over at the fast path
+        attempt = 0;
+        begin_round();
+    } else if (attempt_kind == ATTEMPT_FAST) {
+        ESP_LOGI(TAG, "Cached BSSID missed (reason %d) - scanning", event->reason);
+        start_scan();
+    } else if (attempt_kind == ATTEMPT_CANDIDATE) {
+        ESP_LOGI(TAG, "%s failed (reason %d)", current >= 0 ? nets[current].ssid : "?", event->reason);
+        try_next_candidate();
+    } else if (attempt_kind == ATTEMPT_DIRECT) {
+        ESP_LOGI(TAG, "%s failed (reason %d) - ranking saved networks",
+                 current >= 0 ? nets[current].ssid : "?", event->reason);
+        start_scan();
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+static void sta_got_ip(const void *arg, size_t len)
+{
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (current >= 0) {
+        saved_net_t *n = &nets[current];
+        // Flash only when something a later boot ranks by changed: the BSSID
+        // or channel, which network is newest, or a stale success stamp.
+        // Rejoining the same AP on a flapping uplink writes nothing
+        bool changed = n->moved;
+        int newest = newest_net();
+        if (newest != current) {
+            uint16_t seq = newest >= 0 ? nets[newest].success_seq : 0;
+            if (seq == UINT16_MAX) {
+                // Halving keeps the order (ties aside) and frees the top of the range
+                for (int i = 0; i < net_count; i++) {
+                    nets[i].success_seq = (nets[i].success_seq + 1) / 2;
+                }
+                seq = UINT16_MAX / 2 + 1;
+            }
+            n->success_seq = seq + 1;
+            changed = true;
+        }
+        if (clock_is_epoch()) {
+            n->last_success = (uint32_t)time(NULL);
+            if (n->last_success - n->saved_success >= WIFI_STA_STAMP_SAVE_S) {
+                changed = true;
+            }
+        }
+        if (changed) {
+            save_networks();
+        }
+
+        if (round_started_us != 0) {
+            last_connect_ms = (uint32_t)((esp_timer_get_time() - round_started_us) / 1000);
+        }
+        const char *path = attempt_kind == ATTEMPT_FAST ? "cached BSSID" :
+                           attempt_kind == ATTEMPT_CANDIDATE ? "ranked scan" : "driver scan";
+        ESP_LOGI(TAG, "✓ Uplink %s in %lums (%s, %lu retries)", n->ssid,
+                 (unsigned long)last_connect_ms, path, (unsigned long)attempt);
+    }
+    link_up = true;
+    attempt = 0;
+    round_started_us = 0;
+    xSemaphoreGive(state_mutex);
+}
+
+// Runs on the default event loop: copy what the step needs and queue it.
+// Scan ranking and NVS commits happen on the worker, in event order, and
+// are never dropped (run inline if the link queue is full)
+static void wifi_sta_event_handler(void *arg, esp_event_base_t event_base,
+                                   int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        event_worker_post_or_run(EVENT_PRIO_LINK, sta_started, NULL, 0);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        event_worker_post_or_run(EVENT_PRIO_LINK, scan_done, NULL, 0);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        const wifi_event_sta_connected_t *event = event_data;
+        sta_location_t at = { .channel = event->channel, .authmode = (uint8_t)event->authmode };
+        memcpy(at.bssid, event->bssid, sizeof(at.bssid));
+        event_worker_post_or_run(EVENT_PRIO_LINK, sta_connected, &at, sizeof(at));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        event_worker_post_or_run(EVENT_PRIO_LINK, sta_disconnected, event_data, sizeof(wifi_event_sta_disconnected_t));
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        event_worker_post_or_run(EVENT_PRIO_LINK, sta_got_ip, NULL, 0);
+    }
+}
+
+esp_err_t wifi_sta_init(void)
+{
+    if (state_mutex) {
+        return net_count > 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+    }
+    state_mutex = xSemaphoreCreateMutex();
+    if (!state_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry"
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &retry_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    load_networks();
+    if (net_count == 0) {
+        migrate_legacy();
+    }
+
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_START, &wifi_sta_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &wifi_sta_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &wifi_sta_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &wifi_sta_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_sta_event_handler, NULL));
+
+    if (net_count == 0) {
+        ESP_LOGI(TAG, "No saved network");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Seed the driver config so get_wifi_ssid() works before the first connect
+    int newest = newest_net();
+    const saved_net_t *n = &nets[newest >= 0 ? newest : 0];
+    wifi_config_t cfg = {0};
+    memcpy(cfg.sta.ssid, n->ssid, strlen(n->ssid));
+    esp_wifi_set_config(WIFI_IF_STA, &cfg);
+
+    ESP_LOGI(TAG, "✓ %d saved network(s), last joined %s", net_count, newest >= 0 ? n->ssid : "none");
+    return ESP_OK;
+}
+
+esp_err_t wifi_sta_connect(const char *ssid, const char *password)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (strlen(ssid) == 0 || strlen(ssid) >= sizeof(nets[0].ssid) ||
+        strlen(password) >= sizeof(nets[0].password)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int i = find_net(ssid);
+    if (i < 0) {
+        if (net_count == WIFI_STA_MAX_NETWORKS) {
+            // Full: drop the lowest priority, least recently joined (never the current one)
+            int victim = -1;
+            for (int v = 0; v < net_count; v++) {
+                if (v == current) {
+                    continue;
+                }
+                if (victim < 0 || nets[v].priority < nets[victim].priority ||
+                    (nets[v].priority == nets[victim].priority &&
+                     nets[v].success_seq < nets[victim].success_seq)) {
+                    victim = v;
+                }
+            }
+            ESP_LOGI(TAG, "Forgetting %s to make room", nets[victim].ssid);
+            remove_net(victim);
+        }
+        i = net_count++;
+        memset(&nets[i], 0, sizeof(nets[i]));
+        memcpy(nets[i].ssid, ssid, strlen(ssid) + 1);   // Length checked above
+        nets[i].priority = WIFI_STA_PRIORITY_DEFAULT;
+    }
+    memcpy(nets[i].password, password, strlen(password) + 1);
+    esp_err_t err = save_networks();
+
+    esp_timer_stop(retry_timer);
+    if (scanning) {
+        esp_wifi_scan_stop();
+        scanning = false;
+    }
+    attempt = 0;
+    cand_count = 0;
+    cand_next = 0;
+    link_up = false;
+    round_started_us = esp_timer_get_time();
+
+    wifi_ap_record_t ap;
+    ignore_disconnect = esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+    esp_wifi_disconnect();
+    connect_to(i, NULL, 0, 0, ATTEMPT_DIRECT);
+    xSemaphoreGive(state_mutex);
+    return err;
+}
+
+esp_err_t wifi_sta_forget(const char *ssid)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int i = find_net(ssid);
+    if (i < 0) {
+        xSemaphoreGive(state_mutex);
+        return ESP_ERR_NOT_FOUND;
+    }
+    bool was_current = i == current;
+    remove_net(i);
+    esp_err_t err = save_networks();
+    ESP_LOGI(TAG, "Forgot %s (%d left)", ssid, net_count);
+
+    if (net_count == 0) {
+        esp_timer_stop(retry_timer);
+    }
+    if (was_current && link_up) {
+        // The drop starts a round over whatever is left
+        esp_wifi_disconnect();
+    }
+    xSemaphoreGive(state_mutex);
+    return err;
+}
+
+esp_err_t wifi_sta_set_priority(const char *ssid, uint8_t priority)
+{
+    if (!state_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (priority > WIFI_STA_PRIORITY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int i = find_net(ssid);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (i >= 0) {
+        nets[i].priority = priority;
+        err = save_networks();
+    }
+    xSemaphoreGive(state_mutex);
+    return err;
+}
+
+size_t wifi_sta_list(wifi_sta_network_t *out, size_t max)
+{
+    if (!state_mutex) {
+        return 0;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    int newest = newest_net();
+    int order[WIFI_STA_MAX_NETWORKS];
+    int scores[WIFI_STA_MAX_NETWORKS];
+    for (int i = 0; i < net_count; i++) {
+        // Out of range ranks as a very weak signal
+        int s = score(i, nets[i].rssi != 0 ? nets[i].rssi : -100, newest);
+        int pos = i;
+        while (pos > 0 && scores[pos - 1] < s) {
+            order[pos] = order[pos - 1];
+            scores[pos] = scores[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+        scores[pos] = s;
+    }
+
+    size_t n = 0;
+    for (int k = 0; k < net_count && n < max; k++) {
+        const saved_net_t *src = &nets[order[k]];
+        wifi_sta_network_t *dst = &out[n++];
+        memcpy(dst->ssid, src->ssid, sizeof(dst->ssid));
+        dst->priority = src->priority;
+        dst->last_success = src->last_success;
+        dst->throughput_kbps = src->throughput_kbps;
+        dst->rssi = src->rssi;
+        dst->connected = link_up && order[k] == current;
+    }
+    xSemaphoreGive(state_mutex);
+    return n;
+}
+
+void wifi_sta_report_throughput(uint32_t kbps)
+{
+    if (!state_mutex || kbps < TPUT_IDLE_KBPS) {
+        return;
+    }
+    xSemaphoreTake(state_mutex, portMAX_DELAY);
+    if (link_up && current >= 0) {
+        saved_net_t *n = &nets[current];
+        // Decaying peak: a quiet minute says nothing about capacity, a busy
+        // one slowly replaces an old best with what the venue gives today
+        uint32_t decayed = n->throughput_kbps - n->throughput_kbps / 8;
+        n->throughput_kbps = kbps > decayed ? kbps : decayed;
+        if (clock_is_epoch()) {
+            n->last_success = (uint32_t)time(NULL);
+        }
+        // Otherwise flash waits for the disconnect
+        if (n->throughput_kbps > n->saved_kbps + n->saved_kbps / 2 + 500) {
+            save_networks();
+        }
+    }
+    xSemaphoreGive(state_mutex);
+}
+
+uint32_t wifi_sta_last_connect_ms(void)
+{
+    return last_connect_ms;
+}
@@ -0,0 +1,166 @@
+// Lookup throughput of components/napt_table against the linear-scan
+// table from src_arduino_backup/simple_napt.cpp
+//   ./napt_bench [lookups]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "napt_table.h"
+
+// ---------------------------------------------------------------------------
+// Baseline: simple_napt.cpp with the table size as a parameter
+
+typedef struct {
+    uint32_t src_addr;
+    uint16_t src_port;
+    uint16_t mapped_port;
+    uint8_t  proto;
+    uint32_t last_active;
+    bool     in_use;
+} linear_entry_t;
+
+typedef struct {
+    linear_entry_t *entries;
+    int size;
+    uint16_t next_port;
+} linear_table_t;
+
+static int linear_find_or_create(linear_table_t *t, uint32_t src_ip, uint16_t src_port,
+                                 uint8_t proto, uint32_t now)
+{
+    int free_slot = -1;
+    for (int i = 0; i < t->size; i++) {
+        linear_entry_t *e = &t->entries[i];
+        if (e->in_use) {
+            if (now - e->last_active > 60000) {
+                e->in_use = false;
+                continue;
+            }
+            if (e->src_addr == src_ip && e->src_port == src_port && e->proto == proto) {
+                e->last_active = now;
+                return i;
+            }
+        } else if (free_slot == -1) {
+            free_slot = i;
+        }
+    }
+    if (free_slot != -1) {
+        linear_entry_t *e = &t->entries[free_slot];
+        e->src_addr = src_ip;
+        e->src_port = src_port;
+        e->mapped_port = t->next_port++;
+        e->proto = proto;
+        e->last_active = now;
+        e->in_use = true;
+        if (t->next_port > 65000) t->next_port = 50000;
+        return free_slot;
+    }
+    return -1;
+}
+
+static int linear_reverse_lookup(linear_table_t *t, uint16_t mapped_port, uint8_t proto, uint32_t now)
+{
+    for (int i = 0; i < t->size; i++) {
+        linear_entry_t *e = &t->entries[i];
+        if (e->in_use && e->mapped_port == mapped_port && e->proto == proto) {
+            e->last_active = now;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rng = 12345;
+
+static uint32_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+#define CLIENT_IP(i)  (0x0004a8c0u | ((uint32_t)(2 + (i) % 250) << 24))
+#define CLIENT_PORT(i) ((uint16_t)(1024 + (i) / 250))
+#define REMOTE_IP     0x08080808u
+
+static void bench(int sessions, long lookups)
+{
+    volatile long sink = 0;
+
+    // Hashed table
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.capacity = (uint16_t)sessions;
+    napt_table_t t;
+    if (napt_table_init(&t, &cfg) != ESP_OK) {
+        fprintf(stderr, "napt_table_init failed\n");
+        exit(1);
+    }
+    uint16_t *mapped = malloc(sessions * sizeof(uint16_t));
+    for (int i = 0; i < sessions; i++) {
+        napt_entry_t *e = napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT_IP(i), CLIENT_PORT(i),
+                                              REMOTE_IP, 53, 0, 0, true);
+        mapped[i] = e->mapped_port;
+    }
+
+    double start = now_s();
+    for (long n = 0; n < lookups; n++) {
+        int i = next_rand() % sessions;
+        napt_entry_t *e = (n & 1)
+            ? napt_table_inbound(&t, NAPT_PROTO_UDP, mapped[i], REMOTE_IP, 53, 0, 1)
+            : napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT_IP(i), CLIENT_PORT(i), REMOTE_IP, 53, 0, 1, false);
+        sink += e != NULL;
+    }
+    double hashed = lookups / (now_s() - start);
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    double avg_probe = (double)st.probes / st.lookups;
+    napt_table_deinit(&t);
+
+    // Linear baseline (fewer iterations, it is slow)
+    linear_table_t lt = {
+        .entries = calloc(sessions, sizeof(linear_entry_t)),
+        .size = sessions,
+        .next_port = 50000,
+    };
+    for (int i = 0; i < sessions; i++) {
+        int slot = linear_find_or_create(&lt, CLIENT_IP(i), CLIENT_PORT(i), NAPT_PROTO_UDP, 0);
+        mapped[i] = lt.entries[slot].mapped_port;
+    }
+    long linear_lookups = lookups / 64;
+    start = now_s();
+    for (long n = 0; n < linear_lookups; n++) {
+        int i = next_rand() % sessions;
+        int slot = (n & 1)
+            ? linear_reverse_lookup(&lt, mapped[i], NAPT_PROTO_UDP, 1)
+            : linear_find_or_create(&lt, CLIENT_IP(i), CLIENT_PORT(i), NAPT_PROTO_UDP, 1);
+        sink += slot >= 0;
+    }
+    double linear = linear_lookups / (now_s() - start);
+    free(lt.entries);
+    free(mapped);
+
+    printf("%5d sessions  hashed %11.0f lookups/s (%.2f probes avg, %u max)  linear %10.0f lookups/s  x%.0f\n",
+           sessions, hashed, avg_probe, st.max_probe, linear, hashed / linear);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    long lookups = argc > 1 ? atol(argv[1]) : 4000000;
+
+    bench(512, lookups);
+    bench(4096, lookups);
+    return 0;
+}
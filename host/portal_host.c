@@ -0,0 +1,229 @@
+// Runs the DNS proxy, captive portal, debug server and visitor log on a Linux box
+// against the POSIX shims in host/shim. Privileged ports are shifted by
+// LABPORTAL_PORT_OFFSET (default 10000): DNS on 10053/udp, portal on 10080/tcp.
+//
+//   portal_host [--setup] [--no-captive] [--stations N] [--run-for SECONDS]
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+
+#include "admission.h"
+#include "bench_server.h"
+#include "captive_portal.h"
+#include "channel_plan.h"
+#include "client_stats.h"
+#include "client_table.h"
+#include "dhcp_leases.h"
+#include "dns_server.h"
+#include "event_worker.h"
+#include "fleet_sync.h"
+#include "mdns_responder.h"
+#include "log_capture.h"
+#include "mss_clamp.h"
+#include "napt_monitor.h"
+#include "portal_mode.h"
+#include "shaper.h"
+#include "tcp_debug.h"
+#include "uplink_monitor.h"
+#include "visitor_log.h"
+#include "wifi_sta.h"
+
+static const char *TAG = "Host";
+
+bool setup_mode = false;
+
+static volatile sig_atomic_t stop_requested;
+static volatile sig_atomic_t reload_requested;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+// SIGHUP re-reads the Wi-Fi script, e.g. to take the uplink AP away
+static void on_reload(int sig)
+{
+    (void)sig;
+    reload_requested = 1;
+}
+
+// Same AP bookkeeping as wifi_event_handler in src/main.c, deferred the same way
+static void station_joined(const void *arg, size_t len)
+{
+    const wifi_event_ap_staconnected_t *event = arg;
+    client_table_station_joined(event->mac);
+    fleet_sync_station_joined(event->mac);   // Approved on a peer stick - before admission looks
+    dhcp_leases_station_joined(event->mac);
+    visitor_log_station_joined(event->mac);
+    admission_station_joined();
+}
+
+static void station_left(const void *arg, size_t len)
+{
+    const wifi_event_ap_stadisconnected_t *event = arg;
+    client_table_station_left(event->mac);
+    dhcp_leases_station_left(event->mac);
+    visitor_log_station_left(event->mac);
+}
+
+static void station_got_ip(const void *arg, size_t len)
+{
+    const ip_event_ap_staipassigned_t *event = arg;
+    dhcp_leases_assigned(event->mac, event->ip.addr);
+    client_table_station_ip(event->mac, event->ip.addr);
+    visitor_log_station_ip(event->mac, event->ip.addr);
+}
+
+static void uplink_up(const void *arg, size_t len)
+{
+    const esp_netif_ip_info_t *ip_info = arg;
+    channel_plan_follow_uplink();
+    mdns_responder_set_address(ip_info->ip.addr);
+    fleet_sync_set_address(ip_info->ip.addr);
+}
+
+static void ap_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_joined, event_data, sizeof(wifi_event_ap_staconnected_t));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_left, event_data, sizeof(wifi_event_ap_stadisconnected_t));
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_got_ip, event_data, sizeof(ip_event_ap_staipassigned_t));
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+        event_worker_post_or_run(EVENT_PRIO_LINK, uplink_up, &event->ip_info, sizeof(event->ip_info));
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--setup] [--no-captive] [--stations N] [--uplink] [--run-for SECONDS]\n"
+            "  --setup        serve the setup (Wi-Fi config) portal instead of the lab portal\n"
+            "  --no-captive   forward every DNS query instead of hijacking probes\n"
+            "  --stations N   simulate N phones joined to the AP (127.0.0.2..)\n"
+            "  --uplink       run the uplink monitor's probes from this host (ICMP needs root)\n"
+            "  --run-for S    exit cleanly after S seconds (default: until SIGINT)\n"
+            "env: LABPORTAL_STATE_DIR, LABPORTAL_PORT_OFFSET, LABPORTAL_WIFI_SCRIPT, LABPORTAL_LOG_LEVEL\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    bool captive = true;
+    int stations = 0;
+    int run_for = 0;
+    bool uplink = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--setup") == 0) {
+            setup_mode = true;
+        } else if (strcmp(argv[i], "--no-captive") == 0) {
+            captive = false;
+        } else if (strcmp(argv[i], "--stations") == 0 && i + 1 < argc) {
+            stations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--uplink") == 0) {
+            uplink = true;
+        } else if (strcmp(argv[i], "--run-for") == 0 && i + 1 < argc) {
+            run_for = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGHUP, on_reload);
+    signal(SIGPIPE, SIG_IGN);
+
+    log_capture_init();
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS file unreadable, starting fresh");
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // Restores approvals from nvs.bin, so restarts keep phones signed in
+    client_table_init();
+    dhcp_leases_init(NULL);   // Stations bring their own addresses, no server to configure
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    ESP_ERROR_CHECK(event_worker_init());
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, ap_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, ap_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, ap_event_handler, NULL));
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
+    wifi_sta_init();   // Joins the saved network if the Wi-Fi script lists it
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    // Channel the AP would come up on, scored from the scripted scan
+    channel_plan_init();
+    wifi_config_t ap_config = { .ap = { .channel = channel_plan_select() } };
+    esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+
+    tcp_debug_init();
+    if (visitor_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Visitor log unavailable");
+    }
+
+    // No forward path on the host, so /api/clients stays empty
+    client_stats_init(ESP_IP4TOADDR(127, 0, 0, 0));
+    shaper_init();
+    mss_clamp_init();
+    napt_monitor_init();
+    uplink_monitor_init();
+    bench_server_init();
+    mdns_responder_init();   // Answers on 5353 once the scripted uplink comes up
+    fleet_sync_init(10);   // AP_MAX_CONN in src/main.c
+    admission_init(10);   // AP_MAX_CONN in src/main.c
+    uplink_monitor_set_link(uplink);
+
+    dns_set_captive_mode(captive);
+    dns_server_start();
+    start_captive_portal();
+    ESP_LOGI(TAG, "✓ Serving %s portal (captive DNS %s)", setup_mode ? "SETUP" : "LABORATORY",
+             captive ? "on" : "off");
+
+    // Simulated phones take the loopback addresses a storm run binds to
+    for (int i = 0; i < stations; i++) {
+        uint8_t mac[6] = {0x02, 0x11, 0x22, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+        host_wifi_station_join(mac, ESP_IP4TOADDR(127, 0, (i + 2) >> 8, (i + 2) & 0xff));
+    }
+
+    int elapsed = 0;
+    while (!stop_requested && (run_for == 0 || elapsed < run_for)) {
+        sleep(1);
+        elapsed++;
+        if (reload_requested) {
+            reload_requested = 0;
+            host_wifi_reload_script();
+        }
+    }
+
+    ESP_LOGI(TAG, "Shutting down");
+    stop_captive_portal();
+    dns_server_stop();
+    visitor_log_flush();
+    client_table_flush();
+    return 0;
+}
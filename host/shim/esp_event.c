@@ -0,0 +1,192 @@
+// Default event loop: posted events are copied into a queue and dispatched in order
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EVENT_QUEUE_LEN 32
+
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+struct host_event_instance {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+    struct host_event_instance *next;
+};
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    void *data;
+} posted_event_t;
+
+static pthread_mutex_t event_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct host_event_instance *handlers;
+static struct host_event_instance **handlers_tail = &handlers;
+static QueueHandle_t event_queue;
+
+static void event_task(void *arg)
+{
+    (void)arg;
+    posted_event_t ev;
+    while (1) {
+        if (xQueueReceive(event_queue, &ev, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        pthread_mutex_lock(&event_lock);
+        struct host_event_instance *h = handlers;
+        pthread_mutex_unlock(&event_lock);
+
+        // Handlers are only appended, so the list can be walked unlocked
+        for (; h; h = h->next) {
+            bool base_match = h->base == ESP_EVENT_ANY_BASE || strcmp(h->base, ev.base) == 0;
+            if (base_match && (h->id == ESP_EVENT_ANY_ID || h->id == ev.id) && h->handler) {
+                h->handler(h->arg, ev.base, ev.id, ev.data);
+            }
+        }
+        free(ev.data);
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    if (event_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    event_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(posted_event_t));
+    if (!event_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    return xTaskCreate(event_task, "sys_evt", 2304, NULL, 20, NULL) == pdPASS ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id,
+                                              esp_event_handler_t handler, void *arg,
+                                              esp_event_handler_instance_t *instance)
+{
+    struct host_event_instance *h = calloc(1, sizeof(*h));
+    if (!h) {
+        return ESP_ERR_NO_MEM;
+    }
+    h->base = base;
+    h->id = id;
+    h->handler = handler;
+    h->arg = arg;
+
+    pthread_mutex_lock(&event_lock);
+    *handlers_tail = h;
+    handlers_tail = &h->next;
+    pthread_mutex_unlock(&event_lock);
+    if (instance) {
+        *instance = h;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id,
+                                     esp_event_handler_t handler, void *arg)
+{
+    return esp_event_handler_instance_register(base, id, handler, arg, NULL);
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id,
+                                       esp_event_handler_t handler)
+{
+    // Entries stay linked (the dispatcher walks unlocked); just disarm them
+    pthread_mutex_lock(&event_lock);
+    for (struct host_event_instance *h = handlers; h; h = h->next) {
+        if (h->base == base && h->id == id && h->handler == handler) {
+            h->handler = NULL;
+        }
+    }
+    pthread_mutex_unlock(&event_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data,
+                         size_t size, TickType_t ticks)
+{
+    if (!event_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    posted_event_t ev = { .base = base, .id = id, .data = NULL };
+    if (data && size) {
+        ev.data = malloc(size);
+        if (!ev.data) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(ev.data, data, size);
+    }
+    if (xQueueSend(event_queue, &ev, ticks) != pdPASS) {
+        free(ev.data);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+// AP addressing as on the device; options only take while the server is stopped
+static bool dhcps_started = false;
+static uint32_t dhcps_lease_time = 120;
+static dhcps_lease_t dhcps_range;
+
+// One AP, no handles: the calls below ignore the netif they are given
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key)
+{
+    (void)if_key;
+    return NULL;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info)
+{
+    (void)esp_netif;
+    IP4_ADDR(&ip_info->ip, 192, 168, 4, 1);
+    IP4_ADDR(&ip_info->gw, 192, 168, 4, 1);
+    IP4_ADDR(&ip_info->netmask, 255, 255, 255, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcps_start(esp_netif_t *esp_netif)
+{
+    (void)esp_netif;
+    dhcps_started = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *esp_netif)
+{
+    (void)esp_netif;
+    dhcps_started = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcps_option(esp_netif_t *esp_netif, esp_netif_dhcp_option_mode_t opt_op,
+                                 esp_netif_dhcp_option_id_t opt_id, void *opt_val, uint32_t opt_len)
+{
+    (void)esp_netif;
+    void *stored = opt_id == ESP_NETIF_IP_ADDRESS_LEASE_TIME ? (void *)&dhcps_lease_time :
+                   opt_id == ESP_NETIF_REQUESTED_IP_ADDRESS ? (void *)&dhcps_range : NULL;
+    uint32_t size = opt_id == ESP_NETIF_IP_ADDRESS_LEASE_TIME ? sizeof(dhcps_lease_time) : sizeof(dhcps_range);
+    if (!stored || opt_len != size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (opt_op == ESP_NETIF_OP_GET) {
+        memcpy(opt_val, stored, size);
+        return ESP_OK;
+    }
+    if (dhcps_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memcpy(stored, opt_val, size);
+    return ESP_OK;
+}
@@ -0,0 +1,737 @@
+// Minimal esp_http_server: one server thread, select() over the listen socket and
+// every open session, handlers run to completion one at a time
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "httpd_shim";
+
+#define HTTPD_MAX_EXTRA_HDRS 8
+
+typedef struct {
+    int fd;
+    uint64_t last_used;     // LRU stamp
+} httpd_session_t;
+
+typedef struct {
+    httpd_config_t config;
+    int listen_fd;
+    int wake_pipe[2];
+    volatile bool stopping;
+    pthread_t thread;
+    httpd_uri_t *handlers;
+    int handler_count;
+    httpd_err_handler_func_t err_handlers[HTTPD_ERR_CODE_MAX];
+    httpd_session_t *sessions;
+    uint64_t lru_counter;
+} httpd_server_t;
+
+typedef struct {
+    int fd;
+    char hdr[HTTPD_MAX_REQ_HDR_LEN];
+    size_t hdr_len;             // Bytes of the header block (through the blank line)
+    const char *fields;         // First header line
+    char body[HTTPD_MAX_REQ_HDR_LEN];   // Body bytes that arrived with the headers
+    size_t body_len;
+    size_t body_pos;
+    size_t remaining;           // Body bytes not yet handed to the handler
+    bool keep_alive;
+    bool headers_sent;
+    bool chunked;
+    char status[48];
+    char type[64];
+    struct {
+        const char *field;
+        const char *value;
+    } extra[HTTPD_MAX_EXTRA_HDRS];
+    int extra_count;
+} httpd_req_aux_t;
+
+static const char *status_for_error(httpd_err_code_t code, const char **msg)
+{
+    switch (code) {
+    case HTTPD_501_METHOD_NOT_IMPLEMENTED:
+        *msg = "Request method is not supported by server";
+        return "501 Method Not Implemented";
+    case HTTPD_505_VERSION_NOT_SUPPORTED:
+        *msg = "HTTP version not supported by server";
+        return "505 Version Not Supported";
+    case HTTPD_400_BAD_REQUEST:
+        *msg = "Bad request syntax";
+        return "400 Bad Request";
+    case HTTPD_401_UNAUTHORIZED:
+        *msg = "No permission -- see authorization schemes";
+        return "401 Unauthorized";
+    case HTTPD_403_FORBIDDEN:
+        *msg = "Request forbidden -- authorization will not help";
+        return "403 Forbidden";
+    case HTTPD_404_NOT_FOUND:
+        *msg = "Nothing matches the given URI";
+        return "404 Not Found";
+    case HTTPD_405_METHOD_NOT_ALLOWED:
+        *msg = "Specified method is invalid for this resource";
+        return "405 Method Not Allowed";
+    case HTTPD_408_REQ_TIMEOUT:
+        *msg = "Server closed this connection";
+        return "408 Request Timeout";
+    case HTTPD_411_LENGTH_REQUIRED:
+        *msg = "Client must specify Content-Length";
+        return "411 Length Required";
+    case HTTPD_414_URI_TOO_LONG:
+        *msg = "URI is too long";
+        return "414 URI Too Long";
+    case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE:
+        *msg = "Header fields are too long";
+        return "431 Request Header Fields Too Large";
+    default:
+        *msg = "Server has encountered an unexpected error";
+        return "500 Internal Server Error";
+    }
+}
+
+static int send_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static void set_timeouts(int fd, const httpd_config_t *config)
+{
+    struct timeval rcv = { .tv_sec = config->recv_wait_timeout };
+    struct timeval snd = { .tv_sec = config->send_wait_timeout };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &rcv, sizeof(rcv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &snd, sizeof(snd));
+}
+
+// ---------------------------------------------------------------------------
+// Request side
+
+static const char *find_header(const httpd_req_aux_t *aux, const char *field, size_t *value_len)
+{
+    size_t field_len = strlen(field);
+    const char *line = aux->fields;
+    const char *end = aux->hdr + aux->hdr_len;
+
+    while (line && line < end) {
+        const char *eol = strstr(line, "\r\n");
+        if (!eol || eol == line) break;
+        if ((size_t)(eol - line) > field_len && line[field_len] == ':' &&
+            strncasecmp(line, field, field_len) == 0) {
+            const char *v = line + field_len + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) v++;
+            const char *v_end = eol;
+            while (v_end > v && (v_end[-1] == ' ' || v_end[-1] == '\t')) v_end--;
+            *value_len = (size_t)(v_end - v);
+            return v;
+        }
+        line = eol + 2;
+    }
+    return NULL;
+}
+
+static int parse_method(const char *s, size_t len)
+{
+    static const char *const names[] = {"DELETE", "GET", "HEAD", "POST", "PUT", "CONNECT", "OPTIONS", "TRACE"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strlen(names[i]) == len && memcmp(names[i], s, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Read one request head; returns an error code to answer with, or -1 to drop the connection
+static int read_request(httpd_req_t *req, httpd_req_aux_t *aux)
+{
+    char *term = NULL;
+    while (!term) {
+        if (aux->hdr_len >= sizeof(aux->hdr) - 1) {
+            return HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE;
+        }
+        ssize_t n = recv(aux->fd, aux->hdr + aux->hdr_len, sizeof(aux->hdr) - 1 - aux->hdr_len, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return (n < 0 && errno == EAGAIN && aux->hdr_len > 0) ? HTTPD_408_REQ_TIMEOUT : -1;
+        }
+        aux->hdr_len += (size_t)n;
+        aux->hdr[aux->hdr_len] = '\0';
+        term = strstr(aux->hdr, "\r\n\r\n");
+    }
+
+    size_t head_len = (size_t)(term - aux->hdr) + 4;
+    aux->body_len = aux->hdr_len - head_len;
+    memcpy(aux->body, term + 4, aux->body_len);
+    aux->hdr_len = head_len;
+    aux->hdr[head_len] = '\0';
+
+    // Request line: METHOD SP URI SP VERSION
+    const char *sp1 = memchr(aux->hdr, ' ', head_len);
+    const char *eol = strstr(aux->hdr, "\r\n");
+    const char *sp2 = sp1 ? memchr(sp1 + 1, ' ', (size_t)(eol - sp1 - 1)) : NULL;
+    if (!sp1 || !sp2 || sp2 > eol) {
+        return HTTPD_400_BAD_REQUEST;
+    }
+    req->method = parse_method(aux->hdr, (size_t)(sp1 - aux->hdr));
+    if (req->method < 0) {
+        return HTTPD_501_METHOD_NOT_IMPLEMENTED;
+    }
+    size_t uri_len = (size_t)(sp2 - sp1 - 1);
+    if (uri_len > HTTPD_MAX_URI_LEN) {
+        return HTTPD_414_URI_TOO_LONG;
+    }
+    memcpy((char *)req->uri, sp1 + 1, uri_len);
+    ((char *)req->uri)[uri_len] = '\0';
+    aux->fields = eol + 2;
+
+    bool http10 = strncmp(sp2 + 1, "HTTP/1.0", 8) == 0;
+    size_t len;
+    const char *conn = find_header(aux, "Connection", &len);
+    aux->keep_alive = conn ? !(len == 5 && strncasecmp(conn, "close", 5) == 0) : !http10;
+
+    const char *cl = find_header(aux, "Content-Length", &len);
+    req->content_len = cl ? strtoul(cl, NULL, 10) : 0;
+    if (aux->body_len > req->content_len) {
+        aux->body_len = req->content_len;   // Pipelined requests are not supported
+    }
+    aux->remaining = req->content_len;
+    return HTTPD_ERR_CODE_MAX;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    httpd_req_aux_t *aux = r->aux;
+    if (buf_len > aux->remaining) {
+        buf_len = aux->remaining;
+    }
+    if (buf_len == 0) {
+        return 0;
+    }
+
+    if (aux->body_pos < aux->body_len) {
+        size_t n = aux->body_len - aux->body_pos;
+        if (n > buf_len) n = buf_len;
+        memcpy(buf, aux->body + aux->body_pos, n);
+        aux->body_pos += n;
+        aux->remaining -= n;
+        return (int)n;
+    }
+
+    while (1) {
+        ssize_t n = recv(aux->fd, buf, buf_len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return HTTPD_SOCK_ERR_TIMEOUT;
+        if (n <= 0) return HTTPD_SOCK_ERR_FAIL;
+        aux->remaining -= (size_t)n;
+        return (int)n;
+    }
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return r ? ((httpd_req_aux_t *)r->aux)->fd : -1;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    size_t len = 0;
+    return find_header(r->aux, field, &len) ? len : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    size_t len = 0;
+    const char *v = find_header(r->aux, field, &len);
+    if (!v) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (val_size == 0) {
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, v, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    const char *q = strchr(r->uri, '?');
+    return q ? strlen(q + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    const char *q = strchr(r->uri, '?');
+    if (!q) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!buf || buf_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = strlen(q + 1);
+    size_t n = len < buf_len - 1 ? len : buf_len - 1;
+    memcpy(buf, q + 1, n);
+    buf[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    if (!qry || !key || !val || val_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t key_len = strlen(key);
+    const char *p = qry;
+    while (*p) {
+        const char *pair_end = strchr(p, '&');
+        if (!pair_end) pair_end = p + strlen(p);
+        const char *eq = memchr(p, '=', (size_t)(pair_end - p));
+        if (eq && (size_t)(eq - p) == key_len && memcmp(p, key, key_len) == 0) {
+            size_t len = (size_t)(pair_end - eq - 1);
+            size_t n = len < val_size - 1 ? len : val_size - 1;
+            memcpy(val, eq + 1, n);
+            val[n] = '\0';
+            return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        p = *pair_end ? pair_end + 1 : pair_end;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// ---------------------------------------------------------------------------
+// Response side
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    httpd_req_aux_t *aux = r->aux;
+    snprintf(aux->status, sizeof(aux->status), "%s", status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    httpd_req_aux_t *aux = r->aux;
+    snprintf(aux->type, sizeof(aux->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    // Like the IDF server, field/value are not copied and must outlive the send
+    httpd_req_aux_t *aux = r->aux;
+    if (aux->extra_count >= HTTPD_MAX_EXTRA_HDRS) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    aux->extra[aux->extra_count].field = field;
+    aux->extra[aux->extra_count].value = value;
+    aux->extra_count++;
+    return ESP_OK;
+}
+
+static esp_err_t send_head(httpd_req_aux_t *aux, const char *length_hdr)
+{
+    char head[1024];
+    int len = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\n%s\r\n",
+                       aux->status, aux->type, length_hdr);
+    for (int i = 0; i < aux->extra_count && len < (int)sizeof(head); i++) {
+        len += snprintf(head + len, sizeof(head) - len, "%s: %s\r\n",
+                        aux->extra[i].field, aux->extra[i].value);
+    }
+    if (!aux->keep_alive && len < (int)sizeof(head)) {
+        len += snprintf(head + len, sizeof(head) - len, "Connection: close\r\n");
+    }
+    if (len >= (int)sizeof(head) - 2) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    len += snprintf(head + len, sizeof(head) - len, "\r\n");
+    aux->headers_sent = true;
+    return send_all(aux->fd, head, (size_t)len) == 0 ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    httpd_req_aux_t *aux = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    char length_hdr[48];
+    snprintf(length_hdr, sizeof(length_hdr), "Content-Length: %d", (int)buf_len);
+    esp_err_t err = send_head(aux, length_hdr);
+    if (err == ESP_OK && buf_len > 0 && send_all(aux->fd, buf, (size_t)buf_len) != 0) {
+        err = ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    httpd_req_aux_t *aux = r->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? (ssize_t)strlen(buf) : 0;
+    }
+    if (!aux->headers_sent) {
+        aux->chunked = true;
+        esp_err_t err = send_head(aux, "Transfer-Encoding: chunked");
+        if (err != ESP_OK) return err;
+    }
+
+    char size_line[16];
+    int n = snprintf(size_line, sizeof(size_line), "%x\r\n", (unsigned)buf_len);
+    if (send_all(aux->fd, size_line, (size_t)n) != 0 ||
+        (buf_len > 0 && send_all(aux->fd, buf, (size_t)buf_len) != 0) ||
+        send_all(aux->fd, "\r\n", 2) != 0) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+    return httpd_resp_send(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str)
+{
+    return httpd_resp_send_chunk(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *usr_msg)
+{
+    const char *msg;
+    const char *status = status_for_error(error, &msg);
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "text/html");
+    // Error responses end the session, as on the device
+    ((httpd_req_aux_t *)req->aux)->keep_alive = false;
+    return httpd_resp_send(req, usr_msg ? usr_msg : msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// ---------------------------------------------------------------------------
+// Server
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    size_t tpl_len = strlen(uri_template);
+    size_t exact_len = tpl_len;
+    bool wildcard = false;
+    bool optional = false;
+
+    if (exact_len > 0 && uri_template[exact_len - 1] == '*') {
+        wildcard = true;
+        exact_len--;
+    }
+    if (exact_len > 0 && uri_template[exact_len - 1] == '?') {
+        optional = true;    // Last character before '?' may be absent
+        exact_len--;
+    }
+
+    if (optional && match_upto == exact_len - 1 &&
+        strncmp(uri_template, uri_to_match, match_upto) == 0) {
+        return true;
+    }
+    if (match_upto < exact_len || strncmp(uri_template, uri_to_match, exact_len) != 0) {
+        return false;
+    }
+    return wildcard || match_upto == exact_len;
+}
+
+static bool uri_matches(const httpd_server_t *server, const char *tpl, const char *uri)
+{
+    size_t len = strcspn(uri, "?");
+    if (server->config.uri_match_fn) {
+        return server->config.uri_match_fn(tpl, uri, len);
+    }
+    return strlen(tpl) == len && strncmp(tpl, uri, len) == 0;
+}
+
+static esp_err_t send_error(httpd_server_t *server, httpd_req_t *req, httpd_err_code_t code)
+{
+    if (server->err_handlers[code]) {
+        return server->err_handlers[code](req, code);
+    }
+    httpd_resp_send_err(req, code, NULL);
+    return ESP_FAIL;
+}
+
+// Serve one request on a readable session; false = close the session
+static bool serve_request(httpd_server_t *server, int fd)
+{
+    httpd_req_t req;
+    httpd_req_aux_t *aux = calloc(1, sizeof(*aux));
+    if (!aux) {
+        return false;
+    }
+    memset(&req, 0, sizeof(req));
+    req.handle = server;
+    req.aux = aux;
+    aux->fd = fd;
+    aux->keep_alive = true;
+    strcpy(aux->status, "200 OK");
+    strcpy(aux->type, "text/html");
+
+    bool keep = false;
+    int code = read_request(&req, aux);
+    if (code < 0) {
+        keep = false;
+    } else if (code != HTTPD_ERR_CODE_MAX) {
+        send_error(server, &req, (httpd_err_code_t)code);
+        keep = false;
+    } else {
+        const httpd_uri_t *handler = NULL;
+        bool other_method = false;
+        for (int i = 0; i < server->handler_count; i++) {
+            if (!uri_matches(server, server->handlers[i].uri, req.uri)) continue;
+            if ((int)server->handlers[i].method == req.method) {
+                handler = &server->handlers[i];
+                break;
+            }
+            other_method = true;
+        }
+
+        esp_err_t result;
+        if (handler) {
+            req.user_ctx = handler->user_ctx;
+            result = handler->handler(&req);
+        } else {
+            result = send_error(server, &req, other_method ? HTTPD_405_METHOD_NOT_ALLOWED
+                                                           : HTTPD_404_NOT_FOUND);
+        }
+
+        // Discard any body the handler did not read so the next request parses cleanly
+        char sink[256];
+        while (result == ESP_OK && aux->remaining > 0) {
+            if (httpd_req_recv(&req, sink, sizeof(sink)) <= 0) {
+                result = ESP_FAIL;
+            }
+        }
+        keep = (result == ESP_OK) && aux->keep_alive;
+    }
+
+    free(aux);
+    return keep;
+}
+
+static void close_session(httpd_session_t *s)
+{
+    if (s->fd >= 0) {
+        close(s->fd);
+        s->fd = -1;
+    }
+}
+
+static void accept_session(httpd_server_t *server)
+{
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    httpd_session_t *slot = NULL;
+    httpd_session_t *lru = NULL;
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        httpd_session_t *s = &server->sessions[i];
+        if (s->fd < 0) {
+            slot = s;
+            break;
+        }
+        if (!lru || s->last_used < lru->last_used) {
+            lru = s;
+        }
+    }
+    if (!slot && server->config.lru_purge_enable && lru) {
+        ESP_LOGD(TAG, "LRU purge of fd %d", lru->fd);
+        close_session(lru);
+        slot = lru;
+    }
+    if (!slot) {
+        ESP_LOGW(TAG, "No free session slot, rejecting fd %d", fd);
+        close(fd);
+        return;
+    }
+
+    if (server->config.open_fn && server->config.open_fn(server, fd) != ESP_OK) {
+        close(fd);
+        return;
+    }
+    set_timeouts(fd, &server->config);
+    slot->fd = fd;
+    slot->last_used = ++server->lru_counter;
+}
+
+static void *server_thread(void *arg)
+{
+    httpd_server_t *server = arg;
+
+    while (!server->stopping) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(server->listen_fd, &readable);
+        FD_SET(server->wake_pipe[0], &readable);
+        int max_fd = server->listen_fd > server->wake_pipe[0] ? server->listen_fd : server->wake_pipe[0];
+        for (int i = 0; i < server->config.max_open_sockets; i++) {
+            int fd = server->sessions[i].fd;
+            if (fd >= 0) {
+                FD_SET(fd, &readable);
+                if (fd > max_fd) max_fd = fd;
+            }
+        }
+
+        if (select(max_fd + 1, &readable, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) continue;
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
+            break;
+        }
+        if (server->stopping) {
+            break;
+        }
+
+        for (int i = 0; i < server->config.max_open_sockets; i++) {
+            httpd_session_t *s = &server->sessions[i];
+            if (s->fd >= 0 && FD_ISSET(s->fd, &readable)) {
+                s->last_used = ++server->lru_counter;
+                if (!serve_request(server, s->fd)) {
+                    close_session(s);
+                }
+            }
+        }
+        if (FD_ISSET(server->listen_fd, &readable)) {
+            accept_session(server);
+        }
+    }
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (!handle || !config || config->max_open_sockets == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_server_t *server = calloc(1, sizeof(*server));
+    if (!server) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    server->config = *config;
+    server->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    server->sessions = calloc(config->max_open_sockets, sizeof(httpd_session_t));
+    if (!server->handlers || !server->sessions || pipe(server->wake_pipe) != 0) {
+        free(server->handlers);
+        free(server->sessions);
+        free(server);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    for (int i = 0; i < config->max_open_sockets; i++) {
+        server->sessions[i].fd = -1;
+    }
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->server_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (server->listen_fd < 0 ||
+        bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, config->backlog_conn) != 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %u: errno %d",
+                 host_port_remap(config->server_port), errno);
+        if (server->listen_fd >= 0) close(server->listen_fd);
+        close(server->wake_pipe[0]);
+        close(server->wake_pipe[1]);
+        free(server->handlers);
+        free(server->sessions);
+        free(server);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    if (pthread_create(&server->thread, NULL, server_thread, server) != 0) {
+        close(server->listen_fd);
+        close(server->wake_pipe[0]);
+        close(server->wake_pipe[1]);
+        free(server->handlers);
+        free(server->sessions);
+        free(server);
+        return ESP_ERR_HTTPD_TASK;
+    }
+    pthread_setname_np(server->thread, "httpd");
+
+    ESP_LOGI(TAG, "Listening on port %u", host_port_remap(config->server_port));
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    httpd_server_t *server = handle;
+    if (!server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    server->stopping = true;
+    if (write(server->wake_pipe[1], "x", 1) < 0) {
+        ESP_LOGW(TAG, "Wake pipe write failed");
+    }
+    if (pthread_equal(pthread_self(), server->thread)) {
+        // Stopped from inside a handler: the loop exits once the handler returns.
+        // The server struct is leaked in that case (same lifetime as the process)
+        pthread_detach(server->thread);
+        return ESP_OK;
+    }
+    pthread_join(server->thread, NULL);
+
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        close_session(&server->sessions[i]);
+    }
+    close(server->listen_fd);
+    close(server->wake_pipe[0]);
+    close(server->wake_pipe[1]);
+    free(server->handlers);
+    free(server->sessions);
+    free(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    httpd_server_t *server = handle;
+    if (!server || !uri_handler || !uri_handler->uri || !uri_handler->handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < server->handler_count; i++) {
+        if (server->handlers[i].method == uri_handler->method &&
+            strcmp(server->handlers[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->handler_count >= server->config.max_uri_handlers) {
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    server->handlers[server->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t error,
+                                     httpd_err_handler_func_t handler_fn)
+{
+    httpd_server_t *server = handle;
+    if (!server || error >= HTTPD_ERR_CODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    server->err_handlers[error] = handler_fn;
+    return ESP_OK;
+}
@@ -0,0 +1,153 @@
+// Data partitions as sparse files with NOR-flash semantics, and inert OTA ops
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "shim_internal.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define HOST_PARTITION_SIZE     (256 * 1024)
+#define HOST_PARTITION_SECTOR   4096
+#define HOST_MAX_PARTITIONS     4
+
+static pthread_mutex_t part_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_partition_t partitions[HOST_MAX_PARTITIONS];
+static int partition_count;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    if (type != ESP_PARTITION_TYPE_DATA || !label) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&part_lock);
+    for (int i = 0; i < partition_count; i++) {
+        if (strcmp(partitions[i].label, label) == 0) {
+            pthread_mutex_unlock(&part_lock);
+            return &partitions[i];
+        }
+    }
+    if (partition_count == HOST_MAX_PARTITIONS) {
+        pthread_mutex_unlock(&part_lock);
+        return NULL;
+    }
+
+    char name[64], path[512];
+    snprintf(name, sizeof(name), "%s.part", label);
+    host_state_path(name, path, sizeof(path));
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        pthread_mutex_unlock(&part_lock);
+        return NULL;
+    }
+    // A fresh partition reads as erased flash (0xFF)
+    if (lseek(fd, 0, SEEK_END) < HOST_PARTITION_SIZE) {
+        uint8_t *blank = malloc(HOST_PARTITION_SIZE);
+        memset(blank, 0xFF, HOST_PARTITION_SIZE);
+        pwrite(fd, blank, HOST_PARTITION_SIZE, 0);
+        free(blank);
+    }
+
+    esp_partition_t *part = &partitions[partition_count++];
+    part->type = type;
+    part->subtype = subtype;
+    part->address = 0x300000 + (uint32_t)(partition_count - 1) * HOST_PARTITION_SIZE;
+    part->size = HOST_PARTITION_SIZE;
+    strncpy(part->label, label, sizeof(part->label) - 1);
+    part->fd = fd;
+    pthread_mutex_unlock(&part_lock);
+    return part;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    if (!part || offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return pread(part->fd, dst, size, offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    if (!part || offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // NOR flash can only clear bits: AND with the current contents
+    uint8_t *merged = malloc(size);
+    if (!merged) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (pread(part->fd, merged, size, offset) != (ssize_t)size) {
+        free(merged);
+        return ESP_FAIL;
+    }
+    for (size_t i = 0; i < size; i++) {
+        merged[i] &= ((const uint8_t *)src)[i];
+    }
+    esp_err_t err = pwrite(part->fd, merged, size, offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+    free(merged);
+    return err;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (!part || offset + size > part->size ||
+        offset % HOST_PARTITION_SECTOR || size % HOST_PARTITION_SECTOR) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t blank[HOST_PARTITION_SECTOR];
+    memset(blank, 0xFF, sizeof(blank));
+    for (size_t done = 0; done < size; done += sizeof(blank)) {
+        if (pwrite(part->fd, blank, sizeof(blank), offset + done) != (ssize_t)sizeof(blank)) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+// The host has no app slots: firmware upload fails before anything is written
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    (void)start_from;
+    return NULL;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    (void)partition;
+    (void)image_size;
+    (void)out_handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    (void)handle;
+    (void)data;
+    (void)size;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    (void)partition;
+    return ESP_ERR_NOT_SUPPORTED;
+}
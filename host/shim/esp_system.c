@@ -0,0 +1,161 @@
+// esp_log, esp_err_to_name, esp_system and esp_mac on the host
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "shim_internal.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static vprintf_like_t log_vprintf = vprintf;
+static esp_log_level_t log_level = ESP_LOG_INFO;
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+
+static void log_level_from_env(void)
+{
+    // LABPORTAL_LOG_LEVEL=0..5 (NONE..VERBOSE), default INFO like the firmware
+    const char *env = getenv("LABPORTAL_LOG_LEVEL");
+    if (env && *env >= '0' && *env <= '5') {
+        log_level = (esp_log_level_t)(*env - '0');
+    }
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t previous = log_vprintf;
+    log_vprintf = func ? func : vprintf;
+    return previous;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    // Per-tag levels are not modelled; "*" sets the global level
+    if (tag && strcmp(tag, "*") == 0) {
+        pthread_once(&log_once, log_level_from_env);
+        log_level = level;
+    }
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)tag;
+    pthread_once(&log_once, log_level_from_env);
+    if (level > log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    log_vprintf(format, args);
+    va_end(args);
+    fflush(stdout);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC:       return "ESP_ERR_INVALID_MAC";
+    case ESP_ERR_NOT_FINISHED:      return "ESP_ERR_NOT_FINISHED";
+    case 0x1102:                    return "ESP_ERR_NVS_NOT_FOUND";
+    case 0x1103:                    return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case 0x110c:                    return "ESP_ERR_NVS_INVALID_LENGTH";
+    default:                        return "UNKNOWN ERROR";
+    }
+}
+
+// Same limit as the IDF's shutdown handler table
+#define SHUTDOWN_HANDLERS_NO 5
+static shutdown_handler_t shutdown_handlers[SHUTDOWN_HANDLERS_NO];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    for (int i = 0; i < SHUTDOWN_HANDLERS_NO; i++) {
+        if (shutdown_handlers[i] == handle) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (shutdown_handlers[i] == NULL) {
+            shutdown_handlers[i] = handle;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_restart(void)
+{
+    for (int i = SHUTDOWN_HANDLERS_NO - 1; i >= 0; i--) {
+        if (shutdown_handlers[i]) {
+            shutdown_handlers[i]();
+        }
+    }
+    ESP_LOGW("host", "esp_restart() - exiting");
+    exit(3);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    // Roughly what the firmware reports with the AP and portal running
+    return 180 * 1024;
+}
+
+uint32_t esp_random(void)
+{
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+void esp_fill_random(void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    for (size_t i = 0; i < len; i++) {
+        p[i] = (uint8_t)esp_random();
+    }
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 150 * 1024;
+}
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac)
+{
+    static const uint8_t host_mac[6] = {0x02, 0x4c, 0x41, 0x42, 0x00, 0x01};  // Locally administered
+    memcpy(mac, host_mac, sizeof(host_mac));
+    return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    esp_efuse_mac_get_default(mac);
+    if (type == ESP_MAC_WIFI_SOFTAP) {
+        mac[5]++;
+    }
+    return ESP_OK;
+}
+
+void host_state_path(const char *name, char *out, size_t out_size)
+{
+    const char *dir = getenv("LABPORTAL_STATE_DIR");
+    snprintf(out, out_size, "%s/%s", (dir && *dir) ? dir : ".", name);
+}
@@ -0,0 +1,167 @@
+// esp_timer: callbacks run on one dispatch thread, like ESP_TIMER_TASK
+#include "esp_timer.h"
+#include "shim_internal.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t expiry_us;
+    uint64_t period_us;     // 0 = one-shot
+    bool armed;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static struct esp_timer *timers;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void *timer_thread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&timer_lock);
+    while (1) {
+        struct esp_timer *due = NULL;
+        int64_t next = INT64_MAX;
+        int64_t now = esp_timer_get_time();
+
+        for (struct esp_timer *t = timers; t; t = t->next) {
+            if (!t->armed) continue;
+            if (t->expiry_us <= now) {
+                due = t;
+                break;
+            }
+            if (t->expiry_us < next) next = t->expiry_us;
+        }
+
+        if (due) {
+            if (due->period_us) {
+                due->expiry_us += due->period_us;
+            } else {
+                due->armed = false;
+            }
+            esp_timer_cb_t cb = due->callback;
+            void *cb_arg = due->arg;
+            pthread_mutex_unlock(&timer_lock);
+            cb(cb_arg);
+            pthread_mutex_lock(&timer_lock);
+            continue;
+        }
+
+        if (next == INT64_MAX) {
+            pthread_cond_wait(&timer_cond, &timer_lock);
+        } else {
+            struct timespec ts = { .tv_sec = next / 1000000, .tv_nsec = (next % 1000000) * 1000 };
+            pthread_cond_timedwait(&timer_cond, &timer_lock, &ts);
+        }
+    }
+    return NULL;
+}
+
+static void timer_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, timer_thread, NULL);
+    pthread_setname_np(thread, "esp_timer");
+    pthread_detach(thread);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_once(&timer_once, timer_init);
+
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = args->callback;
+    t->arg = args->arg;
+
+    pthread_mutex_lock(&timer_lock);
+    t->next = timers;
+    timers = t;
+    pthread_mutex_unlock(&timer_lock);
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    pthread_mutex_lock(&timer_lock);
+    if (t->armed) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->expiry_us = esp_timer_get_time() + (int64_t)timeout_us;
+    t->period_us = period_us;
+    t->armed = true;
+    pthread_cond_signal(&timer_cond);
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    bool was_armed = timer->armed;
+    timer->armed = false;
+    pthread_mutex_unlock(&timer_lock);
+    return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **pp = &timers; *pp; pp = &(*pp)->next) {
+        if (*pp == timer) {
+            *pp = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&timer_lock);
+    bool armed = timer->armed;
+    pthread_mutex_unlock(&timer_lock);
+    return armed;
+}
@@ -0,0 +1,435 @@
+// Scripted Wi-Fi driver: scan results and connect outcomes come from $LABPORTAL_WIFI_SCRIPT
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_MAX_APS 32
+
+static const char *TAG = "wifi_shim";
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+
+typedef struct {
+    wifi_ap_record_t record;
+    char password[64];
+} scripted_ap_t;
+
+static pthread_mutex_t wifi_lock = PTHREAD_MUTEX_INITIALIZER;
+static scripted_ap_t script_aps[SCRIPT_MAX_APS];
+static int script_ap_count;
+static bool script_loaded;
+static wifi_mode_t wifi_mode;
+static wifi_config_t sta_config;
+static wifi_config_t ap_config;
+static bool started;
+static int sta_connected_ap = -1;
+static uint16_t scan_count;
+static wifi_sta_list_t ap_stations;
+static uint8_t ap_channel = 1;
+
+static void script_load(void)
+{
+    if (script_loaded) {
+        return;
+    }
+    script_loaded = true;
+    script_ap_count = 0;
+
+    const char *path = getenv("LABPORTAL_WIFI_SCRIPT");
+    FILE *f = path ? fopen(path, "r") : NULL;
+    if (!f) {
+        if (path) {
+            ESP_LOGW(TAG, "Cannot open %s, radio environment is empty", path);
+        }
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) && script_ap_count < SCRIPT_MAX_APS) {
+        char ssid[33] = {0}, auth[16] = {0}, pass[64] = {0};
+        int rssi = 0, channel = 0;
+        if (line[0] == '#' ||
+            sscanf(line, "ap %32s %d %d %15s %63s", ssid, &rssi, &channel, auth, pass) < 4) {
+            continue;
+        }
+        scripted_ap_t *ap = &script_aps[script_ap_count];
+        memset(ap, 0, sizeof(*ap));
+        strncpy((char *)ap->record.ssid, ssid, sizeof(ap->record.ssid) - 1);
+        ap->record.rssi = (int8_t)rssi;
+        ap->record.primary = (uint8_t)channel;
+        ap->record.authmode = strcmp(auth, "open") == 0 ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK;
+        // Stable fake BSSID derived from the line number
+        uint8_t bssid[6] = {0x02, 0x00, 0x5e, 0x10, 0x00, (uint8_t)script_ap_count};
+        memcpy(ap->record.bssid, bssid, sizeof(bssid));
+        strncpy(ap->password, pass, sizeof(ap->password) - 1);
+        script_ap_count++;
+    }
+    fclose(f);
+    ESP_LOGI(TAG, "Loaded %d scripted APs from %s", script_ap_count, path);
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    (void)config;
+    pthread_mutex_lock(&wifi_lock);
+    script_load();
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    wifi_mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+    *mode = wifi_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    pthread_mutex_lock(&wifi_lock);
+    if (interface == WIFI_IF_STA) {
+        sta_config = *conf;
+    } else {
+        ap_config = *conf;
+        if (conf->ap.channel) {
+            ap_channel = conf->ap.channel;
+        }
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    pthread_mutex_lock(&wifi_lock);
+    *conf = (interface == WIFI_IF_STA) ? sta_config : ap_config;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    started = true;
+    if (wifi_mode == WIFI_MODE_STA || wifi_mode == WIFI_MODE_APSTA) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, portMAX_DELAY);
+    }
+    if (wifi_mode == WIFI_MODE_AP || wifi_mode == WIFI_MODE_APSTA) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, portMAX_DELAY);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    started = false;
+    sta_connected_ap = -1;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    if (!started) {
+        return ESP_ERR_WIFI_NOT_STARTED;
+    }
+
+    pthread_mutex_lock(&wifi_lock);
+    script_load();
+    int found = -1;
+    uint8_t reason = WIFI_REASON_NO_AP_FOUND;
+    for (int i = 0; i < script_ap_count; i++) {
+        if (strncmp((char *)script_aps[i].record.ssid, (char *)sta_config.sta.ssid, 32) != 0) continue;
+        if (sta_config.sta.bssid_set && memcmp(sta_config.sta.bssid, script_aps[i].record.bssid, 6) != 0) continue;
+        if (sta_config.sta.channel && sta_config.sta.channel != script_aps[i].record.primary) continue;
+        if (script_aps[i].record.authmode != WIFI_AUTH_OPEN &&
+            strncmp(script_aps[i].password, (char *)sta_config.sta.password, 64) != 0) {
+            reason = WIFI_REASON_AUTH_FAIL;
+            continue;
+        }
+        found = i;
+        break;
+    }
+    sta_connected_ap = found;
+    if (found >= 0) {
+        ap_channel = script_aps[found].record.primary;   // One radio: the AP moves with the STA
+    }
+    wifi_config_t conf = sta_config;
+    wifi_ap_record_t rec = found >= 0 ? script_aps[found].record : (wifi_ap_record_t){0};
+    pthread_mutex_unlock(&wifi_lock);
+
+    // The driver scans before associating: one channel when it is pinned, all 13 otherwise
+    if (!getenv("LABPORTAL_FAST_SCAN")) {
+        vTaskDelay(pdMS_TO_TICKS(conf.sta.channel ? 120 : 13 * 120));
+    }
+
+    if (found < 0) {
+        wifi_event_sta_disconnected_t ev = { .reason = reason };
+        memcpy(ev.ssid, conf.sta.ssid, sizeof(ev.ssid));
+        ev.ssid_len = (uint8_t)strnlen((char *)conf.sta.ssid, 32);
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &ev, sizeof(ev), portMAX_DELAY);
+        return ESP_OK;
+    }
+
+    wifi_event_sta_connected_t conn = { .channel = rec.primary, .authmode = rec.authmode, .aid = 1 };
+    memcpy(conn.ssid, rec.ssid, sizeof(conn.ssid));
+    conn.ssid_len = (uint8_t)strnlen((char *)rec.ssid, 32);
+    memcpy(conn.bssid, rec.bssid, 6);
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &conn, sizeof(conn), portMAX_DELAY);
+
+    ip_event_got_ip_t got = { .ip_changed = true };
+    IP4_ADDR(&got.ip_info.ip, 10, 0, 0, 50);
+    IP4_ADDR(&got.ip_info.netmask, 255, 255, 255, 0);
+    IP4_ADDR(&got.ip_info.gw, 10, 0, 0, 1);
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, &got, sizeof(got), portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    bool was_connected = sta_connected_ap >= 0;
+    sta_connected_ap = -1;
+    pthread_mutex_unlock(&wifi_lock);
+
+    if (was_connected) {
+        wifi_event_sta_disconnected_t ev = { .reason = WIFI_REASON_ASSOC_LEAVE };
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &ev, sizeof(ev), portMAX_DELAY);
+    }
+    return ESP_OK;
+}
+
+// A background scan reports SCAN_DONE once its airtime has passed
+static void *scan_done_later(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS((int)(intptr_t)arg));
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, NULL, 0, portMAX_DELAY);
+    return NULL;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    pthread_mutex_lock(&wifi_lock);
+    script_load();
+    scan_count = 0;
+    for (int i = 0; i < script_ap_count; i++) {
+        if (!config || config->channel == 0 || config->channel == script_aps[i].record.primary) {
+            scan_count++;
+        }
+    }
+    pthread_mutex_unlock(&wifi_lock);
+
+    // An all-channel active scan costs roughly this much airtime on the device
+    int dwell_ms = (config && config->channel) ? 120 : 13 * 120;
+    if (getenv("LABPORTAL_FAST_SCAN")) {
+        dwell_ms = 0;
+    }
+    if (!block) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, scan_done_later, (void *)(intptr_t)dwell_ms) != 0) {
+            return ESP_FAIL;
+        }
+        pthread_detach(thread);
+        return ESP_OK;
+    }
+    vTaskDelay(pdMS_TO_TICKS(dwell_ms));
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, NULL, 0, portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number)
+{
+    *number = scan_count;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records)
+{
+    pthread_mutex_lock(&wifi_lock);
+    uint16_t n = 0;
+    for (int i = 0; i < script_ap_count && n < *number; i++) {
+        records[n++] = script_aps[i].record;
+    }
+    *number = n;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *info)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t err = ESP_ERR_WIFI_CONN;
+    if (sta_connected_ap >= 0) {
+        *info = script_aps[sta_connected_ap].record;
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return err;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta)
+{
+    pthread_mutex_lock(&wifi_lock);
+    *sta = ap_stations;
+    pthread_mutex_unlock(&wifi_lock);
+    return ESP_OK;
+}
+
+// AIDs follow list position, matching esp_wifi_deauth_sta below
+esp_err_t esp_wifi_ap_get_sta_aid(const uint8_t mac[6], uint16_t *aid)
+{
+    pthread_mutex_lock(&wifi_lock);
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    for (int i = 0; i < ap_stations.num; i++) {
+        if (memcmp(ap_stations.sta[i].mac, mac, 6) == 0) {
+            *aid = (uint16_t)(i + 1);
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    return err;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second)
+{
+    (void)second;
+    if (primary < 1 || primary > 13) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ap_channel = primary;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second)
+{
+    *primary = ap_channel;
+    if (second) {
+        *second = WIFI_SECOND_CHAN_NONE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deauth_sta(uint16_t aid)
+{
+    pthread_mutex_lock(&wifi_lock);
+    uint8_t mac[6];
+    bool found = false;
+    for (int i = 0; i < ap_stations.num; i++) {
+        if (aid == 0 || aid == i + 1) {
+            memcpy(mac, ap_stations.sta[i].mac, 6);
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&wifi_lock);
+    if (found) {
+        host_wifi_station_leave(mac);
+    }
+    return ESP_OK;
+}
+
+// No radio to sniff: callers fall back to scan-only decisions
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb)
+{
+    (void)cb;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter)
+{
+    (void)filter;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable)
+{
+    (void)enable;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void host_wifi_station_join(const uint8_t mac[6], uint32_t ip)
+{
+    pthread_mutex_lock(&wifi_lock);
+    uint8_t aid = 0;
+    if (ap_stations.num < ESP_WIFI_MAX_CONN_NUM) {
+        memcpy(ap_stations.sta[ap_stations.num].mac, mac, 6);
+        ap_stations.sta[ap_stations.num].rssi = -45;
+        aid = (uint8_t)++ap_stations.num;
+    }
+    pthread_mutex_unlock(&wifi_lock);
+
+    wifi_event_ap_staconnected_t conn = { .aid = aid };
+    memcpy(conn.mac, mac, 6);
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_STACONNECTED, &conn, sizeof(conn), portMAX_DELAY);
+
+    ip_event_ap_staipassigned_t assigned = { .ip.addr = ip };
+    memcpy(assigned.mac, mac, 6);
+    esp_event_post(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &assigned, sizeof(assigned), portMAX_DELAY);
+}
+
+void host_wifi_station_leave(const uint8_t mac[6])
+{
+    pthread_mutex_lock(&wifi_lock);
+    for (int i = 0; i < ap_stations.num; i++) {
+        if (memcmp(ap_stations.sta[i].mac, mac, 6) == 0) {
+            ap_stations.sta[i] = ap_stations.sta[--ap_stations.num];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&wifi_lock);
+
+    wifi_event_ap_stadisconnected_t ev = { .reason = WIFI_REASON_ASSOC_LEAVE };
+    memcpy(ev.mac, mac, 6);
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_STADISCONNECTED, &ev, sizeof(ev), portMAX_DELAY);
+}
+
+void host_wifi_reload_script(void)
+{
+    pthread_mutex_lock(&wifi_lock);
+    uint8_t bssid[6] = {0};
+    bool was_connected = sta_connected_ap >= 0;
+    if (was_connected) {
+        memcpy(bssid, script_aps[sta_connected_ap].record.bssid, 6);
+    }
+    script_loaded = false;
+    script_load();
+
+    // BSSIDs follow line numbers, so the link survives only if its line did
+    int found = -1;
+    for (int i = 0; was_connected && i < script_ap_count; i++) {
+        if (memcmp(script_aps[i].record.bssid, bssid, 6) == 0 &&
+            strncmp((char *)script_aps[i].record.ssid, (char *)sta_config.sta.ssid, 32) == 0) {
+            found = i;
+            break;
+        }
+    }
+    sta_connected_ap = found;
+    pthread_mutex_unlock(&wifi_lock);
+
+    if (was_connected && found < 0) {
+        ESP_LOGI(TAG, "Connected AP left the script, dropping the STA link");
+        wifi_event_sta_disconnected_t ev = { .reason = WIFI_REASON_BEACON_TIMEOUT };
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &ev, sizeof(ev), portMAX_DELAY);
+    }
+}
@@ -0,0 +1,23 @@
+// Host shim: FreeRTOS idle hooks (no idle task here, so registration fails)
+#ifndef HOST_SHIM_ESP_FREERTOS_HOOKS_H
+#define HOST_SHIM_ESP_FREERTOS_HOOKS_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef bool (*esp_freertos_idle_cb_t)(void);
+
+static inline esp_err_t esp_register_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t cb, int cpu)
+{
+    (void)cb;
+    (void)cpu;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline void esp_deregister_freertos_idle_hook_for_cpu(esp_freertos_idle_cb_t cb, int cpu)
+{
+    (void)cb;
+    (void)cpu;
+}
+
+#endif
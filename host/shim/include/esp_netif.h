@@ -0,0 +1,79 @@
+// Host shim: IPv4 address types, IP_EVENT and DHCP server options
+#ifndef HOST_SHIM_ESP_NETIF_H
+#define HOST_SHIM_ESP_NETIF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef struct {
+    uint32_t addr;      // Network byte order
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct esp_netif_obj esp_netif_t;
+
+#define esp_netif_ip4_makeu32(a, b, c, d) \
+    (((uint32_t)(d) << 24) | ((uint32_t)(c) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
+#define ESP_IP4TOADDR(a, b, c, d) esp_netif_ip4_makeu32(a, b, c, d)
+#define IP4_ADDR(ipaddr, a, b, c, d) (ipaddr)->addr = esp_netif_ip4_makeu32(a, b, c, d)
+
+#define esp_ip4_addr_get_byte(ipaddr, idx) (((const uint8_t *)(&(ipaddr)->addr))[idx])
+#define IP2STR(ipaddr) esp_ip4_addr_get_byte(ipaddr, 0), esp_ip4_addr_get_byte(ipaddr, 1), \
+                       esp_ip4_addr_get_byte(ipaddr, 2), esp_ip4_addr_get_byte(ipaddr, 3)
+#define IPSTR "%d.%d.%d.%d"
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED,
+} ip_event_t;
+
+typedef struct {
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+typedef struct {
+    esp_netif_t *esp_netif;
+    esp_ip4_addr_t ip;
+    uint8_t mac[6];
+} ip_event_ap_staipassigned_t;
+
+// DHCP server options - accepted and remembered, no server runs on the host
+typedef enum {
+    ESP_NETIF_OP_START = 0,
+    ESP_NETIF_OP_SET,
+    ESP_NETIF_OP_GET,
+} esp_netif_dhcp_option_mode_t;
+
+typedef enum {
+    ESP_NETIF_DOMAIN_NAME_SERVER = 6,
+    ESP_NETIF_REQUESTED_IP_ADDRESS = 50,
+    ESP_NETIF_IP_ADDRESS_LEASE_TIME = 51,
+} esp_netif_dhcp_option_id_t;
+
+typedef struct {
+    bool enable;
+    esp_ip4_addr_t start_ip;
+    esp_ip4_addr_t end_ip;
+} dhcps_lease_t;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *esp_netif, esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_dhcps_start(esp_netif_t *esp_netif);
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *esp_netif);
+esp_err_t esp_netif_dhcps_option(esp_netif_t *esp_netif, esp_netif_dhcp_option_mode_t opt_op,
+                                 esp_netif_dhcp_option_id_t opt_id, void *opt_val, uint32_t opt_len);
+
+#endif
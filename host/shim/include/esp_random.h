@@ -0,0 +1,11 @@
+// Host shim: hardware RNG
+#ifndef HOST_SHIM_ESP_RANDOM_H
+#define HOST_SHIM_ESP_RANDOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t esp_random(void);
+void esp_fill_random(void *buf, size_t len);
+
+#endif
@@ -0,0 +1,25 @@
+// Host shim: FreeRTOS scalar types on a 1 ms tick
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE  0
+#define pdTRUE   1
+#define pdFAIL   0
+#define pdPASS   1
+
+#define configTICK_RATE_HZ   1000
+#define portTICK_PERIOD_MS   (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY       0x7fffffff
+
+#endif
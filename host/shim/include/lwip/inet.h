@@ -0,0 +1,7 @@
+// Host shim: address conversion
+#ifndef HOST_SHIM_LWIP_INET_H
+#define HOST_SHIM_LWIP_INET_H
+
+#include "lwip/sockets.h"
+
+#endif
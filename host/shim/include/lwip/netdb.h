@@ -0,0 +1,7 @@
+// Host shim: resolver
+#ifndef HOST_SHIM_LWIP_NETDB_H
+#define HOST_SHIM_LWIP_NETDB_H
+
+#include <netdb.h>
+
+#endif
@@ -0,0 +1,30 @@
+// Host shim: BSD sockets, with privileged ports remapped so the portal runs unprivileged
+#ifndef HOST_SHIM_LWIP_SOCKETS_H
+#define HOST_SHIM_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// lwIP's sys_arch.h drags these in on the device, and firmware code relies on it
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define inet_ntoa_r(addr, buf, buflen) inet_ntop(AF_INET, &(addr), (buf), (buflen))
+
+// Ports below 1024 are shifted by $LABPORTAL_PORT_OFFSET (default 10000): 53 -> 10053, 80 -> 10080
+uint16_t host_port_remap(uint16_t port);
+int host_bind(int fd, const struct sockaddr *addr, socklen_t len);
+
+#ifndef HOST_SHIM_NO_BIND_REMAP
+#define bind host_bind
+#endif
+
+#endif
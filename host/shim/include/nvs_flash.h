@@ -0,0 +1,10 @@
+// Host shim: NVS partition is $LABPORTAL_STATE_DIR/nvs.bin
+#ifndef HOST_SHIM_NVS_FLASH_H
+#define HOST_SHIM_NVS_FLASH_H
+
+#include "nvs.h"
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#endif
@@ -0,0 +1,363 @@
+// NVS as an in-memory table, rewritten to $LABPORTAL_STATE_DIR/nvs.bin on commit
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "shim_internal.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NVS_KEY_MAX      16   // 15 chars + NUL, same limit as the device
+#define NVS_MAX_HANDLES  32
+#define NVS_FILE_MAGIC   0x4e565331u   // "NVS1"
+
+typedef enum {
+    NVS_TYPE_U8 = 1,
+    NVS_TYPE_I8,
+    NVS_TYPE_U16,
+    NVS_TYPE_I32,
+    NVS_TYPE_U32,
+    NVS_TYPE_STR,
+    NVS_TYPE_BLOB,
+} nvs_type_t;
+
+typedef struct nvs_entry {
+    char ns[NVS_KEY_MAX];
+    char key[NVS_KEY_MAX];
+    uint8_t type;
+    uint32_t len;
+    uint8_t *data;
+    struct nvs_entry *next;
+} nvs_entry_t;
+
+typedef struct {
+    bool used;
+    bool writable;
+    char ns[NVS_KEY_MAX];
+} nvs_open_handle_t;
+
+static pthread_mutex_t nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+static nvs_entry_t *entries;
+static nvs_open_handle_t handles[NVS_MAX_HANDLES];
+static bool initialized;
+
+static void nvs_path(char *out, size_t size)
+{
+    host_state_path("nvs.bin", out, size);
+}
+
+static void entries_clear(void)
+{
+    while (entries) {
+        nvs_entry_t *next = entries->next;
+        free(entries->data);
+        free(entries);
+        entries = next;
+    }
+}
+
+static nvs_entry_t *entry_find(const char *ns, const char *key)
+{
+    for (nvs_entry_t *e = entries; e; e = e->next) {
+        if (strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t entry_store(const char *ns, const char *key, uint8_t type, const void *data, uint32_t len)
+{
+    nvs_entry_t *e = entry_find(ns, key);
+    uint8_t *copy = malloc(len ? len : 1);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, data, len);
+
+    if (!e) {
+        e = calloc(1, sizeof(*e));
+        if (!e) {
+            free(copy);
+            return ESP_ERR_NO_MEM;
+        }
+        strcpy(e->ns, ns);
+        strcpy(e->key, key);
+        e->next = entries;
+        entries = e;
+    }
+    free(e->data);
+    e->type = type;
+    e->len = len;
+    e->data = copy;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_load(void)
+{
+    char path[512];
+    nvs_path(path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_OK;  // First run: empty store
+    }
+
+    uint32_t magic = 0;
+    esp_err_t result = ESP_OK;
+    if (fread(&magic, sizeof(magic), 1, f) != 1 || magic != NVS_FILE_MAGIC) {
+        result = ESP_ERR_NVS_NEW_VERSION_FOUND;
+    }
+
+    while (result == ESP_OK) {
+        nvs_entry_t hdr;
+        if (fread(hdr.ns, NVS_KEY_MAX, 1, f) != 1) break;
+        if (fread(hdr.key, NVS_KEY_MAX, 1, f) != 1 ||
+            fread(&hdr.type, 1, 1, f) != 1 ||
+            fread(&hdr.len, sizeof(hdr.len), 1, f) != 1 ||
+            hdr.len > 512 * 1024) {
+            result = ESP_ERR_NVS_NEW_VERSION_FOUND;
+            break;
+        }
+        hdr.ns[NVS_KEY_MAX - 1] = '\0';
+        hdr.key[NVS_KEY_MAX - 1] = '\0';
+
+        uint8_t *data = malloc(hdr.len ? hdr.len : 1);
+        if (!data || (hdr.len && fread(data, hdr.len, 1, f) != 1)) {
+            free(data);
+            result = ESP_ERR_NVS_NEW_VERSION_FOUND;
+            break;
+        }
+        entry_store(hdr.ns, hdr.key, hdr.type, data, hdr.len);
+        free(data);
+    }
+
+    fclose(f);
+    if (result != ESP_OK) {
+        entries_clear();
+    }
+    return result;
+}
+
+static esp_err_t nvs_save(void)
+{
+    char path[512], tmp[520];
+    nvs_path(path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    uint32_t magic = NVS_FILE_MAGIC;
+    fwrite(&magic, sizeof(magic), 1, f);
+    for (nvs_entry_t *e = entries; e; e = e->next) {
+        fwrite(e->ns, NVS_KEY_MAX, 1, f);
+        fwrite(e->key, NVS_KEY_MAX, 1, f);
+        fwrite(&e->type, 1, 1, f);
+        fwrite(&e->len, sizeof(e->len), 1, f);
+        fwrite(e->data, e->len, 1, f);
+    }
+    bool ok = fflush(f) == 0;
+    fclose(f);
+    // Rename keeps the file consistent if the process dies mid-write
+    if (!ok || rename(tmp, path) != 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t err = ESP_OK;
+    if (!initialized) {
+        err = nvs_load();
+        initialized = (err == ESP_OK);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    char path[512];
+    nvs_path(path, sizeof(path));
+    pthread_mutex_lock(&nvs_lock);
+    entries_clear();
+    remove(path);
+    initialized = false;
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_OK;
+}
+
+static nvs_open_handle_t *handle_get(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > NVS_MAX_HANDLES || !handles[handle - 1].used) {
+        return NULL;
+    }
+    return &handles[handle - 1];
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    if (!ns || strlen(ns) >= NVS_KEY_MAX || !out) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    pthread_mutex_lock(&nvs_lock);
+    if (!initialized) {
+        pthread_mutex_unlock(&nvs_lock);
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (!handles[i].used) {
+            handles[i].used = true;
+            handles[i].writable = (mode == NVS_READWRITE);
+            strcpy(handles[i].ns, ns);
+            *out = (nvs_handle_t)(i + 1);
+            pthread_mutex_unlock(&nvs_lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_handle_t *h = handle_get(handle);
+    if (h) {
+        h->used = false;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    esp_err_t err = handle_get(handle) ? nvs_save() : ESP_ERR_NVS_INVALID_HANDLE;
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+static esp_err_t nvs_set(nvs_handle_t handle, const char *key, uint8_t type, const void *data, size_t len)
+{
+    if (!key || strlen(key) >= NVS_KEY_MAX) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err;
+    if (!h) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!h->writable) {
+        err = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        err = entry_store(h->ns, key, type, data, (uint32_t)len);
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+// Copies up to *len bytes; NULL out only reports the stored length
+static esp_err_t nvs_get(nvs_handle_t handle, const char *key, uint8_t type, void *out, size_t *len)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err = ESP_OK;
+    nvs_entry_t *e = h ? entry_find(h->ns, key) : NULL;
+
+    if (!h) {
+        err = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!e) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (e->type != type) {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (out == NULL) {
+        *len = e->len;
+    } else if (*len < e->len) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, e->data, e->len);
+        *len = e->len;
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_handle_t *h = handle_get(handle);
+    esp_err_t err = h ? ESP_ERR_NVS_NOT_FOUND : ESP_ERR_NVS_INVALID_HANDLE;
+    for (nvs_entry_t **pp = &entries; h && *pp; pp = &(*pp)->next) {
+        if (strcmp((*pp)->ns, h->ns) == 0 && strcmp((*pp)->key, key) == 0) {
+            nvs_entry_t *e = *pp;
+            *pp = e->next;
+            free(e->data);
+            free(e);
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return err;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&nvs_lock);
+    nvs_open_handle_t *h = handle_get(handle);
+    nvs_entry_t **pp = &entries;
+    while (h && *pp) {
+        if (strcmp((*pp)->ns, h->ns) == 0) {
+            nvs_entry_t *e = *pp;
+            *pp = e->next;
+            free(e->data);
+            free(e);
+        } else {
+            pp = &(*pp)->next;
+        }
+    }
+    pthread_mutex_unlock(&nvs_lock);
+    return h ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+#define NVS_SCALAR(suffix, ctype, tag)                                          \
+    esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char *key, ctype value) \
+    {                                                                           \
+        return nvs_set(handle, key, tag, &value, sizeof(value));                \
+    }                                                                           \
+    esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char *key, ctype *out) \
+    {                                                                           \
+        size_t len = sizeof(*out);                                              \
+        return nvs_get(handle, key, tag, out, &len);                            \
+    }
+
+NVS_SCALAR(u8, uint8_t, NVS_TYPE_U8)
+NVS_SCALAR(i8, int8_t, NVS_TYPE_I8)
+NVS_SCALAR(u16, uint16_t, NVS_TYPE_U16)
+NVS_SCALAR(i32, int32_t, NVS_TYPE_I32)
+NVS_SCALAR(u32, uint32_t, NVS_TYPE_U32)
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t len)
+{
+    return nvs_set(handle, key, NVS_TYPE_BLOB, value, len);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *len)
+{
+    return nvs_get(handle, key, NVS_TYPE_STR, out, len);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *len)
+{
+    return nvs_get(handle, key, NVS_TYPE_BLOB, out, len);
+}
@@ -0,0 +1,15 @@
+// Shared helpers for the host shims (not visible to firmware code)
+#ifndef HOST_SHIM_INTERNAL_H
+#define HOST_SHIM_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Absolute deadline for a FreeRTOS tick timeout (portMAX_DELAY = NULL, wait forever)
+struct timespec *host_deadline(uint32_t ticks, struct timespec *ts);
+
+// $LABPORTAL_STATE_DIR/<name> (default: current directory)
+void host_state_path(const char *name, char *out, size_t out_size);
+
+#endif
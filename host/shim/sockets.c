@@ -0,0 +1,31 @@
+// Port remapping for bind() so the DNS proxy and portal run without root
+#define HOST_SHIM_NO_BIND_REMAP
+#include "lwip/sockets.h"
+
+#include <stdlib.h>
+
+uint16_t host_port_remap(uint16_t port)
+{
+    static int offset = -1;
+    if (offset < 0) {
+        const char *env = getenv("LABPORTAL_PORT_OFFSET");
+        offset = env ? atoi(env) : 10000;
+    }
+    if (port == 0 || port >= 1024 || port + offset > 65535) {
+        return port;
+    }
+    return (uint16_t)(port + offset);
+}
+
+int host_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+    if (addr && addr->sa_family == AF_INET && len >= sizeof(struct sockaddr_in)) {
+        struct sockaddr_in remapped = *(const struct sockaddr_in *)addr;
+        remapped.sin_port = htons(host_port_remap(ntohs(remapped.sin_port)));
+        // Restarted portals must be able to rebind while old sockets sit in TIME_WAIT
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return bind(fd, (const struct sockaddr *)&remapped, sizeof(remapped));
+    }
+    return bind(fd, addr, len);
+}
@@ -0,0 +1,96 @@
+// Host test for components/client_table: the lease-octet index only answers
+// for addresses on the lease subnet, so a same-octet host elsewhere neither
+// inherits a station's approval nor keeps it looking active
+//   ctest --test-dir build-host -R client_table
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "client_table.h"
+#include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+static const uint8_t phone[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+static uint32_t addr(const char *dotted)
+{
+    return inet_addr(dotted);
+}
+
+static uint32_t last_request(uint32_t ip)
+{
+    client_entry_t e;
+    return client_table_find_ip(ip, &e) ? e.last_request : UINT32_MAX;
+}
+
+static void test_approval_is_per_subnet(void)
+{
+    client_table_station_joined(phone);
+    client_table_station_ip(phone, addr("192.168.4.23"));
+    CHECK(!client_table_is_ip_approved(addr("192.168.4.23")));
+
+    // Approving by an off-subnet address with the same octet finds nobody
+    CHECK(client_table_approve_ip(addr("10.0.0.23")) == ESP_ERR_NOT_FOUND);
+    CHECK(!client_table_is_ip_approved(addr("192.168.4.23")));
+
+    CHECK(client_table_approve_ip(addr("192.168.4.23")) == ESP_OK);
+    CHECK(client_table_is_ip_approved(addr("192.168.4.23")));
+    CHECK(client_table_is_octet_approved(23));
+
+    // Uplink and venue hosts ending in .23 are not the phone
+    CHECK(!client_table_is_ip_approved(addr("10.0.0.23")));
+    CHECK(!client_table_is_ip_approved(addr("192.168.1.23")));
+    CHECK(!client_table_is_ip_approved(addr("192.168.5.23")));
+    CHECK(!client_table_is_ip_approved(0));
+
+    client_entry_t e;
+    CHECK(!client_table_find_ip(addr("10.0.0.23"), &e));
+    CHECK(client_table_find_ip(addr("192.168.4.23"), &e) && e.approved);
+}
+
+static void test_touch_is_per_subnet(void)
+{
+    // Request stamps are whole seconds since boot; move off zero first
+    vTaskDelay(pdMS_TO_TICKS(1100));
+    CHECK(last_request(addr("192.168.4.23")) == 0);
+
+    client_table_touch_ip(addr("10.0.0.23"));
+    client_table_touch_ip(addr("192.168.1.23"));
+    CHECK(last_request(addr("192.168.4.23")) == 0);
+
+    client_table_touch_ip(addr("192.168.4.23"));
+    CHECK(last_request(addr("192.168.4.23")) >= 1);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/client_table_test.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("LABPORTAL_STATE_DIR", dir, 1);
+    nvs_flash_init();
+    client_table_init();
+
+    test_approval_is_per_subnet();
+    test_touch_is_per_subnet();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("client_table: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+// Host test for components/dns_server: IPv6 suppression and answers we build
+// ourselves, through the real proxy task on loopback
+//   ctest --test-dir build-host -R dns_server
+
+#include <arpa/inet.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "dns_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+#define PORT_OFFSET "27000"   // Proxy's port 53 lands on 27053
+#define PROXY_PORT  27053
+
+#define TYPE_A     1
+#define TYPE_AAAA  28
+#define TYPE_HTTPS 65
+
+typedef struct {
+    int len;
+    uint16_t flags;
+    uint16_t qdcount, ancount, nscount, arcount;
+    uint16_t answer_type;     // First answer, 0 if none
+    uint8_t answer_ip[4];
+} reply_t;
+
+static size_t put_name(uint8_t *p, const char *name)
+{
+    size_t n = 0;
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        size_t label = dot ? (size_t)(dot - name) : strlen(name);
+        p[n++] = (uint8_t)label;
+        memcpy(p + n, name, label);
+        n += label;
+        name += label + (dot ? 1 : 0);
+    }
+    p[n++] = 0;
+    return n;
+}
+
+// One query with RD set, optionally carrying an EDNS OPT record like phones send
+static bool query(const char *name, uint16_t qtype, bool edns, reply_t *r)
+{
+    uint8_t q[512] = {0x12, 0x34, 0x01, 0x00, 0x00, 0x01};
+    size_t n = 12;
+    n += put_name(q + n, name);
+    q[n++] = 0;
+    q[n++] = (uint8_t)qtype;
+    q[n++] = 0;
+    q[n++] = 1;
+    if (edns) {
+        static const uint8_t opt[] = {0, 0x00, 0x29, 0x05, 0xc0, 0, 0, 0, 0, 0, 0};
+        memcpy(q + n, opt, sizeof(opt));
+        n += sizeof(opt);
+        q[11] = 1;   // arcount
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval timeout = { .tv_sec = 3 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in proxy = { .sin_family = AF_INET, .sin_port = htons(PROXY_PORT) };
+    proxy.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(sock, q, n, 0, (struct sockaddr *)&proxy, sizeof(proxy));
+
+    uint8_t a[512];
+    int len = (int)recv(sock, a, sizeof(a), 0);
+    close(sock);
+    memset(r, 0, sizeof(*r));
+    if (len < 12 || a[0] != 0x12 || a[1] != 0x34) {
+        return false;
+    }
+    r->len = len;
+    r->flags = (uint16_t)(a[2] << 8 | a[3]);
+    r->qdcount = (uint16_t)(a[4] << 8 | a[5]);
+    r->ancount = (uint16_t)(a[6] << 8 | a[7]);
+    r->nscount = (uint16_t)(a[8] << 8 | a[9]);
+    r->arcount = (uint16_t)(a[10] << 8 | a[11]);
+
+    // The question is echoed as sent, answer right behind it (a compressed name)
+    size_t at = 12 + strlen(name) + 2 + 4;
+    if (r->ancount && (size_t)len >= at + 16) {
+        r->answer_type = (uint16_t)(a[at + 2] << 8 | a[at + 3]);
+        memcpy(r->answer_ip, a + at + 12, 4);
+    }
+    return true;
+}
+
+static bool is_nodata(const reply_t *r)
+{
+    return (r->flags & 0x8000) && (r->flags & 0x000f) == 0 && r->qdcount == 1 &&
+           r->ancount == 0 && r->nscount == 0 && r->arcount == 0;
+}
+
+static void test_aaaa_nodata(void)
+{
+    reply_t r;
+
+    // Any name, never forwarded: the upstream here is a dead port, which would
+    // come back as SERVFAIL
+    CHECK(query("example.com", TYPE_AAAA, false, &r));
+    CHECK(is_nodata(&r));
+    CHECK(r.flags & 0x0080);          // Recursion available
+    CHECK(r.flags & 0x0100);          // RD echoed
+    CHECK(!(r.flags & 0x0400));       // Not authoritative for someone else's name
+
+    CHECK(query("www.example.org", TYPE_AAAA, true, &r));
+    CHECK(is_nodata(&r));             // OPT record from the query is not echoed
+
+    // A queries are still forwarded - and fail against the dead upstream
+    CHECK(query("example.com", TYPE_A, false, &r));
+    CHECK((r.flags & 0x000f) == 2);
+}
+
+static void test_captive_answers(void)
+{
+    reply_t r;
+    dns_set_captive_mode(true);
+
+    // Unapproved client probing: A gets the portal, even with EDNS in the query
+    CHECK(query("connectivitycheck.gstatic.com", TYPE_A, true, &r));
+    CHECK(r.ancount == 1 && r.arcount == 0);
+    CHECK(r.answer_type == TYPE_A);
+    CHECK(memcmp(r.answer_ip, "\xc0\xa8\x04\x01", 4) == 0);
+
+    // ...but never an A record to an AAAA or HTTPS question
+    CHECK(query("captive.apple.com", TYPE_AAAA, false, &r));
+    CHECK(is_nodata(&r));
+    CHECK(query("captive.apple.com", TYPE_HTTPS, true, &r));
+    CHECK(is_nodata(&r));
+    CHECK(r.flags & 0x0400);          // Hijacked name, we answer authoritatively
+
+    dns_set_captive_mode(false);
+}
+
+static void test_local_name(void)
+{
+    reply_t r;
+    CHECK(query("labportal.local", TYPE_A, true, &r));
+    CHECK(r.ancount == 1 && r.answer_type == TYPE_A);
+    CHECK(memcmp(r.answer_ip, "\xc0\xa8\x04\x01", 4) == 0);
+    CHECK(query("labportal.local", TYPE_AAAA, false, &r));
+    CHECK(is_nodata(&r));
+}
+
+int main(void)
+{
+    setenv("LABPORTAL_PORT_OFFSET", PORT_OFFSET, 1);
+    dns_set_upstream(htonl(INADDR_LOOPBACK));   // Nothing listens on 127.0.0.1:53
+    dns_server_start();
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    test_aaaa_nodata();
+    test_captive_answers();
+    test_local_name();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("dns_server: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,256 @@
+// Host test for components/form_parser: bodies arriving in arbitrary chunks
+// (delimiters and %XX escapes split across reads) and fields that overflow
+// the scratch buffer
+//   ctest --test-dir build-host -R form_parser
+
+#include <stdio.h>
+#include <string.h>
+#include "form_parser.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+#define MP_TYPE "multipart/form-data; boundary=XyZ"
+
+// What the handlers saw, flattened to one string: "name=value;" per field,
+// "<name:file>data...</>" per streamed part
+typedef struct {
+    char text[512];
+    size_t len;
+} record_t;
+
+static void append(record_t *rec, const char *s, size_t len)
+{
+    if (rec->len + len < sizeof(rec->text)) {
+        memcpy(rec->text + rec->len, s, len);
+        rec->len += len;
+        rec->text[rec->len] = '\0';
+    }
+}
+
+static esp_err_t on_field(const form_field_t *field, void *ctx)
+{
+    char name[64], value[128];
+    size_t name_len, value_len;
+    esp_err_t err = form_decode(field->name, name, sizeof(name), &name_len);
+    if (err == ESP_OK) {
+        err = form_decode(field->value, value, sizeof(value), &value_len);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    append(ctx, name, name_len);
+    append(ctx, "=", 1);
+    append(ctx, value, value_len);
+    append(ctx, ";", 1);
+    return ESP_OK;
+}
+
+static esp_err_t on_part_begin(const form_part_t *part, void *ctx)
+{
+    append(ctx, "<", 1);
+    append(ctx, part->name, strlen(part->name));
+    append(ctx, ":", 1);
+    append(ctx, part->filename, strlen(part->filename));
+    append(ctx, ">", 1);
+    return ESP_OK;
+}
+
+static esp_err_t on_part_data(const form_part_t *part, const char *data, size_t len, void *ctx)
+{
+    (void)part;
+    append(ctx, data, len);
+    return ESP_OK;
+}
+
+static esp_err_t on_part_end(const form_part_t *part, void *ctx)
+{
+    (void)part;
+    append(ctx, "</>", 3);
+    return ESP_OK;
+}
+
+static const form_handlers_t field_handlers = { .field = on_field };
+static const form_handlers_t stream_handlers = {
+    .part_begin = on_part_begin,
+    .part_data = on_part_data,
+    .part_end = on_part_end,
+};
+
+// Push body through a parser: `first` bytes, then `chunk` bytes per read
+// (each read also capped by the free scratch space, like form_parse_request)
+static esp_err_t parse(const char *content_type, const char *body, size_t scratch_size,
+                       const form_handlers_t *handlers, size_t first, size_t chunk, record_t *rec)
+{
+    char scratch[256];
+    form_parser_t parser;
+    memset(rec, 0, sizeof(*rec));
+    esp_err_t err = form_parser_init(&parser, content_type, scratch, scratch_size, handlers, rec);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    size_t len = strlen(body);
+    size_t at = 0;
+    size_t want = first ? first : chunk;
+    while (at < len) {
+        size_t avail;
+        char *space = form_parser_space(&parser, &avail);
+        size_t n = len - at;
+        if (n > want) n = want;
+        if (n > avail) n = avail;
+        memcpy(space, body + at, n);
+        at += n;
+        err = form_parser_feed(&parser, n);
+        if (err != ESP_OK) {
+            return err;
+        }
+        want = chunk;
+    }
+    return form_parser_finish(&parser);
+}
+
+// Same result whether the body arrives whole, byte by byte, or cut in two
+// anywhere - every '&', %XX escape and boundary gets split at some point
+static void check_all_splits(const char *content_type, const char *body, size_t scratch_size,
+                             const form_handlers_t *handlers, const char *expected)
+{
+    record_t rec;
+    size_t len = strlen(body);
+
+    CHECK(parse(content_type, body, scratch_size, handlers, 0, len, &rec) == ESP_OK);
+    CHECK(strcmp(rec.text, expected) == 0);
+
+    CHECK(parse(content_type, body, scratch_size, handlers, 0, 1, &rec) == ESP_OK);
+    CHECK(strcmp(rec.text, expected) == 0);
+
+    for (size_t cut = 1; cut < len; cut++) {
+        esp_err_t err = parse(content_type, body, scratch_size, handlers, cut, len, &rec);
+        if (err != ESP_OK || strcmp(rec.text, expected) != 0) {
+            fprintf(stderr, "split at %zu: err 0x%x, got \"%s\"\n", cut, (unsigned)err, rec.text);
+            failures++;
+            return;
+        }
+    }
+}
+
+static void test_urlencoded_splits(void)
+{
+    check_all_splits("application/x-www-form-urlencoded",
+                     "ssid=Lab%20Net&pass=p%26ss+w%3Drd&&empty=&flag&ch=%E2%9C%93",
+                     64, &field_handlers,
+                     "ssid=Lab Net;pass=p&ss w=rd;empty=;flag=;ch=\xe2\x9c\x93;");
+
+    // Body far larger than scratch streams through one field at a time
+    char body[200] = "";
+    char expected[300] = "";
+    for (int i = 0; i < 12; i++) {
+        char field[24];
+        snprintf(field, sizeof(field), "%sk%d=v%%2F%d", i ? "&" : "", i, i);
+        strcat(body, field);
+        snprintf(field, sizeof(field), "k%d=v/%d;", i, i);
+        strcat(expected, field);
+    }
+    check_all_splits(NULL, body, 16, &field_handlers, expected);
+}
+
+static void test_multipart_splits(void)
+{
+    static const char body[] =
+        "preamble\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"ssid\"\r\n"
+        "\r\n"
+        "Lab Net\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"note\"\r\n"
+        "\r\n"
+        "a\r\n--Xy not the boundary\r\n"
+        "--XyZ--\r\n"
+        "epilogue";
+
+    check_all_splits(MP_TYPE, body, 96, &field_handlers,
+                     "ssid=Lab Net;note=a\r\n--Xy not the boundary;");
+
+    static const char upload[] =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"fw\"; filename=\"app.bin\"\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "\r\n"
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+        "0123456789abcdef0123456789abcdef\r\n--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"go\"\r\n"
+        "\r\n"
+        "1\r\n"
+        "--XyZ--\r\n";
+
+    // File data larger than the room left after the headers arrives in pieces,
+    // never including the delimiter
+    check_all_splits(MP_TYPE, upload, 128, &stream_handlers,
+                     "<fw:app.bin>0123456789abcdef0123456789abcdef0123456789abcdef"
+                     "0123456789abcdef0123456789abcdef0123456789abcdef</><go:>1</>");
+}
+
+static void test_overflow(void)
+{
+    record_t rec;
+
+    // One urlencoded field longer than scratch: refused, not truncated
+    CHECK(parse(NULL, "a=1&long=0123456789abcdef&b=2", 16, &field_handlers, 0, 4, &rec) ==
+          ESP_ERR_INVALID_SIZE);
+    CHECK(strcmp(rec.text, "a=1;") == 0);
+
+    // The same body fits a bigger buffer
+    CHECK(parse(NULL, "a=1&long=0123456789abcdef&b=2", 32, &field_handlers, 0, 4, &rec) == ESP_OK);
+    CHECK(strcmp(rec.text, "a=1;long=0123456789abcdef;b=2;") == 0);
+
+    // A plain multipart field must fit whole
+    char body[256];
+    snprintf(body, sizeof(body),
+             "--XyZ\r\nContent-Disposition: form-data; name=\"v\"\r\n\r\n%0120d\r\n--XyZ--\r\n", 0);
+    CHECK(parse(MP_TYPE, body, 96, &field_handlers, 0, 8, &rec) == ESP_ERR_INVALID_SIZE);
+
+    // Part headers that never fit
+    snprintf(body, sizeof(body),
+             "--XyZ\r\nContent-Disposition: form-data; name=\"v\"\r\nX-Pad: %0100d\r\n\r\n1\r\n--XyZ--\r\n", 0);
+    CHECK(parse(MP_TYPE, body, 96, &field_handlers, 0, 8, &rec) == ESP_ERR_INVALID_SIZE);
+
+    // A part name longer than form_part_t holds
+    snprintf(body, sizeof(body),
+             "--XyZ\r\nContent-Disposition: form-data; name=\"%040d\"\r\n\r\n1\r\n--XyZ--\r\n", 0);
+    CHECK(parse(MP_TYPE, body, 128, &field_handlers, 0, 8, &rec) == ESP_ERR_INVALID_SIZE);
+
+    // Missing terminator is an error, not a silently short body
+    CHECK(parse(MP_TYPE, "--XyZ\r\nContent-Disposition: form-data; name=\"v\"\r\n\r\n1\r\n",
+                96, &field_handlers, 0, 8, &rec) == ESP_ERR_INVALID_ARG);
+
+    // Decoding: too small an output and broken escapes
+    char out[4];
+    form_span_t raw = { .ptr = "abcd", .len = 4 };
+    CHECK(form_decode(raw, out, sizeof(out), NULL) == ESP_ERR_INVALID_SIZE);
+    raw = (form_span_t){ .ptr = "a%2", .len = 3 };
+    CHECK(form_decode(raw, out, sizeof(out), NULL) == ESP_ERR_INVALID_ARG);
+    raw = (form_span_t){ .ptr = "%zz", .len = 3 };
+    CHECK(form_decode(raw, out, sizeof(out), NULL) == ESP_ERR_INVALID_ARG);
+    CHECK(parse(NULL, "a=%4", 16, &field_handlers, 0, 1, &rec) == ESP_ERR_INVALID_ARG);
+}
+
+int main(void)
+{
+    test_urlencoded_splits();
+    test_multipart_splits();
+    test_overflow();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("form_parser: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+// Host test for components/napt_table
+//   ctest --test-dir build-host -R napt_table
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "napt_table.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+#define CLIENT(n)  (0x0204a8c0u + ((uint32_t)(n) << 24))   // 192.168.4.n
+#define REMOTE     0x08080808u                             // 8.8.8.8
+
+static void test_roundtrip(void)
+{
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    napt_table_t t;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+
+    napt_entry_t *e = napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 50001, REMOTE, 53, 0, 0, true);
+    CHECK(e != NULL);
+    CHECK(e->mapped_port == 50001);   // Source port preserved
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 50001, REMOTE, 53, 0, 10, true) == e);
+    CHECK(e->packets_out == 2);
+
+    // Same source port from another client gets a different mapped port
+    napt_entry_t *f = napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(3), 50001, REMOTE, 53, 0, 0, true);
+    CHECK(f != NULL && f->mapped_port != 50001);
+
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, 50001, REMOTE, 53, 0, 20) == e);
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, f->mapped_port, REMOTE, 53, 0, 20) == f);
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_TCP, 50001, REMOTE, 53, 0, 20) == NULL);
+
+    // Address+port dependent filtering
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, 50001, REMOTE + 1, 53, 0, 20) == NULL);
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, 50001, REMOTE, 54, 0, 20) == NULL);
+
+    // Not creating must not allocate
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(4), 1, REMOTE, 53, 0, 0, false) == NULL);
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    CHECK(st.active == 2 && st.created == 2 && st.inbound_miss == 3);
+
+    napt_table_remove(&t, e);
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, 50001, REMOTE, 53, 0, 30) == NULL);
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, f->mapped_port, REMOTE, 53, 0, 30) == f);
+    napt_table_deinit(&t);
+}
+
+static void test_capacity_and_ports(void)
+{
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.capacity = 64;
+    cfg.port_min = 40000;
+    cfg.port_max = 40039;   // 40 ports, not a multiple of 32
+    napt_table_t t;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+
+    uint8_t seen[40] = {0};
+    for (int i = 0; i < 40; i++) {
+        napt_entry_t *e = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 1000 + i, REMOTE, 80,
+                                              NAPT_TCP_SYN, 0, true);
+        CHECK(e != NULL);
+        if (!e) continue;
+        CHECK(e->mapped_port >= 40000 && e->mapped_port <= 40039);
+        CHECK(!seen[e->mapped_port - 40000]);
+        seen[e->mapped_port - 40000] = 1;
+    }
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 2000, REMOTE, 80, NAPT_TCP_SYN, 0, true) == NULL);
+    // Port spaces are per protocol
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 2000, REMOTE, 80, 0, 0, true) != NULL);
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    CHECK(st.ports_exhausted == 1);
+    napt_table_deinit(&t);
+
+    cfg.capacity = 8;
+    cfg.port_min = 49152;
+    cfg.port_max = 65535;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+    for (int i = 0; i < 8; i++) {
+        CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 1000 + i, REMOTE, 53, 0, 0, true) != NULL);
+    }
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 2000, REMOTE, 53, 0, 0, true) == NULL);
+    napt_table_get_stats(&t, &st);
+    CHECK(st.table_full == 1);
+    napt_table_deinit(&t);
+}
+
+static int expired_count;
+
+static void count_expired(const napt_entry_t *entry, void *ctx)
+{
+    (void)entry;
+    (void)ctx;
+    expired_count++;
+}
+
+static void test_expiry(void)
+{
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.on_expire = count_expired;
+    napt_table_t t;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+    expired_count = 0;
+
+    uint32_t now = 0xFFFFF000u;   // Straddle the millisecond counter wrap
+    napt_entry_t *udp = napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 5000, REMOTE, 53, 0, now, true);
+    napt_entry_t *icmp = napt_table_outbound(&t, NAPT_PROTO_ICMP, CLIENT(2), 7, REMOTE, 0, 0, now, true);
+    napt_entry_t *tcp = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE, 443,
+                                            NAPT_TCP_SYN, now, true);
+    napt_entry_t *rst = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 6001, REMOTE, 443,
+                                            NAPT_TCP_SYN, now, true);
+    CHECK(udp && icmp && tcp && rst);
+    uint16_t udp_port = udp->mapped_port;
+
+    // Handshake completes -> established timeout
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_TCP, tcp->mapped_port, REMOTE, 443,
+                             NAPT_TCP_SYN | NAPT_TCP_ACK, now) == tcp);
+    CHECK(tcp->tcp_state == NAPT_TCP_STATE_ESTABLISHED);
+    // RST pulls the entry forward to the short reset timeout
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_TCP, rst->mapped_port, REMOTE, 443, NAPT_TCP_RST, now) == rst);
+
+    napt_table_tick(&t, now + 3000);
+    CHECK(expired_count == 1);                          // rst
+    napt_table_tick(&t, now + 11000);
+    CHECK(expired_count == 2);                          // icmp
+
+    // Keep UDP alive past its first deadline
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(2), 5000, REMOTE, 53, 0, now + 50000, false) == udp);
+    napt_table_tick(&t, now + 61000);
+    CHECK(expired_count == 2);
+    napt_table_tick(&t, now + 111000);
+    CHECK(expired_count == 3);                          // udp
+    CHECK(napt_table_inbound(&t, NAPT_PROTO_UDP, udp_port, REMOTE, 53, 0, now + 111000) == NULL);
+
+    // Established TCP survives until 30 min idle (cascades through the upper levels)
+    napt_table_tick(&t, now + 29 * 60 * 1000);
+    CHECK(expired_count == 3);
+    napt_table_tick(&t, now + 31 * 60 * 1000);
+    CHECK(expired_count == 4);
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    CHECK(st.active == 0 && st.expired == 4 && st.peak == 4);
+    napt_table_deinit(&t);
+}
+
+// Shadow use: replies keyed by the inside tuple, LRU eviction, runtime timeouts
+static void test_shadow(void)
+{
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.capacity = 4;
+    cfg.evict_lru = true;
+    cfg.on_expire = count_expired;
+    napt_table_t t;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+    expired_count = 0;
+
+    napt_entry_t *tcp = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE, 443,
+                                            NAPT_TCP_SYN, 0, true);
+    CHECK(tcp != NULL);
+    CHECK(napt_table_reply(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE, 443, NAPT_TCP_SYN | NAPT_TCP_ACK, 100) == tcp);
+    CHECK(tcp->tcp_state == NAPT_TCP_STATE_ESTABLISHED && tcp->packets_in == 1);
+    CHECK(napt_table_reply(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE + 1, 443, 0, 100) == NULL);
+
+    // Fill up; the fifth mapping reclaims the longest idle one (the first UDP)
+    for (int i = 0; i < 3; i++) {
+        CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(3), 5000 + i, REMOTE, 53, 0, 200 + i, true) != NULL);
+    }
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE, 443, 0, 300, false) == tcp);
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(4), 5000, REMOTE, 53, 0, 400, true) != NULL);
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_UDP, CLIENT(3), 5000, REMOTE, 53, 0, 400, false) == NULL);
+    CHECK(napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2), 6000, REMOTE, 443, 0, 400, false) == tcp);
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    CHECK(st.active == 4 && st.evicted == 1 && st.table_full == 0 && st.inbound_miss == 1);
+
+    // Shortening the timeouts re-files what was due in 30 min
+    napt_table_set_timeouts(&t, 5000, 5000, 1000, 2000, 2000);
+    napt_table_tick(&t, 3000);
+    CHECK(expired_count == 3);                          // udp x3
+    napt_table_tick(&t, 6000);
+    CHECK(expired_count == 4);                          // tcp
+    napt_table_deinit(&t);
+}
+
+// Churn against a shadow array to catch index corruption from deletions
+static void test_churn(void)
+{
+    napt_config_t cfg = NAPT_CONFIG_DEFAULT();
+    cfg.capacity = 256;
+    napt_table_t t;
+    CHECK(napt_table_init(&t, &cfg) == ESP_OK);
+
+    napt_entry_t *live[1024] = {0};
+    srand(1);
+    for (int round = 0; round < 200000; round++) {
+        int k = rand() % 1024;
+        uint16_t sport = (uint16_t)(1024 + k);
+        napt_entry_t *e = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2 + k % 8), sport,
+                                              REMOTE, 80, 0, 0, false);
+        CHECK(e == live[k]);
+        if (e && (rand() & 1)) {
+            CHECK(napt_table_inbound(&t, NAPT_PROTO_TCP, e->mapped_port, REMOTE, 80, 0, 0) == e);
+            napt_table_remove(&t, e);
+            live[k] = NULL;
+        } else if (!e) {
+            live[k] = napt_table_outbound(&t, NAPT_PROTO_TCP, CLIENT(2 + k % 8), sport,
+                                          REMOTE, 80, NAPT_TCP_SYN, 0, true);
+        }
+    }
+
+    napt_stats_t st;
+    napt_table_get_stats(&t, &st);
+    // Load factor stays <= 0.5: misses average ~2.5 probes
+    CHECK((double)st.probes / st.lookups < 3.0);
+    CHECK(st.max_probe < 64);
+    napt_table_deinit(&t);
+}
+
+int main(void)
+{
+    test_roundtrip();
+    test_capacity_and_ports();
+    test_expiry();
+    test_shadow();
+    test_churn();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("napt_table: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Host test for components/uri_router: exact vs wildcard vs capture priority,
+// trailing slashes and method mismatches on the segment trie
+//   ctest --test-dir build-host -R uri_router
+
+#include <stdio.h>
+#include <string.h>
+#include "uri_router.h"
+
+static int failures;
+
+#define CHECK(cond) do {                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                    \
+        }                                                                  \
+    } while (0)
+
+static esp_err_t handler(httpd_req_t *req)
+{
+    (void)req;
+    return ESP_OK;
+}
+
+enum {
+    R_ROOT, R_SCAN, R_CONNECT, R_DEBUG_ANY, R_DEBUG_HEAP, R_CLIENT, R_CLIENT_DELETE,
+    R_CLIENT_APPROVE, R_CLIENT_LIST, R_STATIC_ANY, R_STATIC_LOGO,
+};
+
+static const uri_route_t routes[] = {
+    [R_ROOT]           = { HTTP_GET,    "/",                        handler, NULL },
+    [R_SCAN]           = { HTTP_GET,    "/wifi/scan",               handler, NULL },
+    [R_CONNECT]        = { HTTP_POST,   "/wifi/connect",            handler, NULL },
+    [R_DEBUG_ANY]      = { HTTP_GET,    "/debug/*",                 handler, NULL },
+    [R_DEBUG_HEAP]     = { HTTP_GET,    "/debug/heap",              handler, NULL },
+    [R_CLIENT]         = { HTTP_GET,    "/api/client/:ip",          handler, NULL },
+    [R_CLIENT_DELETE]  = { HTTP_DELETE, "/api/client/:ip",          handler, NULL },
+    [R_CLIENT_APPROVE] = { HTTP_POST,   "/api/client/:ip/approve",  handler, NULL },
+    [R_CLIENT_LIST]    = { HTTP_GET,    "/api/client/list",         handler, NULL },
+    [R_STATIC_ANY]     = { HTTP_GET,    "/static/*",                handler, NULL },
+    [R_STATIC_LOGO]    = { HTTP_GET,    "/static/img/logo.png",     handler, NULL },
+};
+
+static uri_router_t router;
+
+static uri_route_result_t match(int method, const char *path, uri_match_t *m)
+{
+    return uri_router_match(&router, method, path, strlen(path), m);
+}
+
+// Found, and by this route
+static bool routed(int method, const char *path, int route)
+{
+    uri_match_t m;
+    return match(method, path, &m) == URI_ROUTE_FOUND && m.route == &routes[route];
+}
+
+static bool rest_is(const uri_match_t *m, const char *rest)
+{
+    return m->rest_len == strlen(rest) && memcmp(m->rest, rest, m->rest_len) == 0;
+}
+
+static bool param_is(const uri_match_t *m, int i, const char *name, const char *value)
+{
+    return i < m->param_count &&
+           m->params[i].name_len == strlen(name) && memcmp(m->params[i].name, name, m->params[i].name_len) == 0 &&
+           m->params[i].len == strlen(value) && memcmp(m->params[i].value, value, m->params[i].len) == 0;
+}
+
+static void test_priority(void)
+{
+    uri_match_t m;
+
+    // Exact beats the wildcard it sits under, whatever the table order
+    CHECK(routed(HTTP_GET, "/debug/heap", R_DEBUG_HEAP));
+    CHECK(match(HTTP_GET, "/debug/tasks", &m) == URI_ROUTE_FOUND && m.route == &routes[R_DEBUG_ANY]);
+    CHECK(rest_is(&m, "tasks"));
+
+    // A walk that dies below an exact segment falls back to the deepest wildcard
+    CHECK(match(HTTP_GET, "/debug/heap/detail", &m) == URI_ROUTE_FOUND && m.route == &routes[R_DEBUG_ANY]);
+    CHECK(rest_is(&m, "heap/detail"));
+    CHECK(match(HTTP_GET, "/static/img/icon.png", &m) == URI_ROUTE_FOUND && m.route == &routes[R_STATIC_ANY]);
+    CHECK(rest_is(&m, "img/icon.png"));
+    CHECK(routed(HTTP_GET, "/static/img/logo.png", R_STATIC_LOGO));
+
+    // '*' also covers the bare prefix, with nothing left over
+    CHECK(match(HTTP_GET, "/debug", &m) == URI_ROUTE_FOUND && m.route == &routes[R_DEBUG_ANY]);
+    CHECK(m.rest_len == 0);
+
+    // Exact segment beats a capture at the same depth
+    CHECK(match(HTTP_GET, "/api/client/list", &m) == URI_ROUTE_FOUND && m.route == &routes[R_CLIENT_LIST]);
+    CHECK(m.param_count == 0);
+    CHECK(match(HTTP_GET, "/api/client/192.168.4.23", &m) == URI_ROUTE_FOUND && m.route == &routes[R_CLIENT]);
+    CHECK(param_is(&m, 0, "ip", "192.168.4.23"));
+    CHECK(match(HTTP_POST, "/api/client/192.168.4.23/approve", &m) == URI_ROUTE_FOUND &&
+          m.route == &routes[R_CLIENT_APPROVE]);
+    CHECK(param_is(&m, 0, "ip", "192.168.4.23"));
+
+    // A capture never matches an empty segment
+    CHECK(match(HTTP_GET, "/api/client/", &m) == URI_ROUTE_NOT_FOUND);
+
+    CHECK(match(HTTP_GET, "/nothing/here", &m) == URI_ROUTE_NOT_FOUND);
+    CHECK(m.route == NULL);
+}
+
+static void test_trailing_slash(void)
+{
+    uri_match_t m;
+
+    CHECK(routed(HTTP_GET, "/", R_ROOT));
+    CHECK(routed(HTTP_GET, "/wifi/scan/", R_SCAN));
+    CHECK(routed(HTTP_GET, "/debug/heap/", R_DEBUG_HEAP));
+    CHECK(match(HTTP_GET, "/debug/", &m) == URI_ROUTE_FOUND && m.route == &routes[R_DEBUG_ANY]);
+    CHECK(m.rest_len == 0);
+    CHECK(match(HTTP_GET, "/api/client/10.0.0.1/", &m) == URI_ROUTE_FOUND && m.route == &routes[R_CLIENT]);
+    CHECK(param_is(&m, 0, "ip", "10.0.0.1"));
+
+    // Only a trailing slash is forgiven: inner empty segments and bare
+    // interior nodes are not routes
+    CHECK(match(HTTP_GET, "/wifi//scan", &m) == URI_ROUTE_NOT_FOUND);
+    CHECK(match(HTTP_GET, "/wifi/", &m) == URI_ROUTE_NOT_FOUND);
+    CHECK(match(HTTP_GET, "/wifi", &m) == URI_ROUTE_NOT_FOUND);
+    CHECK(match(HTTP_GET, "wifi/scan", &m) == URI_ROUTE_NOT_FOUND);
+}
+
+static void test_method_mismatch(void)
+{
+    uri_match_t m;
+
+    // Path known under another method: 405, not 404
+    CHECK(match(HTTP_POST, "/wifi/scan", &m) == URI_ROUTE_METHOD_NOT_ALLOWED);
+    CHECK(m.route == NULL);
+    CHECK(match(HTTP_GET, "/wifi/connect", &m) == URI_ROUTE_METHOD_NOT_ALLOWED);
+    CHECK(match(HTTP_PUT, "/api/client/10.0.0.1", &m) == URI_ROUTE_METHOD_NOT_ALLOWED);
+    CHECK(m.param_count == 0);
+    CHECK(match(HTTP_GET, "/api/client/10.0.0.1/approve", &m) == URI_ROUTE_METHOD_NOT_ALLOWED);
+    CHECK(match(HTTP_POST, "/debug/heap", &m) == URI_ROUTE_METHOD_NOT_ALLOWED);
+
+    // Same path, two methods, two routes
+    CHECK(routed(HTTP_GET, "/api/client/10.0.0.1", R_CLIENT));
+    CHECK(routed(HTTP_DELETE, "/api/client/10.0.0.1", R_CLIENT_DELETE));
+
+    // Method outside the table's range
+    CHECK(match(URI_ROUTER_METHODS, "/wifi/scan", &m) == URI_ROUTE_NOT_FOUND);
+    CHECK(match(-1, "/wifi/scan", &m) == URI_ROUTE_NOT_FOUND);
+}
+
+static void test_bad_tables(void)
+{
+    static uri_router_t scratch;
+
+    static const uri_route_t dup[] = {
+        { HTTP_GET, "/a", handler, NULL },
+        { HTTP_GET, "/a/", handler, NULL },
+    };
+    CHECK(uri_router_build(&scratch, dup, 2, NULL) == ESP_ERR_INVALID_STATE);
+
+    static const uri_route_t inner_star[] = { { HTTP_GET, "/a/*/b", handler, NULL } };
+    CHECK(uri_router_build(&scratch, inner_star, 1, NULL) == ESP_ERR_INVALID_ARG);
+
+    static const uri_route_t two_names[] = {
+        { HTTP_GET, "/c/:ip", handler, NULL },
+        { HTTP_POST, "/c/:mac", handler, NULL },
+    };
+    CHECK(uri_router_build(&scratch, two_names, 2, NULL) == ESP_ERR_INVALID_STATE);
+
+    static const uri_route_t relative[] = { { HTTP_GET, "a", handler, NULL } };
+    CHECK(uri_router_build(&scratch, relative, 1, NULL) == ESP_ERR_INVALID_ARG);
+}
+
+int main(void)
+{
+    if (uri_router_build(&router, routes, sizeof(routes) / sizeof(routes[0]), NULL) != ESP_OK) {
+        fprintf(stderr, "route table failed to build\n");
+        return 1;
+    }
+
+    test_priority();
+    test_trailing_slash();
+    test_method_mismatch();
+    test_bad_tables();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("uri_router: all checks passed\n");
+    return 0;
+}
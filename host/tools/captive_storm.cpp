@@ -0,0 +1,650 @@
+// Captive-storm load generator
+//
+// Replays the join sequence real phones run against the portal: resolve the
+// OS probe domain through our DNS proxy, fetch the probe URL, load the landing
+// page, think, tap Connect (/grant) and re-probe. Reports latency percentiles
+// per step, errors by class and socket usage.
+//
+// Targets a flashed stick (192.168.4.1) or the host build on loopback
+// (one command line):
+//   captive_storm --host 127.0.0.1 --http-port 10080 --dns-port 10053
+//                 --clients 50 --source-base 127.0.0.10
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "192.168.4.1";
+    int http_port = 80;
+    int dns_port = 53;
+    int clients = 20;
+    int concurrency = 0;          // 0 = all clients at once (a storm)
+    int think_ms = 800;           // Mean time a human looks at the landing page
+    int timeout_ms = 3000;
+    int rounds = 1;
+    double grant_ratio = 1.0;     // Fraction of visitors that tap Connect
+    std::string mix = "ios:45,android:40,windows:10,linux:5";
+    std::string source_base;      // Bind each client to base+i (loopback aliases)
+    unsigned seed = 0;
+    bool json = false;
+};
+
+// One step of an OS probe sequence
+enum class StepKind { Dns, Probe, Portal, Grant, Verify };
+
+struct Step {
+    StepKind kind;
+    const char *host;   // DNS name / Host header
+    const char *path;   // HTTP path (nullptr for DNS)
+};
+
+struct Profile {
+    const char *name;
+    std::vector<Step> steps;
+};
+
+const std::vector<Profile> &profiles()
+{
+    static const std::vector<Profile> all = {
+        {"ios", {
+            {StepKind::Dns,    "captive.apple.com", nullptr},
+            {StepKind::Probe,  "captive.apple.com", "/hotspot-detect.html"},
+            {StepKind::Probe,  "captive.apple.com", "/library/test/success.html"},
+            {StepKind::Portal, "captive.apple.com", "/"},
+            {StepKind::Grant,  "captive.apple.com", "/grant"},
+            {StepKind::Verify, "captive.apple.com", "/hotspot-detect.html"},
+        }},
+        {"android", {
+            {StepKind::Dns,    "connectivitycheck.gstatic.com", nullptr},
+            {StepKind::Probe,  "connectivitycheck.gstatic.com", "/generate_204"},
+            {StepKind::Dns,    "clients3.google.com", nullptr},
+            {StepKind::Probe,  "clients3.google.com", "/gen_204"},
+            {StepKind::Portal, "connectivitycheck.gstatic.com", "/"},
+            {StepKind::Grant,  "connectivitycheck.gstatic.com", "/grant"},
+            {StepKind::Verify, "connectivitycheck.gstatic.com", "/generate_204"},
+        }},
+        {"windows", {
+            {StepKind::Dns,    "www.msftconnecttest.com", nullptr},
+            {StepKind::Probe,  "www.msftconnecttest.com", "/connecttest.txt"},
+            {StepKind::Dns,    "www.msftncsi.com", nullptr},
+            {StepKind::Probe,  "www.msftncsi.com", "/ncsi.txt"},
+            {StepKind::Portal, "www.msftconnecttest.com", "/"},
+            {StepKind::Grant,  "www.msftconnecttest.com", "/grant"},
+            {StepKind::Verify, "www.msftconnecttest.com", "/connecttest.txt"},
+        }},
+        {"linux", {
+            {StepKind::Dns,    "connectivity-check.ubuntu.com", nullptr},
+            {StepKind::Probe,  "connectivity-check.ubuntu.com", "/canonical.html"},
+            {StepKind::Probe,  "detectportal.firefox.com", "/success.txt"},
+            {StepKind::Portal, "connectivity-check.ubuntu.com", "/"},
+            {StepKind::Grant,  "connectivity-check.ubuntu.com", "/grant"},
+            {StepKind::Verify, "connectivity-check.ubuntu.com", "/connectivity-check.html"},
+        }},
+    };
+    return all;
+}
+
+const char *step_name(StepKind kind)
+{
+    switch (kind) {
+        case StepKind::Dns:    return "dns";
+        case StepKind::Probe:  return "probe";
+        case StepKind::Portal: return "portal";
+        case StepKind::Grant:  return "grant";
+        case StepKind::Verify: return "verify";
+    }
+    return "?";
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+struct Stats {
+    std::mutex lock;
+    std::map<std::string, std::vector<double>> latency_ms;   // Per step kind + "join"
+    std::map<std::string, int> errors;                        // Per error class
+    std::map<std::string, int> http_status;
+    int joins_ok = 0;
+    int joins_failed = 0;
+
+    void sample(const std::string &key, double ms)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        latency_ms[key].push_back(ms);
+    }
+
+    void error(const std::string &cls)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        errors[cls]++;
+    }
+
+    void status(int code)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        http_status[std::to_string(code)]++;
+    }
+};
+
+std::atomic<int> sockets_open{0};
+std::atomic<int> sockets_peak{0};
+
+// RAII socket that tracks how many the tool holds open
+class Socket {
+public:
+    Socket(int type) : fd_(::socket(AF_INET, type, 0))
+    {
+        if (fd_ >= 0) {
+            int now = ++sockets_open;
+            int peak = sockets_peak.load();
+            while (now > peak && !sockets_peak.compare_exchange_weak(peak, now)) {
+            }
+        }
+    }
+    ~Socket()
+    {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            --sockets_open;
+        }
+    }
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+    int fd() const { return fd_; }
+    bool ok() const { return fd_ >= 0; }
+
+private:
+    int fd_;
+};
+
+double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool wait_fd(int fd, short events, int timeout_ms)
+{
+    pollfd pfd{fd, events, 0};
+    return ::poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & (events | POLLHUP | POLLERR));
+}
+
+bool bind_source(int fd, const in_addr &source)
+{
+    if (source.s_addr == 0) {
+        return true;
+    }
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr = source;
+    return ::bind(fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// DNS
+
+// Returns empty string on success, otherwise the error class
+std::string dns_query(const Options &opt, const in_addr &source, const char *name, std::mt19937 &rng)
+{
+    uint8_t query[512];
+    uint16_t id = static_cast<uint16_t>(rng());
+    size_t len = 0;
+
+    query[len++] = id >> 8;
+    query[len++] = id & 0xFF;
+    query[len++] = 0x01;  // RD
+    query[len++] = 0x00;
+    query[len++] = 0x00; query[len++] = 0x01;  // QDCOUNT
+    for (int i = 0; i < 6; i++) query[len++] = 0;
+
+    const char *label = name;
+    while (*label) {
+        const char *dot = std::strchr(label, '.');
+        size_t n = dot ? static_cast<size_t>(dot - label) : std::strlen(label);
+        query[len++] = static_cast<uint8_t>(n);
+        std::memcpy(query + len, label, n);
+        len += n;
+        label += n + (dot ? 1 : 0);
+    }
+    query[len++] = 0;
+    query[len++] = 0x00; query[len++] = 0x01;  // QTYPE A
+    query[len++] = 0x00; query[len++] = 0x01;  // QCLASS IN
+
+    Socket sock(SOCK_DGRAM);
+    if (!sock.ok()) return "dns_socket";
+    if (!bind_source(sock.fd(), source)) return "bind_source";
+
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(opt.dns_port);
+    inet_pton(AF_INET, opt.host.c_str(), &server.sin_addr);
+
+    if (::sendto(sock.fd(), query, len, 0, reinterpret_cast<sockaddr *>(&server), sizeof(server)) < 0) {
+        return "dns_send";
+    }
+
+    uint8_t resp[512];
+    auto deadline = Clock::now() + std::chrono::milliseconds(opt.timeout_ms);
+    while (true) {
+        int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (left <= 0 || !wait_fd(sock.fd(), POLLIN, left)) return "dns_timeout";
+        ssize_t n = ::recv(sock.fd(), resp, sizeof(resp), 0);
+        if (n < 12) return "dns_short";
+        if (((resp[0] << 8) | resp[1]) != id) continue;  // Stale answer
+        int rcode = resp[3] & 0x0F;
+        if (rcode == 2) return "dns_servfail";
+        if (rcode != 0) return "dns_rcode";
+        if (((resp[6] << 8) | resp[7]) == 0) return "dns_noanswer";
+        return "";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// HTTP
+
+// Returns empty string on success and fills status, otherwise the error class
+std::string http_get(const Options &opt, const in_addr &source, const char *host, const char *path,
+                     const char *user_agent, int &status)
+{
+    Socket sock(SOCK_STREAM);
+    if (!sock.ok()) return "tcp_socket";
+    if (!bind_source(sock.fd(), source)) return "bind_source";
+
+    int flags = ::fcntl(sock.fd(), F_GETFL, 0);
+    ::fcntl(sock.fd(), F_SETFL, flags | O_NONBLOCK);
+
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(opt.http_port);
+    inet_pton(AF_INET, opt.host.c_str(), &server.sin_addr);
+
+    if (::connect(sock.fd(), reinterpret_cast<sockaddr *>(&server), sizeof(server)) < 0 && errno != EINPROGRESS) {
+        return errno == ECONNREFUSED ? "connect_refused" : "connect_error";
+    }
+    if (!wait_fd(sock.fd(), POLLOUT, opt.timeout_ms)) return "connect_timeout";
+    int soerr = 0;
+    socklen_t soerr_len = sizeof(soerr);
+    ::getsockopt(sock.fd(), SOL_SOCKET, SO_ERROR, &soerr, &soerr_len);
+    if (soerr == ECONNREFUSED) return "connect_refused";
+    if (soerr == ECONNRESET) return "connect_reset";
+    if (soerr != 0) return "connect_error";
+
+    char request[512];
+    int req_len = std::snprintf(request, sizeof(request),
+                                "GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: %s\r\n"
+                                "Accept: */*\r\nConnection: close\r\n\r\n",
+                                path, host, user_agent);
+    if (::send(sock.fd(), request, req_len, MSG_NOSIGNAL) != req_len) return "send_error";
+
+    std::string response;
+    char buf[2048];
+    auto deadline = Clock::now() + std::chrono::milliseconds(opt.timeout_ms);
+    while (true) {
+        int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (left <= 0 || !wait_fd(sock.fd(), POLLIN, left)) return "recv_timeout";
+        ssize_t n = ::recv(sock.fd(), buf, sizeof(buf), 0);
+        if (n < 0) return errno == ECONNRESET ? "recv_reset" : "recv_error";
+        if (n == 0) break;  // Server closed - response complete
+        response.append(buf, static_cast<size_t>(n));
+        if (response.size() > 256 * 1024) break;
+    }
+
+    if (response.compare(0, 5, "HTTP/") != 0) return "http_parse";
+    size_t sp = response.find(' ');
+    if (sp == std::string::npos) return "http_parse";
+    status = std::atoi(response.c_str() + sp + 1);
+    return status > 0 ? "" : "http_parse";
+}
+
+const char *user_agent_for(const std::string &profile)
+{
+    if (profile == "ios") return "CaptiveNetworkSupport-443.100.2 wispr";
+    if (profile == "android") return "Dalvik/2.1.0 (Linux; U; Android 14)";
+    if (profile == "windows") return "Microsoft NCSI";
+    return "NetworkManager/1.46";
+}
+
+// ---------------------------------------------------------------------------
+// Client
+
+struct Client {
+    int index;
+    const Profile *profile;
+    in_addr source{};
+    bool will_grant;
+};
+
+void run_client(const Options &opt, const Client &client, Stats &stats, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> think(1.0 / std::max(1, opt.think_ms));
+    const char *ua = user_agent_for(client.profile->name);
+    auto join_start = Clock::now();
+    bool failed = false;
+
+    for (const Step &step : client.profile->steps) {
+        if (step.kind == StepKind::Grant) {
+            // Human reads the landing page before tapping Connect
+            std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(think(rng))));
+            if (!client.will_grant) break;
+        }
+
+        auto start = Clock::now();
+        std::string err;
+        int status = 0;
+
+        if (step.kind == StepKind::Dns) {
+            err = dns_query(opt, client.source, step.host, rng);
+        } else {
+            err = http_get(opt, client.source, step.host, step.path, ua, status);
+        }
+
+        double elapsed = ms_since(start);
+        if (!err.empty()) {
+            stats.error(err);
+            // DNS failures don't stop a phone from trying HTTP (it may have cached the answer)
+            if (step.kind != StepKind::Dns) {
+                failed = true;
+                break;
+            }
+            continue;
+        }
+
+        stats.sample(step_name(step.kind), elapsed);
+        if (status) {
+            stats.status(status);
+            // Captive portal contract: probes redirect before /grant and succeed after
+            bool expected = (step.kind == StepKind::Probe) ? (status == 302 || status == 200)
+                          : (step.kind == StepKind::Verify) ? (status == 200)
+                          : (status == 200);
+            if (!expected) {
+                stats.error("http_unexpected_" + std::to_string(status));
+                failed = true;
+                break;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(stats.lock);
+    if (failed) {
+        stats.joins_failed++;
+    } else {
+        stats.joins_ok++;
+        stats.latency_ms["join"].push_back(ms_since(join_start));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Server-side socket census (host build only: reads the kernel's TCP table)
+
+struct SocketCensus {
+    std::atomic<bool> running{true};
+    std::atomic<int> peak_established{0};
+    std::atomic<int> peak_time_wait{0};
+    std::atomic<bool> available{false};
+};
+
+void census_loop(const Options &opt, SocketCensus &census)
+{
+    while (census.running) {
+        std::ifstream tcp("/proc/net/tcp");
+        if (!tcp) return;
+        census.available = true;
+
+        std::string line;
+        std::getline(tcp, line);  // Header
+        int established = 0, time_wait = 0;
+        while (std::getline(tcp, line)) {
+            char local[64], remote[64];
+            unsigned state = 0;
+            if (std::sscanf(line.c_str(), "%*d: %63s %63s %x", local, remote, &state) != 3) continue;
+            const char *colon = std::strchr(local, ':');
+            if (!colon || static_cast<int>(std::strtoul(colon + 1, nullptr, 16)) != opt.http_port) continue;
+            if (state == 0x01) established++;
+            if (state == 0x06) time_wait++;
+        }
+        if (established > census.peak_established) census.peak_established = established;
+        if (time_wait > census.peak_time_wait) census.peak_time_wait = time_wait;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Reporting
+
+double percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void report(const Options &opt, Stats &stats, const SocketCensus &census, double wall_ms)
+{
+    static const char *order[] = {"dns", "probe", "portal", "grant", "verify", "join"};
+
+    if (opt.json) {
+        std::printf("{\"clients\":%d,\"rounds\":%d,\"wall_ms\":%.1f,\"joins_ok\":%d,\"joins_failed\":%d,\"latency\":{",
+                    opt.clients, opt.rounds, wall_ms, stats.joins_ok, stats.joins_failed);
+        bool first = true;
+        for (const char *key : order) {
+            auto &v = stats.latency_ms[key];
+            std::sort(v.begin(), v.end());
+            std::printf("%s\"%s\":{\"n\":%zu,\"p50\":%.2f,\"p95\":%.2f,\"p99\":%.2f,\"max\":%.2f}",
+                        first ? "" : ",", key, v.size(), percentile(v, 50), percentile(v, 95),
+                        percentile(v, 99), v.empty() ? 0.0 : v.back());
+            first = false;
+        }
+        std::printf("},\"errors\":{");
+        first = true;
+        for (auto &e : stats.errors) {
+            std::printf("%s\"%s\":%d", first ? "" : ",", e.first.c_str(), e.second);
+            first = false;
+        }
+        std::printf("},\"sockets\":{\"client_peak\":%d", sockets_peak.load());
+        if (census.available) {
+            std::printf(",\"server_established_peak\":%d,\"server_time_wait_peak\":%d",
+                        census.peak_established.load(), census.peak_time_wait.load());
+        }
+        std::printf("}}\n");
+        return;
+    }
+
+    std::printf("\nCaptive storm: %d clients x %d rounds against %s (http %d, dns %d)\n",
+                opt.clients, opt.rounds, opt.host.c_str(), opt.http_port, opt.dns_port);
+    std::printf("Wall time: %.1f ms | joins ok: %d | failed: %d\n\n", wall_ms, stats.joins_ok, stats.joins_failed);
+
+    std::printf("%-8s %8s %10s %10s %10s %10s\n", "step", "n", "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (const char *key : order) {
+        auto &v = stats.latency_ms[key];
+        std::sort(v.begin(), v.end());
+        std::printf("%-8s %8zu %10.2f %10.2f %10.2f %10.2f\n", key, v.size(),
+                    percentile(v, 50), percentile(v, 95), percentile(v, 99), v.empty() ? 0.0 : v.back());
+    }
+
+    std::printf("\nErrors by class:%s\n", stats.errors.empty() ? " none" : "");
+    for (auto &e : stats.errors) {
+        std::printf("  %-24s %d\n", e.first.c_str(), e.second);
+    }
+
+    std::printf("\nHTTP status:");
+    for (auto &s : stats.http_status) {
+        std::printf(" %s=%d", s.first.c_str(), s.second);
+    }
+    std::printf("\n\nSockets: client peak %d", sockets_peak.load());
+    if (census.available) {
+        std::printf(" | server port %d peak ESTABLISHED %d, TIME_WAIT %d",
+                    opt.http_port, census.peak_established.load(), census.peak_time_wait.load());
+    }
+    std::printf("\n");
+}
+
+// ---------------------------------------------------------------------------
+// CLI
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --host ADDR          Portal address (default 192.168.4.1)\n"
+        "  --http-port N        Portal HTTP port (default 80)\n"
+        "  --dns-port N         DNS proxy port (default 53)\n"
+        "  --clients N          Phones joining per round (default 20)\n"
+        "  --concurrency N      Joins in flight at once, 0 = all (default 0)\n"
+        "  --think-ms N         Mean landing-page think time (default 800)\n"
+        "  --timeout-ms N       Per-request timeout (default 3000)\n"
+        "  --rounds N           Repeat the storm N times (default 1)\n"
+        "  --grant-ratio F      Fraction that tap Connect (default 1.0)\n"
+        "  --mix LIST           OS mix, e.g. ios:45,android:40,windows:10,linux:5\n"
+        "  --source-base ADDR   Bind client i to ADDR+i (e.g. 127.0.0.10 on loopback)\n"
+        "  --seed N             RNG seed (default: time)\n"
+        "  --json               Machine-readable output\n",
+        argv0);
+}
+
+bool parse_args(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&](void) -> const char * {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--host") opt.host = next();
+        else if (arg == "--http-port") opt.http_port = std::atoi(next());
+        else if (arg == "--dns-port") opt.dns_port = std::atoi(next());
+        else if (arg == "--clients") opt.clients = std::atoi(next());
+        else if (arg == "--concurrency") opt.concurrency = std::atoi(next());
+        else if (arg == "--think-ms") opt.think_ms = std::atoi(next());
+        else if (arg == "--timeout-ms") opt.timeout_ms = std::atoi(next());
+        else if (arg == "--rounds") opt.rounds = std::atoi(next());
+        else if (arg == "--grant-ratio") opt.grant_ratio = std::atof(next());
+        else if (arg == "--mix") opt.mix = next();
+        else if (arg == "--source-base") opt.source_base = next();
+        else if (arg == "--seed") opt.seed = static_cast<unsigned>(std::strtoul(next(), nullptr, 10));
+        else if (arg == "--json") opt.json = true;
+        else {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (opt.clients <= 0 || opt.rounds <= 0) {
+        std::fprintf(stderr, "--clients and --rounds must be positive\n");
+        return false;
+    }
+    return true;
+}
+
+// Expand "ios:45,android:40" into a weighted profile picker
+std::vector<std::pair<const Profile *, int>> parse_mix(const std::string &mix)
+{
+    std::vector<std::pair<const Profile *, int>> weights;
+    std::stringstream ss(mix);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+        int weight = colon == std::string::npos ? 1 : std::atoi(item.c_str() + colon + 1);
+        for (const Profile &p : profiles()) {
+            if (name == p.name && weight > 0) weights.emplace_back(&p, weight);
+        }
+    }
+    return weights;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        return 2;
+    }
+    if (opt.seed == 0) {
+        opt.seed = static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count());
+    }
+
+    auto mix = parse_mix(opt.mix);
+    if (mix.empty()) {
+        std::fprintf(stderr, "Empty OS mix: %s\n", opt.mix.c_str());
+        return 2;
+    }
+    int total_weight = 0;
+    for (auto &m : mix) total_weight += m.second;
+
+    in_addr source_base{};
+    if (!opt.source_base.empty() && inet_pton(AF_INET, opt.source_base.c_str(), &source_base) != 1) {
+        std::fprintf(stderr, "Bad --source-base %s\n", opt.source_base.c_str());
+        return 2;
+    }
+
+    std::mt19937 rng(opt.seed);
+    std::vector<Client> clients;
+    for (int i = 0; i < opt.clients; i++) {
+        int pick = static_cast<int>(rng() % total_weight);
+        const Profile *profile = mix.back().first;
+        for (auto &m : mix) {
+            if (pick < m.second) { profile = m.first; break; }
+            pick -= m.second;
+        }
+        Client c{i, profile, {}, std::uniform_real_distribution<double>(0, 1)(rng) < opt.grant_ratio};
+        if (source_base.s_addr) {
+            c.source.s_addr = htonl(ntohl(source_base.s_addr) + i);
+        }
+        clients.push_back(c);
+    }
+
+    Stats stats;
+    SocketCensus census;
+    std::thread census_thread(census_loop, std::cref(opt), std::ref(census));
+
+    int workers = opt.concurrency > 0 ? std::min(opt.concurrency, opt.clients) : opt.clients;
+    auto wall_start = Clock::now();
+
+    for (int round = 0; round < opt.rounds; round++) {
+        std::atomic<int> next{0};
+        std::vector<std::thread> pool;
+        for (int w = 0; w < workers; w++) {
+            pool.emplace_back([&, round]() {
+                int i;
+                while ((i = next++) < opt.clients) {
+                    run_client(opt, clients[i], stats, opt.seed ^ (round * 7919u + i));
+                }
+            });
+        }
+        for (auto &t : pool) t.join();
+    }
+
+    double wall_ms = ms_since(wall_start);
+    census.running = false;
+    census_thread.join();
+
+    report(opt, stats, census, wall_ms);
+    return stats.joins_failed == 0 ? 0 : 1;
+}
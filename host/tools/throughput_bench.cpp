@@ -0,0 +1,495 @@
+// Throughput bench client for the firmware's bench server (TCP/UDP 5201)
+//
+// Drives one test per run and prints what both ends saw: the rate measured
+// here plus the device's own counters, per-core CPU and heap low-water mark.
+//   tcp-up / tcp-down   TCP to or from the stick itself
+//   udp-up / udp-down   sequence-numbered datagrams, loss counted at the receiver
+//   relay               TCP through the stick's NAPT to a host on the uplink,
+//                       which runs "throughput_bench serve"
+//
+//   throughput_bench --mode tcp-up --seconds 10
+//   throughput_bench serve --port 5202            (on the upstream box)
+//   throughput_bench --mode relay --relay 192.168.1.20:5202
+//
+// Against the host build on loopback: --host 127.0.0.1 (CPU reads as n/a)
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kUdpPayload = 1470;   // Matches BENCH_UDP_PAYLOAD
+constexpr int kTailMs = 5000;       // Wait for the device's result after the run
+
+struct Options {
+    std::string host = "192.168.4.1";
+    int port = 5201;
+    std::string mode = "tcp-up";
+    int seconds = 10;
+    int kbps = 0;                   // UDP rate, 0 = default for the mode
+    std::string relay;              // host:port of a "serve" sink
+    bool json = false;
+    bool serve = false;
+};
+
+// What this end measured
+struct Local {
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    uint64_t lost = 0;
+    double ms = 0;
+};
+
+double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+bool wait_fd(int fd, short events, int timeout_ms)
+{
+    pollfd pfd{fd, events, 0};
+    return ::poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & (events | POLLHUP | POLLERR));
+}
+
+bool resolve(const std::string &host, int port, sockaddr_in &addr)
+{
+    addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1;
+}
+
+int connect_tcp(const std::string &host, int port)
+{
+    sockaddr_in addr;
+    if (!resolve(host, port, addr)) {
+        std::fprintf(stderr, "Bad address %s\n", host.c_str());
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        std::fprintf(stderr, "connect %s:%d: %s\n", host.c_str(), port, std::strerror(errno));
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One newline-terminated line, or empty on timeout/EOF
+std::string read_line(int fd, int timeout_ms)
+{
+    std::string line;
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (left <= 0 || !wait_fd(fd, POLLIN, left)) return "";
+        char c;
+        if (::recv(fd, &c, 1, 0) != 1) return "";
+        if (c == '\n') return line;
+        line += c;
+    }
+}
+
+bool send_all(int fd, const std::string &s)
+{
+    return ::send(fd, s.data(), s.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(s.size());
+}
+
+// Send the command and wait for the device's GO (it takes a CPU baseline first)
+int start_test(const Options &opt, const std::string &command)
+{
+    int fd = connect_tcp(opt.host, opt.port);
+    if (fd < 0) return -1;
+    if (!send_all(fd, command + "\n")) {
+        ::close(fd);
+        return -1;
+    }
+    std::string reply = read_line(fd, 3000);
+    if (reply != "GO") {
+        std::fprintf(stderr, "Device refused: %s\n", reply.empty() ? "(no answer)" : reply.c_str());
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+uint32_t read_seq(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+// ---------------------------------------------------------------------------
+// Tests
+
+// Push TCP at fd until the clock runs out
+void push_tcp(int fd, int seconds, Local &local)
+{
+    static char buf[16384];
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    while (Clock::now() < end) {
+        if (!wait_fd(fd, POLLOUT, 100)) continue;
+        ssize_t n = ::send(fd, buf, sizeof(buf), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            local.bytes += static_cast<uint64_t>(n);
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            break;
+        }
+    }
+    local.ms = ms_since(start);
+    local.packets = (local.bytes + 1459) / 1460;
+}
+
+std::string run_tcp_up(const Options &opt, Local &local)
+{
+    int fd = start_test(opt, "TCP_SINK " + std::to_string(opt.seconds));
+    if (fd < 0) return "";
+    push_tcp(fd, opt.seconds, local);
+    ::shutdown(fd, SHUT_WR);
+    std::string result = read_line(fd, kTailMs);
+    ::close(fd);
+    return result;
+}
+
+std::string run_tcp_down(const Options &opt, Local &local)
+{
+    int fd = start_test(opt, "TCP_SOURCE " + std::to_string(opt.seconds));
+    if (fd < 0) return "";
+    static char buf[16384];
+    auto start = Clock::now();
+    while (wait_fd(fd, POLLIN, kTailMs)) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        local.bytes += static_cast<uint64_t>(n);
+    }
+    local.ms = ms_since(start);
+    local.packets = (local.bytes + 1459) / 1460;
+    ::close(fd);
+
+    // The data connection carried no result; ask on a fresh one
+    fd = connect_tcp(opt.host, opt.port);
+    if (fd < 0) return "";
+    send_all(fd, "RESULT\n");
+    std::string result = read_line(fd, kTailMs);
+    ::close(fd);
+    return result;
+}
+
+std::string run_udp_up(const Options &opt, Local &local)
+{
+    int ctrl = start_test(opt, "UDP_SINK " + std::to_string(opt.seconds));
+    if (ctrl < 0) return "";
+    int udp = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in dest;
+    resolve(opt.host, opt.port, dest);
+
+    uint8_t buf[kUdpPayload] = {};
+    int kbps = opt.kbps > 0 ? opt.kbps : 10000;
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(opt.seconds);
+    uint32_t seq = 0;
+    for (auto now = start; now < end; now = Clock::now()) {
+        double budget = kbps * 1000.0 / 8 * std::chrono::duration<double>(now - start).count();
+        if (static_cast<double>(local.bytes) > budget) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        buf[0] = static_cast<uint8_t>(seq >> 24);
+        buf[1] = static_cast<uint8_t>(seq >> 16);
+        buf[2] = static_cast<uint8_t>(seq >> 8);
+        buf[3] = static_cast<uint8_t>(seq);
+        if (::sendto(udp, buf, sizeof(buf), 0, reinterpret_cast<sockaddr *>(&dest), sizeof(dest)) == kUdpPayload) {
+            local.bytes += kUdpPayload;
+            local.packets++;
+            seq++;
+        }
+    }
+    local.ms = ms_since(start);
+    ::close(udp);
+
+    // Give the last datagrams a moment to land before telling the device we're done
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ::shutdown(ctrl, SHUT_WR);
+    std::string result = read_line(ctrl, kTailMs);
+    ::close(ctrl);
+    return result;
+}
+
+std::string run_udp_down(const Options &opt, Local &local)
+{
+    int udp = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in any{};
+    any.sin_family = AF_INET;
+    socklen_t len = sizeof(any);
+    if (udp < 0 || ::bind(udp, reinterpret_cast<sockaddr *>(&any), sizeof(any)) < 0 ||
+        ::getsockname(udp, reinterpret_cast<sockaddr *>(&any), &len) < 0) {
+        std::fprintf(stderr, "UDP socket: %s\n", std::strerror(errno));
+        return "";
+    }
+    int rcvbuf = 4 << 20;
+    ::setsockopt(udp, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    int kbps = opt.kbps > 0 ? opt.kbps : 10000;
+    int ctrl = start_test(opt, "UDP_SOURCE " + std::to_string(opt.seconds) + " " + std::to_string(kbps) +
+                               " " + std::to_string(ntohs(any.sin_port)));
+    if (ctrl < 0) {
+        ::close(udp);
+        return "";
+    }
+
+    uint8_t buf[2048];
+    uint32_t highest = 0;
+    std::string result;
+    auto start = Clock::now();
+    auto last_rx = start;
+    while (true) {
+        pollfd fds[2] = {{udp, POLLIN, 0}, {ctrl, POLLIN, 0}};
+        if (::poll(fds, 2, (opt.seconds * 1000) + kTailMs) <= 0) break;
+        if (fds[0].revents & POLLIN) {
+            ssize_t n = ::recv(udp, buf, sizeof(buf), 0);
+            if (n >= 4) {
+                uint32_t seq = read_seq(buf);
+                if (local.packets == 0 || seq > highest) highest = seq;
+                local.bytes += static_cast<uint64_t>(n);
+                local.packets++;
+                last_rx = Clock::now();
+            }
+            continue;   // Drain datagrams before reading the result
+        }
+        if (fds[1].revents) {
+            result = read_line(ctrl, kTailMs);
+            break;
+        }
+    }
+    local.ms = std::chrono::duration<double, std::milli>(last_rx - start).count();
+    if (local.packets > 0 && highest + 1 > local.packets) {
+        local.lost = highest + 1 - local.packets;
+    }
+    ::close(ctrl);
+    ::close(udp);
+    return result;
+}
+
+std::string run_relay(const Options &opt, Local &local)
+{
+    size_t colon = opt.relay.rfind(':');
+    if (colon == std::string::npos) {
+        std::fprintf(stderr, "--relay needs host:port\n");
+        return "";
+    }
+    std::string sink_host = opt.relay.substr(0, colon);
+    int sink_port = std::atoi(opt.relay.c_str() + colon + 1);
+
+    int ctrl = start_test(opt, "RELAY " + std::to_string(opt.seconds));
+    if (ctrl < 0) return "";
+    int data = connect_tcp(sink_host, sink_port);
+    if (data >= 0) {
+        push_tcp(data, opt.seconds, local);
+        ::close(data);
+    }
+    ::shutdown(ctrl, SHUT_WR);
+    std::string result = read_line(ctrl, kTailMs);
+    ::close(ctrl);
+    return result;
+}
+
+// Upstream end of the relay test: accept and discard
+int serve(const Options &opt)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, 4) < 0) {
+        std::fprintf(stderr, "listen :%d: %s\n", opt.port, std::strerror(errno));
+        return 1;
+    }
+    std::fprintf(stderr, "Discarding TCP on port %d\n", opt.port);
+    while (true) {
+        sockaddr_in peer{};
+        socklen_t len = sizeof(peer);
+        int conn = ::accept(fd, reinterpret_cast<sockaddr *>(&peer), &len);
+        if (conn < 0) continue;
+        std::thread([conn, peer]() {
+            static thread_local char buf[65536];
+            uint64_t total = 0;
+            auto start = Clock::now();
+            ssize_t n;
+            while ((n = ::recv(conn, buf, sizeof(buf), 0)) > 0) total += static_cast<uint64_t>(n);
+            double ms = ms_since(start);
+            std::fprintf(stderr, "%s: %.2f Mbit/s over %.1f s\n", inet_ntoa(peer.sin_addr),
+                         ms > 0 ? total * 8 / ms / 1000 : 0.0, ms / 1000);
+            ::close(conn);
+        }).detach();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Reporting
+
+// Numeric field from the device's flat JSON line; -1 if absent or null
+long long json_number(const std::string &json, const char *key)
+{
+    std::string needle = std::string("\"") + key + "\":";
+    size_t pos = json.find(needle);
+    if (pos == std::string::npos) return -1;
+    const char *p = json.c_str() + pos + needle.size();
+    if (*p == '[') p++;
+    if (std::strncmp(p, "null", 4) == 0) return -1;
+    return std::strtoll(p, nullptr, 10);
+}
+
+// Second element of the "cpu" array
+long long json_cpu1(const std::string &json)
+{
+    size_t pos = json.find("\"cpu\":[");
+    if (pos == std::string::npos) return -1;
+    size_t comma = json.find(',', pos);
+    if (comma == std::string::npos || std::strncmp(json.c_str() + comma + 1, "null", 4) == 0) return -1;
+    return std::strtoll(json.c_str() + comma + 1, nullptr, 10);
+}
+
+void report(const Options &opt, const Local &local, const std::string &device)
+{
+    double mbps = local.ms > 0 ? local.bytes * 8 / local.ms / 1000 : 0.0;
+    double pps = local.ms > 0 ? local.packets * 1000 / local.ms : 0.0;
+
+    if (opt.json) {
+        std::printf("{\"mode\":\"%s\",\"seconds\":%d,\"local\":{\"ms\":%.1f,\"bytes\":%llu,\"packets\":%llu,"
+                    "\"lost\":%llu,\"mbps\":%.3f,\"pps\":%.1f},\"device\":%s}\n",
+                    opt.mode.c_str(), opt.seconds, local.ms, static_cast<unsigned long long>(local.bytes),
+                    static_cast<unsigned long long>(local.packets), static_cast<unsigned long long>(local.lost),
+                    mbps, pps, device.empty() ? "null" : device.c_str());
+        return;
+    }
+
+    std::printf("\nThroughput bench: %s for %d s against %s:%d\n", opt.mode.c_str(), opt.seconds,
+                opt.host.c_str(), opt.port);
+    std::printf("  here    %8.2f Mbit/s %9.0f pkt/s  %llu bytes",
+                mbps, pps, static_cast<unsigned long long>(local.bytes));
+    if (opt.mode == "udp-down") {
+        std::printf("  lost %llu", static_cast<unsigned long long>(local.lost));
+    }
+    std::printf("\n");
+
+    if (device.empty()) {
+        std::printf("  device  no result\n");
+        return;
+    }
+    long long kbps = json_number(device, "kbps");
+    long long cpu0 = json_number(device, "cpu");
+    long long cpu1 = json_cpu1(device);
+    std::printf("  device  %8.2f Mbit/s %9lld pkt/s  %lld bytes", kbps / 1000.0, json_number(device, "pps"),
+                json_number(device, "bytes"));
+    if (opt.mode == "udp-up") {
+        std::printf("  lost %lld", json_number(device, "lost"));
+    }
+    if (json_number(device, "errors") > 0) {
+        std::printf("  send errors %lld", json_number(device, "errors"));
+    }
+    std::printf("\n  cpu     ");
+    if (cpu0 < 0 && cpu1 < 0) {
+        std::printf("n/a");
+    } else {
+        std::printf("core0 %lld%%  core1 %lld%%", cpu0, cpu1);
+    }
+    std::printf("\n  heap    %lld free at start, %lld lowest\n",
+                json_number(device, "heap_free"), json_number(device, "heap_min"));
+}
+
+// ---------------------------------------------------------------------------
+// CLI
+
+void usage(const char *argv0)
+{
+    std::fprintf(stderr,
+        "Usage: %s [options]\n"
+        "       %s serve [--port N]\n"
+        "  --host ADDR          Bench server address (default 192.168.4.1)\n"
+        "  --port N             Bench server port, or the serve port (default 5201)\n"
+        "  --mode M             tcp-up, tcp-down, udp-up, udp-down or relay (default tcp-up)\n"
+        "  --seconds N          Test length, 1-60 (default 10)\n"
+        "  --kbps N             UDP send rate (default 10000)\n"
+        "  --relay HOST:PORT    Upstream \"serve\" sink for --mode relay\n"
+        "  --json               Machine-readable output\n",
+        argv0, argv0);
+}
+
+bool parse_args(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&](void) -> const char * {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "serve" && i == 1) opt.serve = true;
+        else if (arg == "--host") opt.host = next();
+        else if (arg == "--port") opt.port = std::atoi(next());
+        else if (arg == "--mode") opt.mode = next();
+        else if (arg == "--seconds") opt.seconds = std::atoi(next());
+        else if (arg == "--kbps") opt.kbps = std::atoi(next());
+        else if (arg == "--relay") opt.relay = next();
+        else if (arg == "--json") opt.json = true;
+        else {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (opt.seconds < 1 || opt.seconds > 60) {
+        std::fprintf(stderr, "--seconds must be 1-60\n");
+        return false;
+    }
+    if (opt.mode == "relay" && opt.relay.empty() && !opt.serve) {
+        std::fprintf(stderr, "--mode relay needs --relay HOST:PORT\n");
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        return 2;
+    }
+    if (opt.serve) {
+        return serve(opt);
+    }
+
+    Local local;
+    std::string device;
+    if (opt.mode == "tcp-up") device = run_tcp_up(opt, local);
+    else if (opt.mode == "tcp-down") device = run_tcp_down(opt, local);
+    else if (opt.mode == "udp-up") device = run_udp_up(opt, local);
+    else if (opt.mode == "udp-down") device = run_udp_down(opt, local);
+    else if (opt.mode == "relay") device = run_relay(opt, local);
+    else {
+        usage(argv[0]);
+        return 2;
+    }
+
+    report(opt, local, device);
+    return device.empty() ? 1 : 0;
+}
@@ -1,13 +1,32 @@
 #include "captive_portal.h"
+#include "admission.h"
+#include "bench_server.h"
+#include "channel_plan.h"
+#include "client_stats.h"
+#include "client_table.h"
+#include "dhcp_leases.h"
 #include "dns_server.h"
+#include "fleet_sync.h"
+#include "form_parser.h"
 #include "log_capture.h"
+#include "mss_clamp.h"
+#include "napt_monitor.h"
 #include "ota_manager.h"
+#include "pcap_ring.h"
 #include "portal_mode.h"
+#include "shaper.h"
+#include "uplink_monitor.h"
+#include "visitor_log.h"
+#include "wifi_sta.h"
+#include "uri_router.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
+#include "esp_netif.h"
 #include "esp_ota_ops.h"
 #include "esp_wifi.h"
 #include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "lwip/sockets.h"
 #include <stdlib.h>
 #include <string.h>
@@ -20,6 +39,64 @@ static httpd_handle_t portal_server = NULL;
 // Buffer for serving logs (16KB should be plenty)
 #define LOG_RESPONSE_BUFFER_SIZE (16 * 1024)
 
+// Peer IPv4 of a socket (handles IPv6-mapped), 0 if unknown
+static uint32_t sock_peer_ip(int sockfd)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_size = sizeof(addr);
+    if (sockfd < 0 || getpeername(sockfd, (struct sockaddr *)&addr, &addr_size) != 0) {
+        return 0;
+    }
+
+    if (addr.ss_family == AF_INET) {
+        return ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
+    } else if (addr.ss_family == AF_INET6) {
+        uint8_t *bytes = ((struct sockaddr_in6 *)&addr)->sin6_addr.s6_addr;
+        if (bytes[10] == 0xFF && bytes[11] == 0xFF) {
+            return bytes[12] | (bytes[13] << 8) | (bytes[14] << 16) | (bytes[15] << 24);
+        }
+    }
+    return 0;
+}
+
+// Get client IPv4 from the request socket, 0 if unknown
+static uint32_t get_client_ip(httpd_req_t *req)
+{
+    return sock_peer_ip(httpd_req_to_sockfd(req));
+}
+
+// Operator-only endpoints (fleet key, packet capture) answer the venue network
+// - a peer reaching us over the STA interface - never a phone on the open AP,
+// approved or not
+static bool request_from_uplink(httpd_req_t *req)
+{
+    uint32_t ip = get_client_ip(req);
+    esp_netif_ip_info_t ap;
+    if (ip == 0 || esp_netif_get_ip_info(esp_netif_get_handle_from_ifkey("WIFI_AP_DEF"), &ap) != ESP_OK) {
+        return false;
+    }
+    client_entry_t station;
+    return (ip & ap.netmask.addr) != (ap.ip.addr & ap.netmask.addr) && !client_table_find_ip(ip, &station);
+}
+
+// 403 for AP clients; true if the handler may go on
+static bool require_uplink(httpd_req_t *req)
+{
+    if (request_from_uplink(req)) {
+        return true;
+    }
+    httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Only available from the venue network");
+    return false;
+}
+
+// Every new portal connection counts as activity for admission control
+static esp_err_t session_open(httpd_handle_t hd, int sockfd)
+{
+    (void)hd;
+    client_table_touch_ip(sock_peer_ip(sockfd));
+    return ESP_OK;
+}
+
 // Landing pages removed - portal now redirects straight to /wifi scanner
 // WiFi Setup Portal - Shown when device needs configuration (UNUSED - kept for reference)
 /*
@@ -117,6 +194,7 @@ static const char LABORATORY_HTML[] =
 static esp_err_t root_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, ">>> ROOT PAGE REQUEST (landing page)");
+    visitor_log_page_hit(get_client_ip(req));
 
     // Show Laboratory landing page - user must tap Connect to get approved
     const char* landing_html =
@@ -155,13 +233,6 @@ static esp_err_t root_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t root_uri = {
-    .uri       = "/",
-    .method    = HTTP_GET,
-    .handler   = root_handler,
-    .user_ctx  = NULL
-};
-
 // Debug logs handler - serves captured logs as plain text
 static esp_err_t logs_handler(httpd_req_t *req)
 {
@@ -189,13 +260,6 @@ static esp_err_t logs_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t logs_uri = {
-    .uri       = "/debug/logs",
-    .method    = HTTP_GET,
-    .handler   = logs_handler,
-    .user_ctx  = NULL
-};
-
 // Recent logs handler - serves last N lines (default 20)
 static esp_err_t logs_recent_handler(httpd_req_t *req)
 {
@@ -208,13 +272,16 @@ static esp_err_t logs_recent_handler(httpd_req_t *req)
     }
 
     // Get query parameter for number of lines
-    char query[32];
     int num_lines = 20; // default
-    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
-        char param[16];
-        if (httpd_query_key_value(query, "lines", param, sizeof(param)) == ESP_OK) {
-            num_lines = atoi(param);
+    form_span_t lines;
+    if (form_find(form_query(req), "lines", &lines)) {
+        long value;
+        if (form_decode_long(lines, 1, LOG_BUFFER_SIZE, &value) != ESP_OK) {
+            free(log_buffer);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid lines parameter");
+            return ESP_FAIL;
         }
+        num_lines = (int)value;
     }
 
     // Get recent logs
@@ -231,13 +298,6 @@ static esp_err_t logs_recent_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t logs_recent_uri = {
-    .uri       = "/debug/recent",
-    .method    = HTTP_GET,
-    .handler   = logs_recent_handler,
-    .user_ctx  = NULL
-};
-
 // OTA update handler - accepts firmware binary via POST
 static esp_err_t ota_upload_handler(httpd_req_t *req)
 {
@@ -328,13 +388,6 @@ static esp_err_t ota_upload_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t ota_upload_uri = {
-    .uri       = "/ota",
-    .method    = HTTP_POST,
-    .handler   = ota_upload_handler,
-    .user_ctx  = NULL
-};
-
 // OTA page handler - serves upload form
 static esp_err_t ota_page_handler(httpd_req_t *req)
 {
@@ -389,13 +442,6 @@ static esp_err_t ota_page_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t ota_page_uri = {
-    .uri       = "/update",
-    .method    = HTTP_GET,
-    .handler   = ota_page_handler,
-    .user_ctx  = NULL
-};
-
 // WiFi settings page - white background Laboratory style
 static esp_err_t wifi_page_handler(httpd_req_t *req)
 {
@@ -446,11 +492,17 @@ static esp_err_t wifi_page_handler(httpd_req_t *req)
     "  document.getElementById('networks').innerHTML='<div class=\"scanning\">Scanning...</div>';"
     "  const res=await fetch('/wifi/scan');"
     "  const networks=await res.json();"
-    "  let html='';"
+    "  const list=document.getElementById('networks');"
+    "  list.textContent='';"
+    // SSIDs come from anyone's AP - text nodes only, never markup
     "  networks.forEach(n=>{"
-    "    html+=`<div class='network' onclick='select(\"${n.ssid}\",${n.auth})'><span>${n.ssid}</span><span style='color:#666;font-size:0.9em;'>${n.rssi}dBm ${n.auth?'🔒':''}</span></div>`;"
+    "    const row=document.createElement('div');row.className='network';row.onclick=()=>select(n.ssid,n.auth);"
+    "    const name=document.createElement('span');name.textContent=n.ssid;"
+    "    const info=document.createElement('span');info.style.cssText='color:#666;font-size:0.9em;';"
+    "    info.textContent=n.rssi+'dBm '+(n.auth?'🔒':'');"
+    "    row.append(name,info);list.append(row);"
     "  });"
-    "  document.getElementById('networks').innerHTML=html||'<div class=\"scanning\">No networks found</div>';"
+    "  if(!networks.length)list.innerHTML='<div class=\"scanning\">No networks found</div>';"
     "}"
     "function select(ssid,auth){"
     "  selectedSSID=ssid;"
@@ -483,13 +535,6 @@ static esp_err_t wifi_page_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t wifi_page_uri = {
-    .uri       = "/wifi",
-    .method    = HTTP_GET,
-    .handler   = wifi_page_handler,
-    .user_ctx  = NULL
-};
-
 // File transfer page - simple upload interface
 static esp_err_t transfer_page_handler(httpd_req_t *req)
 {
@@ -536,12 +581,26 @@ static esp_err_t transfer_page_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t transfer_page_uri = {
-    .uri       = "/transfer",
-    .method    = HTTP_GET,
-    .handler   = transfer_page_handler,
-    .user_ctx  = NULL
-};
+// SSIDs are arbitrary bytes: a 32-byte one escapes to at most 6 chars per byte
+#define SSID_JSON_MAX (32 * 6 + 1)
+
+// Escape for a JSON string body: quote, backslash and control characters
+static void json_escape(const char *in, char *out, size_t out_size)
+{
+    size_t n = 0;
+    for (; *in && n + 7 <= out_size; in++) {
+        unsigned char c = (unsigned char)*in;
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = (char)c;
+        } else if (c < 0x20) {
+            n += snprintf(out + n, out_size - n, "\\u%04x", c);
+        } else {
+            out[n++] = (char)c;
+        }
+    }
+    out[n] = '\0';
+}
 
 // WiFi scan handler - returns JSON list of available networks
 static esp_err_t wifi_scan_handler(httpd_req_t *req)
@@ -580,161 +639,204 @@ static esp_err_t wifi_scan_handler(httpd_req_t *req)
 
     esp_wifi_scan_get_ap_records(&ap_count, ap_list);
 
-    // Build JSON response
-    char *json_buf = malloc(4096);
-    if (!json_buf) {
-        free(ap_list);
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-
-    int offset = 0;
-    offset += snprintf(json_buf + offset, 4096 - offset, "[");
+    // Build JSON response, one network per chunk
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send_chunk(req, "[", 1);
 
+    char ssid[SSID_JSON_MAX];
+    char entry[SSID_JSON_MAX + 64];
     for (int i = 0; i < ap_count && i < 20; i++) { // Limit to 20 networks
-        if (i > 0) offset += snprintf(json_buf + offset, 4096 - offset, ",");
-        offset += snprintf(json_buf + offset, 4096 - offset,
-            "{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":%s}",
-            ap_list[i].ssid,
+        json_escape((const char *)ap_list[i].ssid, ssid, sizeof(ssid));
+        int len = snprintf(entry, sizeof(entry),
+            "%s{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":%s}",
+            i > 0 ? "," : "", ssid,
             ap_list[i].rssi,
             ap_list[i].authmode == WIFI_AUTH_OPEN ? "false" : "true"
         );
+        if (httpd_resp_send_chunk(req, entry, len) != ESP_OK) {
+            free(ap_list);
+            return ESP_FAIL;
+        }
     }
-
-    offset += snprintf(json_buf + offset, 4096 - offset, "]");
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_buf, HTTPD_RESP_USE_STRLEN);
-
-    free(json_buf);
     free(ap_list);
+
+    httpd_resp_send_chunk(req, "]", 1);
+    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
-static const httpd_uri_t wifi_scan_uri = {
-    .uri       = "/wifi/scan",
-    .method    = HTTP_GET,
-    .handler   = wifi_scan_handler,
-    .user_ctx  = NULL
-};
+// Fields of the setup form, decoded straight out of the receive buffer
+typedef struct {
+    char ssid[33];        // 32 bytes max, as in wifi_sta_config_t
+    char password[65];    // 63-char passphrase or 64 hex digits
+    bool has_ssid;
+    bool has_password;
+} wifi_form_t;
 
-static esp_err_t wifi_connect_handler(httpd_req_t *req)
+static esp_err_t wifi_form_field(const form_field_t *field, void *ctx)
 {
-    char buf[256];
-    int ret, remaining = req->content_len;
+    wifi_form_t *form = (wifi_form_t *)ctx;
 
-    if (remaining >= sizeof(buf)) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Payload too large");
-        return ESP_FAIL;
+    if (form_span_eq(field->name, "ssid")) {
+        form->has_ssid = true;
+        return form_decode(field->value, form->ssid, sizeof(form->ssid), NULL);
     }
+    if (form_span_eq(field->name, "password")) {
+        form->has_password = true;
+        return form_decode(field->value, form->password, sizeof(form->password), NULL);
+    }
+    return ESP_OK;  // Ignore unknown fields
+}
 
-    ret = httpd_req_recv(req, buf, remaining);
-    if (ret <= 0) {
+static esp_err_t wifi_connect_handler(httpd_req_t *req)
+{
+    // Parse form data: ssid=xxx&password=yyy (urlencoded or multipart)
+    char scratch[256];
+    wifi_form_t form = {0};
+    static const form_handlers_t handlers = { .field = wifi_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &form);
+    if (err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SSID or password too long");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed form data");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
         return ESP_FAIL;
     }
-    buf[ret] = '\0';
-
-    // Parse form data: ssid=xxx&password=yyy
-    char ssid[33] = {0};
-    char password[64] = {0};
 
-    char *ssid_start = strstr(buf, "ssid=");
-    char *pass_start = strstr(buf, "password=");
-
-    if (!ssid_start || !pass_start) {
+    if (!form.has_ssid || !form.has_password || form.ssid[0] == '\0') {
         httpd_resp_send(req, "Missing SSID or password", HTTPD_RESP_USE_STRLEN);
         return ESP_FAIL;
     }
 
-    // URL decode and extract SSID
-    ssid_start += 5; // Skip "ssid="
-    char *ssid_end = strchr(ssid_start, '&');
-    if (ssid_end) {
-        int len = ssid_end - ssid_start;
-        if (len > 32) len = 32;
-        strncpy(ssid, ssid_start, len);
-        // Simple URL decode for spaces
-        for (int i = 0; ssid[i]; i++) {
-            if (ssid[i] == '+') ssid[i] = ' ';
+    const char *ssid = form.ssid;
+    const char *password = form.password;
+
+    ESP_LOGI(TAG, "WiFi connect request: SSID='%s'", ssid);
+
+    // Adds it to the saved networks (or updates its password) and joins it now
+    wifi_sta_connect(ssid, password);
+
+    httpd_resp_send(req, "✅ SUCCESS! Connecting to WiFi network. You can close this page.", HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Saved uplink networks, best candidate first (passwords never leave the device)
+static esp_err_t networks_get_handler(httpd_req_t *req)
+{
+    wifi_sta_network_t networks[WIFI_STA_MAX_NETWORKS];
+    size_t count = wifi_sta_list(networks, WIFI_STA_MAX_NETWORKS);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, "[", 1);
+
+    // Escaped SSIDs can be six times their length; a chunk per network
+    // keeps that off one fixed buffer
+    char ssid[SSID_JSON_MAX];
+    char entry[SSID_JSON_MAX + 160];
+    for (size_t i = 0; i < count; i++) {
+        json_escape(networks[i].ssid, ssid, sizeof(ssid));
+        int len = snprintf(entry, sizeof(entry),
+            "%s{\"ssid\":\"%s\",\"priority\":%u,\"rssi\":%d,\"connected\":%s,"
+            "\"last_success\":%lu,\"throughput_kbps\":%lu}",
+            i > 0 ? "," : "", ssid, networks[i].priority, networks[i].rssi,
+            networks[i].connected ? "true" : "false",
+            (unsigned long)networks[i].last_success, (unsigned long)networks[i].throughput_kbps);
+        if (httpd_resp_send_chunk(req, entry, len) != ESP_OK) {
+            return ESP_FAIL;
         }
     }
 
-    // URL decode and extract password
-    pass_start += 9; // Skip "password="
-    strncpy(password, pass_start, 63);
-    // Simple URL decode for spaces
-    for (int i = 0; password[i]; i++) {
-        if (password[i] == '+') password[i] = ' ';
-    }
+    httpd_resp_send_chunk(req, "]", 1);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "WiFi connect request: SSID='%s'", ssid);
+typedef struct {
+    char ssid[33];
+    long priority;        // -1 = unchanged
+    bool forget;
+} networks_form_t;
 
-    // Save to NVS
-    nvs_handle_t nvs;
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &nvs);
-    if (err == ESP_OK) {
-        nvs_set_str(nvs, "wifi_ssid", ssid);
-        nvs_set_str(nvs, "wifi_pass", password);
-        nvs_commit(nvs);
-        nvs_close(nvs);
-        ESP_LOGI(TAG, "WiFi credentials saved to NVS");
+static esp_err_t networks_form_field(const form_field_t *field, void *ctx)
+{
+    networks_form_t *form = (networks_form_t *)ctx;
+
+    if (form_span_eq(field->name, "ssid")) {
+        return form_decode(field->value, form->ssid, sizeof(form->ssid), NULL);
+    }
+    if (form_span_eq(field->name, "priority")) {
+        return form_decode_long(field->value, 0, WIFI_STA_PRIORITY_MAX, &form->priority);
+    }
+    if (form_span_eq(field->name, "forget")) {
+        form->forget = true;
     }
+    return ESP_OK;  // Ignore unknown fields
+}
 
-    // Update WiFi config and reconnect
-    wifi_config_t wifi_config = {0};
-    strncpy((char*)wifi_config.sta.ssid, ssid, 32);
-    strncpy((char*)wifi_config.sta.password, password, 64);
+// Edit one saved network: ssid plus priority (0-9) and/or forget. Not from AP clients
+static esp_err_t networks_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[128];
+    networks_form_t form = { .priority = -1 };
+    static const form_handlers_t handlers = { .field = networks_form_field };
 
-    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
-    esp_wifi_disconnect();
-    esp_wifi_connect();
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &form);
+    if (err == ESP_OK && form.ssid[0] == '\0') {
+        err = ESP_ERR_INVALID_ARG;
+    }
+    if (err == ESP_OK && form.priority >= 0) {
+        err = wifi_sta_set_priority(form.ssid, (uint8_t)form.priority);
+    }
+    if (err == ESP_OK && form.forget) {
+        err = wifi_sta_forget(form.ssid);
+    }
 
-    httpd_resp_send(req, "✅ SUCCESS! Connecting to WiFi network. You can close this page.", HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Needs ssid, and priority 0-9 or forget");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such saved network");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save networks");
+        return ESP_FAIL;
+    }
+    return networks_get_handler(req);
 }
 
-static const httpd_uri_t wifi_connect_uri = {
-    .uri       = "/wifi/connect",
-    .method    = HTTP_POST,
-    .handler   = wifi_connect_handler,
-    .user_ctx  = NULL
-};
-
 // Grant internet access handler - approves client via DNS filtering
 static esp_err_t grant_access_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, ">>> GRANT ACCESS REQUEST");
 
-    // Get client IP from socket (handles both IPv4 and IPv6-mapped)
-    int sockfd = httpd_req_to_sockfd(req);
-    uint32_t client_ip = 0;
-
-    if (sockfd >= 0) {
-        struct sockaddr_storage addr;
-        socklen_t addr_size = sizeof(addr);
-        if (getpeername(sockfd, (struct sockaddr *)&addr, &addr_size) == 0) {
-            if (addr.ss_family == AF_INET) {
-                client_ip = ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
-            } else if (addr.ss_family == AF_INET6) {
-                uint8_t *bytes = ((struct sockaddr_in6 *)&addr)->sin6_addr.s6_addr;
-                if (bytes[10] == 0xFF && bytes[11] == 0xFF) {
-                    client_ip = bytes[12] | (bytes[13] << 8) | (bytes[14] << 16) | (bytes[15] << 24);
-                }
-            }
-        }
+    // Approval binds to the station's MAC via its DHCP lease - never guess
+    // an address, that would unlock whichever phone happens to hold it
+    uint32_t client_ip = get_client_ip(req);
+    if (client_ip == 0 || dns_approve_client(client_ip) != ESP_OK) {
+        ESP_LOGW(TAG, ">>> GRANT REFUSED - no station lease for this request");
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "text/html");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        httpd_resp_send(req,
+            "<HTML><HEAD><TITLE>Try again</TITLE></HEAD><BODY>"
+            "<div style='text-align:center;padding:50px;font-family:-apple-system,sans-serif;'>"
+            "Couldn't identify your device. Reconnect to the WiFi and tap Connect again."
+            "</div></BODY></HTML>", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
     }
 
-    if (client_ip != 0) {
-        uint8_t *ip = (uint8_t*)&client_ip;
-        ESP_LOGI(TAG, ">>> APPROVING CLIENT: %d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-        dns_approve_client(client_ip);
-    } else {
-        // Fallback to first DHCP client
-        client_ip = (2 << 24) | (4 << 16) | (168 << 8) | 192;
-        ESP_LOGW(TAG, "Using fallback IP: 192.168.4.2");
-        dns_approve_client(client_ip);
-    }
+    uint8_t *ip = (uint8_t*)&client_ip;
+    ESP_LOGI(TAG, ">>> APPROVED CLIENT: %d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    visitor_log_page_hit(client_ip);
+    visitor_log_approved(client_ip);
 
     // Return simple Success page that iOS recognizes (shows checkmark + Done)
     httpd_resp_set_type(req, "text/html");
@@ -750,12 +852,937 @@ static esp_err_t grant_access_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static const httpd_uri_t grant_access_uri = {
-    .uri       = "/grant",
-    .method    = HTTP_GET,
-    .handler   = grant_access_handler,
-    .user_ctx  = NULL
-};
+// Visitor analytics export - streams the flash log as CSV
+static bool visitors_csv_emit(const char *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
+}
+
+// Per-visitor history - venue network only
+static esp_err_t visitors_csv_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Exporting visitor analytics");
+
+    httpd_resp_set_type(req, "text/csv");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"visitors.csv\"");
+
+    esp_err_t err = visitor_log_export_csv(visitors_csv_emit, req);
+    if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_send_chunk(req, "analytics partition unavailable\n", HTTPD_RESP_USE_STRLEN);
+    }
+
+    // Terminate chunked response
+    httpd_resp_send_chunk(req, NULL, 0);
+    return err == ESP_FAIL ? ESP_FAIL : ESP_OK;
+}
+
+// Packet capture - streams the ring as a pcap file (open in Wireshark)
+static bool pcap_emit(const void *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
+}
+
+// Captures hold other visitors' traffic - venue network only
+static esp_err_t pcap_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    pcap_ring_status_t st;
+    pcap_ring_get_status(&st);
+    ESP_LOGI(TAG, "Exporting %lu captured packets", (unsigned long)st.held);
+
+    httpd_resp_set_type(req, "application/vnd.tcpdump.pcap");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"labportal.pcap\"");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    esp_err_t err = pcap_ring_export(pcap_emit, req);
+
+    // Terminate chunked response
+    httpd_resp_send_chunk(req, NULL, 0);
+    return err;
+}
+
+static esp_err_t capture_get_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    pcap_ring_status_t st;
+    pcap_ring_get_status(&st);
+
+    char json[160];
+    snprintf(json, sizeof(json),
+        "{\"enabled\":%s,\"octet\":%u,\"proto\":%u,\"port\":%u,"
+        "\"captured\":%lu,\"held\":%lu,\"slots\":%d}",
+        st.enabled ? "true" : "false", st.filter.octet, st.filter.proto, st.filter.port,
+        (unsigned long)st.captured, (unsigned long)st.held, PCAP_RING_SLOTS);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+typedef struct {
+    bool enable;
+    pcap_filter_t filter;
+} capture_form_t;
+
+static esp_err_t capture_form_field(const form_field_t *field, void *ctx)
+{
+    capture_form_t *form = (capture_form_t *)ctx;
+    long value;
+    esp_err_t err;
+
+    if (form_span_eq(field->name, "enable")) {
+        err = form_decode_long(field->value, 0, 1, &value);
+        form->enable = value == 1;
+    } else if (form_span_eq(field->name, "octet")) {
+        err = form_decode_long(field->value, 0, 255, &value);
+        form->filter.octet = (uint8_t)value;
+    } else if (form_span_eq(field->name, "proto")) {
+        err = form_decode_long(field->value, 0, 255, &value);
+        form->filter.proto = (uint8_t)value;
+    } else if (form_span_eq(field->name, "port")) {
+        err = form_decode_long(field->value, 0, 65535, &value);
+        form->filter.port = (uint16_t)value;
+    } else {
+        return ESP_OK;  // Ignore unknown fields
+    }
+    return err;
+}
+
+// Start/stop capture: enable (0/1), octet, proto, port (0 or left out = any)
+// Starting clears the ring; stopping keeps it for /debug/pcap
+static esp_err_t capture_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[128];
+    capture_form_t form = {0};
+    static const form_handlers_t handlers = { .field = capture_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &form);
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "enable 0-1, octet 0-255, proto 0-255, port 0-65535");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
+        return ESP_FAIL;
+    }
+
+    pcap_ring_set(form.enable, &form.filter);
+    ESP_LOGI(TAG, "Capture %s (octet %u, proto %u, port %u)", form.enable ? "on" : "off",
+             form.filter.octet, form.filter.proto, form.filter.port);
+    return capture_get_handler(req);
+}
+
+// Per-client traffic - busiest first, refreshed every CLIENT_STATS_PERIOD_MS.
+// Venue network only: it exposes every other station's usage
+static esp_err_t clients_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    client_stats_t *clients = malloc(sizeof(client_stats_t) * CLIENT_STATS_MAX_TRACKED);
+    if (!clients) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    size_t count = client_stats_snapshot(clients, CLIENT_STATS_MAX_TRACKED);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, "[", 1);
+
+    char entry[256];
+    for (size_t i = 0; i < count; i++) {
+        const client_stats_t *c = &clients[i];
+        char ip[16];
+        inet_ntoa_r(c->ip, ip, sizeof(ip));
+        int len = snprintf(entry, sizeof(entry),
+            "%s{\"ip\":\"%s\",\"up_bytes\":%llu,\"down_bytes\":%llu,"
+            "\"up_packets\":%llu,\"down_packets\":%llu,"
+            "\"up_rate\":%lu,\"down_rate\":%lu,\"idle_s\":%lu,\"approved\":%s}",
+            i > 0 ? "," : "", ip,
+            (unsigned long long)c->up_bytes, (unsigned long long)c->down_bytes,
+            (unsigned long long)c->up_packets, (unsigned long long)c->down_packets,
+            (unsigned long)c->up_rate, (unsigned long)c->down_rate, (unsigned long)c->idle_s,
+            dns_is_client_approved(c->ip) ? "true" : "false");
+        if (httpd_resp_send_chunk(req, entry, len) != ESP_OK) {
+            free(clients);
+            return ESP_FAIL;
+        }
+    }
+    free(clients);
+
+    httpd_resp_send_chunk(req, "]", 1);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Last throughput bench run (see bench_server.h for how to start one)
+static esp_err_t bench_get_handler(httpd_req_t *req)
+{
+    char json[320];
+    bench_result_t result;
+    if (bench_server_last_result(&result)) {
+        bench_result_json(&result, json, sizeof(json));
+    } else {
+        snprintf(json, sizeof(json), "{\"mode\":\"none\"}");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Bandwidth limits - current config plus shaper counters
+static esp_err_t shaper_get_handler(httpd_req_t *req)
+{
+    shaper_config_t cfg;
+    shaper_stats_t st;
+    shaper_get_config(&cfg);
+    shaper_get_stats(&st);
+
+    char json[512];
+    snprintf(json, sizeof(json),
+        "{\"client_up_kbps\":%lu,\"client_down_kbps\":%lu,"
+        "\"uplink_up_kbps\":%lu,\"uplink_down_kbps\":%lu,"
+        "\"up\":{\"passed\":%lu,\"delayed\":%lu,\"dropped\":%lu,\"backlog\":%lu},"
+        "\"down\":{\"passed\":%lu,\"delayed\":%lu,\"dropped\":%lu,\"backlog\":%lu},"
+        "\"flows_exhausted\":%lu,\"held_bytes\":%lu,\"budget_drops\":%lu}",
+        (unsigned long)cfg.client_up_kbps, (unsigned long)cfg.client_down_kbps,
+        (unsigned long)cfg.uplink_up_kbps, (unsigned long)cfg.uplink_down_kbps,
+        (unsigned long)st.dir[SHAPER_DIR_UP].passed, (unsigned long)st.dir[SHAPER_DIR_UP].delayed,
+        (unsigned long)st.dir[SHAPER_DIR_UP].dropped, (unsigned long)st.dir[SHAPER_DIR_UP].backlog,
+        (unsigned long)st.dir[SHAPER_DIR_DOWN].passed, (unsigned long)st.dir[SHAPER_DIR_DOWN].delayed,
+        (unsigned long)st.dir[SHAPER_DIR_DOWN].dropped, (unsigned long)st.dir[SHAPER_DIR_DOWN].backlog,
+        (unsigned long)st.flows_exhausted, (unsigned long)st.held_bytes, (unsigned long)st.budget_drops);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+static esp_err_t shaper_form_field(const form_field_t *field, void *ctx)
+{
+    shaper_config_t *cfg = (shaper_config_t *)ctx;
+    uint32_t *target = NULL;
+
+    if (form_span_eq(field->name, "client_up")) {
+        target = &cfg->client_up_kbps;
+    } else if (form_span_eq(field->name, "client_down")) {
+        target = &cfg->client_down_kbps;
+    } else if (form_span_eq(field->name, "uplink_up")) {
+        target = &cfg->uplink_up_kbps;
+    } else if (form_span_eq(field->name, "uplink_down")) {
+        target = &cfg->uplink_down_kbps;
+    } else {
+        return ESP_OK;  // Ignore unknown fields
+    }
+
+    long kbps;
+    esp_err_t err = form_decode_long(field->value, 0, 1000000, &kbps);
+    if (err == ESP_OK) {
+        *target = (uint32_t)kbps;
+    }
+    return err;
+}
+
+// Update limits: client_up, client_down, uplink_up, uplink_down in kbit/s (0 = unlimited)
+// Fields left out keep their current value. Not from AP clients
+static esp_err_t shaper_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[128];
+    shaper_config_t cfg;
+    shaper_get_config(&cfg);
+    static const form_handlers_t handlers = { .field = shaper_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &cfg);
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Limits must be 0-1000000 kbit/s");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive data");
+        return ESP_FAIL;
+    }
+
+    if (shaper_set_config(&cfg, true) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save limits");
+        return ESP_FAIL;
+    }
+    return shaper_get_handler(req);
+}
+
+// Uplink MTU and MSS clamping - what new flows are clamped to and why
+static esp_err_t mtu_get_handler(httpd_req_t *req)
+{
+    mss_clamp_config_t cfg;
+    mss_clamp_status_t st;
+    mss_clamp_get_config(&cfg);
+    mss_clamp_get_status(&st);
+    char host[16] = "";
+    if (st.learned_mtu) {
+        inet_ntoa_r(st.learned_dst, host, sizeof(host));
+    }
+
+    char json[448];
+    snprintf(json, sizeof(json),
+        "{\"enabled\":%s,\"configured_mtu\":%u,\"mtu\":%u,\"mss\":%u,\"source\":\"%s\","
+        "\"link_mtu\":%u,\"learned_paths\":%u,\"learned_mtu\":%u,\"learned_host\":\"%s\","
+        "\"learned_age_s\":%lu,\"syns\":%lu,\"clamped_up\":%lu,\"clamped_down\":%lu,"
+        "\"frag_needed_heard\":%lu,\"frag_needed_rejected\":%lu,\"frag_needed_sent\":%lu}",
+        cfg.enabled ? "true" : "false", cfg.mtu, st.mtu, st.mtu - MSS_CLAMP_HEADERS,
+        mss_clamp_source_name(st.source), st.link_mtu, st.learned_paths, st.learned_mtu,
+        host, (unsigned long)st.learned_age_s,
+        (unsigned long)st.syns, (unsigned long)st.clamped[MSS_CLAMP_DIR_UP],
+        (unsigned long)st.clamped[MSS_CLAMP_DIR_DOWN], (unsigned long)st.frag_needed_heard,
+        (unsigned long)st.frag_needed_rejected, (unsigned long)st.frag_needed_sent);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+static esp_err_t mtu_form_field(const form_field_t *field, void *ctx)
+{
+    mss_clamp_config_t *cfg = (mss_clamp_config_t *)ctx;
+    long value;
+    esp_err_t err;
+
+    if (form_span_eq(field->name, "enabled")) {
+        err = form_decode_long(field->value, 0, 1, &value);
+        if (err == ESP_OK) {
+            cfg->enabled = value != 0;
+        }
+        return err;
+    } else if (form_span_eq(field->name, "mtu")) {
+        err = form_decode_long(field->value, 0, MSS_CLAMP_MAX_MTU, &value);
+        if (err == ESP_OK && value != 0 && value < MSS_CLAMP_MIN_MTU) {
+            err = ESP_ERR_INVALID_ARG;
+        }
+        if (err == ESP_OK) {
+            cfg->mtu = (uint16_t)value;
+        }
+        return err;
+    }
+    return ESP_OK;  // Ignore unknown fields
+}
+
+// Update clamping: enabled (0/1), mtu (576-1500, 0 = auto from link and frag-needed)
+// Fields left out keep their current value. Not from AP clients
+static esp_err_t mtu_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[64];
+    mss_clamp_config_t cfg;
+    mss_clamp_get_config(&cfg);
+    static const form_handlers_t handlers = { .field = mtu_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &cfg);
+    if (err == ESP_OK) {
+        err = mss_clamp_set_config(&cfg, true);
+    }
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "MTU must be 576-1500, or 0 for auto");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save MTU");
+        return ESP_FAIL;
+    }
+    return mtu_get_handler(req);
+}
+
+// NAPT occupancy - mappings by protocol, state, age and client, plus the
+// idle timeouts (lwIP's, fixed at build time)
+static esp_err_t napt_get_handler(httpd_req_t *req)
+{
+    napt_monitor_report_t r;
+    napt_monitor_timeouts_t t;
+    napt_monitor_get_report(&r);
+    napt_monitor_get_timeouts(&t);
+
+    char json[512];
+    int len = snprintf(json, sizeof(json),
+        "{\"capacity\":%u,\"active\":%u,\"peak\":%u,"
+        "\"tcp\":%u,\"udp\":%u,\"icmp\":%u,\"tcp_opening\":%u,\"tcp_closing\":%u,"
+        "\"created\":%lu,\"expired\":%lu,\"evicted\":%lu,\"table_full\":%lu,\"unmatched\":%lu,"
+        "\"skipped\":%lu,\"age\":{\"10s\":%u,\"1m\":%u,\"5m\":%u,\"30m\":%u,\"2h\":%u,\"older\":%u},"
+        "\"timeouts\":{\"tcp\":%lu,\"tcp_closing\":%lu,\"udp\":%lu,\"icmp\":%lu},\"clients\":[",
+        r.capacity, r.active, r.peak, r.tcp, r.udp, r.icmp, r.tcp_opening, r.tcp_closing,
+        (unsigned long)r.created, (unsigned long)r.expired, (unsigned long)r.evicted,
+        (unsigned long)r.table_full, (unsigned long)r.unmatched, (unsigned long)r.skipped,
+        r.age[0], r.age[1], r.age[2], r.age[3], r.age[4], r.age[5],
+        (unsigned long)t.tcp_s, (unsigned long)t.tcp_closing_s, (unsigned long)t.udp_s, (unsigned long)t.icmp_s);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, json, len);
+
+    for (int i = 0; i < r.client_count; i++) {
+        char ip[16];
+        inet_ntoa_r(r.clients[i].ip, ip, sizeof(ip));
+        len = snprintf(json, sizeof(json), "%s{\"ip\":\"%s\",\"tcp\":%u,\"udp\":%u,\"icmp\":%u}",
+                       i > 0 ? "," : "", ip, r.clients[i].tcp, r.clients[i].udp, r.clients[i].icmp);
+        if (httpd_resp_send_chunk(req, json, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    httpd_resp_send_chunk(req, "]}", 2);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// DHCP leases - policy, then every unexpired lease with its MAC and time left.
+// Venue network only, like the policy change below
+static esp_err_t leases_get_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    dhcp_lease_t *leases = malloc(sizeof(dhcp_lease_t) * DHCP_LEASES_POOL_MAX);
+    if (!leases) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    size_t count = dhcp_leases_list(leases, DHCP_LEASES_POOL_MAX);
+    uint32_t now = (uint32_t)((xTaskGetTickCount() * portTICK_PERIOD_MS) / 1000);
+
+    dhcp_leases_config_t cfg;
+    dhcp_leases_status_t st;
+    dhcp_leases_get_config(&cfg);
+    dhcp_leases_get_status(&st);
+
+    char entry[160];
+    int len = snprintf(entry, sizeof(entry),
+        "{\"lease_min\":%u,\"pool\":%u,\"pending\":%s,\"active\":%u,\"associated\":%u,"
+        "\"assigned\":%lu,\"reused\":%lu,\"leases\":[",
+        cfg.lease_min, cfg.pool_size, st.pending ? "true" : "false", st.active, st.associated,
+        (unsigned long)st.assigned, (unsigned long)st.reused);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, entry, len);
+
+    for (size_t i = 0; i < count; i++) {
+        const dhcp_lease_t *l = &leases[i];
+        char ip[16];
+        inet_ntoa_r(l->ip, ip, sizeof(ip));
+        int32_t left = (int32_t)(l->expires_at - now);
+        len = snprintf(entry, sizeof(entry),
+            "%s{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"ip\":\"%s\",\"expires_in_s\":%ld,"
+            "\"associated\":%s}",
+            i > 0 ? "," : "", l->mac[0], l->mac[1], l->mac[2], l->mac[3], l->mac[4], l->mac[5],
+            ip, (long)(left > 0 ? left : 0), l->associated ? "true" : "false");
+        if (httpd_resp_send_chunk(req, entry, len) != ESP_OK) {
+            free(leases);
+            return ESP_FAIL;
+        }
+    }
+    free(leases);
+
+    httpd_resp_send_chunk(req, "]}", 2);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static esp_err_t leases_form_field(const form_field_t *field, void *ctx)
+{
+    dhcp_leases_config_t *cfg = (dhcp_leases_config_t *)ctx;
+    long value;
+    esp_err_t err;
+
+    if (form_span_eq(field->name, "lease")) {
+        err = form_decode_long(field->value, DHCP_LEASES_TIME_MIN, DHCP_LEASES_TIME_MAX, &value);
+        if (err == ESP_OK) {
+            cfg->lease_min = (uint16_t)value;
+        }
+        return err;
+    }
+    if (form_span_eq(field->name, "pool")) {
+        err = form_decode_long(field->value, DHCP_LEASES_POOL_MIN, DHCP_LEASES_POOL_MAX, &value);
+        if (err == ESP_OK) {
+            cfg->pool_size = (uint16_t)value;
+        }
+        return err;
+    }
+    return ESP_OK;  // Ignore unknown fields
+}
+
+// Update the lease policy: lease (minutes), pool (addresses from .2)
+// Takes effect once no station is on the AP - see "pending"
+static esp_err_t leases_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[64];
+    dhcp_leases_config_t cfg;
+    dhcp_leases_get_config(&cfg);
+    static const form_handlers_t handlers = { .field = leases_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &cfg);
+    if (err == ESP_OK) {
+        err = dhcp_leases_set_config(&cfg, true);
+    }
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "lease 1-1440 min, pool 8-100 addresses");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save lease policy");
+        return ESP_FAIL;
+    }
+    return leases_get_handler(req);
+}
+
+// Bandwidth page - edits the same fields as POST /api/shaper
+static esp_err_t shaper_page_handler(httpd_req_t *req)
+{
+    const char* shaper_html =
+    "<!DOCTYPE html><html><head>"
+    "<meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1.0'>"
+    "<title>Bandwidth - Laboratory</title>"
+    "<style>"
+    "*{margin:0;padding:0;box-sizing:border-box;}"
+    "body{font-family:-apple-system,BlinkMacSystemFont,'Segoe UI',Roboto,Helvetica,Arial,sans-serif;background:#f5f5f5;color:#000;padding:30px 20px;}"
+    ".container{max-width:500px;margin:0 auto;}"
+    "h1{text-align:center;margin-bottom:20px;}"
+    ".frame{background:#fff;border:3px solid #000;border-radius:40px;padding:30px;}"
+    "label{display:block;margin-top:12px;font-weight:bold;}"
+    "input{width:100%;padding:12px;margin-top:6px;border:3px solid #000;border-radius:25px;font-size:1em;}"
+    "button{width:100%;padding:15px;margin-top:20px;background:#000;color:#fff;border:none;border-radius:50px;font-size:1.1em;cursor:pointer;}"
+    "#status{text-align:center;margin-top:15px;color:#666;}"
+    "</style>"
+    "</head><body>"
+    "<div class='container'>"
+    "<h1>Bandwidth</h1>"
+    "<form class='frame' id='f'>"
+    "<p>Limits in kbit/s, 0 = unlimited</p>"
+    "<label>Per client upload<input name='client_up' type='number' min='0'></label>"
+    "<label>Per client download<input name='client_down' type='number' min='0'></label>"
+    "<label>Uplink upload (all clients)<input name='uplink_up' type='number' min='0'></label>"
+    "<label>Uplink download (all clients)<input name='uplink_down' type='number' min='0'></label>"
+    "<button type='submit'>Save</button>"
+    "<div id='status'></div>"
+    "</form>"
+    "</div>"
+    "<script>"
+    "const f=document.getElementById('f');"
+    "function show(c){['client_up','client_down','uplink_up','uplink_down'].forEach(k=>f[k].value=c[k+'_kbps']);}"
+    "fetch('/api/shaper').then(r=>r.json()).then(show);"
+    "f.onsubmit=async e=>{"
+    "  e.preventDefault();"
+    "  const r=await fetch('/api/shaper',{method:'POST',body:new URLSearchParams(new FormData(f))});"
+    "  document.getElementById('status').textContent=r.ok?'Saved':await r.text();"
+    "  if(r.ok)show(await r.json());"
+    "};"
+    "</script>"
+    "</body></html>";
+
+    httpd_resp_send(req, shaper_html, HTTPD_RESP_USE_STRLEN);
+    return ESP_OK;
+}
+
+// Uplink health - probe targets plus smoothed RTT, loss and percentiles per probe
+static int uplink_metric_json(char *buf, size_t size, const char *name, uint32_t target,
+                              const uplink_metric_t *m)
+{
+    char ip[16];
+    inet_ntoa_r(target, ip, sizeof(ip));
+    return snprintf(buf, size,
+        "\"%s\":{\"target\":\"%s\",\"sent\":%lu,\"lost\":%lu,\"loss_pct\":%u,"
+        "\"last_ms\":%lu,\"ewma_ms\":%lu,\"p50_ms\":%lu,\"p95_ms\":%lu}",
+        name, ip, (unsigned long)m->sent, (unsigned long)m->lost, m->loss_pct,
+        (unsigned long)m->last_ms, (unsigned long)m->ewma_ms,
+        (unsigned long)m->p50_ms, (unsigned long)m->p95_ms);
+}
+
+static esp_err_t uplink_get_handler(httpd_req_t *req)
+{
+    uplink_monitor_config_t cfg;
+    uplink_status_t st;
+    uplink_monitor_get_config(&cfg);
+    uplink_monitor_get_status(&st);
+
+    char upstream[16];
+    uint32_t upstream_ip = dns_get_upstream();
+    inet_ntoa_r(upstream_ip, upstream, sizeof(upstream));
+
+    char json[1024];
+    int len = snprintf(json, sizeof(json),
+        "{\"link_up\":%s,\"degraded\":%s,\"rounds\":%lu,\"period_s\":%u,"
+        "\"tcp_port\":%u,\"upstream\":\"%s\",",
+        st.link_up ? "true" : "false", st.degraded ? "true" : "false",
+        (unsigned long)st.rounds, cfg.period_s, cfg.tcp_port, upstream);
+    len += uplink_metric_json(json + len, sizeof(json) - len, "ping", cfg.ping_target, &st.icmp);
+    json[len++] = ',';
+    len += uplink_metric_json(json + len, sizeof(json) - len, "tcp", cfg.tcp_target, &st.tcp);
+    for (int i = 0; i < UPLINK_MONITOR_MAX_RESOLVERS; i++) {
+        char name[8];
+        snprintf(name, sizeof(name), "dns%d", i + 1);
+        json[len++] = ',';
+        len += uplink_metric_json(json + len, sizeof(json) - len, name, cfg.resolvers[i], &st.dns[i]);
+    }
+    json[len++] = '}';
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, len);
+    return ESP_OK;
+}
+
+static esp_err_t uplink_form_field(const form_field_t *field, void *ctx)
+{
+    uplink_monitor_config_t *cfg = (uplink_monitor_config_t *)ctx;
+    uint32_t *target = NULL;
+
+    if (form_span_eq(field->name, "ping")) {
+        target = &cfg->ping_target;
+    } else if (form_span_eq(field->name, "dns1")) {
+        target = &cfg->resolvers[0];
+    } else if (form_span_eq(field->name, "dns2")) {
+        target = &cfg->resolvers[1];
+    } else if (form_span_eq(field->name, "dns3")) {
+        target = &cfg->resolvers[2];
+    } else if (form_span_eq(field->name, "tcp")) {
+        target = &cfg->tcp_target;
+    } else if (form_span_eq(field->name, "tcp_port")) {
+        long port;
+        esp_err_t err = form_decode_long(field->value, 1, 65535, &port);
+        if (err == ESP_OK) {
+            cfg->tcp_port = (uint16_t)port;
+        }
+        return err;
+    } else if (form_span_eq(field->name, "period")) {
+        long period;
+        esp_err_t err = form_decode_long(field->value, 5, 3600, &period);
+        if (err == ESP_OK) {
+            cfg->period_s = (uint16_t)period;
+        }
+        return err;
+    } else {
+        return ESP_OK;  // Ignore unknown fields
+    }
+
+    // Dotted quad, empty disables the probe
+    char ip[16];
+    struct in_addr addr = {0};
+    if (form_decode(field->value, ip, sizeof(ip), NULL) != ESP_OK ||
+        (ip[0] != '\0' && inet_pton(AF_INET, ip, &addr) != 1)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *target = addr.s_addr;
+    return ESP_OK;
+}
+
+// Update probe targets: ping, dns1..dns3, tcp (IPv4, empty = off), tcp_port, period (s)
+// Fields left out keep their current value. Not from AP clients
+static esp_err_t uplink_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[128];
+    uplink_monitor_config_t cfg;
+    uplink_monitor_get_config(&cfg);
+    static const form_handlers_t handlers = { .field = uplink_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &cfg);
+    if (err == ESP_OK) {
+        err = uplink_monitor_set_config(&cfg, true);
+    }
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Targets must be IPv4 addresses, period 5-3600 s");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save targets");
+        return ESP_FAIL;
+    }
+    return uplink_get_handler(req);
+}
+
+// Admission control - policy, eviction counters and who holds the AP's slots
+static esp_err_t admission_get_handler(httpd_req_t *req)
+{
+    admission_config_t cfg;
+    admission_status_t st;
+    admission_station_t list[ADMISSION_MAX_STATIONS];
+    admission_get_config(&cfg);
+    admission_get_status(&st);
+    size_t count = admission_list(list, ADMISSION_MAX_STATIONS);
+
+    char json[320];
+    char last[20] = "null";
+    if (st.last_at) {
+        snprintf(last, sizeof(last), "\"%02x:%02x:%02x:%02x:%02x:%02x\"",
+                 st.last_mac[0], st.last_mac[1], st.last_mac[2], st.last_mac[3], st.last_mac[4], st.last_mac[5]);
+    }
+    int len = snprintf(json, sizeof(json),
+        "{\"policy\":\"%s\",\"reserve\":%u,\"idle_s\":%u,\"grace_s\":%u,"
+        "\"stations\":%u,\"max\":%u,\"evicted_idle\":%lu,\"evicted_unapproved\":%lu,"
+        "\"steered\":%lu,\"last_evicted\":%s,\"last_at\":%lu,\"list\":[",
+        admission_policy_name(cfg.policy), cfg.reserve, cfg.idle_s, cfg.grace_s,
+        st.stations, st.max_stations, (unsigned long)st.evicted_idle, (unsigned long)st.evicted_unapproved,
+        (unsigned long)st.steered, last, (unsigned long)st.last_at);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, json, len);
+
+    for (size_t i = 0; i < count; i++) {
+        const admission_station_t *s = &list[i];
+        char ip[16];
+        inet_ntoa_r(s->ip, ip, sizeof(ip));
+        len = snprintf(json, sizeof(json),
+            "%s{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"ip\":\"%s\",\"approved\":%s,"
+            "\"connected_s\":%lu,\"idle_s\":%lu,\"evictable\":%s}",
+            i > 0 ? "," : "", s->mac[0], s->mac[1], s->mac[2], s->mac[3], s->mac[4], s->mac[5], ip,
+            s->approved ? "true" : "false", (unsigned long)s->connected_s, (unsigned long)s->idle_s,
+            s->evictable ? "true" : "false");
+        if (httpd_resp_send_chunk(req, json, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    httpd_resp_send_chunk(req, "]}", 2);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static esp_err_t admission_form_field(const form_field_t *field, void *ctx)
+{
+    admission_config_t *cfg = (admission_config_t *)ctx;
+    long value;
+    esp_err_t err;
+
+    if (form_span_eq(field->name, "policy")) {
+        for (int p = ADMISSION_POLICY_OFF; p <= ADMISSION_POLICY_UNAPPROVED_FIRST; p++) {
+            if (form_span_eq(field->value, admission_policy_name((admission_policy_t)p))) {
+                cfg->policy = (admission_policy_t)p;
+                return ESP_OK;
+            }
+        }
+        return ESP_ERR_INVALID_ARG;
+    } else if (form_span_eq(field->name, "reserve")) {
+        err = form_decode_long(field->value, 1, 4, &value);
+        if (err == ESP_OK) {
+            cfg->reserve = (uint8_t)value;
+        }
+        return err;
+    } else if (form_span_eq(field->name, "idle")) {
+        err = form_decode_long(field->value, 60, 7200, &value);
+        if (err == ESP_OK) {
+            cfg->idle_s = (uint16_t)value;
+        }
+        return err;
+    } else if (form_span_eq(field->name, "grace")) {
+        err = form_decode_long(field->value, 30, 3600, &value);
+        if (err == ESP_OK) {
+            cfg->grace_s = (uint16_t)value;
+        }
+        return err;
+    }
+    return ESP_OK;  // Ignore unknown fields
+}
+
+// Update the policy: policy (off, idle, unapproved_first), reserve (1-4 slots),
+// idle and grace (s). Fields left out keep their current value. Not from AP clients
+static esp_err_t admission_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[96];
+    admission_config_t cfg;
+    admission_get_config(&cfg);
+    static const form_handlers_t handlers = { .field = admission_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &cfg);
+    if (err == ESP_OK) {
+        err = admission_set_config(&cfg, true);
+    }
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            "policy off|idle|unapproved_first, reserve 1-4, idle 60-7200 s, grace 30-3600 s");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save policy");
+        return ESP_FAIL;
+    }
+    return admission_get_handler(req);
+}
+
+// Fleet sync - this stick's gossip state and the peers it hears. Never the key
+static esp_err_t fleet_get_handler(httpd_req_t *req)
+{
+    fleet_peer_t peers[FLEET_MAX_PEERS];
+    size_t count = fleet_sync_list_peers(peers, FLEET_MAX_PEERS);
+
+    fleet_sync_config_t cfg;
+    fleet_sync_status_t st;
+    fleet_sync_get_config(&cfg);
+    fleet_sync_get_status(&st);
+
+    char entry[320];
+    int len = snprintf(entry, sizeof(entry),
+        "{\"enabled\":%s,\"steer\":%s,\"key_set\":%s,\"joined\":%s,\"approvals_cached\":%u,"
+        "\"sent\":%lu,\"received\":%lu,\"rejected\":%lu,\"replayed\":%lu,"
+        "\"approvals_learned\":%lu,\"approvals_applied\":%lu,\"peers\":[",
+        cfg.enabled ? "true" : "false", cfg.steer ? "true" : "false", st.key_set ? "true" : "false",
+        st.joined ? "true" : "false", st.approvals_cached, (unsigned long)st.sent,
+        (unsigned long)st.received, (unsigned long)st.rejected, (unsigned long)st.replayed,
+        (unsigned long)st.approvals_learned, (unsigned long)st.approvals_applied);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send_chunk(req, entry, len);
+
+    for (size_t i = 0; i < count; i++) {
+        const fleet_peer_t *p = &peers[i];
+        char ip[16];
+        inet_ntoa_r(p->ip, ip, sizeof(ip));
+        len = snprintf(entry, sizeof(entry),
+            "%s{\"mac\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"ip\":\"%s\",\"stations\":%u,\"max\":%u,"
+            "\"up_rate\":%lu,\"down_rate\":%lu,\"age_s\":%lu}",
+            i > 0 ? "," : "", p->mac[0], p->mac[1], p->mac[2], p->mac[3], p->mac[4], p->mac[5],
+            ip, p->stations, p->max_stations, (unsigned long)p->up_rate, (unsigned long)p->down_rate,
+            (unsigned long)p->age_s);
+        if (httpd_resp_send_chunk(req, entry, len) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+
+    httpd_resp_send_chunk(req, "]}", 2);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+typedef struct {
+    fleet_sync_config_t cfg;
+    uint8_t key[FLEET_KEY_LEN];
+    bool key_given;
+} fleet_form_t;
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static esp_err_t fleet_form_field(const form_field_t *field, void *ctx)
+{
+    fleet_form_t *form = (fleet_form_t *)ctx;
+    long value;
+    esp_err_t err;
+
+    if (form_span_eq(field->name, "enabled") || form_span_eq(field->name, "steer")) {
+        err = form_decode_long(field->value, 0, 1, &value);
+        if (err == ESP_OK) {
+            if (form_span_eq(field->name, "enabled")) {
+                form->cfg.enabled = value != 0;
+            } else {
+                form->cfg.steer = value != 0;
+            }
+        }
+        return err;
+    }
+    if (form_span_eq(field->name, "key")) {
+        char hex[FLEET_KEY_LEN * 2 + 1];
+        size_t n = 0;
+        err = form_decode(field->value, hex, sizeof(hex), &n);
+        if (err != ESP_OK || n != FLEET_KEY_LEN * 2) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int i = 0; i < FLEET_KEY_LEN; i++) {
+            int hi = hex_nibble(hex[2 * i]), lo = hex_nibble(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            form->key[i] = (uint8_t)(hi << 4 | lo);
+        }
+        form->key_given = true;
+        return ESP_OK;
+    }
+    return ESP_OK;  // Ignore unknown fields
+}
+
+// Update fleet sync: key (64 hex chars, the same on every stick), enabled (0/1),
+// steer (0/1). A key in the same request is set before enabling. Not from AP clients
+static esp_err_t fleet_set_handler(httpd_req_t *req)
+{
+    if (!require_uplink(req)) {
+        return ESP_FAIL;
+    }
+    char scratch[128];
+    fleet_form_t form = {0};
+    fleet_sync_get_config(&form.cfg);
+    static const form_handlers_t handlers = { .field = fleet_form_field };
+
+    esp_err_t err = form_parse_request(req, scratch, sizeof(scratch), &handlers, &form);
+    if (err == ESP_OK && form.key_given) {
+        err = fleet_sync_set_key(form.key);
+    }
+    if (err == ESP_OK) {
+        err = fleet_sync_set_config(&form.cfg, true);
+    }
+    if (err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "key is 64 hex chars, enabled and steer 0/1");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Set a key before enabling fleet sync");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save fleet settings");
+        return ESP_FAIL;
+    }
+    return fleet_get_handler(req);
+}
+
+// AP channel plan - the decision, why, and the scored candidates behind it
+static esp_err_t channel_get_handler(httpd_req_t *req)
+{
+    channel_plan_t plan;
+    channel_plan_get(&plan);
+    uint8_t radio = 0;
+    esp_wifi_get_channel(&radio, NULL);
+
+    char json[1536];
+    int len = snprintf(json, sizeof(json),
+        "{\"channel\":%u,\"radio\":%u,\"source\":\"%s\",\"planned_s\":%lu,\"candidates\":[",
+        plan.channel, radio, channel_plan_source_name(plan.source), (unsigned long)plan.planned_s);
+    for (int i = 0; i < plan.count && len < (int)sizeof(json) - 96; i++) {
+        const channel_candidate_t *c = &plan.candidates[i];
+        char air[8] = "null";
+        if (c->airtime_pct >= 0) {
+            snprintf(air, sizeof(air), "%d", c->airtime_pct);
+        }
+        len += snprintf(json + len, sizeof(json) - len,
+            "%s{\"channel\":%u,\"bss\":%u,\"occupancy\":%u,\"airtime_pct\":%s,\"score\":%lu}",
+            i > 0 ? "," : "", c->channel, c->bss, c->occupancy, air, (unsigned long)c->score);
+    }
+    len += snprintf(json + len, sizeof(json) - len, "]}");
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, json, len);
+    return ESP_OK;
+}
 
 // Captive portal detection handlers
 // For approved clients: return "Success" so phone dismisses portal
@@ -765,27 +1792,9 @@ static esp_err_t captive_redirect_handler(httpd_req_t *req)
     ESP_LOGI(TAG, ">>> CAPTIVE DETECTION: %s", req->uri);
 
     // Check if client is approved
-    int sockfd = httpd_req_to_sockfd(req);
-    bool approved = false;
-
-    if (sockfd >= 0) {
-        struct sockaddr_storage addr;
-        socklen_t addr_size = sizeof(addr);
-        if (getpeername(sockfd, (struct sockaddr *)&addr, &addr_size) == 0) {
-            uint32_t client_ip = 0;
-            if (addr.ss_family == AF_INET) {
-                client_ip = ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
-            } else if (addr.ss_family == AF_INET6) {
-                uint8_t *bytes = ((struct sockaddr_in6 *)&addr)->sin6_addr.s6_addr;
-                if (bytes[10] == 0xFF && bytes[11] == 0xFF) {
-                    client_ip = bytes[12] | (bytes[13] << 8) | (bytes[14] << 16) | (bytes[15] << 24);
-                }
-            }
-            if (client_ip != 0) {
-                approved = dns_is_client_approved(client_ip);
-            }
-        }
-    }
+    uint32_t client_ip = get_client_ip(req);
+    bool approved = client_ip != 0 && dns_is_client_approved(client_ip);
+    visitor_log_page_hit(client_ip);
 
     if (approved) {
         // Client approved - return Success so phone dismisses captive portal
@@ -817,85 +1826,20 @@ static esp_err_t generate_204_handler(httpd_req_t *req)
     return captive_redirect_handler(req);
 }
 
-static const httpd_uri_t generate_204_uri = {
-    .uri       = "/generate_204",
-    .method    = HTTP_GET,
-    .handler   = generate_204_handler,
-    .user_ctx  = NULL
-};
-
-static const httpd_uri_t gen_204_uri = {
-    .uri       = "/gen_204",
-    .method    = HTTP_GET,
-    .handler   = generate_204_handler,
-    .user_ctx  = NULL
-};
-
 // iOS/Apple captive portal detection
 static esp_err_t hotspot_detect_handler(httpd_req_t *req)
 {
     return captive_redirect_handler(req);
 }
 
-static const httpd_uri_t hotspot_detect_uri = {
-    .uri       = "/hotspot-detect.html",
-    .method    = HTTP_GET,
-    .handler   = hotspot_detect_handler,
-    .user_ctx  = NULL
-};
-
-static const httpd_uri_t library_test_uri = {
-    .uri       = "/library/test/success.html",
-    .method    = HTTP_GET,
-    .handler   = hotspot_detect_handler,
-    .user_ctx  = NULL
-};
-
 // Windows connectivity check
 static esp_err_t connecttest_handler(httpd_req_t *req)
 {
     return captive_redirect_handler(req);
 }
 
-static const httpd_uri_t connecttest_uri = {
-    .uri       = "/connecttest.txt",
-    .method    = HTTP_GET,
-    .handler   = connecttest_handler,
-    .user_ctx  = NULL
-};
-
-static const httpd_uri_t ncsi_uri = {
-    .uri       = "/ncsi.txt",
-    .method    = HTTP_GET,
-    .handler   = connecttest_handler,
-    .user_ctx  = NULL
-};
-
-// Linux connectivity checks
-static const httpd_uri_t canonical_uri = {
-    .uri       = "/canonical.html",
-    .method    = HTTP_GET,
-    .handler   = captive_redirect_handler,
-    .user_ctx  = NULL
-};
-
-static const httpd_uri_t connectivity_check_uri = {
-    .uri       = "/connectivity-check.html",
-    .method    = HTTP_GET,
-    .handler   = captive_redirect_handler,
-    .user_ctx  = NULL
-};
-
-// Firefox connectivity check
-static const httpd_uri_t success_txt_uri = {
-    .uri       = "/success.txt",
-    .method    = HTTP_GET,
-    .handler   = captive_redirect_handler,
-    .user_ctx  = NULL
-};
-
-// Catch-all 404 handler - redirect ANY unknown request to portal
-static esp_err_t http_404_handler(httpd_req_t *req, httpd_err_code_t err)
+// Catch-all - redirect ANY unknown request to portal
+static esp_err_t not_found_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG, ">>> CATCH-ALL: %s -> redirecting to portal", req->uri);
     httpd_resp_set_status(req, "302 Found");
@@ -904,6 +1848,66 @@ static esp_err_t http_404_handler(httpd_req_t *req, httpd_err_code_t err)
     return ESP_OK;
 }
 
+// Route table - dispatched through one catch-all httpd handler per method,
+// so adding endpoints costs no httpd handler slots and no extra match time
+static const uri_route_t portal_routes[] = {
+    // Core endpoints
+    { HTTP_GET,  "/",                 root_handler,          NULL },
+    { HTTP_GET,  "/grant",            grant_access_handler,  NULL },
+    { HTTP_GET,  "/wifi",             wifi_page_handler,     NULL },
+    { HTTP_GET,  "/transfer",         transfer_page_handler, NULL },
+    { HTTP_GET,  "/update",           ota_page_handler,      NULL },
+    { HTTP_GET,  "/bandwidth",        shaper_page_handler,   NULL },
+    { HTTP_POST, "/ota",              ota_upload_handler,    NULL },
+
+    // Debug endpoints
+    { HTTP_GET,  "/debug/logs",       logs_handler,          NULL },
+    { HTTP_GET,  "/debug/recent",     logs_recent_handler,   NULL },
+    { HTTP_GET,  "/debug/pcap",       pcap_handler,          NULL },
+    { HTTP_GET,  "/api/capture",      capture_get_handler,   NULL },
+    { HTTP_POST, "/api/capture",      capture_set_handler,   NULL },
+
+    // WiFi API
+    { HTTP_GET,  "/wifi/scan",        wifi_scan_handler,     NULL },
+    { HTTP_POST, "/wifi/connect",     wifi_connect_handler,  NULL },
+    { HTTP_GET,  "/api/networks",     networks_get_handler,  NULL },
+    { HTTP_POST, "/api/networks",     networks_set_handler,  NULL },
+
+    // Analytics
+    { HTTP_GET,  "/api/visitors.csv", visitors_csv_handler,  NULL },
+    { HTTP_GET,  "/api/clients",      clients_handler,       NULL },
+    { HTTP_GET,  "/api/bench",        bench_get_handler,     NULL },
+
+    // Bandwidth shaping
+    { HTTP_GET,  "/api/shaper",       shaper_get_handler,    NULL },
+    { HTTP_POST, "/api/shaper",       shaper_set_handler,    NULL },
+    { HTTP_GET,  "/api/mtu",          mtu_get_handler,       NULL },
+    { HTTP_POST, "/api/mtu",          mtu_set_handler,       NULL },
+    { HTTP_GET,  "/api/napt",         napt_get_handler,      NULL },
+    { HTTP_GET,  "/api/leases",       leases_get_handler,    NULL },
+    { HTTP_POST, "/api/leases",       leases_set_handler,    NULL },
+    { HTTP_GET,  "/api/uplink",       uplink_get_handler,    NULL },
+    { HTTP_POST, "/api/uplink",       uplink_set_handler,    NULL },
+    { HTTP_GET,  "/api/channel",      channel_get_handler,   NULL },
+    { HTTP_GET,  "/api/admission",    admission_get_handler, NULL },
+    { HTTP_POST, "/api/admission",    admission_set_handler, NULL },
+    { HTTP_GET,  "/api/fleet",        fleet_get_handler,     NULL },
+    { HTTP_POST, "/api/fleet",        fleet_set_handler,     NULL },
+
+    // Captive portal detection endpoints
+    { HTTP_GET,  "/generate_204",              generate_204_handler,     NULL },  // Android
+    { HTTP_GET,  "/gen_204",                   generate_204_handler,     NULL },  // Android
+    { HTTP_GET,  "/hotspot-detect.html",       hotspot_detect_handler,   NULL },  // iOS/macOS
+    { HTTP_GET,  "/library/test/success.html", hotspot_detect_handler,   NULL },  // iOS/macOS
+    { HTTP_GET,  "/connecttest.txt",           connecttest_handler,      NULL },  // Windows
+    { HTTP_GET,  "/ncsi.txt",                  connecttest_handler,      NULL },  // Windows
+    { HTTP_GET,  "/canonical.html",            captive_redirect_handler, NULL },  // Linux
+    { HTTP_GET,  "/connectivity-check.html",   captive_redirect_handler, NULL },  // Linux
+    { HTTP_GET,  "/success.txt",               captive_redirect_handler, NULL },  // Firefox
+};
+
+static uri_router_t portal_router;
+
 static httpd_handle_t start_webserver(void)
 {
     // Check if already running
@@ -912,11 +1916,18 @@ static httpd_handle_t start_webserver(void)
         return portal_server;
     }
 
+    if (uri_router_build(&portal_router, portal_routes,
+                         sizeof(portal_routes) / sizeof(portal_routes[0]), not_found_handler) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid route table!");
+        return NULL;
+    }
+
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
     config.lru_purge_enable = true;
-    config.max_uri_handlers = 24;  // Increase to fit all URIs + captive detection
-    config.uri_match_fn = httpd_uri_match_wildcard;  // Enable wildcard matching
+    config.max_uri_handlers = 4;  // Only the router's catch-alls (one per method)
+    config.uri_match_fn = httpd_uri_match_wildcard;  // Needed for the "/*" catch-alls
+    config.open_fn = session_open;
 
     // Multi-device support: handle iOS/Android captive detection (10+ parallel connections)
     config.max_open_sockets = 13;   // 16 LWIP limit - 3 reserved = 13 usable
@@ -926,35 +1937,15 @@ static httpd_handle_t start_webserver(void)
     ESP_LOGI(TAG, "Starting web server on port %d with %d sockets",
              config.server_port, config.max_open_sockets);
     if (httpd_start(&portal_server, &config) == ESP_OK) {
-        // Register 404 handler to catch ALL unmatched requests
-        httpd_register_err_handler(portal_server, HTTPD_404_NOT_FOUND, http_404_handler);
-        // Core endpoints
-        httpd_register_uri_handler(portal_server, &root_uri);
-        httpd_register_uri_handler(portal_server, &grant_access_uri);
-        httpd_register_uri_handler(portal_server, &wifi_page_uri);
-        httpd_register_uri_handler(portal_server, &transfer_page_uri);
-        httpd_register_uri_handler(portal_server, &logs_uri);
-        httpd_register_uri_handler(portal_server, &logs_recent_uri);
-        httpd_register_uri_handler(portal_server, &ota_page_uri);
-        httpd_register_uri_handler(portal_server, &ota_upload_uri);
-        httpd_register_uri_handler(portal_server, &wifi_scan_uri);
-        httpd_register_uri_handler(portal_server, &wifi_connect_uri);
-
-        // Captive portal detection endpoints (all return 302 redirect)
-        httpd_register_uri_handler(portal_server, &generate_204_uri);   // Android
-        httpd_register_uri_handler(portal_server, &gen_204_uri);        // Android
-        httpd_register_uri_handler(portal_server, &hotspot_detect_uri); // iOS/macOS
-        httpd_register_uri_handler(portal_server, &library_test_uri);   // iOS/macOS
-        httpd_register_uri_handler(portal_server, &connecttest_uri);    // Windows
-        httpd_register_uri_handler(portal_server, &ncsi_uri);           // Windows
-        httpd_register_uri_handler(portal_server, &canonical_uri);      // Linux
-        httpd_register_uri_handler(portal_server, &connectivity_check_uri); // Linux
-        httpd_register_uri_handler(portal_server, &success_txt_uri);    // Firefox
-
-        ESP_LOGI(TAG, "✓ Registered core endpoints: /, /wifi, /transfer, /update");
-        ESP_LOGI(TAG, "✓ Registered debug endpoints: /debug/logs, /debug/recent");
-        ESP_LOGI(TAG, "✓ Registered WiFi API: /wifi/scan, /wifi/connect");
-        ESP_LOGI(TAG, "✓ Registered captive portal detection (Android, iOS, Windows, Linux, Firefox)");
+        if (uri_router_mount(portal_server, &portal_router) != ESP_OK) {
+            httpd_stop(portal_server);
+            portal_server = NULL;
+            ESP_LOGE(TAG, "Failed to mount router!");
+            return NULL;
+        }
+
+        ESP_LOGI(TAG, "✓ Routed %d endpoints (core, debug, WiFi API, analytics, captive detection)",
+                 (int)(sizeof(portal_routes) / sizeof(portal_routes[0])));
         return portal_server;
     }
 
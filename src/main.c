@@ -16,10 +16,10 @@
 #include "lwip/inet.h"
 #include "lwip/netif.h"
 
-#include "ping/ping_sock.h"
-
 #include "captive_portal.h"
 #include "dns_server.h"
+#include "mdns_responder.h"
+#include "fleet_sync.h"
 #include "portal_ui.h"
 #include "log_capture.h"
 #include "tcp_debug.h"
@@ -27,6 +27,20 @@
 #include "axp2101_power.h"
 #include "portal_mode.h"
 #include "sound_system.h"
+#include "visitor_log.h"
+#include "client_table.h"
+#include "dhcp_leases.h"
+#include "client_stats.h"
+#include "shaper.h"
+#include "mss_clamp.h"
+#include "napt_monitor.h"
+#include "ap_forward.h"
+#include "uplink_monitor.h"
+#include "wifi_sta.h"
+#include "bench_server.h"
+#include "channel_plan.h"
+#include "admission.h"
+#include "event_worker.h"
 
 static const char *TAG = "Laboratory";
 
@@ -34,10 +48,6 @@ static const char *TAG = "Laboratory";
 static esp_netif_t *g_sta_netif = NULL;
 static esp_netif_t *g_ap_netif = NULL;
 
-// WiFi retry counter
-static int wifi_retry_count = 0;
-#define WIFI_MAX_RETRY 5
-
 // Global flags
 static bool wifi_connected = false;
 bool setup_mode = true;
@@ -46,68 +56,6 @@ bool setup_mode = true;
 static int total_clients_connected = 0;
 static uint32_t portal_start_time = 0;
 
-// Ping callback
-static void ping_success(esp_ping_handle_t hdl, void *args)
-{
-    uint8_t ttl;
-    uint16_t seqno;
-    uint32_t elapsed_time, recv_len;
-    ip_addr_t target_addr;
-    esp_ping_get_profile(hdl, ESP_PING_PROF_SEQNO, &seqno, sizeof(seqno));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_TTL, &ttl, sizeof(ttl));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_IPADDR, &target_addr, sizeof(target_addr));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_SIZE, &recv_len, sizeof(recv_len));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsed_time, sizeof(elapsed_time));
-    ESP_LOGI(TAG, "✓ PING SUCCESS: %lu bytes from %s icmp_seq=%d ttl=%d time=%lu ms",
-             (unsigned long)recv_len, ipaddr_ntoa(&target_addr), seqno, ttl, (unsigned long)elapsed_time);
-    tcp_debug_printf("[PING] ✓ SUCCESS: %s %lums\r\n", ipaddr_ntoa(&target_addr), (unsigned long)elapsed_time);
-}
-
-static void ping_timeout(esp_ping_handle_t hdl, void *args)
-{
-    uint16_t seqno;
-    ip_addr_t target_addr;
-    esp_ping_get_profile(hdl, ESP_PING_PROF_SEQNO, &seqno, sizeof(seqno));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_IPADDR, &target_addr, sizeof(target_addr));
-    ESP_LOGW(TAG, "✗ PING TIMEOUT: From %s icmp_seq=%d", ipaddr_ntoa(&target_addr), seqno);
-    tcp_debug_printf("[PING] ✗ TIMEOUT: %s\r\n", ipaddr_ntoa(&target_addr));
-}
-
-static void ping_end(esp_ping_handle_t hdl, void *args)
-{
-    uint32_t transmitted, received, total_time_ms;
-    esp_ping_get_profile(hdl, ESP_PING_PROF_REQUEST, &transmitted, sizeof(transmitted));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_REPLY, &received, sizeof(received));
-    esp_ping_get_profile(hdl, ESP_PING_PROF_DURATION, &total_time_ms, sizeof(total_time_ms));
-    ESP_LOGI(TAG, "PING complete: %lu/%lu packets, %lu%% loss",
-             (unsigned long)received, (unsigned long)transmitted, (unsigned long)(((transmitted - received) * 100) / transmitted));
-    esp_ping_delete_session(hdl);
-}
-
-static void test_internet_connectivity(void)
-{
-    ESP_LOGI(TAG, "Testing internet connectivity - pinging 8.8.8.8...");
-    tcp_debug_printf("[TEST] Pinging 8.8.8.8...\r\n");
-
-    esp_ping_config_t ping_config = ESP_PING_DEFAULT_CONFIG();
-    ping_config.target_addr.u_addr.ip4.addr = ipaddr_addr("8.8.8.8");
-    ping_config.target_addr.type = IPADDR_TYPE_V4;
-    ping_config.count = 3;
-    ping_config.interval_ms = 1000;
-    ping_config.timeout_ms = 2000;
-
-    esp_ping_callbacks_t cbs = {
-        .on_ping_success = ping_success,
-        .on_ping_timeout = ping_timeout,
-        .on_ping_end = ping_end,
-        .cb_args = NULL
-    };
-
-    esp_ping_handle_t ping;
-    esp_ping_new_session(&ping_config, &cbs, &ping);
-    esp_ping_start(ping);
-}
-
 // Diagnostic monitoring task
 static void diagnostics_task(void *pvParameters)
 {
@@ -149,6 +97,32 @@ static void diagnostics_task(void *pvParameters)
                         total_clients_connected,
                         (unsigned long)uptime_min);
 
+        // Deferred event work: worst start latency per priority, and anything dropped
+        event_worker_stats_t link_stats, client_work_stats, feedback_stats;
+        event_worker_get_stats(EVENT_PRIO_LINK, &link_stats);
+        event_worker_get_stats(EVENT_PRIO_CLIENT, &client_work_stats);
+        event_worker_get_stats(EVENT_PRIO_FEEDBACK, &feedback_stats);
+        ESP_LOGI(TAG, "[DIAG] Event worker wait max: link %lums, client %lums, feedback %lums | dropped: %lu, inline: %lu",
+                 (unsigned long)(link_stats.max_wait_us / 1000),
+                 (unsigned long)(client_work_stats.max_wait_us / 1000),
+                 (unsigned long)(feedback_stats.max_wait_us / 1000),
+                 (unsigned long)(link_stats.dropped + client_work_stats.dropped + feedback_stats.dropped),
+                 (unsigned long)(link_stats.ran_inline + client_work_stats.ran_inline));
+
+        // Push analytics counters to the UI
+        visitor_log_stats_t vstats;
+        visitor_log_get_stats(&vstats);
+        portal_ui_set_visitors(vstats.unique_visitors);
+
+        // What the clients pulled through the uplink rates the saved network
+        static client_stats_t stats[CLIENT_STATS_MAX_TRACKED];
+        size_t stat_count = client_stats_snapshot(stats, CLIENT_STATS_MAX_TRACKED);
+        uint64_t total_rate = 0;
+        for (size_t i = 0; i < stat_count; i++) {
+            total_rate += (uint64_t)stats[i].up_rate + stats[i].down_rate;
+        }
+        wifi_sta_report_throughput((uint32_t)(total_rate * 8 / 1000));
+
         // Check for memory leak (heap dropping consistently)
         if (free_heap < 50000) {
             ESP_LOGW(TAG, "[DIAG] ⚠️  LOW MEMORY: %lu bytes free!", (unsigned long)free_heap);
@@ -162,7 +136,6 @@ static void diagnostics_task(void *pvParameters)
 #define AP_SSID_PORTAL "Laboratory"
 #define AP_SSID_SETUP "labPORTAL Wifi Setup"
 #define AP_PASS ""  // Open network
-#define AP_CHANNEL 1
 #define AP_MAX_CONN 10  // Hardware limit
 
 // Function to start AP with DNS and HTTP services
@@ -176,12 +149,16 @@ void start_ap(const char *ssid, bool is_setup_mode)
     // Set global setup mode flag for HTTP server
     setup_mode = is_setup_mode;
 
+    // Uplink's channel if STA is associated, otherwise the least contended one.
+    // Planned while still STA-only so the scan can't knock AP clients off
+    uint8_t channel = channel_plan_select();
+
     // Configure AP with SSID
     wifi_config_t wifi_ap_config = {
         .ap = {
             .ssid = "",
             .ssid_len = 0,
-            .channel = AP_CHANNEL,
+            .channel = channel,
             .password = AP_PASS,
             .max_connection = AP_MAX_CONN,
             .authmode = WIFI_AUTH_OPEN
@@ -217,7 +194,7 @@ void start_ap(const char *ssid, bool is_setup_mode)
         }
     }
 
-    ESP_LOGI(TAG, "✓ AP active: %s", ssid);
+    ESP_LOGI(TAG, "✓ AP active: %s on channel %d", ssid, channel);
     ESP_LOGI(TAG, "✓ Serving %s portal at http://192.168.4.1", is_setup_mode ? "SETUP" : "LABORATORY");
 }
 
@@ -252,82 +229,155 @@ bool is_wifi_connected(void)
     return wifi_connected;
 }
 
+// Deferred halves of wifi_event_handler - run on the event worker so the
+// default event loop never sleeps or sends on sockets
+
+static void start_tcp_debug(const void *arg, size_t len)
+{
+    tcp_debug_init();   // Once; later calls return straight away
+}
+
+static void uplink_lost(const void *arg, size_t len)
+{
+    // wifi_sta schedules the reconnect (cached BSSID first, then backoff)
+    const wifi_event_sta_disconnected_t *event = arg;
+    uplink_monitor_set_link(false);
+    mdns_responder_set_address(0);
+    fleet_sync_set_address(0);
+    ESP_LOGI(TAG, "Disconnected from AP (reason %d)", event->reason);
+    tcp_debug_printf("[WIFI] STA disconnected, reason %d\r\n", event->reason);
+}
+
+static void ap_started(const void *arg, size_t len)
+{
+    // lwIP rebuilds the AP netif on every start - re-tap the forward path
+    ap_forward_attach(g_ap_netif);
+}
+
+static void station_joined(const void *arg, size_t len)
+{
+    const wifi_event_ap_staconnected_t *event = arg;
+    total_clients_connected++;  // Track total client connections
+    ESP_LOGI(TAG, "Client connected to AP - MAC: %02x:%02x:%02x:%02x:%02x:%02x (total: %d)",
+             event->mac[0], event->mac[1], event->mac[2],
+             event->mac[3], event->mac[4], event->mac[5],
+             total_clients_connected);
+    tcp_debug_printf("[AP] Client connected: %02x:%02x:%02x:%02x:%02x:%02x (total: %d)\r\n",
+             event->mac[0], event->mac[1], event->mac[2],
+             event->mac[3], event->mac[4], event->mac[5],
+             total_clients_connected);
+    client_table_station_joined(event->mac);
+    fleet_sync_station_joined(event->mac);   // Approved on a peer stick - before admission looks
+    dhcp_leases_station_joined(event->mac);
+    visitor_log_station_joined(event->mac);
+    admission_station_joined();
+}
+
+static void station_left(const void *arg, size_t len)
+{
+    const wifi_event_ap_stadisconnected_t *event = arg;
+    ESP_LOGI(TAG, "Client disconnected from AP - MAC: %02x:%02x:%02x:%02x:%02x:%02x",
+             event->mac[0], event->mac[1], event->mac[2],
+             event->mac[3], event->mac[4], event->mac[5]);
+    tcp_debug_printf("[AP] Client disconnected: %02x:%02x:%02x:%02x:%02x:%02x\r\n",
+             event->mac[0], event->mac[1], event->mac[2],
+             event->mac[3], event->mac[4], event->mac[5]);
+    client_table_station_left(event->mac);
+    dhcp_leases_station_left(event->mac);   // May restart dhcps with a pending lease policy
+    visitor_log_station_left(event->mac);
+}
+
+static void station_got_ip(const void *arg, size_t len)
+{
+    const ip_event_ap_staipassigned_t *event = arg;
+    ESP_LOGI(TAG, "Client assigned IP: " IPSTR, IP2STR(&event->ip));
+    dhcp_leases_assigned(event->mac, event->ip.addr);
+    client_table_station_ip(event->mac, event->ip.addr);
+    visitor_log_station_ip(event->mac, event->ip.addr);
+}
+
+// Queued 500 ms after GOT_IP so the AP can settle; the uplink may have
+// dropped or the AP been stopped in the meantime
+static void enable_nat(const void *arg, size_t len)
+{
+    const esp_netif_ip_info_t *ip_info = arg;
+    wifi_mode_t current_mode;
+    if (!wifi_connected || esp_wifi_get_mode(&current_mode) != ESP_OK || current_mode != WIFI_MODE_APSTA) {
+        ESP_LOGW(TAG, "Uplink or AP went away before NAT could be enabled");
+        return;
+    }
+
+    esp_err_t err = esp_netif_napt_enable(g_ap_netif);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "✓ NAT ENABLED on AP netif (192.168.4.1)");
+        ESP_LOGI(TAG, "✓ IP Forwarding: AP clients (192.168.4.x) -> masquerade as STA (" IPSTR ")", IP2STR(&ip_info->ip));
+        tcp_debug_printf("[NAT] ✓ ENABLED: 192.168.4.x -> " IPSTR "\r\n", IP2STR(&ip_info->ip));
+    } else {
+        ESP_LOGE(TAG, "✗ NAT ENABLE FAILED: %s", esp_err_to_name(err));
+        tcp_debug_printf("[NAT] ✗ ENABLE FAILED: %s\r\n", esp_err_to_name(err));
+    }
+}
+
+static void uplink_up(const void *arg, size_t len)
+{
+    const esp_netif_ip_info_t *ip_info = arg;
+    ESP_LOGI(TAG, "STA Got IP:" IPSTR, IP2STR(&ip_info->ip));
+    ESP_LOGI(TAG, "Gateway: " IPSTR, IP2STR(&ip_info->gw));
+    ESP_LOGI(TAG, "Netmask: " IPSTR, IP2STR(&ip_info->netmask));
+    tcp_debug_printf("[NAT] STA got IP: " IPSTR "\r\n", IP2STR(&ip_info->ip));
+
+    // One radio: a running AP has just moved to the uplink's channel
+    channel_plan_follow_uplink();
+
+    // Check if AP is already running (user manually started a portal)
+    wifi_mode_t current_mode;
+    esp_wifi_get_mode(&current_mode);
+    if (current_mode == WIFI_MODE_APSTA) {
+        // ENABLE NAT - Masquerade AP subnet through STA interface
+        ESP_LOGI(TAG, "AP already running - enabling NAT");
+        if (event_worker_post(EVENT_PRIO_LINK, enable_nat, ip_info, sizeof(*ip_info), 500) != ESP_OK) {
+            enable_nat(ip_info, sizeof(*ip_info));   // Link queue full - skip the settle delay
+        }
+        // Keep captive portal enabled - already set when user started the portal
+    } else {
+        ESP_LOGI(TAG, "✓ WiFi connected - Launch Laboratory from menu to share internet");
+    }
+
+    // Continuous ping/DNS/TCP probing of the uplink (first round right away)
+    uplink_monitor_set_link(true);
+
+    // labportal-xxxx.local and its portal/debug services on the venue network
+    mdns_responder_set_address(ip_info->ip.addr);
+    fleet_sync_set_address(ip_info->ip.addr);
+
+    // Start TCP debug server after we have IP
+    event_worker_post_or_run(EVENT_PRIO_CLIENT, start_tcp_debug, NULL, 0);
+}
+
+// Runs on the default event loop: note the link flag, copy the payload and
+// queue the real work. Link changes go ahead of station bookkeeping, which
+// is never dropped (run inline if its queue is full). The fanfare plays on
+// the sound task so it never holds up the worker
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         wifi_connected = false;
-        if (wifi_retry_count < WIFI_MAX_RETRY) {
-            wifi_retry_count++;
-            ESP_LOGI(TAG, "Disconnected from AP, retry %d/%d...", wifi_retry_count, WIFI_MAX_RETRY);
-            tcp_debug_printf("[WIFI] STA disconnected, retry %d/%d...\r\n", wifi_retry_count, WIFI_MAX_RETRY);
-            esp_wifi_connect();
-        } else {
-            ESP_LOGW(TAG, "WiFi connection failed after %d attempts - use Portal > Join WiFi to configure", WIFI_MAX_RETRY);
-            tcp_debug_printf("[WIFI] Connection failed after %d attempts\r\n", WIFI_MAX_RETRY);
-        }
+        event_worker_post_or_run(EVENT_PRIO_LINK, uplink_lost, event_data, sizeof(wifi_event_sta_disconnected_t));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
+        event_worker_post_or_run(EVENT_PRIO_LINK, ap_started, NULL, 0);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
-        wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
-        total_clients_connected++;  // Track total client connections
-        ESP_LOGI(TAG, "Client connected to AP - MAC: %02x:%02x:%02x:%02x:%02x:%02x (total: %d)",
-                 event->mac[0], event->mac[1], event->mac[2],
-                 event->mac[3], event->mac[4], event->mac[5],
-                 total_clients_connected);
-        tcp_debug_printf("[AP] Client connected: %02x:%02x:%02x:%02x:%02x:%02x (total: %d)\r\n",
-                 event->mac[0], event->mac[1], event->mac[2],
-                 event->mac[3], event->mac[4], event->mac[5],
-                 total_clients_connected);
-        sound_system_play(SOUND_CONNECT);  // Triumphant fanfare for client connection!
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_joined, event_data, sizeof(wifi_event_ap_staconnected_t));
+        sound_system_play_async(SOUND_CONNECT);  // Triumphant fanfare!
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
-        wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
-        ESP_LOGI(TAG, "Client disconnected from AP - MAC: %02x:%02x:%02x:%02x:%02x:%02x",
-                 event->mac[0], event->mac[1], event->mac[2],
-                 event->mac[3], event->mac[4], event->mac[5]);
-        tcp_debug_printf("[AP] Client disconnected: %02x:%02x:%02x:%02x:%02x:%02x\r\n",
-                 event->mac[0], event->mac[1], event->mac[2],
-                 event->mac[3], event->mac[4], event->mac[5]);
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_left, event_data, sizeof(wifi_event_ap_stadisconnected_t));
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        event_worker_post_or_run(EVENT_PRIO_CLIENT, station_got_ip, event_data, sizeof(ip_event_ap_staipassigned_t));
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "STA Got IP:" IPSTR, IP2STR(&event->ip_info.ip));
-        ESP_LOGI(TAG, "Gateway: " IPSTR, IP2STR(&event->ip_info.gw));
-        ESP_LOGI(TAG, "Netmask: " IPSTR, IP2STR(&event->ip_info.netmask));
-        tcp_debug_printf("[NAT] STA got IP: " IPSTR "\r\n", IP2STR(&event->ip_info.ip));
         wifi_connected = true;
-        wifi_retry_count = 0;  // Reset retry counter on successful connection
-        sound_system_play(SOUND_CONNECT);  // Triumphant fanfare for WiFi connection!
-
-        // Check if AP is already running (user manually started a portal)
-        wifi_mode_t current_mode;
-        esp_wifi_get_mode(&current_mode);
-        if (current_mode == WIFI_MODE_APSTA) {
-            // ENABLE NAT - Masquerade AP subnet through STA interface
-            ESP_LOGI(TAG, "AP already running - enabling NAT");
-
-            vTaskDelay(pdMS_TO_TICKS(500));  // Wait for AP to stabilize
-
-            esp_err_t err = esp_netif_napt_enable(g_ap_netif);
-            if (err == ESP_OK) {
-                ESP_LOGI(TAG, "✓ NAT ENABLED on AP netif (192.168.4.1)");
-                ESP_LOGI(TAG, "✓ IP Forwarding: AP clients (192.168.4.x) -> masquerade as STA (" IPSTR ")", IP2STR(&event->ip_info.ip));
-                tcp_debug_printf("[NAT] ✓ ENABLED: 192.168.4.x -> " IPSTR "\r\n", IP2STR(&event->ip_info.ip));
-            } else {
-                ESP_LOGE(TAG, "✗ NAT ENABLE FAILED: %s", esp_err_to_name(err));
-                tcp_debug_printf("[NAT] ✗ ENABLE FAILED: %s\r\n", esp_err_to_name(err));
-            }
-
-            // Keep captive portal enabled - already set when user started the portal
-        } else {
-            ESP_LOGI(TAG, "✓ WiFi connected - Launch Laboratory from menu to share internet");
-        }
-
-        // Test internet connectivity from ESP32 itself
-        vTaskDelay(pdMS_TO_TICKS(2000));  // Wait 2s for routing to settle
-        test_internet_connectivity();
-
-        // Start TCP debug server after we have IP
-        tcp_debug_init();
+        event_worker_post_or_run(EVENT_PRIO_LINK, uplink_up, &event->ip_info, sizeof(event->ip_info));
+        sound_system_play_async(SOUND_CONNECT);  // Triumphant fanfare!
     }
 }
 
@@ -349,6 +399,12 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    // Visitor analytics log (dedicated flash partition, batched writes)
+    visitor_log_init();
+
+    // Station MAC -> lease/approval table, fed by the AP events below
+    client_table_init();
+
     /*  HARDWARE TEST - DISABLED (use when needed)
     run_hardware_tests();
     return;
@@ -379,42 +435,45 @@ void app_main(void)
 
     ESP_LOGI(TAG, "✓ DHCP DNS configured to offer 192.168.4.1 (our DNS proxy)");
 
+    // Lease time and pool size from NVS, while the server is still stopped
+    dhcp_leases_init(g_ap_netif);
+
     esp_netif_dhcps_start(g_ap_netif);
 
+    // Per-client packet/byte counters and bandwidth limits for everything forwarded through the AP
+    client_stats_init(ip_info.ip.addr & ip_info.netmask.addr);
+    shaper_init();
+    mss_clamp_init();   // Fits TCP flows to the uplink MTU
+    napt_monitor_init();   // Occupancy of the NAPT table, from a shadow copy
+    uplink_monitor_init();
+    bench_server_init();   // Listens on 5201 whenever a network is up
+    mdns_responder_init();   // Answers once the STA has an address
+    fleet_sync_init(AP_MAX_CONN);   // Off until a key is set and it is enabled
+    channel_plan_init();
+    admission_init(AP_MAX_CONN);   // Keeps a slot free by disconnecting idle stations
+
+    // Slow follow-up to Wi-Fi/IP events (NAT, logs, sounds) runs here, not on the event loop
+    ESP_ERROR_CHECK(event_worker_init());
+
     // WiFi init
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &wifi_event_handler, NULL));
 
-    // Configure STA mode - load from NVS only (no hardcoded fallback)
-    wifi_config_t wifi_sta_config = {0};
-
-    // Try to load saved WiFi credentials from NVS
-    nvs_handle_t nvs;
-    if (nvs_open("storage", NVS_READONLY, &nvs) == ESP_OK) {
-        size_t ssid_len = sizeof(wifi_sta_config.sta.ssid);
-        size_t pass_len = sizeof(wifi_sta_config.sta.password);
+    // Start in STA-only mode - AP will only be started when user activates it from menu
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
 
-        if (nvs_get_str(nvs, "wifi_ssid", (char*)wifi_sta_config.sta.ssid, &ssid_len) == ESP_OK &&
-            nvs_get_str(nvs, "wifi_pass", (char*)wifi_sta_config.sta.password, &pass_len) == ESP_OK) {
-            ESP_LOGI(TAG, "✓ Loaded saved network from NVS: %s", wifi_sta_config.sta.ssid);
-            setup_mode = false;
-        } else {
-            ESP_LOGI(TAG, "No saved networks - device must connect via Portal UI");
-            setup_mode = true;
-        }
-        nvs_close(nvs);
+    // Saved network plus its cached BSSID/channel - wifi_sta drives STA connects from here
+    if (wifi_sta_init() == ESP_OK) {
+        setup_mode = false;
     } else {
-        ESP_LOGI(TAG, "NVS not available - device must connect via Portal UI");
+        ESP_LOGI(TAG, "No saved networks - device must connect via Portal UI");
         setup_mode = true;
     }
 
-    // Start in STA-only mode - AP will only be started when user activates it from menu
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_sta_config));
-
     // Disable WiFi power management to prevent sleep/cutoff on battery
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
     ESP_LOGI(TAG, "WiFi power management DISABLED (always on)");
@@ -422,8 +481,7 @@ void app_main(void)
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "WiFi started in STA-only mode");
-    ESP_LOGI(TAG, "Searching for network: %s",
-             strlen((char*)wifi_sta_config.sta.ssid) > 0 ? (char*)wifi_sta_config.sta.ssid : "[NONE]");
+    ESP_LOGI(TAG, "Searching for network: %s", setup_mode ? "[NONE]" : get_wifi_ssid());
     ESP_LOGI(TAG, "AP disabled on boot - use Portal UI to start if needed");
 
     // DNS server and captive portal are NOT started on boot